@@ -3,9 +3,13 @@
 //
 // アセット読み込み
 //  OSX版のみDEBUGビルドで特殊なパスから読み込むようにしている
+//  NGS_PACKED_ASSETS が有効なら、まとめたファイル(assets.pack)から先に探す
 //
 
 #include "Path.hpp"
+#if defined (NGS_PACKED_ASSETS)
+#include "PackedArchive.hpp"
+#endif
 
 
 namespace ngs { namespace Asset {
@@ -15,8 +19,45 @@ ci::DataSourceRef load(const std::string& path);
 
 #if defined (NGS_ASSET_IMPLEMENTATION)
 
+#if defined (NGS_PACKED_ASSETS)
+
+// TIPS 最初に使う時に開いて、アプリ終了まで開きっぱなし
+const PackedArchive& packedAssets() noexcept
+{
+  static PackedArchive archive(getAssetPath("assets.pack").string());
+  return archive;
+}
+
+#endif
+
 ci::DataSourceRef load(const std::string& path)
 {
+#if defined (NGS_PACKED_ASSETS)
+  PackedArchive::Entry entry;
+  if (packedAssets().find(path, entry))
+  {
+    if (entry.compression == PackedArchive::Compression::NONE)
+    {
+      if (PackedArchive::verify(entry))
+      {
+        // TIPS 割り当てたメモリをそのまま渡す(ci::Bufferは解放しない)
+        auto buffer = ci::Buffer::create(const_cast<char*>(entry.data.begin()), entry.data.size());
+        return ci::DataSourceBuffer::create(buffer, path);
+      }
+    }
+    else
+    {
+      auto buffer = ci::Buffer::create(size_t(entry.size));
+      if (PackedArchive::extract(entry, buffer->getData()))
+      {
+        return ci::DataSourceBuffer::create(buffer, path);
+      }
+    }
+    // NOTICE 壊れていたら個別のファイルを読む
+    DOUT << "Broken packed asset: " << path << std::endl;
+  }
+#endif
+
   return ci::loadFile(getAssetPath(path));
 }
 
@@ -0,0 +1,266 @@
+﻿#pragma once
+
+//
+// 起動時の読み込みを並列に行う仕組み
+//   ファイルの読み込みや解析はワーカー(ThreadPool)で、GPUへの転送などはメインスレッドで行う
+//   仕事には依存関係を付けられて、依存する仕事が全て終わると実行される
+//   いつ・どのスレッドで・何をしていたかを記録して表示できる
+//   Cinderに依存しないので、ツール(tools/bench_loader.cpp)からも使う
+//
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <cassert>
+#include "ThreadPool.hpp"
+
+
+namespace ngs {
+
+class AssetLoader
+{
+public:
+  using JobId = uint32_t;
+  using Work  = std::function<void ()>;
+
+  AssetLoader(unsigned int threads = std::thread::hardware_concurrency()) noexcept
+    : pool_(threads)
+  {
+  }
+
+  AssetLoader(const AssetLoader&) = delete;
+  AssetLoader& operator=(const AssetLoader&) = delete;
+
+
+  // ワーカーで行う仕事を追加
+  // NOTICE 依存する仕事は先に追加しておく事(循環しない)
+  JobId add(const std::string& name, const Work& work, const std::vector<JobId>& depends = {}) noexcept
+  {
+    return append(name, work, false, depends);
+  }
+
+  // メインスレッドで行う仕事を追加(GPUへの転送など)
+  JobId addMain(const std::string& name, const Work& work, const std::vector<JobId>& depends = {}) noexcept
+  {
+    return append(name, work, true, depends);
+  }
+
+
+  // 全ての仕事を実行する
+  // メインスレッドの仕事をこなしながら、全て終わるまで待つ
+  // TIPS 仕事が例外を投げたら記録だけして続ける(依存する仕事も実行する)
+  void run() noexcept
+  {
+    start_ = Clock::now();
+    remaining_ = jobs_.size();
+
+    // NOTICE 先に全て集めてから実行する
+    //        実行を始めるとワーカーが waiting を書き換える(同じ仕事を２回実行してしまう)
+    std::vector<JobId> ready;
+    for (JobId id = 0; id < jobs_.size(); ++id)
+    {
+      if (jobs_[id].waiting == 0) ready.push_back(id);
+    }
+    for (auto id : ready) dispatch(id);
+
+    while (true)
+    {
+      JobId id;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [this]() { return !main_queue_.empty() || (remaining_ == 0); });
+        if (main_queue_.empty()) break;
+
+        id = main_queue_.front();
+        main_queue_.pop_front();
+      }
+      execute(id, MAIN_THREAD);
+    }
+    total_ = elapsed();
+  }
+
+
+  size_t size() const noexcept
+  {
+    return jobs_.size();
+  }
+
+  unsigned int threads() const noexcept
+  {
+    return pool_.size();
+  }
+
+  // 例外を投げた仕事の数
+  size_t failed() const noexcept
+  {
+    return size_t(std::count_if(jobs_.begin(), jobs_.end(), [](const Job& job) { return job.failed; }));
+  }
+
+  // run() にかかった時間(秒)
+  double total() const noexcept
+  {
+    return total_;
+  }
+
+  // 全ての仕事にかかった時間の合計(秒)
+  double work() const noexcept
+  {
+    double sum = 0.0;
+    for (const auto& job : jobs_) sum += job.end - job.begin;
+    return sum;
+  }
+
+  // 経過の表示
+  //   開始 終了(ms) スレッド 仕事の名前 と、時間の流れを図にしたもの
+  void report(std::ostream& ostr, int width = 40) const
+  {
+    std::vector<JobId> order(jobs_.size());
+    for (JobId id = 0; id < jobs_.size(); ++id) order[id] = id;
+    std::stable_sort(order.begin(), order.end(),
+                     [this](JobId a, JobId b) { return jobs_[a].begin < jobs_[b].begin; });
+
+    auto flags = ostr.flags();
+    auto precision = ostr.precision();
+    ostr << std::fixed << std::setprecision(2)
+         << "startup timeline: " << (total_ * 1e3) << "ms"
+         << " (work " << (work() * 1e3) << "ms, " << threads() << " threads)" << std::endl;
+
+    double scale = (total_ > 0.0) ? (width / total_) : 0.0;
+    for (auto id : order)
+    {
+      const auto& job = jobs_[id];
+      int from = std::min(int(job.begin * scale), width - 1);
+      int to   = std::max(std::min(int(job.end * scale), width), from + 1);
+
+      std::string bar(width, ' ');
+      std::fill(bar.begin() + from, bar.begin() + to, job.main ? '=' : '#');
+
+      ostr << std::setw(9) << (job.begin * 1e3)
+           << std::setw(9) << (job.end * 1e3)
+           << "  " << std::left << std::setw(6)
+           << ((job.thread == MAIN_THREAD) ? std::string("main") : std::to_string(job.thread))
+           << std::right
+           << " |" << bar << "| "
+           << job.name << (job.failed ? " (failed)" : "")
+           << std::endl;
+    }
+
+    ostr.flags(flags);
+    ostr.precision(precision);
+  }
+
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  enum
+  {
+    MAIN_THREAD = -1,
+  };
+
+  struct Job
+  {
+    std::string name;
+    Work work;
+    bool main;
+    // 終わっていない依存する仕事の数
+    uint32_t waiting;
+    // この仕事に依存している仕事
+    std::vector<JobId> dependents;
+
+    // 記録(run() を始めてからの秒数)
+    double begin;
+    double end;
+    int thread;
+    bool failed;
+  };
+
+  std::vector<Job> jobs_;
+
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<JobId> main_queue_;
+  size_t remaining_ = 0;
+
+  Clock::time_point start_;
+  double total_ = 0.0;
+
+  // NOTICE 最後に宣言して最初に破棄する(ワーカーが他のメンバーを使い終えるのを待つ)
+  ThreadPool pool_;
+
+
+  JobId append(const std::string& name, const Work& work, bool main, const std::vector<JobId>& depends) noexcept
+  {
+    auto id = JobId(jobs_.size());
+    jobs_.push_back({ name, work, main, uint32_t(depends.size()), {}, 0.0, 0.0, MAIN_THREAD, false });
+    for (auto depend : depends)
+    {
+      assert(depend < id);
+      jobs_[depend].dependents.push_back(id);
+    }
+    return id;
+  }
+
+  double elapsed() const noexcept
+  {
+    return std::chrono::duration<double>(Clock::now() - start_).count();
+  }
+
+
+  void dispatch(JobId id) noexcept
+  {
+    if (jobs_[id].main)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        main_queue_.push_back(id);
+      }
+      ready_.notify_all();
+      return;
+    }
+
+    pool_.push([this, id](unsigned int worker)
+               {
+                 execute(id, int(worker));
+               });
+  }
+
+  void execute(JobId id, int thread) noexcept
+  {
+    auto& job = jobs_[id];
+    job.thread = thread;
+    job.begin  = elapsed();
+    try
+    {
+      job.work();
+    }
+    catch (...)
+    {
+      job.failed = true;
+    }
+    job.end = elapsed();
+
+    // 依存する仕事が全て終わったものを実行する
+    std::vector<JobId> ready;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto dependent : job.dependents)
+      {
+        if (--jobs_[dependent].waiting == 0) ready.push_back(dependent);
+      }
+      remaining_ -= 1;
+      if (remaining_ == 0) ready_.notify_all();
+    }
+    for (auto dependent : ready) dispatch(dependent);
+  }
+
+};
+
+}
@@ -42,6 +42,9 @@ static id observer = nullptr;
 
 void begin() noexcept
 {
+  // TIPS 起動時の読み込み(Sound::preload)とSoundのコンストラクタの両方から呼ばれる
+  if (observer) return;
+
   // AVFoundationのインスタンス
   AVAudioSession* audioSession = [AVAudioSession sharedInstance];
 
@@ -0,0 +1,313 @@
+﻿#pragma once
+
+//
+// 焼き込み済みのメッシュ(.bmesh)
+//   頂点はまとめ済み・インターリーブ済み・量子化済みで、ファイルの中身をそのままVBOへ転送できる
+//   [Header][Vertex × vertex_num][頂点番号 × index_num]
+//   Vertex(16バイト)
+//     position: half float × 4 (w = 1)
+//     normal:   GL_INT_2_10_10_10_REV (正規化して読む)
+//     color:    RGBA8 (正規化して読む)
+//   頂点番号は頂点数が65536以下なら16bit、それ以外は32bit
+//   Cinderに依存しないので、ツール(tools/bake_mesh.cpp)からも使う
+//
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+
+namespace ngs { namespace BakedMesh {
+
+enum
+{
+  VERSION = 1,
+  // 頂点と頂点番号の先頭の境界
+  ALIGNMENT = 16,
+};
+
+struct Header
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t vertex_num;
+  uint32_t index_num;
+  // 頂点番号のバイト数(2 or 4)
+  uint32_t index_size;
+  // 頂点のバイト数
+  uint32_t stride;
+  uint32_t vertex_offset;
+  uint32_t index_offset;
+  float bounds_min[3];
+  float bounds_max[3];
+  uint32_t reserved[2];
+};
+
+struct Vertex
+{
+  uint16_t position[4];
+  uint32_t normal;
+  uint8_t color[4];
+};
+
+static_assert(sizeof(Header) == 64, "Unexpected header size.");
+static_assert(sizeof(Vertex) == 16, "Unexpected vertex size.");
+
+const char MAGIC[] = { 'P', 'M', 'B', 'M' };
+
+
+// float → half float(最近接偶数丸め)
+uint16_t toHalf(float value) noexcept
+{
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  uint32_t sign = (bits >> 16) & 0x8000;
+  int32_t  exp  = int32_t((bits >> 23) & 0xff) - 127 + 15;
+  uint32_t mant = bits & 0x7fffff;
+
+  if (((bits >> 23) & 0xff) == 0xff)
+  {
+    // 無限大とNaN
+    return uint16_t(sign | 0x7c00 | (mant ? 0x200 : 0));
+  }
+  if (exp >= 0x1f)
+  {
+    // 大きすぎる値は無限大
+    return uint16_t(sign | 0x7c00);
+  }
+  if (exp <= 0)
+  {
+    // 非正規化数(小さすぎる値は0)
+    if (exp < -10) return uint16_t(sign);
+    mant |= 0x800000;
+    uint32_t shift = uint32_t(14 - exp);
+    uint32_t half  = mant >> shift;
+    uint32_t rest  = mant & ((1u << shift) - 1);
+    uint32_t round = 1u << (shift - 1);
+    if ((rest > round) || ((rest == round) && (half & 1))) half += 1;
+    return uint16_t(sign | half);
+  }
+
+  uint32_t half = sign | (uint32_t(exp) << 10) | (mant >> 13);
+  uint32_t rest = mant & 0x1fff;
+  // TIPS 繰り上がりで指数が増えても正しい値になる
+  if ((rest > 0x1000) || ((rest == 0x1000) && (half & 1))) half += 1;
+  return uint16_t(half);
+}
+
+float fromHalf(uint16_t value) noexcept
+{
+  uint32_t sign = uint32_t(value & 0x8000) << 16;
+  uint32_t exp  = (value >> 10) & 0x1f;
+  uint32_t mant = value & 0x3ff;
+
+  uint32_t bits;
+  if (exp == 0)
+  {
+    if (mant == 0)
+    {
+      bits = sign;
+    }
+    else
+    {
+      // 非正規化数
+      exp = 127 - 15 + 1;
+      while (!(mant & 0x400))
+      {
+        mant <<= 1;
+        exp -= 1;
+      }
+      bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+  }
+  else if (exp == 0x1f)
+  {
+    bits = sign | 0x7f800000 | (mant << 13);
+  }
+  else
+  {
+    bits = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+  }
+
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+
+// 法線(-1〜1)を10bitずつ詰める
+uint32_t packNormal(const float* normal) noexcept
+{
+  uint32_t packed = 0;
+  for (int i = 0; i < 3; ++i)
+  {
+    float v = std::isnan(normal[i]) ? 0.0f : std::min(std::max(normal[i], -1.0f), 1.0f);
+    auto snorm = int32_t(std::lround(v * 511.0f));
+    packed |= (uint32_t(snorm) & 0x3ff) << (i * 10);
+  }
+  return packed;
+}
+
+// TIPS OpenGL ES 3.0 と同じく -512 は -1 として扱う
+void unpackNormal(uint32_t packed, float* normal) noexcept
+{
+  for (int i = 0; i < 3; ++i)
+  {
+    auto snorm = int32_t(packed << (22 - i * 10)) >> 22;
+    normal[i] = std::max(float(snorm) / 511.0f, -1.0f);
+  }
+}
+
+uint8_t packColor(float value) noexcept
+{
+  float v = std::isnan(value) ? 0.0f : std::min(std::max(value, 0.0f), 1.0f);
+  return uint8_t(std::lround(v * 255.0f));
+}
+
+
+size_t alignOffset(size_t offset) noexcept
+{
+  return (offset + ALIGNMENT - 1) & ~size_t(ALIGNMENT - 1);
+}
+
+// 焼き込んだファイルの名前
+// TIPS .plyは拡張子を置き換え、それ以外(.obj)は後ろに付ける
+//      (blank.ply と blank.obj が同じ名前にならない)
+std::string bakedPath(const std::string& path)
+{
+  const std::string ply = ".ply";
+  if ((path.size() > ply.size()) && (path.compare(path.size() - ply.size(), ply.size(), ply) == 0))
+  {
+    return path.substr(0, path.size() - ply.size()) + ".bmesh";
+  }
+  return path + ".bmesh";
+}
+
+
+// i番目の頂点番号
+// TIPS ファイルの中身は16bitの事がある。境界に揃っているとは限らないのでコピーして読む
+uint32_t readIndex(const void* data, const Header& header, uint32_t i) noexcept
+{
+  const auto* p = static_cast<const uint8_t*>(data) + header.index_offset;
+  if (header.index_size == 2)
+  {
+    uint16_t index;
+    std::memcpy(&index, p + size_t(i) * 2, sizeof(index));
+    return index;
+  }
+
+  uint32_t index;
+  std::memcpy(&index, p + size_t(i) * 4, sizeof(index));
+  return index;
+}
+
+// 中身を調べてヘッダを取り出す
+// 壊れていたらfalse
+// NOTICE 頂点番号も全て調べる(範囲外のまま描画するとGPUが範囲外を読む)
+bool validate(const void* data, size_t size, Header& header) noexcept
+{
+  if (size < sizeof(Header)) return false;
+  std::memcpy(&header, data, sizeof(Header));
+
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) return false;
+  if (header.version != VERSION) return false;
+  if (header.stride != sizeof(Vertex)) return false;
+  if ((header.index_size != 2) && (header.index_size != 4)) return false;
+  if ((header.index_size == 2) && (header.vertex_num > 0x10000)) return false;
+  if ((header.index_num % 3) != 0) return false;
+
+  uint64_t vertex_end = uint64_t(header.vertex_offset) + uint64_t(header.vertex_num) * header.stride;
+  uint64_t index_end  = uint64_t(header.index_offset) + uint64_t(header.index_num) * header.index_size;
+  if ((header.vertex_offset < sizeof(Header)) || (vertex_end > size)) return false;
+  if ((header.index_offset < vertex_end) || (index_end > size)) return false;
+
+  for (uint32_t i = 0; i < header.index_num; ++i)
+  {
+    if (readIndex(data, header, i) >= header.vertex_num) return false;
+  }
+
+  return true;
+}
+
+// 頂点番号(index_num個)をコピーして取り出す
+void readIndices(const void* data, const Header& header, uint32_t* indices) noexcept
+{
+  for (uint32_t i = 0; i < header.index_num; ++i)
+  {
+    indices[i] = readIndex(data, header, i);
+  }
+}
+
+
+// 焼き込み
+//   positions/colors/normals: float 3つの並び(num個)
+//   indices: 三角形の頂点番号(index_num個)
+// 頂点はまとめ終わっているものとする
+// NOTICE 頂点番号は範囲内である事
+void write(const float* positions, const float* colors, const float* normals, uint32_t num,
+           const uint32_t* indices, uint32_t index_num, std::string& output)
+{
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version       = VERSION;
+  header.vertex_num    = num;
+  header.index_num     = index_num;
+  header.index_size    = (num <= 0x10000) ? 2 : 4;
+  header.stride        = sizeof(Vertex);
+  header.vertex_offset = uint32_t(alignOffset(sizeof(Header)));
+  header.index_offset  = uint32_t(alignOffset(header.vertex_offset + size_t(num) * sizeof(Vertex)));
+
+  const float inf = std::numeric_limits<float>::infinity();
+  for (int i = 0; i < 3; ++i)
+  {
+    header.bounds_min[i] = num ?  inf : 0.0f;
+    header.bounds_max[i] = num ? -inf : 0.0f;
+  }
+  for (uint32_t i = 0; i < num; ++i)
+  {
+    for (int j = 0; j < 3; ++j)
+    {
+      header.bounds_min[j] = std::min(header.bounds_min[j], positions[i * 3 + j]);
+      header.bounds_max[j] = std::max(header.bounds_max[j], positions[i * 3 + j]);
+    }
+  }
+
+  output.assign(header.index_offset + size_t(index_num) * header.index_size, '\0');
+  auto* data = &output[0];
+  std::memcpy(data, &header, sizeof(header));
+
+  for (uint32_t i = 0; i < num; ++i)
+  {
+    Vertex vertex;
+    for (int j = 0; j < 3; ++j)
+    {
+      vertex.position[j] = toHalf(positions[i * 3 + j]);
+      vertex.color[j]    = packColor(colors[i * 3 + j]);
+    }
+    vertex.position[3] = toHalf(1.0f);
+    vertex.normal      = packNormal(&normals[i * 3]);
+    vertex.color[3]    = 255;
+
+    std::memcpy(data + header.vertex_offset + i * sizeof(Vertex), &vertex, sizeof(Vertex));
+  }
+
+  for (uint32_t i = 0; i < index_num; ++i)
+  {
+    if (header.index_size == 2)
+    {
+      auto index = uint16_t(indices[i]);
+      std::memcpy(data + header.index_offset + i * 2, &index, sizeof(index));
+    }
+    else
+    {
+      std::memcpy(data + header.index_offset + i * 4, &indices[i], sizeof(uint32_t));
+    }
+  }
+}
+
+} }
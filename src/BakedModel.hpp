@@ -0,0 +1,113 @@
+﻿#pragma once
+
+//
+// 焼き込み済みのメッシュ(BakedMesh)の描画
+//   ファイルの中身をそのままVBOへ転送する(変換もコピーもしない)
+//   頂点の形式が ci::gl::VboMesh では扱えない(half float など)ので、VAOはシェーダーごとに自前で作る
+//
+
+#include <map>
+#include <cstddef>
+#include <boost/noncopyable.hpp>
+#include <cinder/AxisAlignedBox.h>
+#include <cinder/gl/Vao.h>
+#include <cinder/gl/Vbo.h>
+#include <cinder/gl/GlslProg.h>
+#include <cinder/gl/scoped.h>
+#include <cinder/gl/Context.h>
+#include "BakedMesh.hpp"
+
+
+namespace ngs {
+
+class BakedModel
+  : private boost::noncopyable
+{
+public:
+  // NOTICE 中身が壊れていたら nullptr
+  static std::shared_ptr<BakedModel> create(const void* data, size_t size)
+  {
+    BakedMesh::Header header;
+    if (!BakedMesh::validate(data, size, header)) return nullptr;
+
+    return std::make_shared<BakedModel>(header, static_cast<const uint8_t*>(data));
+  }
+
+  BakedModel(const BakedMesh::Header& header, const uint8_t* data)
+    : index_num_(header.index_num),
+      index_type_((header.index_size == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT),
+      bounds_(glm::vec3(header.bounds_min[0], header.bounds_min[1], header.bounds_min[2]),
+              glm::vec3(header.bounds_max[0], header.bounds_max[1], header.bounds_max[2]))
+  {
+    vertices_ = ci::gl::Vbo::create(GL_ARRAY_BUFFER, header.vertex_num * header.stride,
+                                    data + header.vertex_offset, GL_STATIC_DRAW);
+    indices_  = ci::gl::Vbo::create(GL_ELEMENT_ARRAY_BUFFER, header.index_num * header.index_size,
+                                    data + header.index_offset, GL_STATIC_DRAW);
+  }
+
+
+  const ci::AxisAlignedBox& getBounds() const noexcept
+  {
+    return bounds_;
+  }
+
+  // 描画
+  // TIPS 使用中のシェーダーで描画する(影の描画などで切り替えられる)
+  void draw() noexcept
+  {
+    const auto* shader = ci::gl::context()->getGlslProg();
+    if (!shader) return;
+
+    ci::gl::ScopedVao vao(getVao(shader));
+    ci::gl::setDefaultShaderVars();
+    ci::gl::drawElements(GL_TRIANGLES, GLsizei(index_num_), index_type_, nullptr);
+  }
+
+
+private:
+  uint32_t index_num_;
+  GLenum index_type_;
+  ci::AxisAlignedBox bounds_;
+
+  ci::gl::VboRef vertices_;
+  ci::gl::VboRef indices_;
+
+  // TIPS シェーダーごとに属性の場所が違う
+  std::map<const ci::gl::GlslProg*, ci::gl::VaoRef> vaos_;
+
+
+  const ci::gl::VaoRef& getVao(const ci::gl::GlslProg* shader) noexcept
+  {
+    auto it = vaos_.find(shader);
+    if (it != vaos_.end()) return it->second;
+
+    auto vao = ci::gl::Vao::create();
+    {
+      ci::gl::ScopedVao scoped_vao(vao);
+      ci::gl::ScopedBuffer scoped_vbo(vertices_);
+      // NOTICE 頂点番号のバッファはVAOが覚える
+      indices_->bind();
+
+      auto attrib = [&](ci::geom::Attrib semantic, GLenum type, GLboolean normalized, size_t offset)
+                    {
+                      int location = shader->getAttribSemanticLocation(semantic);
+                      if (location < 0) return;
+
+                      ci::gl::enableVertexAttribArray(location);
+                      ci::gl::vertexAttribPointer(location, 4, type, normalized,
+                                                  sizeof(BakedMesh::Vertex), reinterpret_cast<const GLvoid*>(offset));
+                    };
+
+      attrib(ci::geom::Attrib::POSITION, GL_HALF_FLOAT,          GL_FALSE, offsetof(BakedMesh::Vertex, position));
+      attrib(ci::geom::Attrib::NORMAL,   GL_INT_2_10_10_10_REV,  GL_TRUE,  offsetof(BakedMesh::Vertex, normal));
+      attrib(ci::geom::Attrib::COLOR,    GL_UNSIGNED_BYTE,       GL_TRUE,  offsetof(BakedMesh::Vertex, color));
+    }
+
+    return vaos_.insert({ shader, vao }).first->second;
+  }
+
+};
+
+using BakedModelPtr = std::shared_ptr<BakedModel>;
+
+}
@@ -0,0 +1,232 @@
+﻿#pragma once
+
+//
+// チャンク分割した２次元グリッド
+//   std::map<glm::ivec2, T> の代わりに使う
+//   TIPS count/at/emplace はstd::mapと同じ呼び出し方ができる
+//   NOTICE emplaceで取得済みの参照が無効になる事がある
+//
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+
+namespace ngs {
+
+template <typename T>
+class ChunkedGrid
+{
+  enum {
+    // チャンク１辺のマス数
+    CHUNK_SHIFT = 3,
+    CHUNK_SIZE  = 1 << CHUNK_SHIFT,
+    CHUNK_MASK  = CHUNK_SIZE - 1,
+  };
+
+  // 8x8マスと、その占有状況(1マス1bit)
+  struct Chunk
+  {
+    uint64_t occupied = 0;
+    std::array<T, CHUNK_SIZE * CHUNK_SIZE> cells;
+  };
+
+
+public:
+  ChunkedGrid()  = default;
+  ~ChunkedGrid() = default;
+
+
+  size_t count(const glm::ivec2& pos) const noexcept
+  {
+    int index = chunkIndex(pos);
+    if (index < 0) return 0;
+
+    return (chunks_[index].occupied >> cellIndex(pos)) & 1;
+  }
+
+  const T& at(const glm::ivec2& pos) const noexcept
+  {
+    int index = chunkIndex(pos);
+    assert(index >= 0);
+    assert(count(pos));
+
+    return chunks_[index].cells[cellIndex(pos)];
+  }
+
+  T& at(const glm::ivec2& pos) noexcept
+  {
+    int index = chunkIndex(pos);
+    assert(index >= 0);
+    assert(count(pos));
+
+    return chunks_[index].cells[cellIndex(pos)];
+  }
+
+  // NOTICE std::mapと同じく、既に値があれば上書きしない
+  bool emplace(const glm::ivec2& pos, const T& value) noexcept
+  {
+    auto& chunk = chunks_[prepareChunk(pos)];
+
+    auto cell = cellIndex(pos);
+    uint64_t bit = uint64_t(1) << cell;
+    if (chunk.occupied & bit) return false;
+
+    chunk.occupied |= bit;
+    chunk.cells[cell] = value;
+    ++num_;
+
+    return true;
+  }
+
+  // NOTICE チャンクは解放しない
+  size_t erase(const glm::ivec2& pos) noexcept
+  {
+    int index = chunkIndex(pos);
+    if (index < 0) return 0;
+
+    uint64_t bit = uint64_t(1) << cellIndex(pos);
+    auto& chunk = chunks_[index];
+    if (!(chunk.occupied & bit)) return 0;
+
+    chunk.occupied &= ~bit;
+    --num_;
+
+    return 1;
+  }
+
+  size_t size() const noexcept
+  {
+    return num_;
+  }
+
+  bool empty() const noexcept
+  {
+    return num_ == 0;
+  }
+
+  // 書き込む範囲と最大のマス数を前もって確保
+  // TIPS 範囲内なら emplace で割り当てが起きない
+  void reserve(const glm::ivec2& min_pos, const glm::ivec2& max_pos, size_t max_cells) noexcept
+  {
+    auto c_min = chunkPos(min_pos);
+    auto c_max = chunkPos(max_pos) + 1;
+    if (!directory_.empty())
+    {
+      c_min = { std::min(c_min.x, origin_.x), std::min(c_min.y, origin_.y) };
+      c_max = { std::max(c_max.x, origin_.x + extent_.x), std::max(c_max.y, origin_.y + extent_.y) };
+    }
+    if (directory_.empty() || (c_min != origin_) || (c_max != origin_ + extent_))
+    {
+      resizeDirectory(c_min, c_max);
+    }
+
+    // NOTICE マスごとに別のチャンクになる事もある
+    chunks_.reserve(std::min(directory_.size(), max_cells));
+  }
+
+  // NOTICE std::vectorと同じく、確保した範囲とチャンクは解放しない
+  void clear() noexcept
+  {
+    std::fill(std::begin(directory_), std::end(directory_), -1);
+    chunks_.clear();
+    num_ = 0;
+  }
+
+
+private:
+  // TIPS 負の座標も算術シフトで切り捨てられる
+  static glm::ivec2 chunkPos(const glm::ivec2& pos) noexcept
+  {
+    return { pos.x >> CHUNK_SHIFT, pos.y >> CHUNK_SHIFT };
+  }
+
+  static uint32_t cellIndex(const glm::ivec2& pos) noexcept
+  {
+    return ((pos.y & CHUNK_MASK) << CHUNK_SHIFT) | (pos.x & CHUNK_MASK);
+  }
+
+  // 原点からの相対位置でディレクトリを引く
+  int chunkIndex(const glm::ivec2& pos) const noexcept
+  {
+    auto c = chunkPos(pos) - origin_;
+    // TIPS 負の値は符号無しにすると範囲外になる
+    if ((uint32_t(c.x) >= uint32_t(extent_.x)) || (uint32_t(c.y) >= uint32_t(extent_.y))) return -1;
+
+    return directory_[c.y * extent_.x + c.x];
+  }
+
+  // 書き込み先のチャンクを用意
+  int prepareChunk(const glm::ivec2& pos) noexcept
+  {
+    auto c = chunkPos(pos);
+    if ((c.x < origin_.x) || (c.x >= origin_.x + extent_.x)
+        || (c.y < origin_.y) || (c.y >= origin_.y + extent_.y))
+    {
+      growDirectory(c);
+    }
+
+    auto& index = directory_[(c.y - origin_.y) * extent_.x + (c.x - origin_.x)];
+    if (index < 0)
+    {
+      index = int(chunks_.size());
+      chunks_.emplace_back();
+    }
+    return index;
+  }
+
+  // 範囲外に書き込む時はディレクトリを広げる
+  void growDirectory(const glm::ivec2& c) noexcept
+  {
+    if (directory_.empty())
+    {
+      origin_ = c;
+      extent_ = glm::ivec2(1);
+      directory_.assign(1, -1);
+      return;
+    }
+
+    // TIPS 広げる方向には１チャンク余分に確保しておく
+    glm::ivec2 new_min{ std::min(origin_.x, c.x - 1), std::min(origin_.y, c.y - 1) };
+    glm::ivec2 new_max{ std::max(origin_.x + extent_.x, c.x + 2), std::max(origin_.y + extent_.y, c.y + 2) };
+    if (c.x >= origin_.x) new_min.x = origin_.x;
+    if (c.y >= origin_.y) new_min.y = origin_.y;
+    if (c.x <  origin_.x + extent_.x) new_max.x = origin_.x + extent_.x;
+    if (c.y <  origin_.y + extent_.y) new_max.y = origin_.y + extent_.y;
+
+    resizeDirectory(new_min, new_max);
+  }
+
+  // ディレクトリを [new_min, new_max) に作り直す
+  // NOTICE 今の範囲を含んでいる事
+  void resizeDirectory(const glm::ivec2& new_min, const glm::ivec2& new_max) noexcept
+  {
+    auto new_extent = new_max - new_min;
+    std::vector<int> directory(new_extent.x * new_extent.y, -1);
+    for (int y = 0; y < extent_.y; ++y)
+    {
+      auto* src = &directory_[y * extent_.x];
+      auto* dst = &directory[(y + origin_.y - new_min.y) * new_extent.x + (origin_.x - new_min.x)];
+      std::copy(src, src + extent_.x, dst);
+    }
+
+    directory_.swap(directory);
+    origin_ = new_min;
+    extent_ = new_extent;
+  }
+
+
+  // ディレクトリ先頭のチャンク座標と広さ
+  glm::ivec2 origin_{ 0, 0 };
+  glm::ivec2 extent_{ 0, 0 };
+  // チャンク座標→chunks_の添字(-1は未確保)
+  std::vector<int> directory_;
+  std::vector<Chunk> chunks_;
+
+  size_t num_ = 0;
+};
+
+}
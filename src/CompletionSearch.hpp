@@ -0,0 +1,293 @@
+﻿#pragma once
+
+//
+// 森や道の完成したパネルを列挙する(作業領域を使い回す版)
+//   Logic.hpp の isCompleteAttribute と同じ順番で同じ結果を返す
+//   調査済みの印はパネルを置いた順番(PanelStatus::index)で引く配列に世代番号で付ける
+//   結果は１つの配列に詰めて、区画ごとにSpanで返す
+//
+//   NOTICE 結果は次に調べるまで有効
+//
+
+#include "Defines.hpp"
+#include <vector>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "Panel.hpp"
+#include "Field.hpp"
+#include "CoreUtility.hpp"
+
+
+namespace ngs {
+
+class CompletionSearch
+{
+public:
+  // 完成した区画１つ分
+  using Cells = Span<const glm::ivec2>;
+
+
+  // num_panels: フィールドに置かれるパネルの最大数
+  // TIPS 作業領域を先に確保しておく
+  CompletionSearch(size_t num_panels) noexcept
+    : cell_marks_(num_panels, 0),
+      edge_marks_(num_panels * 4, 0)
+  {
+    // NOTICE 端のあるパネルは辺ごとに何度か加えられる
+    cells_.reserve(num_panels * 5);
+    ends_.reserve(4);
+  }
+
+  ~CompletionSearch() = default;
+
+
+  // 属性が完成したか調べる
+  // 完成した区画の数を返す
+  size_t search(u_int attribute, const glm::ivec2& pos,
+                const Field& field, const std::vector<Panel>& panels) noexcept
+  {
+    cells_.clear();
+    ends_.clear();
+    prepareMarks(field);
+
+    // パネル情報
+    const auto& status = field.getPanelStatus(pos);
+    const auto& edge   = panels[status.number].getRotatedEdge(status.rotation);
+
+    // パネルは端か途中かの２択(両方含んだ道は無い)
+    bool has_attr = false;
+    bool has_edge = false;
+    for (u_int i = 0; i < 4; ++i)
+    {
+      if (edge[i] & attribute)
+      {
+        has_attr = true;
+        if (edge[i] & Panel::EDGE)
+        {
+          has_edge = true;
+          break;
+        }
+      }
+    }
+
+    // ４辺とも対象ではない
+    if (!has_attr) return 0;
+
+    nextGeneration(edge_generation_, edge_marks_);
+
+    if (has_edge)
+    {
+      // 端を含んでいる→端ごとに調査
+      for (u_int i = 0; i < 4; ++i)
+      {
+        if (!(edge[i] & attribute)) continue;
+
+        auto& edge_mark = edge_marks_[status.index * 4 + i];
+        if (edge_mark == edge_generation_) continue;
+        edge_mark = edge_generation_;
+
+        // その先が閉じているか調査
+        nextGeneration(cell_generation_, cell_marks_);
+        size_t start = cells_.size();
+        if (checkEdge(pos + offsets()[i], i, attribute, field, panels))
+        {
+          cells_.push_back(pos);
+          ends_.push_back(cells_.size());
+        }
+        else
+        {
+          cells_.resize(start);
+        }
+      }
+    }
+    else
+    {
+      // 端を含んでいない→その先すべてで閉じていないとならない
+      nextGeneration(cell_generation_, cell_marks_);
+      cell_marks_[status.index] = cell_generation_;
+
+      for (u_int i = 0; i < 4; ++i)
+      {
+        if (!(edge[i] & attribute)) continue;
+
+        // １つでも閉じていなければ調査完了
+        if (!checkEdge(pos + offsets()[i], i, attribute, field, panels))
+        {
+          cells_.clear();
+          return 0;
+        }
+      }
+      if (!cells_.empty())
+      {
+        cells_.push_back(pos);
+        ends_.push_back(cells_.size());
+      }
+    }
+
+    return ends_.size();
+  }
+
+  // 直前に調べた結果
+  size_t size() const noexcept
+  {
+    return ends_.size();
+  }
+
+  bool empty() const noexcept
+  {
+    return ends_.empty();
+  }
+
+  Cells operator[](size_t index) const noexcept
+  {
+    size_t first = (index > 0) ? ends_[index - 1] : 0;
+    return Cells(cells_.data() + first, cells_.data() + ends_[index]);
+  }
+
+
+  // 森(or道)総面積
+  // TIPS 同じ場所にあるパネルは区画ごとに１回だけ数える
+  //      first 番目以降の区画だけを数える事もできる
+  int countTotalAttribute(const std::vector<std::vector<glm::ivec2>>& completed,
+                          const Field& field, size_t first = 0) noexcept
+  {
+    prepareMarks(field);
+
+    int num = 0;
+    for (size_t i = first; i < completed.size(); ++i)
+    {
+      const auto& comp = completed[i];
+      nextGeneration(cell_generation_, cell_marks_);
+      for (const auto& p : comp)
+      {
+        if (mark(field.getPanelStatus(p))) num += 1;
+      }
+    }
+    return num;
+  }
+
+  // 完成した街の数を数える
+  // TIPS 同じ場所にある街を再カウントしない
+  int countTown(const std::vector<std::vector<glm::ivec2>>& completed,
+                const Field& field, const std::vector<Panel>& panels) noexcept
+  {
+    prepareMarks(field);
+    nextGeneration(cell_generation_, cell_marks_);
+
+    int num = 0;
+    for (const auto& comp : completed)
+    {
+      for (const auto& p : comp)
+      {
+        const auto& status = field.getPanelStatus(p);
+        if (!(panels[status.number].getAttribute() & Panel::BUILDING)) continue;
+        if (mark(status)) num += 1;
+      }
+    }
+    return num;
+  }
+
+
+private:
+  // 時計回りに調べる
+  static const glm::ivec2* offsets() noexcept
+  {
+    static const glm::ivec2 offsets[] = {
+      {  0,  1 },
+      {  1,  0 },
+      {  0, -1 },
+      { -1,  0 },
+    };
+    return offsets;
+  }
+
+  // パネルの端を調べる
+  bool checkEdge(const glm::ivec2& pos, u_int direction,
+                 u_int attribute,
+                 const Field& field, const std::vector<Panel>& panels) noexcept
+  {
+    // パネルがない→閉じていない
+    if (!field.existsPanel(pos)) return false;
+
+    // パネル情報
+    const auto& status = field.getPanelStatus(pos);
+    const auto& edge   = panels[status.number].getRotatedEdge(status.rotation);
+
+    u_int dir = (direction + 2) % 4;
+
+    // そこが端なら判定完了
+    if (edge[dir] & Panel::EDGE)
+    {
+      // 調査済みEdge
+      auto& edge_mark = edge_marks_[status.index * 4 + dir];
+      if (edge_mark == edge_generation_) return false;
+      edge_mark = edge_generation_;
+
+      cells_.push_back(pos);
+      return true;
+    }
+
+    // 調査ずみなら調査続行
+    if (!mark(status)) return true;
+
+    // NOTICE 必ず１編は同じ属性がある
+    for (u_int i = 0; i < 4; ++i)
+    {
+      // 戻らない
+      if (i == dir) continue;
+      if (!(edge[i] & attribute)) continue;
+
+      // その先が閉じているか調査
+      if (!checkEdge(pos + offsets()[i], i, attribute, field, panels)) return false;
+    }
+
+    cells_.push_back(pos);
+    return true;
+  }
+
+  // 印を付ける(付いていたらfalse)
+  bool mark(const PanelStatus& status) noexcept
+  {
+    auto& cell_mark = cell_marks_[status.index];
+    if (cell_mark == cell_generation_) return false;
+
+    cell_mark = cell_generation_;
+    return true;
+  }
+
+  // 世代を進める(一周したら印を消す)
+  static void nextGeneration(u_int& generation, std::vector<u_int>& marks) noexcept
+  {
+    generation += 1;
+    if (generation == 0)
+    {
+      std::fill(std::begin(marks), std::end(marks), 0);
+      generation = 1;
+    }
+  }
+
+  // 置かれたパネルの数だけ印を用意
+  void prepareMarks(const Field& field) noexcept
+  {
+    auto num = field.getPanelPositions().size();
+    if (cell_marks_.size() < num)
+    {
+      cell_marks_.resize(num, 0);
+      edge_marks_.resize(num * 4, 0);
+    }
+  }
+
+
+  // 調査済みの印(パネルを置いた順番で引く)
+  std::vector<u_int> cell_marks_;
+  std::vector<u_int> edge_marks_;
+  u_int cell_generation_ = 0;
+  u_int edge_generation_ = 0;
+
+  // 結果
+  std::vector<glm::ivec2> cells_;
+  // 区画ごとの終端
+  std::vector<size_t> ends_;
+};
+
+}
@@ -24,6 +24,7 @@
 #include "Ranking.hpp"
 #include "Archive.hpp"
 #include "Sound.hpp"
+#include "AssetLoader.hpp"
 #include "DebugTask.hpp"
 #include "Achievements.hpp"
 #include "PurchaseDelegate.h"
@@ -265,8 +266,36 @@ public:
     archive_.save();
     
     // 最初のタスクを登録
-    tasks_.pushBack<Sound>(params_, event_);
-    tasks_.pushBack<MainPart>(params_, event_, archive_);
+    {
+      // TIPS モデルや音の読み込みと解析はワーカーで並列に行い、
+      //      終わったものからメインスレッドでGPUなどへ渡す
+      AssetLoader loader;
+      Sound::Preload sound_preload;
+      View::Preload  view_preload;
+
+      auto sound_jobs = Sound::preload(params_, loader, sound_preload);
+      auto view_jobs  = View::preload(params_["field"], loader, view_preload);
+
+      auto sound = loader.addMain("Sound",
+                                  [&]()
+                                  {
+                                    tasks_.pushBack<Sound>(params_, event_, sound_preload);
+                                  },
+                                  sound_jobs);
+      // NOTICE タスクの順番は Sound → MainPart
+      view_jobs.push_back(sound);
+      loader.addMain("MainPart",
+                     [&]()
+                     {
+                       tasks_.pushBack<MainPart>(params_, event_, archive_, view_preload);
+                     },
+                     view_jobs);
+
+      loader.run();
+#if defined (DEBUG)
+      loader.report(DOUT);
+#endif
+    }
     {
       Intro::Condition condition{
         Archive::isTutorial(archive_),
@@ -160,6 +160,7 @@ class DebugTask
 
                              auto mesh = PLY::load(p, true);
                              Model::writeTriMesh(p, mesh);
+                             Model::writeBaked(p);
                            }
                          });
 
@@ -15,7 +15,15 @@
 #endif
 
 // TIPS:console() をReleaseビルドで排除する
+#if defined (NGS_HEADLESS)
+// Cinder無しでビルドする時は標準エラー出力へ
+#include <iostream>
 #ifdef DEBUG
+#define DOUT std::cerr
+#else
+#define DOUT 0 && std::cerr
+#endif
+#elif defined (DEBUG)
 #define DOUT ci::app::console()
 #else
 #define DOUT 0 && ci::app::console()
@@ -39,6 +47,17 @@
 // 実績キャッシュの難読化
 // #define OBFUSCATION_ACHIEVEMENT
 
+// ゲーム記録をバイナリ形式(GameRecord)で保存
+// TIPS 読み込みは形式を判別するので、JSONの記録と混在していても良い
+// #define BINARY_GAME_RECORD
+
+// アセットをまとめたファイル(assets.pack)から読み込む
+// TIPS 見つからなければ個別のファイルを読む
+// #define NGS_PACKED_ASSETS
+
+// Fieldのパネル情報をstd::mapで管理(無効時はグリッドで管理)
+// #define FIELD_STORAGE_MAP
+
 #if defined(CINDER_COCOA_TOUCH)
 
 // リリース時 NSLog 一網打尽マクロ
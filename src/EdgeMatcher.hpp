@@ -0,0 +1,216 @@
+﻿#pragma once
+
+//
+// パネルの辺の一致をまとめて調べる
+//   全パネルの４回転分の辺情報を並べておき、空き地の周囲の辺と一度に比較する
+//   AVX2なら１パネル(４回転)、SSE2なら２回転ずつ比較する
+//
+//   NOTICE 空き地の周囲の情報は置いたパネルで変わるので、その都度作り直す事
+//
+
+#include "Defines.hpp"
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <glm/glm.hpp>
+#include "Panel.hpp"
+#include "Field.hpp"
+
+#if defined (__AVX2__)
+#include <immintrin.h>
+#define NGS_EDGE_AVX2
+#elif defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define NGS_EDGE_SSE2
+#endif
+
+
+namespace ngs {
+
+class EdgeMatcher
+{
+public:
+  // 空き地の周囲の状況
+  struct Blank
+  {
+    // 隣のパネルから決まる辺
+    uint64_t edge;
+    // 隣にパネルがある辺は EDGE_MASK
+    uint64_t mask;
+  };
+
+
+  EdgeMatcher(const std::vector<Panel>& panels) noexcept
+    : num_(u_int(panels.size())),
+      edges_(panels.size() * 4)
+  {
+    // パネル番号 * 4 + 回転 の順に並べる
+    for (u_int i = 0; i < num_; ++i)
+    {
+      for (u_int r = 0; r < 4; ++r)
+      {
+        edges_[i * 4 + r] = panels[i].getRotatedEdgeValue(r);
+      }
+    }
+  }
+
+  ~EdgeMatcher() = default;
+
+
+  // 空き地の周囲を調べる
+  static Blank getBlank(const glm::ivec2& pos, const Field& field) noexcept
+  {
+    // 時計回りに調べる
+    static const glm::ivec2 offsets[] = {
+      {  0,  1 },
+      {  1,  0 },
+      {  0, -1 },
+      { -1,  0 },
+    };
+
+    Blank blank{ 0, 0 };
+    for (u_int i = 0; i < 4; ++i)
+    {
+      glm::ivec2 p = pos + offsets[i];
+      if (!field.existsPanel(p)) continue;
+
+      // 向かい合う辺が自分の辺の位置に来るよう回す
+      const auto& status = field.getPanelStatus(p);
+      uint64_t side_mask = uint64_t(Panel::EDGE_MASK) << (i * 16);
+      blank.edge |= rotateLeft(status.edge, 32) & side_mask;
+      blank.mask |= side_mask;
+    }
+
+    return blank;
+  }
+
+  // 置けるか(１つだけ)
+  bool fits(u_int panel, u_int rotation, const Blank& blank) const noexcept
+  {
+    return ((edges_[panel * 4 + rotation] ^ blank.edge) & blank.mask) == 0;
+  }
+
+  // パネルごとに置ける回転を調べる
+  // rotations[パネル番号] の bit n が回転nで置ける事を示す
+  void match(const Blank& blank, std::vector<uint8_t>& rotations) const noexcept
+  {
+    rotations.resize(num_);
+
+#if defined (NGS_EDGE_AVX2)
+    const __m256i edge = _mm256_set1_epi64x(int64_t(blank.edge));
+    const __m256i mask = _mm256_set1_epi64x(int64_t(blank.mask));
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (u_int i = 0; i < num_; ++i)
+    {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&edges_[i * 4]));
+      v = _mm256_and_si256(_mm256_xor_si256(v, edge), mask);
+      __m256i eq = _mm256_cmpeq_epi64(v, zero);
+      rotations[i] = uint8_t(_mm256_movemask_pd(_mm256_castsi256_pd(eq)));
+    }
+#elif defined (NGS_EDGE_SSE2)
+    const __m128i edge = _mm_set1_epi64x(int64_t(blank.edge));
+    const __m128i mask = _mm_set1_epi64x(int64_t(blank.mask));
+    const __m128i zero = _mm_setzero_si128();
+
+    for (u_int i = 0; i < num_; ++i)
+    {
+      const auto* p = reinterpret_cast<const __m128i*>(&edges_[i * 4]);
+      rotations[i] = uint8_t(matchPair(_mm_loadu_si128(p), edge, mask, zero)
+                             | (matchPair(_mm_loadu_si128(p + 1), edge, mask, zero) << 2));
+    }
+#else
+    matchScalar(blank, rotations);
+#endif
+  }
+
+  // SIMDを使わない版
+  void matchScalar(const Blank& blank, std::vector<uint8_t>& rotations) const noexcept
+  {
+    rotations.resize(num_);
+
+    for (u_int i = 0; i < num_; ++i)
+    {
+      uint8_t bits = 0;
+      for (u_int r = 0; r < 4; ++r)
+      {
+        if (fits(i, r, blank)) bits |= 1 << r;
+      }
+      rotations[i] = bits;
+    }
+  }
+
+  // １つのパネルの置ける回転を調べる(bit n が回転n)
+  u_int matchRotations(u_int panel, const Blank& blank) const noexcept
+  {
+#if defined (NGS_EDGE_AVX2)
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&edges_[panel * 4]));
+    v = _mm256_and_si256(_mm256_xor_si256(v, _mm256_set1_epi64x(int64_t(blank.edge))),
+                         _mm256_set1_epi64x(int64_t(blank.mask)));
+    __m256i eq = _mm256_cmpeq_epi64(v, _mm256_setzero_si256());
+    return u_int(_mm256_movemask_pd(_mm256_castsi256_pd(eq)));
+#elif defined (NGS_EDGE_SSE2)
+    const auto* p = reinterpret_cast<const __m128i*>(&edges_[panel * 4]);
+    const __m128i edge = _mm_set1_epi64x(int64_t(blank.edge));
+    const __m128i mask = _mm_set1_epi64x(int64_t(blank.mask));
+    const __m128i zero = _mm_setzero_si128();
+    return u_int(matchPair(_mm_loadu_si128(p), edge, mask, zero)
+                 | (matchPair(_mm_loadu_si128(p + 1), edge, mask, zero) << 2));
+#else
+    u_int bits = 0;
+    for (u_int r = 0; r < 4; ++r)
+    {
+      if (fits(panel, r, blank)) bits |= 1 << r;
+    }
+    return bits;
+#endif
+  }
+
+  // どこかの空き地に置けるか
+  bool fitsAny(u_int panel, const std::vector<Blank>& blanks) const noexcept
+  {
+    for (const auto& blank : blanks)
+    {
+      if (matchRotations(panel, blank)) return true;
+    }
+    return false;
+  }
+
+  // 空き地に置ける(パネル番号, 回転)を列挙
+  void enumerate(const glm::ivec2& pos, const Field& field,
+                 std::vector<std::pair<u_int, u_int>>& result) const noexcept
+  {
+    std::vector<uint8_t> rotations;
+    match(getBlank(pos, field), rotations);
+
+    result.clear();
+    for (u_int i = 0; i < num_; ++i)
+    {
+      for (u_int r = 0; r < 4; ++r)
+      {
+        if (rotations[i] & (1 << r)) result.emplace_back(i, r);
+      }
+    }
+  }
+
+
+private:
+#if defined (NGS_EDGE_SSE2)
+  // ２回転分を比べる
+  static int matchPair(__m128i v, __m128i edge, __m128i mask, __m128i zero) noexcept
+  {
+    v = _mm_and_si128(_mm_xor_si128(v, edge), mask);
+    // TIPS SSE2には64bitの比較が無いので、32bitずつ比べて上下を入れ替えたものとANDを取る
+    __m128i eq = _mm_cmpeq_epi32(v, zero);
+    eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_movemask_pd(_mm_castsi128_pd(eq));
+  }
+#endif
+
+
+  u_int num_;
+  // 全パネルの回転済みの辺
+  std::vector<uint64_t> edges_;
+};
+
+}
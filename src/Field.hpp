@@ -2,13 +2,18 @@
 
 //
 // パネルを置く場所
+//   置いた時に変わった内容を覚えておき、置く前の状態へ戻せる
+//   盤面のハッシュ値(Zobrist)を置くたびに更新する
 //
 
+#include "Defines.hpp"
 #include <map>
-#include <boost/noncopyable.hpp>
+#include <vector>
 #include <glm/glm.hpp>
 #include <algorithm>
-#include "Utility.hpp"
+#include <cassert>
+#include "CoreUtility.hpp"
+#include "ChunkedGrid.hpp"
 
 
 namespace ngs {
@@ -21,6 +26,8 @@ struct PanelStatus
   u_int rotation;          // 0~3 時計回りに回転している状態
   // 置いた状態でのパネル端情報
   uint64_t edge;
+  // 置いた順番(0から)
+  u_int index;
 };
 
 
@@ -30,50 +37,16 @@ struct Field
   ~Field() = default;
 
 
-  // Jsonから状況を復元
-  Field(const ci::JsonTree& json) noexcept
+  // 置ける場所
+  // NOTICE 並び順は不定
+  const std::vector<glm::ivec2>& getBlankPositions() const noexcept
   {
-    for (const auto& obj : json)
-    {
-      auto number   = obj.template getValueForKey<int>("number");
-      auto pos      = Json::getVec<glm::ivec2>(obj["pos"]);
-      auto rotation = obj.template getValueForKey<u_int>("rotation");
-      auto edge     = Json::getValue<uint64_t>(obj, "edge", 0);
-
-      addPanel(number, pos, rotation, edge);
-    }
+    return blank_pos_array_;
   }
 
-
-  // 置ける場所を探す
-  std::vector<glm::ivec2> searchBlank() const noexcept
+  bool isBlank(const glm::ivec2& pos) const noexcept
   {
-    // TIPS 重複する場所の列挙を回避できる
-    std::set<glm::ivec2, LessVec<glm::ivec2>> blank_candidate;
-
-    static const glm::ivec2 offsets[] = {
-      { -1,  0 },
-      {  1,  0 },
-      {  0, -1 },
-      {  0,  1 },
-    };
-
-    for (const auto& pos : panel_pos_array_)
-    {
-      for (const auto& ofs : offsets)
-      {
-        auto p = pos + ofs;
-        if (!panel_status_.count(p))
-        {
-          blank_candidate.insert(p);
-        }
-      }
-    }
-
-    std::vector<glm::ivec2> blank;
-    appendContainer(blank_candidate, blank);
-
-    return blank;
+    return blank_index_.count(pos);
   }
 
 
@@ -87,6 +60,25 @@ struct Field
     return panel_status_.at(pos);
   }
 
+
+  // 盤面のハッシュ値
+  // TIPS パネルごとの値のXORなので、置いた順番が違っても同じ盤面なら同じ値
+  uint64_t getHash() const noexcept
+  {
+    return hash_;
+  }
+
+  // パネル１枚分のハッシュ値
+  // TIPS 座標に上限が無いので、乱数表の代わりに値を混ぜ合わせて作る
+  //      回転の代わりに回転済みの辺を使うので、対称なパネルの回転違いは同じ盤面になる
+  static uint64_t hashPanel(const glm::ivec2& pos, int number, uint64_t edge) noexcept
+  {
+    // NOTICE 値を足し合わせると別の組み合わせと一致する事があるので、１つずつ混ぜる
+    uint64_t h = mixBits((uint64_t(uint32_t(pos.x)) << 32) | uint32_t(pos.y));
+    h = mixBits(h ^ edge);
+    return mixBits(h ^ uint64_t(number));
+  }
+
   // 追加
   void addPanel(int number, const glm::ivec2& pos, u_int rotation, uint64_t edge) noexcept
   {
@@ -94,11 +86,72 @@ struct Field
       pos,
       number,
       rotation,
-      edge
+      edge,
+      u_int(panel_pos_array_.size())
     };
 
     panel_status_.emplace(pos, status);
     panel_pos_array_.push_back(pos);
+    hash_ ^= hashPanel(pos, number, edge);
+
+    history_.push_back(updateBlank(pos));
+  }
+
+  // 最後に置いたパネルを取り除く
+  // TIPS 置ける場所の並び順も元に戻る
+  void undo() noexcept
+  {
+    assert(!history_.empty());
+    auto step = history_.back();
+    history_.pop_back();
+
+    // 増えた置ける場所は末尾にある
+    for (u_int i = 0; i < step.added_blanks; ++i)
+    {
+      blank_index_.erase(blank_pos_array_.back());
+      blank_pos_array_.pop_back();
+    }
+
+    auto pos = panel_pos_array_.back();
+    if (step.blank_index >= 0) restoreBlank(pos, u_int(step.blank_index));
+
+    const auto& status = panel_status_.at(pos);
+    hash_ ^= hashPanel(pos, status.number, status.edge);
+
+    panel_pos_array_.pop_back();
+    panel_status_.erase(pos);
+  }
+
+  // 状態の目印(これまでに置いた枚数)
+  size_t snapshot() const noexcept
+  {
+    return history_.size();
+  }
+
+  // 目印の状態まで戻す
+  void restore(size_t snapshot) noexcept
+  {
+    while (history_.size() > snapshot)
+    {
+      undo();
+    }
+  }
+
+  // 置くパネルの枚数分の領域を確保
+  void reserve(size_t num_panels) noexcept
+  {
+    panel_pos_array_.reserve(num_panels);
+    history_.reserve(num_panels);
+    // TIPS 置ける場所はパネルの枚数 * 2 + 2 を超えない
+    blank_pos_array_.reserve(num_panels * 2 + 2);
+
+#if !defined (FIELD_STORAGE_MAP)
+    // TIPS 最初のパネルは原点で、置ける場所は置いたパネルの隣なので
+    //      どちらも原点から num_panels マスの範囲に収まる
+    auto extent = glm::ivec2(int(num_panels));
+    panel_status_.reserve(-extent, extent, num_panels);
+    blank_index_.reserve(-extent, extent, num_panels * 2 + 2);
+#endif
   }
 
   std::vector<PanelStatus> enumeratePanels() const noexcept
@@ -119,33 +172,100 @@ struct Field
   }
 
 
-  ci::JsonTree serialize() const noexcept
+private:
+  // パネルを置いた時に変わった内容
+  struct Step
   {
-    ci::JsonTree data = ci::JsonTree::makeObject("field");
+    // 置いた場所の置ける場所としての添字(-1は置ける場所ではなかった)
+    int blank_index;
+    // 増えた置ける場所の数
+    u_int added_blanks;
+  };
 
-    for (const auto& pos : panel_pos_array_)
-    {
-      const auto& status = panel_status_.at(pos);
 
-      ci::JsonTree p;
-      p.addChild(Json::createFromVec("pos", status.position))
-       .addChild(ci::JsonTree("number",     status.number))
-       .addChild(ci::JsonTree("rotation",   status.rotation))
-       .addChild(ci::JsonTree("edge",       status.edge))
-      ;
+  // 置いた場所と周囲４箇所だけ、置ける場所を更新する
+  Step updateBlank(const glm::ivec2& pos) noexcept
+  {
+    Step step{ removeBlank(pos), 0 };
+
+    static const glm::ivec2 offsets[] = {
+      { -1,  0 },
+      {  1,  0 },
+      {  0, -1 },
+      {  0,  1 },
+    };
+
+    for (const auto& ofs : offsets)
+    {
+      auto p = pos + ofs;
+      if (panel_status_.count(p) || blank_index_.count(p)) continue;
 
-      data.pushBack(p);
+      blank_index_.emplace(p, u_int(blank_pos_array_.size()));
+      blank_pos_array_.push_back(p);
+      step.added_blanks += 1;
     }
 
-    return data;
+    return step;
   }
 
+  // 取り除いた時の添字を返す(-1は置ける場所ではなかった)
+  int removeBlank(const glm::ivec2& pos) noexcept
+  {
+    if (!blank_index_.count(pos)) return -1;
 
-private:
+    // TIPS 末尾と入れ替えてから削除
+    auto index = blank_index_.at(pos);
+    auto last  = blank_pos_array_.back();
+    blank_index_.at(last)   = index;
+    blank_pos_array_[index] = last;
+
+    blank_pos_array_.pop_back();
+    blank_index_.erase(pos);
+
+    return int(index);
+  }
+
+  // removeBlankの逆
+  void restoreBlank(const glm::ivec2& pos, u_int index) noexcept
+  {
+    if (index < blank_pos_array_.size())
+    {
+      // 入れ替えた末尾を戻す
+      auto last = blank_pos_array_[index];
+      blank_index_.at(last) = u_int(blank_pos_array_.size());
+      blank_pos_array_.push_back(last);
+      blank_pos_array_[index] = pos;
+    }
+    else
+    {
+      blank_pos_array_.push_back(pos);
+    }
+    blank_index_.emplace(pos, index);
+  }
+
+
+#if defined (FIELD_STORAGE_MAP)
   // TIPS 座標をマップのキーにしている
-  std::map<glm::ivec2, PanelStatus, LessVec<glm::ivec2>> panel_status_;
+  template <typename T>
+  using Storage = std::map<glm::ivec2, T, LessVec<glm::ivec2>>;
+#else
+  // TIPS 座標から直接引けるグリッドで管理
+  template <typename T>
+  using Storage = ChunkedGrid<T>;
+#endif
+
+  Storage<PanelStatus> panel_status_;
   // 置いた順序
   std::vector<glm::ivec2> panel_pos_array_;
+
+  // 置ける場所と、その場所のblank_pos_array_での添字
+  std::vector<glm::ivec2> blank_pos_array_;
+  Storage<u_int> blank_index_;
+
+  // 置いたパネルごとの変更内容
+  std::vector<Step> history_;
+
+  uint64_t hash_ = 0;
 };
 
 }
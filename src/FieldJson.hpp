@@ -0,0 +1,54 @@
+﻿#pragma once
+
+//
+// Field <-> JsonTree
+//   Field本体はCinderに依存しないので変換はこちらで行う
+//
+
+#include <cinder/Json.h>
+#include "Field.hpp"
+#include "JsonUtil.hpp"
+
+
+namespace ngs { namespace Json {
+
+// Jsonから状況を復元
+Field getField(const ci::JsonTree& json) noexcept
+{
+  Field field;
+
+  for (const auto& obj : json)
+  {
+    auto number   = obj.getValueForKey<int>("number");
+    auto pos      = getVec<glm::ivec2>(obj["pos"]);
+    auto rotation = obj.getValueForKey<u_int>("rotation");
+    auto edge     = getValue<uint64_t>(obj, "edge", 0);
+
+    field.addPanel(number, pos, rotation, edge);
+  }
+
+  return field;
+}
+
+ci::JsonTree createFromField(const Field& field) noexcept
+{
+  ci::JsonTree data = ci::JsonTree::makeObject("field");
+
+  for (const auto& pos : field.getPanelPositions())
+  {
+    const auto& status = field.getPanelStatus(pos);
+
+    ci::JsonTree p;
+    p.addChild(createFromVec("pos", status.position))
+     .addChild(ci::JsonTree("number",     status.number))
+     .addChild(ci::JsonTree("rotation",   status.rotation))
+     .addChild(ci::JsonTree("edge",       status.edge))
+    ;
+
+    data.pushBack(p);
+  }
+
+  return data;
+}
+
+} }
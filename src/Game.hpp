@@ -2,31 +2,62 @@
 
 //
 // ゲーム本編
+//   ルールはGameCoreにまかせて、こちらは時間経過、イベント送信、保存を担当
 //
 
-#include <random>
-#include <numeric>
+#include <fstream>
 #include <boost/noncopyable.hpp>
-#include <cinder/Rand.h>
-#include "Logic.hpp"
+#include "GameCore.hpp"
+#include "FieldJson.hpp"
+#include "Utility.hpp"
 #include "CountExec.hpp"
 #include "TextCodec.hpp"
 
 
 namespace ngs {
 
+// 得点計算のパラメーターを読み込む
+ScoreParams createScoreParams(const ci::JsonTree& params) noexcept
+{
+  ScoreParams score_params;
+
+  score_params.panel_rate         = Json::getVec<glm::vec2>(params["panel_rate"]);
+  score_params.score_rates        = Json::getArray<float>(params["score_rates"]);
+  score_params.perfect_score_rate = params.getValueForKey<float>("perfect_score_rate");
+  score_params.ranking_rate       = Json::getVec<glm::vec3>(params["ranking_rate"]);
+#if defined (DEBUG)
+  score_params.test_score = Json::getValue(params, "test_score", -1.0f);
+#endif
+
+  return score_params;
+}
+
+// 乱数の種を決める
+// TIPS パラメーターで指定すると毎回同じ展開になる(計測や不具合の再現用)
+uint32_t createGameSeed(const ci::JsonTree& params) noexcept
+{
+  if (params.hasChild("seed"))
+  {
+    return params.getValueForKey<uint32_t>("seed");
+  }
+
+  std::random_device seed_gen;
+  return seed_gen();
+}
+
+
 struct Game
-  : private boost::noncopyable
+  : public GameCore,
+    private boost::noncopyable
 {
   Game(const ci::JsonTree& params, Event<Arguments>& event,
        bool purchased,
        const std::vector<Panel>& panels) noexcept
-    : params_(params),
+    : GameCore(panels, createScoreParams(params), createGameSeed(params)),
+      params_(params),
       event_(event),
-      panels_(panels),
       initial_play_time_(params.getValueForKey<double>("play_time")),
-      play_time_(initial_play_time_),
-      scores_(7, 0)
+      play_time_(initial_play_time_)
   {
     DOUT << "Panel: " << panels_.size() << std::endl;
 
@@ -37,10 +68,6 @@ struct Game
       initial_play_time_ = params.getValueForKey<double>("play_time_extend");
       play_time_         = initial_play_time_;
     }
-
-    // 乱数
-    std::random_device seed_gen;
-    engine_ = std::mt19937(seed_gen());
   }
 
   ~Game() = default;
@@ -94,19 +121,32 @@ struct Game
   void setupPanels(bool tutorial)
   {
     // パネルを準備
-    preparationPanel(tutorial);
     if (tutorial)
     {
+      preparationPanel(Json::getArray<int>(params_["tutorial"]));
       // 制限時間無し
       invalidTimeLimit();
     }
+    else
+    {
+      preparationPanel();
+    }
+
+#if defined (DEBUG)
+    auto force_panel = params_.getValueForKey<int>("force_panel");
+    if (force_panel > 0)
+    {
+      // パネル枚数を強制的に変更
+      waiting_panels.resize(force_panel);
+    }
+#endif
   }
 
   // 本編準備
   void putFirstPanel() noexcept
   {
     // 最初のパネルを設置
-    putPanel(start_panel_, { 0, 0 }, ci::randInt(4), true);
+    putPanel(start_panel_, { 0, 0 }, randomRotation(), true);
     // 次のパネルを決めて、置ける場所も探す
     getNextPanel();
   }
@@ -161,40 +201,15 @@ struct Game
   }
 
 
-  // パネルが置けるか調べる
-  bool canPutToBlank(const glm::ivec2& field_pos) const noexcept
-  {
-    bool can_put = false;
-    bool blank = std::any_of(std::begin(blank_), std::end(blank_),
-                    [&field_pos](const auto& it)
-                    {
-                      return it == field_pos;
-                    });
-    if (blank)
-    {
-      can_put = canPutPanel(panels_[hand_panel], field_pos, hand_rotation, field);
-    }
-
-    return can_put;
-  }
-
-  // そこにblankがあるか？
-  bool isBlank(const glm::ivec2& field_pos) const noexcept
-  {
-    return std::find(std::begin(blank_), std::end(blank_), field_pos) != std::end(blank_);
-  }
-
-  bool isPanel(const glm::ivec2& field_pos) const
-  {
-    return field.existsPanel(field_pos);
-  }
-
   // 操作
   void putHandPanel(const glm::ivec2& field_pos) noexcept
   {
     // プレイ中でなければ置けない
     if (!isPlaying()) return;
 
+    // 操作を記録
+    play_log_.add(hand_panel, field_pos, hand_rotation, initial_play_time_ - play_time_);
+
     // パネルを追加してイベント送信
     total_panels += 1;
     putPanel(hand_panel, field_pos, hand_rotation);
@@ -214,98 +229,32 @@ struct Game
   // 状況チェック
   void checkFieldStatus(const glm::ivec2& field_pos)
   {
-    bool update_score = false;
+    auto completed = GameCore::checkFieldStatus(field_pos);
+    if (!completed.forests.empty())
     {
-      // 森完成チェック
-      auto completed = isCompleteAttribute(Panel::FOREST, field_pos, field, panels_);
-      if (!completed.empty())
-      {
-        // 得点
-        DOUT << "Forest: " << completed.size() << '\n';
-        u_int deep_num = 0;
-        for (const auto& comp : completed)
-        {
-          // 深い森
-          auto deep = countDeepForest(comp, field, panels_);
-          deep_num += deep;
-          deep_forest.push_back(deep);
-
-          DOUT << " Point: " << comp.size() << '\n';
-          DOUT << "  Deep: " << deep << '\n';
-        }
-
-        // 最大森
-        auto it = std::max_element(std::begin(completed), std::end(completed),
-                                   [](const auto& a, const auto& b)
-                                   {
-                                     return a.size() < b.size();
-                                   });
-        max_forest_ = u_int(it->size());
-
-        DOUT << "Total Deep: " << deep_num << '\n';
-        DOUT << "Max forest: " << max_forest_ << '\n';
-        DOUT << std::endl;
-
-        appendContainer(completed, completed_forests);
-
-        Arguments args{
-          { "completed", completed }
-        };
-        event_.signal("Game:completed_forests", args);
-
-        update_score = true;
-      }
+      Arguments args{
+        { "completed", completed.forests }
+      };
+      event_.signal("Game:completed_forests", args);
     }
+    if (!completed.path.empty())
     {
-      // 道完成チェック
-      auto completed = isCompleteAttribute(Panel::PATH, field_pos, field, panels_);
-      if (!completed.empty())
-      {
-        DOUT << "  Path: " << completed.size() << '\n';
-        auto it = std::max_element(std::begin(completed), std::end(completed),
-                                   [](const auto& a, const auto& b)
-                                   {
-                                     return a.size() < b.size();
-                                   });
-        max_path_ = int(it->size());
-
-        DOUT << "Max path: " << max_path_;
-        DOUT << std::endl;
-
-        appendContainer(completed, completed_path);
-
-        Arguments args{
-          { "completed", completed }
-        };
-        event_.signal("Game:completed_path", args);
-
-        update_score = true;
-      }
+      Arguments args{
+        { "completed", completed.path }
+      };
+      event_.signal("Game:completed_path", args);
     }
+    if (!completed.church.empty())
     {
-      // 教会完成チェック
-      auto completed = isCompleteChurch(field_pos, field, panels_);
-      if (!completed.empty())
-      {
-        // 得点
-        DOUT << "Church: " << completed.size() << std::endl;
-              
-        appendContainer(completed, completed_church);
-        
-        Arguments args{
-          { "completed", completed }
-        };
-        event_.signal("Game:completed_church", args);
-
-        update_score = true;
-      }
+      Arguments args{
+        { "completed", completed.church }
+      };
+      event_.signal("Game:completed_church", args);
     }
 
     // スコア更新
-    if (update_score)
+    if (!completed.empty())
     {
-      updateScores();
-      
       Arguments args{
         { "scores", scores_ },
       };
@@ -313,155 +262,23 @@ struct Game
     }
   }
 
-  void rotationHandPanel() noexcept
-  {
-    hand_rotation = (hand_rotation + 1) % 4;
-    panel_turned_times_ += 1;
-  }
-
-  void moveHandPanel(const glm::vec2& pos) noexcept
-  {
-    panel_moved_times_ += 1;
-  }
-
-  // 手持ちパネル情報
-  u_int getHandPanel() const noexcept
-  {
-    return hand_panel;
-  }
-
-  u_int getHandRotation() const noexcept
-  {
-    return hand_rotation;
-  }
-
-  // 手持ちパネルのエッジ情報
-  uint64_t getHandPanelEdge() const noexcept
-  {
-    const auto p = panels_[hand_panel];
-    return p.getRotatedEdgeValue(hand_rotation);
-  }
-
-
-  // 配置可能な場所
-  const std::vector<glm::ivec2>& getBlankPositions() const noexcept
-  {
-    return blank_;
-  }
-
-  // パネルを置く場所を適当に決める
-  glm::ivec2 getNextPanelPosition(const glm::ivec2& put_pos) noexcept
-  {
-    auto positions = getBlankPositions();
-    // 適当に並び替える
-    std::shuffle(std::begin(positions), std::end(positions), engine_);
-
-    // 置いた場所から一番距離の近い場所を選ぶ
-    auto it = std::min_element(std::begin(positions), std::end(positions),
-                               [put_pos](const glm::ivec2& a, const glm::ivec2& b) noexcept
-                               {
-                                 // FIXME 整数型のベクトルだとdistance2とかdotとかが使えない
-                                 auto da = put_pos - a;
-                                 auto db = put_pos - b;
-
-                                 return (da.x * da.x + da.y * da.y) < (db.x * db.x + db.y * db.y);
-                               });
-
-    return *it;
-  }
-
-  // 指定属性のパネルを探す
-  std::tuple<bool, glm::ivec2, int> searchAttribute(u_int attribute, u_int edge) const
-  {
-    uint64_t e = edge;
-    uint64_t edge_bundled = e | (e << 16) | (e << 32) | (e << 48);
-
-    const auto& panel_positions = field.getPanelPositions();
-    auto it = std::find_if(std::begin(panel_positions), std::end(panel_positions),
-                           [this, attribute, edge_bundled](const glm::ivec2& pos)
-                           {
-                             const auto& status = field.getPanelStatus(pos);
-                             const auto& panel  = panels_[status.number];
-
-                             return (panel.getAttribute() & attribute) || (edge_bundled & status.edge);
-                           });
-
-    if (it == std::end(panel_positions))
-    {
-      return { false, glm::ivec2(0), 0 };
-    }
-
-    // edge情報をゲット
-    int rotate = 0;
-    if (edge)
-    {
-      const auto& status = field.getPanelStatus(*it);
-      auto rotated_edge  = status.edge;
-
-      for ( ; rotate < 4; ++rotate)
-      {
-        if (rotated_edge & e)
-        {
-          break;
-        }
-        // NOTICE 事前に定義した変数を変更している
-        e <<= 16;
-      }
-    }
-
-    return { true, *it, rotate };
-  }
-
-  // 指定属性のパネルを探す
-  std::vector<glm::ivec2> searchPanels(u_int attribute) const
-  {
-    const auto& panel_positions = field.getPanelPositions();
-
-    std::vector<glm::ivec2> positions;
-    for (const auto& p : panel_positions)
-    {
-      const auto& status = field.getPanelStatus(p);
-      const auto& panel  = panels_[status.number];
-      if (panel.getAttribute() & attribute) positions.push_back(p);
-    }
-
-    return positions;
-  }
-
-  // こちらはEdge版
-  std::vector<glm::ivec2> searchPanelsAtEdge(u_int attribute) const
-  {
-    const auto& panel_positions = field.getPanelPositions();
-    uint64_t e = attribute;
-    uint64_t edge_bundled = e | (e << 16) | (e << 32) | (e << 48);
-
-    std::vector<glm::ivec2> positions;
-    for (const auto& p : panel_positions)
-    {
-      const auto& status = field.getPanelStatus(p);
-      if (status.edge & edge_bundled) positions.push_back(p);
-    }
-
-    return positions;
-  }
-
-  // フィールド上のパネルのEdge状態を取得(回転込み)
-  uint64_t getPanelEdge(const glm::ivec2& pos) const
-  {
-    const auto& status = field.getPanelStatus(pos);
-    return status.edge;
-  }
-
 
   // 保存
   void save(const std::string& name) const noexcept
   {
+#if defined (BINARY_GAME_RECORD)
+    auto record = createRecord();
+    record.play_time = play_time_;
+    auto data = record.serialize();
+    // NOTICE OStream::write(std::string) は終端の0も書き出す
+    ci::writeFile(getDocumentPath() / name)->getStream()->writeData(data.data(), data.size());
+#else
     ci::JsonTree save_data;
 
     save_data.addChild(ci::JsonTree("hand_panel", hand_panel))
              .addChild(ci::JsonTree("hand_rotation", hand_rotation))
              .addChild(Json::createArray("waiting_panels", waiting_panels))
-             .addChild(field.serialize())
+             .addChild(Json::createFromField(field))
              .addChild(ci::JsonTree("play_time", play_time_))
              .addChild(Json::createVecVecArray("completed_forests", completed_forests))
              .addChild(Json::createArray("deep_forest", deep_forest))
@@ -470,6 +287,7 @@ struct Game
              .addChild(ci::JsonTree("panel_turned_times", panel_turned_times_))
              .addChild(ci::JsonTree("panel_moved_times", panel_moved_times_))
              .addChild(ci::JsonTree("tutorial", is_tutorial_))
+             .addChild(ci::JsonTree("play_log", play_log_.toHex()))
              ;
 
 
@@ -477,6 +295,7 @@ struct Game
     TextCodec::write((getDocumentPath() / name).string(), save_data.serialize());
 #else
     save_data.write(getDocumentPath() / name);
+#endif
 #endif
 
     DOUT << "Game saved: " << name << std::endl;
@@ -496,48 +315,12 @@ struct Game
       return;
     }
 
-    ci::JsonTree json;
-#if defined (OBFUSCATION_GAME_RECORD)
-    auto text = TextCodec::load(path.string());
-    try
-    {
-      json = ci::JsonTree(text);
-    }
-    catch (ci::JsonTree::ExcJsonParserError&)
-    {
-      DOUT << "Game record broken." << std::endl;
-      return;
-    }
-#else
-    try
-    {
-      json = ci::JsonTree(ci::loadFile(path));
-    }
-    catch (ci::JsonTree::ExcJsonParserError&)
-    {
-      DOUT << "Game record broken." << std::endl;
-      return;
-    }
-#endif
+    // TIPS バイナリ形式は先頭で判別できる
+    bool loaded = isBinaryRecord(path) ? loadRecord(path) : loadJson(path);
+    if (!loaded) return;
 
     count_exec_.clear();
 
-    hand_panel     = json.getValueForKey<int>("hand_panel");
-    hand_rotation  = json.getValueForKey<u_int>("hand_rotation");
-    waiting_panels = Json::getArray<int>(json["waiting_panels"]);
-    field          = Field(json["field"]);
-    play_time_     = json.getValueForKey<double>("play_time");
-    
-    completed_forests = Json::getVecVecArray<glm::ivec2>(json["completed_forests"]);
-    deep_forest       = Json::getArray<u_int>(json["deep_forest"]);
-    completed_path    = Json::getVecVecArray<glm::ivec2>(json["completed_path"]);
-    completed_church  = Json::getVecArray<glm::ivec2>(json["completed_church"]);
-
-    panel_turned_times_ = json.getValueForKey<u_int>("panel_turned_times");
-    panel_moved_times_  = json.getValueForKey<u_int>("panel_moved_times");
-
-    is_tutorial_ = Json::getValue(json, "tutorial", false);
-
     // 完成したパネル群
     std::set<glm::ivec2, LessVec<glm::ivec2>> completed_panels;
     for (const auto& v : completed_forests)
@@ -722,209 +505,94 @@ struct Game
 
 
 private:
-  // フィールドに置くパネルの準備
-  // tutorial_level >= 0 でチュートリアル用の配置
-  void preparationPanel(bool tutorial)
+  // バイナリ形式か調べる
+  static bool isBinaryRecord(const ci::fs::path& path) noexcept
   {
-    if (tutorial)
-    {
-      // チュートリアル用準備
-      waiting_panels = Json::getArray<int>(params_["tutorial"]);
-      // NOTICE 順番はあらかじめ用意されている
-      start_panel_ = waiting_panels[0];
-      waiting_panels.erase(std::begin(waiting_panels));
-      // FIXME Tutorialであることを覚えたくない
-      is_tutorial_ = true;
-    }
-    else
-    {
-      // パネルを通し番号で用意
-      waiting_panels.resize(panels_.size());
-      std::iota(std::begin(waiting_panels), std::end(waiting_panels), 0);
-
-      // 開始パネルを探す
-      std::vector<int> start_panels;
-      for (int i = 0; i < panels_.size(); ++i)
-      {
-        if (panels_[i].getAttribute() & Panel::START)
-        {
-          start_panels.push_back(i);
-        }
-      }
-      assert(!start_panels.empty());
-
-      if (start_panels.size() > 1)
-      {
-        // 開始パネルが何枚かある時はシャッフル
-        std::shuffle(std::begin(start_panels), std::end(start_panels), engine_);
-      }
-      start_panel_ = start_panels[0];
-
-      {
-        // 最初に置くパネルを取り除いてからシャッフル
-        auto it = std::find(std::begin(waiting_panels), std::end(waiting_panels), start_panel_);
-        assert(it != std::end(waiting_panels));
-        waiting_panels.erase(it);
+    std::ifstream fstr(path.string(), std::ios::binary);
+    std::string head(5, '\0');
+    fstr.read(&head[0], head.size());
+    return GameRecord::isRecord(head);
+  }
 
-        std::shuffle(std::begin(waiting_panels), std::end(waiting_panels), engine_);
-      }
-    }
+  // バイナリ形式の記録を読み込む
+  // TIPS 完成した区画などは置き直して計算する
+  bool loadRecord(const ci::fs::path& path) noexcept
+  {
+    std::ifstream fstr(path.string(), std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(fstr)),
+                     std::istreambuf_iterator<char>());
 
-#if defined (DEBUG)
-    auto force_panel = params_.getValueForKey<int>("force_panel");
-    if (force_panel > 0)
+    GameRecord record;
+    if (!record.deserialize(data) || !restoreRecord(record))
     {
-      // パネル枚数を強制的に変更
-      waiting_panels.resize(force_panel);
+      DOUT << "Game record broken." << std::endl;
+      return false;
     }
-#endif
-  }
+    play_time_ = record.play_time;
 
-  // 制限時間無し
-  void invalidTimeLimit() noexcept
-  {
-    time_limited_ = false;
+    return true;
   }
 
-  bool getNextPanel() noexcept
+  // JSON形式の記録を読み込む
+  bool loadJson(const ci::fs::path& path) noexcept
   {
-    if (waiting_panels.empty()) return false;
-
-    // 先頭から順に置けるかどうか調べる
-    size_t i;
-    for (i = 0; i < waiting_panels.size(); ++i)
+    ci::JsonTree json;
+#if defined (OBFUSCATION_GAME_RECORD)
+    auto text = TextCodec::load(path.string());
+    try
     {
-      if (canPanelPutField(panels_[waiting_panels[i]], blank_, field)) break;
+      json = ci::JsonTree(text);
     }
-
-    if (i == waiting_panels.size())
+    catch (ci::JsonTree::ExcJsonParserError&)
     {
-      // 全く置けない(積んだ)
+      DOUT << "Game record broken." << std::endl;
       return false;
     }
-
-    hand_panel    = waiting_panels[i];
-    hand_rotation = ci::randInt(4);
-
-    // コンテナから削除
-    waiting_panels.erase(std::begin(waiting_panels) + i);
-
-    DOUT << "Next panel: " << hand_panel << "(index: " << i << ")" << std::endl;
-
-    return true;
-  }
-
-  // 各種情報を収集
-  void fieldUpdate() noexcept
-  {
-    blank_ = field.searchBlank();
-  }
-
-  // スコア更新
-  void updateScores() noexcept
-  {
-    // FIXME MagicNumber
-    scores_[0] = int(completed_path.size());
-    scores_[1] = countTotalAttribute(completed_path, field, panels_);
-    scores_[2] = int(completed_forests.size());
-    scores_[3] = countTotalAttribute(completed_forests, field, panels_);
-    scores_[4] = int(std::count_if(std::begin(deep_forest), std::end(deep_forest),
-                                   [](int x) { return x > 0; }));
-    scores_[5] = countTown(completed_path, field, panels_);
-    scores_[6] = int(completed_church.size());
-  }
-
-
-  void calcResults() noexcept
-  {
-    total_score   = calcTotalScore();
-    total_ranking = calcRanking(total_score);
-  }
-
-  // 最終スコア
-  u_int calcTotalScore() const noexcept
-  {
-    // 道と森の計算用
-    auto panel_rate  = Json::getVec<glm::vec2>(params_["panel_rate"]);
-    auto score_rates = Json::getArray<float>(params_["score_rates"]);
-
-    float score = 0;
-
-    // 道の計算
-    // TIPS 長い道ほど指数関数的に得点が上がる
-    auto path_score = std::accumulate(std::begin(completed_path), std::end(completed_path),
-                                      0.0f,
-                                      [this, &panel_rate, &score_rates](auto value, const auto& path)
-                                      {
-                                        auto s = std::pow(float(path.size()), panel_rate.x) * panel_rate.y * score_rates[0];
-                                        DOUT << path.size() << " : " << s << std::endl;
-                                        return value + s;
-                                      });
-    DOUT << "Path: " << path_score << std::endl;
-    score += path_score;
-
-    // 森の計算
-    // TIPS 面積が大きいほど指数関数的に得点が上がる
-    float forest_score = 0;
-    size_t index = 0;
-    for (const auto& forest : completed_forests)
+#else
+    try
     {
-      auto count = forest.size() + deep_forest[index] * score_rates[2];
-      float s = std::pow(float(count), panel_rate.x) * panel_rate.y * score_rates[1];
-      forest_score += s;
-      DOUT << forest.size() << "(" << deep_forest[index] << ") : " << s << std::endl;
-
-      ++index;
+      json = ci::JsonTree(ci::loadFile(path));
     }
-    score += forest_score;
-    DOUT << "Forest: " << forest_score << std::endl;
-
-    // 深い森の数
-    // float df_score = scores_[4] * score_rates[2];
-    // score += df_score;
-    // DOUT << "Deep forest: " << df_score << std::endl;
-
-    // 街の数
-    float town_score = scores_[5] * score_rates[3];
-    score += town_score;
-    DOUT << "Town forest: " << town_score << std::endl;
-
-    // 教会
-    float church_score = scores_[6] * score_rates[4];
-    score += church_score;
-    DOUT << "Church: " << church_score << std::endl;
-
-    // パネル設置数
-    score += total_panels * score_rates[5];
-    DOUT << "Panels: " << score << std::endl;
-
-    // Perfect
-    if (waiting_panels.empty() && !is_tutorial_)
+    catch (ci::JsonTree::ExcJsonParserError&)
     {
-      DOUT << "perfect!!" << std::endl;
-      score *= params_.getValueForKey<float>("perfect_score_rate");
+      DOUT << "Game record broken." << std::endl;
+      return false;
     }
-#if defined (DEBUG)
-    // テスト用にスコアを上書き
-    score = Json::getValue(params_, "test_score", score);
 #endif
-    return score;
-  }
 
-  // ランキングを決める
-  u_int calcRanking(int score) const noexcept
-  {
-    auto rate = Json::getVec<glm::vec3>(params_["ranking_rate"]);
-    u_int rank;
-    // FIXME Magic Number
-    for (rank = 0; rank < 9; ++rank)
+    hand_panel     = json.getValueForKey<int>("hand_panel");
+    hand_rotation  = json.getValueForKey<u_int>("hand_rotation");
+    waiting_panels = Json::getArray<int>(json["waiting_panels"]);
+    field          = Json::getField(json["field"]);
+    rebuildRegions();
+    play_time_     = json.getValueForKey<double>("play_time");
+    
+    completed_forests = Json::getVecVecArray<glm::ivec2>(json["completed_forests"]);
+    deep_forest       = Json::getArray<u_int>(json["deep_forest"]);
+    completed_path    = Json::getVecVecArray<glm::ivec2>(json["completed_path"]);
+    completed_church  = Json::getVecArray<glm::ivec2>(json["completed_church"]);
+
+    panel_turned_times_ = json.getValueForKey<u_int>("panel_turned_times");
+    panel_moved_times_  = json.getValueForKey<u_int>("panel_moved_times");
+
+    is_tutorial_ = Json::getValue(json, "tutorial", false);
+
+    // NOTICE 古い記録には操作記録が無い
+    play_log_.clear();
+    if (json.hasChild("play_log")
+        && !play_log_.fromHex(json.getValueForKey<std::string>("play_log")))
     {
-      // ランク後半ほど高得点が必要になる
-      int s = std::pow(rate.x, rank * rate.y) * rate.z;
-      if (score < s) break;
+      DOUT << "Play log broken." << std::endl;
+      play_log_.clear();
     }
 
-    return rank;
+    return true;
+  }
+
+  // 制限時間無し
+  void invalidTimeLimit() noexcept
+  {
+    time_limited_ = false;
   }
 
   // スコアを送信
@@ -958,12 +626,7 @@ private:
   // パネルを追加してイベント送信
   void putPanel(int panel, const glm::ivec2& pos, u_int rotation, bool first = false) noexcept
   {
-    // Panel端をここで調べる
-    const auto p = panels_[panel];
-    auto edge = p.getRotatedEdgeValue(rotation);
-    field.addPanel(panel, pos, rotation, edge);
-    //置ける場所を探す
-    blank_ = field.searchBlank();
+    GameCore::putPanel(panel, pos, rotation);
 
     {
       Arguments args{
@@ -983,9 +646,6 @@ private:
   // FIXME 参照で持つのいくない
   const ci::JsonTree& params_;
   Event<Arguments>& event_;
-  const std::vector<Panel>& panels_;
-
-  std::mt19937 engine_;
 
   CountExec count_exec_;
 
@@ -1000,46 +660,6 @@ private:
   bool time_count = true;
 #endif
 
-  bool is_tutorial_ = false;
-
-  // 配置するパネル
-  std::vector<int> waiting_panels;
-  // 最初に中央に配置するパネル
-  int start_panel_;
-  // 手持ちのパネル
-  int hand_panel;
-  u_int hand_rotation;
-
-  Field field;
-  
-  // 列挙した置ける箇所
-  std::vector<glm::ivec2> blank_;
-
-  // 完成した森
-  std::vector<std::vector<glm::ivec2>> completed_forests;
-  // 深い森
-  std::vector<u_int> deep_forest;
-  // 完成した道
-  std::vector<std::vector<glm::ivec2>> completed_path;
-  // 完成した教会
-  std::vector<glm::ivec2> completed_church;
-
-  // パネルを回した回数
-  u_int panel_turned_times_ = 0;
-  // パネルを移動した回数
-  u_int panel_moved_times_ = 0;
-
-  // スコア
-  std::vector<u_int> scores_;
-  u_int total_score   = 0;
-  u_int total_ranking = 0;
-  u_int total_panels  = 0;
-
-  // 最長道
-  u_int max_path_ = 0;
-  // 最大森
-  u_int max_forest_ = 0;
-
 #if defined (DEBUG)
 public:
   // 読み込んだパス
@@ -0,0 +1,1102 @@
+﻿#pragma once
+
+//
+// ゲーム本編のルール部分
+//   Cinderに依存しないので、ツールやサーバー側からも使える
+//   イベント送信や保存はGameが受け持つ
+//   putHandPanelで置いたパネルは、snapshot/restoreで置く前に戻せる(探索用)
+//
+
+#include "Defines.hpp"
+#include <vector>
+#include <tuple>
+#include <random>
+#include <array>
+#include <numeric>
+#include <cmath>
+#include <memory>
+#include <glm/glm.hpp>
+#include "Logic.hpp"
+#include "RegionTracker.hpp"
+#include "CompletionSearch.hpp"
+#include "PlacementCache.hpp"
+#include "PlayLog.hpp"
+#include "GameRecord.hpp"
+
+
+namespace ngs {
+
+// 得点計算のパラメーター
+struct ScoreParams
+{
+  glm::vec2 panel_rate;
+  std::vector<float> score_rates;
+  float perfect_score_rate;
+  glm::vec3 ranking_rate;
+
+  // 区画の大きさごとの pow(大きさ, panel_rate.x) * panel_rate.y
+  // TIPS prepareScoreTable で作っておけば、コピーしたゲーム同士で共有する
+  std::shared_ptr<const std::vector<float>> size_scores;
+
+#if defined (DEBUG)
+  // テスト用にスコアを上書き(負数は無効)
+  float test_score = -1.0f;
+#endif
+};
+
+// 区画の大きさごとの得点の表を作る
+// 表より大きい区画はその都度計算する
+void prepareScoreTable(ScoreParams& params, size_t num_panels) noexcept
+{
+  // NOTICE 端のあるパネルは区画に何度か含まれる
+  auto table = std::make_shared<std::vector<float>>(num_panels * 5 + 1);
+  for (size_t i = 0; i < table->size(); ++i)
+  {
+    (*table)[i] = std::pow(float(i), params.panel_rate.x) * params.panel_rate.y;
+  }
+  params.size_scores = std::move(table);
+}
+
+
+class GameCore
+{
+public:
+  // パネルを置いて完成したもの
+  struct Completed
+  {
+    std::vector<std::vector<glm::ivec2>> forests;
+    std::vector<std::vector<glm::ivec2>> path;
+    std::vector<glm::ivec2> church;
+
+    bool empty() const noexcept
+    {
+      return forests.empty() && path.empty() && church.empty();
+    }
+  };
+
+  // 状態の目印
+  // NOTICE パネルの回転を決める乱数も含む
+  struct Snapshot
+  {
+    size_t depth;
+    u_int hand_rotation;
+    u_int panel_turned_times;
+    u_int panel_moved_times;
+    u_int total_score;
+    u_int total_ranking;
+    std::mt19937 engine;
+  };
+
+
+  // NOTICE 乱数の種が同じなら、パネルの順番や回転も同じになる
+  GameCore(const std::vector<Panel>& panels, const ScoreParams& score_params, uint32_t seed) noexcept
+    : panels_(panels),
+      score_params_(score_params),
+      placement_(panels),
+      search_(panels.size()),
+      engine_(seed),
+      position_engine_(~seed),
+      town_counted_(panels.size(), 0),
+      scores_(7, 0)
+  {
+    if (!score_params_.size_scores) prepareScoreTable(score_params_, panels.size());
+
+    play_log_.seed = seed;
+    play_log_.entries.reserve(panels.size());
+
+    // パネルを置いた時に領域を確保しなくて済むように
+    field.reserve(panels.size());
+    forest_region_.reserve(panels.size());
+    path_region_.reserve(panels.size());
+    town_history_.reserve(panels.size());
+    history_.reserve(panels.size());
+    // NOTICE 区画はパネル１枚につき最大４つ
+    completed_forests.reserve(panels.size() * 4);
+    deep_forest.reserve(panels.size() * 4);
+    completed_path.reserve(panels.size() * 4);
+    completed_church.reserve(panels.size());
+    region_pool_.reserve(panels.size() * 4 * 2);
+  }
+
+  ~GameCore() = default;
+
+
+  // フィールドに置くパネルの準備
+  void preparationPanel() noexcept
+  {
+    // パネルを通し番号で用意
+    waiting_panels.resize(panels_.size());
+    std::iota(std::begin(waiting_panels), std::end(waiting_panels), 0);
+
+    // 開始パネルを探す
+    std::vector<int> start_panels;
+    for (int i = 0; i < panels_.size(); ++i)
+    {
+      if (panels_[i].getAttribute() & Panel::START)
+      {
+        start_panels.push_back(i);
+      }
+    }
+    assert(!start_panels.empty());
+
+    if (start_panels.size() > 1)
+    {
+      // 開始パネルが何枚かある時はシャッフル
+      std::shuffle(std::begin(start_panels), std::end(start_panels), engine_);
+    }
+    start_panel_ = start_panels[0];
+
+    {
+      // 最初に置くパネルを取り除いてからシャッフル
+      auto it = std::find(std::begin(waiting_panels), std::end(waiting_panels), start_panel_);
+      assert(it != std::end(waiting_panels));
+      waiting_panels.erase(it);
+
+      std::shuffle(std::begin(waiting_panels), std::end(waiting_panels), engine_);
+    }
+  }
+
+  // チュートリアル用準備
+  // NOTICE 順番はあらかじめ用意されている
+  void preparationPanel(const std::vector<int>& panels) noexcept
+  {
+    waiting_panels = panels;
+    start_panel_   = waiting_panels[0];
+    waiting_panels.erase(std::begin(waiting_panels));
+    // FIXME Tutorialであることを覚えたくない
+    is_tutorial_ = true;
+  }
+
+  // 最初のパネルを設置して、次のパネルを決める
+  bool putFirstPanel() noexcept
+  {
+    putPanel(start_panel_, { 0, 0 }, randomRotation());
+    return getNextPanel();
+  }
+
+  // 手持ちのパネルを置く
+  // 次のパネルが無ければfalse
+  bool putHandPanel(const glm::ivec2& field_pos, double time = 0.0) noexcept
+  {
+    saveStep();
+    play_log_.add(hand_panel, field_pos, hand_rotation, time);
+    total_panels += 1;
+    putPanel(hand_panel, field_pos, hand_rotation);
+    updateCompleted(field_pos);
+
+    return getNextPanel();
+  }
+
+
+  // パネルが置けるか調べる
+  bool canPutToBlank(const glm::ivec2& field_pos) const noexcept
+  {
+    return field.isBlank(field_pos)
+           && canPutPanel(panels_[hand_panel], field_pos, hand_rotation, field);
+  }
+
+  // そこにblankがあるか？
+  bool isBlank(const glm::ivec2& field_pos) const noexcept
+  {
+    return field.isBlank(field_pos);
+  }
+
+  bool isPanel(const glm::ivec2& field_pos) const
+  {
+    return field.existsPanel(field_pos);
+  }
+
+  // 状況チェック
+  // 新しく完成したものを返す
+  Completed checkFieldStatus(const glm::ivec2& field_pos) noexcept
+  {
+    auto forests = completed_forests.size();
+    auto path    = completed_path.size();
+    auto church  = completed_church.size();
+    updateCompleted(field_pos);
+
+    Completed result;
+    result.forests.assign(std::begin(completed_forests) + forests, std::end(completed_forests));
+    result.path.assign(std::begin(completed_path) + path, std::end(completed_path));
+    result.church.assign(std::begin(completed_church) + church, std::end(completed_church));
+    return result;
+  }
+
+  void rotationHandPanel() noexcept
+  {
+    hand_rotation = (hand_rotation + 1) % 4;
+    panel_turned_times_ += 1;
+  }
+
+  void moveHandPanel(const glm::vec2& pos) noexcept
+  {
+    panel_moved_times_ += 1;
+  }
+
+  // 手持ちパネル情報
+  u_int getHandPanel() const noexcept
+  {
+    return hand_panel;
+  }
+
+  u_int getHandRotation() const noexcept
+  {
+    return hand_rotation;
+  }
+
+  // 手持ちパネルのエッジ情報
+  uint64_t getHandPanelEdge() const noexcept
+  {
+    const auto& p = panels_[hand_panel];
+    return p.getRotatedEdgeValue(hand_rotation);
+  }
+
+
+  // 配置可能な場所
+  const std::vector<glm::ivec2>& getBlankPositions() const noexcept
+  {
+    return field.getBlankPositions();
+  }
+
+  // パネルを置く場所を適当に決める
+  glm::ivec2 getNextPanelPosition(const glm::ivec2& put_pos) noexcept
+  {
+    auto positions = getBlankPositions();
+    // 適当に並び替える
+    // TIPS 表示の都合で呼ばれるので、ゲーム本体の乱数は使わない
+    std::shuffle(std::begin(positions), std::end(positions), position_engine_);
+
+    // 置いた場所から一番距離の近い場所を選ぶ
+    auto it = std::min_element(std::begin(positions), std::end(positions),
+                               [put_pos](const glm::ivec2& a, const glm::ivec2& b) noexcept
+                               {
+                                 // FIXME 整数型のベクトルだとdistance2とかdotとかが使えない
+                                 auto da = put_pos - a;
+                                 auto db = put_pos - b;
+
+                                 return (da.x * da.x + da.y * da.y) < (db.x * db.x + db.y * db.y);
+                               });
+
+    return *it;
+  }
+
+  // 指定属性のパネルを探す
+  std::tuple<bool, glm::ivec2, int> searchAttribute(u_int attribute, u_int edge) const
+  {
+    uint64_t e = edge;
+    uint64_t edge_bundled = e | (e << 16) | (e << 32) | (e << 48);
+
+    const auto& panel_positions = field.getPanelPositions();
+    auto it = std::find_if(std::begin(panel_positions), std::end(panel_positions),
+                           [this, attribute, edge_bundled](const glm::ivec2& pos)
+                           {
+                             const auto& status = field.getPanelStatus(pos);
+                             const auto& panel  = panels_[status.number];
+
+                             return (panel.getAttribute() & attribute) || (edge_bundled & status.edge);
+                           });
+
+    if (it == std::end(panel_positions))
+    {
+      return std::make_tuple(false, glm::ivec2(0), 0);
+    }
+
+    // edge情報をゲット
+    int rotate = 0;
+    if (edge)
+    {
+      const auto& status = field.getPanelStatus(*it);
+      auto rotated_edge  = status.edge;
+
+      for ( ; rotate < 4; ++rotate)
+      {
+        if (rotated_edge & e)
+        {
+          break;
+        }
+        // NOTICE 事前に定義した変数を変更している
+        e <<= 16;
+      }
+    }
+
+    return std::make_tuple(true, *it, rotate);
+  }
+
+  // 指定属性のパネルを探す
+  std::vector<glm::ivec2> searchPanels(u_int attribute) const
+  {
+    const auto& panel_positions = field.getPanelPositions();
+
+    std::vector<glm::ivec2> positions;
+    for (const auto& p : panel_positions)
+    {
+      const auto& status = field.getPanelStatus(p);
+      const auto& panel  = panels_[status.number];
+      if (panel.getAttribute() & attribute) positions.push_back(p);
+    }
+
+    return positions;
+  }
+
+  // こちらはEdge版
+  std::vector<glm::ivec2> searchPanelsAtEdge(u_int attribute) const
+  {
+    const auto& panel_positions = field.getPanelPositions();
+    uint64_t e = attribute;
+    uint64_t edge_bundled = e | (e << 16) | (e << 32) | (e << 48);
+
+    std::vector<glm::ivec2> positions;
+    for (const auto& p : panel_positions)
+    {
+      const auto& status = field.getPanelStatus(p);
+      if (status.edge & edge_bundled) positions.push_back(p);
+    }
+
+    return positions;
+  }
+
+  // フィールド上のパネルのEdge状態を取得(回転込み)
+  uint64_t getPanelEdge(const glm::ivec2& pos) const
+  {
+    const auto& status = field.getPanelStatus(pos);
+    return status.edge;
+  }
+
+
+  void calcResults() noexcept
+  {
+    total_score   = calcTotalScore();
+    total_ranking = calcRanking(total_score);
+
+    // 完成した区画から計算し直したものと一致するか確認
+    assert(total_score == recalcTotalScore());
+  }
+
+  // 完成した区画から最終スコアを計算し直す
+  // TIPS 逐次計算した得点の確認用
+  u_int recalcTotalScore() const noexcept
+  {
+    const auto& score_rates = score_params_.score_rates;
+
+    // 道の計算
+    // TIPS 長い道ほど指数関数的に得点が上がる
+    auto path_score = std::accumulate(std::begin(completed_path), std::end(completed_path),
+                                      0.0f,
+                                      [this](auto value, const auto& path)
+                                      {
+                                        auto s = calcPathScore(path.size());
+                                        DOUT << path.size() << " : " << s << std::endl;
+                                        return value + s;
+                                      });
+
+    // 森の計算
+    // TIPS 面積が大きいほど指数関数的に得点が上がる
+    float forest_score = 0;
+    size_t index = 0;
+    for (const auto& forest : completed_forests)
+    {
+      float s = calcForestScore(forest.size(), deep_forest[index]);
+      forest_score += s;
+      DOUT << forest.size() << "(" << deep_forest[index] << ") : " << s << std::endl;
+
+      ++index;
+    }
+
+    // 街の数
+    float town_score = countTown(completed_path, field, panels_) * score_rates[3];
+
+    // 教会
+    float church_score = completed_church.size() * score_rates[4];
+
+    return composeScore(path_score, forest_score, town_score, church_score);
+  }
+
+  // NOTICE calcResultsの後で有効
+  u_int getTotalScore() const noexcept
+  {
+    return total_score;
+  }
+
+  u_int getTotalRanking() const noexcept
+  {
+    return total_ranking;
+  }
+
+  u_int getTotalPanels() const noexcept
+  {
+    return total_panels;
+  }
+
+  // 全てのパネルを置いた
+  bool isPerfect() const noexcept
+  {
+    return waiting_panels.empty() && !is_tutorial_;
+  }
+
+  const Field& getField() const noexcept
+  {
+    return field;
+  }
+
+  // 操作記録
+  const PlayLog& getPlayLog() const noexcept
+  {
+    return play_log_;
+  }
+
+  uint32_t getSeed() const noexcept
+  {
+    return play_log_.seed;
+  }
+
+
+  // 保存用の記録
+  // NOTICE 完成した区画などは含まない(読み込む時に計算し直す)
+  GameRecord createRecord() const noexcept
+  {
+    GameRecord record;
+    record.hand_panel     = hand_panel;
+    record.hand_rotation  = hand_rotation;
+    record.waiting_panels = waiting_panels;
+
+    const auto& positions = field.getPanelPositions();
+    record.field.reserve(positions.size());
+    for (const auto& pos : positions)
+    {
+      const auto& status = field.getPanelStatus(pos);
+      record.field.push_back({ status.number, pos, status.rotation });
+    }
+
+    record.panel_turned_times = panel_turned_times_;
+    record.panel_moved_times  = panel_moved_times_;
+    record.tutorial           = is_tutorial_;
+    record.play_log           = play_log_;
+
+    return record;
+  }
+
+  // 記録から復元
+  // パネルを置いた順番に置き直して、完成した区画と得点を計算し直す
+  // 置けない場所に置いていたらfalse
+  // NOTICE それまでの盤面は消える
+  bool restoreRecord(const GameRecord& record) noexcept
+  {
+    field = Field();
+    field.reserve(panels_.size());
+    rebuildRegions();
+
+    recycleRegions(completed_forests, 0);
+    deep_forest.clear();
+    recycleRegions(completed_path, 0);
+    completed_church.clear();
+    total_panels = 0;
+    updateScores();
+
+    for (size_t i = 0; i < record.field.size(); ++i)
+    {
+      const auto& p = record.field[i];
+      if ((p.panel < 0) || (size_t(p.panel) >= panels_.size())) return false;
+
+      if (i == 0)
+      {
+        putPanel(p.panel, p.pos, p.rotation);
+        continue;
+      }
+
+      if (!isBlank(p.pos) || !canPutPanel(panels_[p.panel], p.pos, p.rotation, field)) return false;
+
+      total_panels += 1;
+      putPanel(p.panel, p.pos, p.rotation);
+      updateCompleted(p.pos);
+    }
+
+    hand_panel          = record.hand_panel;
+    hand_rotation       = record.hand_rotation;
+    waiting_panels      = record.waiting_panels;
+    panel_turned_times_ = record.panel_turned_times;
+    panel_moved_times_  = record.panel_moved_times;
+    is_tutorial_        = record.tutorial;
+
+    // NOTICE 古い記録には操作記録が無い
+    play_log_.clear();
+    if (!record.play_log.entries.empty()) play_log_ = record.play_log;
+
+    calcResults();
+    return true;
+  }
+
+
+  // 今の状態を覚える
+  Snapshot snapshot() const noexcept
+  {
+    return { history_.size(),
+             hand_rotation, panel_turned_times_, panel_moved_times_,
+             total_score, total_ranking,
+             engine_ };
+  }
+
+  // 覚えた状態まで戻す
+  // TIPS 置いたパネルの分だけ戻すので、盤面を丸ごと複製するより速い
+  // NOTICE 同じゲームで、後から覚えた状態へは戻せない
+  void restore(const Snapshot& snapshot) noexcept
+  {
+    assert(snapshot.depth <= history_.size());
+    while (history_.size() > snapshot.depth)
+    {
+      undoStep();
+    }
+
+    hand_rotation       = snapshot.hand_rotation;
+    panel_turned_times_ = snapshot.panel_turned_times;
+    panel_moved_times_  = snapshot.panel_moved_times;
+    total_score         = snapshot.total_score;
+    total_ranking       = snapshot.total_ranking;
+    engine_             = snapshot.engine;
+
+    prepareRegionPool();
+  }
+
+
+protected:
+  bool getNextPanel() noexcept
+  {
+    if (waiting_panels.empty()) return false;
+
+    // 先頭から順に置けるかどうか調べる
+    size_t i;
+    for (i = 0; i < waiting_panels.size(); ++i)
+    {
+      bool fit = placement_.isPlaceable(waiting_panels[i]);
+      assert(fit == canPanelPutField(panels_[waiting_panels[i]], field.getBlankPositions(), field));
+      if (fit) break;
+    }
+
+    if (i == waiting_panels.size())
+    {
+      // 全く置けない(積んだ)
+      return false;
+    }
+    if (!history_.empty()) history_.back().waiting_index = i;
+
+    hand_panel    = waiting_panels[i];
+    hand_rotation = randomRotation();
+
+    // コンテナから削除
+    waiting_panels.erase(std::begin(waiting_panels) + i);
+
+    DOUT << "Next panel: " << hand_panel << "(index: " << i << ")" << std::endl;
+
+    return true;
+  }
+
+  u_int randomRotation() noexcept
+  {
+    std::uniform_int_distribution<u_int> dist(0, 3);
+    return dist(engine_);
+  }
+
+  // パネルを追加
+  void putPanel(int panel, const glm::ivec2& pos, u_int rotation) noexcept
+  {
+    // Panel端をここで調べる
+    const auto& p = panels_[panel];
+    auto edge = p.getRotatedEdgeValue(rotation);
+    field.addPanel(panel, pos, rotation, edge);
+    forest_region_.addPanel(pos, p, rotation);
+    path_region_.addPanel(pos, p, rotation);
+    placement_.addPanel(pos, field);
+  }
+
+  // 森と道のつながり、パネルの置ける場所を作り直す
+  // NOTICE 作り直す前の状態には戻せない
+  void rebuildRegions() noexcept
+  {
+    history_.clear();
+    placement_.rebuild(field);
+
+    forest_region_.clear();
+    path_region_.clear();
+    forest_region_.reserve(panels_.size());
+    path_region_.reserve(panels_.size());
+
+    for (const auto& pos : field.getPanelPositions())
+    {
+      const auto& status = field.getPanelStatus(pos);
+      forest_region_.addPanel(pos, panels_[status.number], status.rotation);
+      path_region_.addPanel(pos, panels_[status.number], status.rotation);
+    }
+  }
+
+  // 完成した森や道を調べて completed へ追加する
+  // TIPS 完成した区画がある時だけパネルを列挙する
+  //      追加する入れ物は使い回すので割り当てが起きない(prepareRegionPool 参照)
+  void appendCompleted(RegionTracker& region, u_int attribute, const glm::ivec2& pos,
+                       std::vector<std::vector<glm::ivec2>>& completed) noexcept
+  {
+#if !defined (NDEBUG)
+    auto first = completed.size();
+#endif
+    if (region.isCompleted(pos))
+    {
+      search_.search(attribute, pos, field, panels_);
+      for (size_t i = 0; i < search_.size(); ++i)
+      {
+        auto cells = search_[i];
+        completed.push_back(takeRegion());
+        completed.back().assign(std::begin(cells), std::end(cells));
+      }
+    }
+
+#if !defined (NDEBUG)
+    // 総当たり版と一致するか確認
+    auto expected = isCompleteAttribute(attribute, pos, field, panels_);
+    assert(std::equal(std::begin(completed) + first, std::end(completed), std::begin(expected), std::end(expected)));
+#endif
+  }
+
+  // 完成した区画を調べて追加し、得点を更新する
+  void updateCompleted(const glm::ivec2& field_pos) noexcept
+  {
+    auto forests = completed_forests.size();
+    auto path    = completed_path.size();
+    auto church  = completed_church.size();
+
+    // 森完成チェック
+    appendCompleted(forest_region_, Panel::FOREST, field_pos, completed_forests);
+    if (completed_forests.size() > forests)
+    {
+      DOUT << "Forest: " << (completed_forests.size() - forests) << '\n';
+      u_int deep_num = 0;
+      size_t max_size = 0;
+      for (auto it = std::begin(completed_forests) + forests; it != std::end(completed_forests); ++it)
+      {
+        // 深い森
+        auto deep = countDeepForest(*it, field, panels_);
+        deep_num += deep;
+        deep_forest.push_back(deep);
+        max_size = std::max(max_size, it->size());
+
+        DOUT << " Point: " << it->size() << '\n';
+        DOUT << "  Deep: " << deep << '\n';
+      }
+
+      // 最大森
+      // NOTICE 今回完成したものの中での最大
+      max_forest_ = u_int(max_size);
+
+      DOUT << "Total Deep: " << deep_num << '\n';
+      DOUT << "Max forest: " << max_forest_ << '\n';
+      DOUT << std::endl;
+    }
+
+    // 道完成チェック
+    appendCompleted(path_region_, Panel::PATH, field_pos, completed_path);
+    if (completed_path.size() > path)
+    {
+      DOUT << "  Path: " << (completed_path.size() - path) << '\n';
+      size_t max_size = 0;
+      for (auto it = std::begin(completed_path) + path; it != std::end(completed_path); ++it)
+      {
+        max_size = std::max(max_size, it->size());
+      }
+      max_path_ = u_int(max_size);
+
+      DOUT << "Max path: " << max_path_;
+      DOUT << std::endl;
+    }
+
+    // 教会完成チェック
+    appendCompleteChurch(field_pos, field, panels_, completed_church);
+    if (completed_church.size() > church)
+    {
+      DOUT << "Church: " << (completed_church.size() - church) << std::endl;
+    }
+
+    // スコア更新
+    addScores(forests, path, church);
+  }
+
+  // 完成した区画の入れ物
+  // TIPS 取り除いた区画の入れ物は捨てずに使い回す
+  std::vector<glm::ivec2> takeRegion() noexcept
+  {
+    if (region_pool_.empty()) return {};
+
+    auto region = std::move(region_pool_.back());
+    region_pool_.pop_back();
+    return region;
+  }
+
+  // completed を num 個に減らして、入れ物を戻す
+  void recycleRegions(std::vector<std::vector<glm::ivec2>>& completed, size_t num) noexcept
+  {
+    while (completed.size() > num)
+    {
+      auto& region = completed.back();
+      region.clear();
+      // TIPS 区画の大きさはパネルの枚数を超えない
+      region.reserve(panels_.size());
+      region_pool_.push_back(std::move(region));
+      completed.pop_back();
+    }
+  }
+
+  // 区画の入れ物を最大数まで用意しておく
+  // TIPS 以降は putHandPanel で割り当てが起きない
+  void prepareRegionPool() noexcept
+  {
+    auto num = completed_forests.size() + completed_path.size() + region_pool_.size();
+    auto max_num = region_pool_.capacity();
+    for (; num < max_num; ++num)
+    {
+      std::vector<glm::ivec2> region;
+      region.reserve(panels_.size());
+      region_pool_.push_back(std::move(region));
+    }
+  }
+
+  // スコアを作り直す
+  // NOTICE 完成した区画を読み込んだ後に呼ぶ
+  void updateScores() noexcept
+  {
+    std::fill(std::begin(scores_), std::end(scores_), 0);
+    std::fill(std::begin(town_counted_), std::end(town_counted_), 0);
+    town_history_.clear();
+    path_score_   = 0.0f;
+    forest_score_ = 0.0f;
+
+    // NOTICE 深い森の数は読み込み済み
+    addScores(0, 0, 0);
+  }
+
+  // 新しく完成した区画の分だけスコアを加える
+  //   forests/path/church: 新しく完成した区画の先頭
+  // NOTICE completed_forests などと deep_forest には追加済みであること
+  void addScores(size_t forests, size_t path, size_t church) noexcept
+  {
+    // FIXME MagicNumber
+    scores_[0] += u_int(completed_path.size() - path);
+    scores_[1] += search_.countTotalAttribute(completed_path, field, path);
+    scores_[2] += u_int(completed_forests.size() - forests);
+    scores_[3] += search_.countTotalAttribute(completed_forests, field, forests);
+    scores_[6] += u_int(completed_church.size() - church);
+
+    // TIPS 完成した順に足していくので、まとめて計算した時と同じ値になる
+    for (size_t i = forests; i < completed_forests.size(); ++i)
+    {
+      auto deep = deep_forest[i];
+      if (deep > 0) scores_[4] += 1;
+      forest_score_ += calcForestScore(completed_forests[i].size(), deep);
+    }
+
+    for (size_t i = path; i < completed_path.size(); ++i)
+    {
+      path_score_ += calcPathScore(completed_path[i].size());
+      scores_[5] += countNewTown(completed_path[i]);
+    }
+
+    // 総当たり版と一致するか確認
+    assert(scores_[1] == countTotalAttribute(completed_path, field, panels_));
+    assert(scores_[3] == countTotalAttribute(completed_forests, field, panels_));
+    assert(scores_[5] == countTown(completed_path, field, panels_));
+  }
+
+  // まだ数えていない街を数える
+  u_int countNewTown(const std::vector<glm::ivec2>& path) noexcept
+  {
+    u_int num = 0;
+    for (const auto& p : path)
+    {
+      const auto& status = field.getPanelStatus(p);
+      if (!(panels_[status.number].getAttribute() & Panel::BUILDING)) continue;
+
+      auto& counted = town_counted_[status.index];
+      if (counted) continue;
+
+      counted = 1;
+      num += 1;
+      town_history_.push_back(status.index);
+    }
+    return num;
+  }
+
+  // パネルを置く前の状態を覚える
+  void saveStep() noexcept
+  {
+    Step step;
+    step.hand_panel     = hand_panel;
+    step.waiting_index  = NOT_TAKEN;
+    step.total_panels   = total_panels;
+    step.forests        = completed_forests.size();
+    step.path           = completed_path.size();
+    step.church         = completed_church.size();
+    step.towns          = town_history_.size();
+    step.max_path       = max_path_;
+    step.max_forest     = max_forest_;
+    step.path_score     = path_score_;
+    step.forest_score   = forest_score_;
+    std::copy(std::begin(scores_), std::end(scores_), std::begin(step.scores));
+
+    history_.push_back(step);
+  }
+
+  // 最後に置いたパネルを取り除く
+  void undoStep() noexcept
+  {
+    const auto& step = history_.back();
+
+    // 次のパネルとして取り出したものを戻す
+    if (step.waiting_index != NOT_TAKEN)
+    {
+      waiting_panels.insert(std::begin(waiting_panels) + step.waiting_index, hand_panel);
+    }
+    hand_panel = step.hand_panel;
+
+    field.undo();
+    forest_region_.undo();
+    path_region_.undo();
+    placement_.undo();
+
+    recycleRegions(completed_forests, step.forests);
+    deep_forest.resize(step.forests);
+    recycleRegions(completed_path, step.path);
+    completed_church.resize(step.church);
+    while (town_history_.size() > step.towns)
+    {
+      town_counted_[town_history_.back()] = 0;
+      town_history_.pop_back();
+    }
+
+    max_path_     = step.max_path;
+    max_forest_   = step.max_forest;
+    path_score_   = step.path_score;
+    forest_score_ = step.forest_score;
+    std::copy(std::begin(step.scores), std::end(step.scores), std::begin(scores_));
+    total_panels  = step.total_panels;
+
+    play_log_.entries.pop_back();
+    history_.pop_back();
+  }
+
+  // 区画の大きさから得点の元を求める
+  float calcSizeScore(float size) const noexcept
+  {
+    const auto& panel_rate = score_params_.panel_rate;
+    return std::pow(size, panel_rate.x) * panel_rate.y;
+  }
+
+  float calcSizeScore(size_t size) const noexcept
+  {
+    const auto& table = score_params_.size_scores;
+    if (table && (size < table->size())) return (*table)[size];
+    return calcSizeScore(float(size));
+  }
+
+  // 道１つの得点
+  float calcPathScore(size_t size) const noexcept
+  {
+    return calcSizeScore(size) * score_params_.score_rates[0];
+  }
+
+  // 森１つの得点
+  // TIPS 深い森は何枚分かとして数える
+  float calcForestScore(size_t size, u_int deep) const noexcept
+  {
+    const auto& score_rates = score_params_.score_rates;
+    if (deep == 0) return calcSizeScore(size) * score_rates[1];
+
+    float count = size + deep * score_rates[2];
+    return calcSizeScore(count) * score_rates[1];
+  }
+
+  // 最終スコア
+  u_int calcTotalScore() const noexcept
+  {
+    const auto& score_rates = score_params_.score_rates;
+    return composeScore(path_score_, forest_score_,
+                        scores_[5] * score_rates[3], scores_[6] * score_rates[4]);
+  }
+
+  // 各得点をまとめる
+  u_int composeScore(float path_score, float forest_score,
+                     float town_score, float church_score) const noexcept
+  {
+    const auto& score_rates = score_params_.score_rates;
+
+    float score = 0;
+
+    // 道
+    score += path_score;
+    DOUT << "Path: " << path_score << std::endl;
+
+    // 森
+    score += forest_score;
+    DOUT << "Forest: " << forest_score << std::endl;
+
+    // 深い森の数
+    // float df_score = scores_[4] * score_rates[2];
+    // score += df_score;
+    // DOUT << "Deep forest: " << df_score << std::endl;
+
+    // 街の数
+    score += town_score;
+    DOUT << "Town forest: " << town_score << std::endl;
+
+    // 教会
+    score += church_score;
+    DOUT << "Church: " << church_score << std::endl;
+
+    // パネル設置数
+    score += total_panels * score_rates[5];
+    DOUT << "Panels: " << score << std::endl;
+
+    // Perfect
+    if (waiting_panels.empty() && !is_tutorial_)
+    {
+      DOUT << "perfect!!" << std::endl;
+      score *= score_params_.perfect_score_rate;
+    }
+#if defined (DEBUG)
+    // テスト用にスコアを上書き
+    if (score_params_.test_score >= 0.0f) score = score_params_.test_score;
+#endif
+    return score;
+  }
+
+  // ランキングを決める
+  u_int calcRanking(int score) const noexcept
+  {
+    const auto& rate = score_params_.ranking_rate;
+    u_int rank;
+    // FIXME Magic Number
+    for (rank = 0; rank < 9; ++rank)
+    {
+      // ランク後半ほど高得点が必要になる
+      int s = std::pow(rate.x, rank * rate.y) * rate.z;
+      if (score < s) break;
+    }
+
+    return rank;
+  }
+
+
+  // FIXME 参照で持つのいくない
+  const std::vector<Panel>& panels_;
+  ScoreParams score_params_;
+
+  // 待機中のパネルが置けるかどうか
+  PlacementCache placement_;
+  // 完成した区画を調べる作業領域
+  CompletionSearch search_;
+
+  // パネルの順番と回転
+  std::mt19937 engine_;
+  // パネルの出現位置
+  std::mt19937 position_engine_;
+
+  PlayLog play_log_;
+
+  bool is_tutorial_ = false;
+
+  // 配置するパネル
+  std::vector<int> waiting_panels;
+  // 最初に中央に配置するパネル
+  int start_panel_;
+  // 手持ちのパネル
+  int hand_panel;
+  u_int hand_rotation;
+
+  Field field;
+  // 森と道のつながり
+  RegionTracker forest_region_{ Panel::FOREST };
+  RegionTracker path_region_{ Panel::PATH };
+
+  // 完成した森
+  std::vector<std::vector<glm::ivec2>> completed_forests;
+  // 深い森
+  std::vector<u_int> deep_forest;
+  // 完成した道
+  std::vector<std::vector<glm::ivec2>> completed_path;
+  // 完成した教会
+  std::vector<glm::ivec2> completed_church;
+  // 完成した森や道の入れ物の使い回し
+  std::vector<std::vector<glm::ivec2>> region_pool_;
+
+  // パネルを回した回数
+  u_int panel_turned_times_ = 0;
+  // パネルを移動した回数
+  u_int panel_moved_times_ = 0;
+
+  // 街として数えたパネル(置いた順番で引く)
+  std::vector<uint8_t> town_counted_;
+  // 数えた順
+  std::vector<u_int> town_history_;
+
+  // スコア
+  std::vector<u_int> scores_;
+  // 道と森の得点(完成した順に足していく)
+  float path_score_   = 0.0f;
+  float forest_score_ = 0.0f;
+  u_int total_score   = 0;
+  u_int total_ranking = 0;
+  u_int total_panels  = 0;
+
+  // 最長道
+  u_int max_path_ = 0;
+  // 最大森
+  u_int max_forest_ = 0;
+
+  // putHandPanelで置く前の状態
+  struct Step
+  {
+    int hand_panel;
+    // 次のパネルを取り出した位置
+    size_t waiting_index;
+    u_int total_panels;
+
+    size_t forests;
+    size_t path;
+    size_t church;
+    size_t towns;
+    u_int max_path;
+    u_int max_forest;
+
+    float path_score;
+    float forest_score;
+    std::array<u_int, 7> scores;
+  };
+  std::vector<Step> history_;
+  // 次のパネルを取り出さなかった
+  static constexpr size_t NOT_TAKEN = ~size_t(0);
+};
+
+
+// 操作記録からゲームを再現する
+// NOTICE coreは記録と同じ乱数の種で作っておく
+//        記録と食い違ったらfalse
+bool replayPlayLog(GameCore& core, const PlayLog& log) noexcept
+{
+  if (core.getSeed() != log.seed) return false;
+
+  core.preparationPanel();
+  bool has_next = core.putFirstPanel();
+
+  for (const auto& e : log.entries)
+  {
+    if (!has_next) return false;
+    if (core.getHandPanel() != e.panel) return false;
+
+    while (core.getHandRotation() != e.rotation)
+    {
+      core.rotationHandPanel();
+    }
+    if (!core.canPutToBlank(e.pos)) return false;
+
+    has_next = core.putHandPanel(e.pos, e.time / 1000.0);
+  }
+  core.calcResults();
+
+  return true;
+}
+
+}
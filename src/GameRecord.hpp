@@ -0,0 +1,285 @@
+﻿#pragma once
+
+//
+// ゲーム記録のバイナリ形式
+//   JSONの記録(Game::save)と同じ状態を小さく保存する
+//   完成した森や道、パネルの辺の情報は保存せず、読み込む時に置いた順番で置き直して計算し直す
+//
+//   整数は可変長(7bitずつ、下位から。最上位bitが立っていたら続く)
+//   符号付きはzigzag変換してから可変長にする
+//
+//     magic            4  "PMGR"
+//     version          1
+//     flags            1  bit0:チュートリアル bit1-2:手持ちの回転 bit3:操作記録あり bit4:操作記録を全て保存
+//     hand_panel       zigzag
+//     play_time        可変長  ミリ秒
+//     turned_times     可変長
+//     moved_times      可変長
+//     waiting数        可変長
+//     waiting          可変長 × waiting数
+//     field数          可変長
+//     field            (panel 可変長, x zigzag, y zigzag) × field数  置いた順番
+//     rotation         2bit × field数  1byteに4つ詰める
+//     操作記録
+//       bit4が0: seed 4, 置いた時間の差分(ミリ秒) 可変長 × (field数 - 1)
+//                パネル、位置、回転はfieldの２番目以降と同じ
+//       bit4が1: 長さ 可変長, PlayLog::serialize の内容
+//
+
+#include "Defines.hpp"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "PlayLog.hpp"
+
+
+namespace ngs {
+
+struct GameRecord
+{
+  struct Placement
+  {
+    int panel;
+    glm::ivec2 pos;
+    u_int rotation;
+  };
+
+
+  int hand_panel = 0;
+  u_int hand_rotation = 0;
+  std::vector<int> waiting_panels;
+  // 置いた順番
+  std::vector<Placement> field;
+
+  double play_time = 0.0;
+  u_int panel_turned_times = 0;
+  u_int panel_moved_times  = 0;
+  bool tutorial = false;
+
+  PlayLog play_log;
+
+
+  // バイナリ形式か調べる
+  static bool isRecord(const std::string& data) noexcept
+  {
+    return (data.size() >= 5) && (data.compare(0, 4, "PMGR") == 0);
+  }
+
+
+  // バイナリ化
+  std::string serialize() const noexcept
+  {
+    std::string data;
+    data.reserve(32 + waiting_panels.size() + field.size() * 5);
+
+    bool has_log  = !play_log.entries.empty();
+    bool full_log = has_log && !matchField(play_log);
+
+    data.append("PMGR", 4);
+    data.push_back(char(VERSION));
+    data.push_back(char((tutorial ? TUTORIAL : 0)
+                        | ((hand_rotation & 3) << 1)
+                        | (has_log ? HAS_LOG : 0)
+                        | (full_log ? FULL_LOG : 0)));
+    writeSigned(data, hand_panel);
+    writeVarint(data, uint64_t(std::max(play_time, 0.0) * 1000.0));
+    writeVarint(data, panel_turned_times);
+    writeVarint(data, panel_moved_times);
+
+    writeVarint(data, waiting_panels.size());
+    for (auto panel : waiting_panels)
+    {
+      writeVarint(data, u_int(panel));
+    }
+
+    writeVarint(data, field.size());
+    for (const auto& p : field)
+    {
+      writeVarint(data, u_int(p.panel));
+      writeSigned(data, p.pos.x);
+      writeSigned(data, p.pos.y);
+    }
+    for (size_t i = 0; i < field.size(); i += 4)
+    {
+      u_int bits = 0;
+      for (size_t j = 0; (j < 4) && ((i + j) < field.size()); ++j)
+      {
+        bits |= (field[i + j].rotation & 3) << (j * 2);
+      }
+      data.push_back(char(bits));
+    }
+
+    if (full_log)
+    {
+      auto log = play_log.serialize();
+      writeVarint(data, log.size());
+      data.append(log);
+    }
+    else if (has_log)
+    {
+      for (int i = 0; i < 4; ++i)
+      {
+        data.push_back(char((play_log.seed >> (i * 8)) & 0xff));
+      }
+      // NOTICE 時間が戻っている記録は全て保存している(matchField)
+      uint32_t time = 0;
+      for (const auto& e : play_log.entries)
+      {
+        writeVarint(data, e.time - time);
+        time = e.time;
+      }
+    }
+
+    return data;
+  }
+
+  // バイナリから復元
+  // 壊れていたらfalse
+  bool deserialize(const std::string& data) noexcept
+  {
+    if (!isRecord(data)) return false;
+    if (uint8_t(data[4]) != VERSION) return false;
+
+    Reader reader{ data, 5 };
+    if (reader.offset >= data.size()) return false;
+    u_int flags = uint8_t(data[reader.offset++]);
+
+    tutorial      = flags & TUTORIAL;
+    hand_rotation = (flags >> 1) & 3;
+    hand_panel    = reader.readSigned();
+    play_time     = reader.readVarint() / 1000.0;
+    panel_turned_times = u_int(reader.readVarint());
+    panel_moved_times  = u_int(reader.readVarint());
+
+    // NOTICE 壊れた数で大量に確保しないよう、残りの大きさで制限する
+    auto num = reader.readVarint();
+    if (!reader.ok || (num > data.size())) return false;
+    waiting_panels.resize(size_t(num));
+    for (auto& panel : waiting_panels)
+    {
+      panel = int(reader.readVarint());
+    }
+
+    num = reader.readVarint();
+    if (!reader.ok || (num > data.size())) return false;
+    field.resize(size_t(num));
+    for (auto& p : field)
+    {
+      p.panel = int(reader.readVarint());
+      p.pos.x = reader.readSigned();
+      p.pos.y = reader.readSigned();
+    }
+    if (!reader.ok || ((data.size() - reader.offset) < ((field.size() + 3) / 4))) return false;
+    for (size_t i = 0; i < field.size(); ++i)
+    {
+      field[i].rotation = (uint8_t(data[reader.offset + i / 4]) >> ((i % 4) * 2)) & 3;
+    }
+    reader.offset += (field.size() + 3) / 4;
+
+    play_log.clear();
+    play_log.seed = 0;
+    if (flags & FULL_LOG)
+    {
+      auto size = reader.readVarint();
+      if (!reader.ok || (size > (data.size() - reader.offset))) return false;
+      if (!play_log.deserialize(data.substr(reader.offset, size_t(size)))) return false;
+      reader.offset += size_t(size);
+    }
+    else if (flags & HAS_LOG)
+    {
+      if (field.empty() || ((data.size() - reader.offset) < 4)) return false;
+      for (int i = 0; i < 4; ++i)
+      {
+        play_log.seed |= uint32_t(uint8_t(data[reader.offset++])) << (i * 8);
+      }
+      uint32_t time = 0;
+      play_log.entries.reserve(field.size() - 1);
+      for (size_t i = 1; i < field.size(); ++i)
+      {
+        time += uint32_t(reader.readVarint());
+        const auto& p = field[i];
+        play_log.entries.push_back({ u_int(p.panel), p.pos, p.rotation, time });
+      }
+    }
+
+    return reader.ok && (reader.offset == data.size());
+  }
+
+
+private:
+  enum
+  {
+    VERSION = 1,
+
+    TUTORIAL = 1 << 0,
+    HAS_LOG  = 1 << 3,
+    FULL_LOG = 1 << 4,
+  };
+
+  // 操作記録がfieldの２番目以降と同じ並びか
+  bool matchField(const PlayLog& log) const noexcept
+  {
+    if ((log.entries.size() + 1) != field.size()) return false;
+
+    uint32_t time = 0;
+    for (size_t i = 0; i < log.entries.size(); ++i)
+    {
+      const auto& e = log.entries[i];
+      const auto& p = field[i + 1];
+      if ((e.panel != u_int(p.panel)) || (e.pos != p.pos) || (e.rotation != p.rotation)) return false;
+      if (e.time < time) return false;
+      time = e.time;
+    }
+    return true;
+  }
+
+
+  static void writeVarint(std::string& data, uint64_t value) noexcept
+  {
+    while (value >= 0x80)
+    {
+      data.push_back(char((value & 0x7f) | 0x80));
+      value >>= 7;
+    }
+    data.push_back(char(value));
+  }
+
+  static void writeSigned(std::string& data, int value) noexcept
+  {
+    writeVarint(data, (uint32_t(value) << 1) ^ uint32_t(value >> 31));
+  }
+
+
+  struct Reader
+  {
+    const std::string& data;
+    size_t offset;
+    bool ok = true;
+
+    // NOTICE 途中で切れていたらokをfalseにして0を返す
+    uint64_t readVarint() noexcept
+    {
+      uint64_t value = 0;
+      for (int shift = 0; shift < 64; shift += 7)
+      {
+        if (offset >= data.size()) break;
+
+        uint8_t c = data[offset++];
+        value |= uint64_t(c & 0x7f) << shift;
+        if (!(c & 0x80)) return value;
+      }
+      ok = false;
+      return 0;
+    }
+
+    int readSigned() noexcept
+    {
+      auto value = uint32_t(readVarint());
+      return int(value >> 1) ^ -int(value & 1);
+    }
+  };
+};
+
+}
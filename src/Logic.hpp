@@ -7,6 +7,8 @@
 #include "Panel.hpp"
 #include "Field.hpp"
 #include <set>
+#include <vector>
+#include <algorithm>
 
 
 namespace ngs {
@@ -73,7 +75,7 @@ bool checkAttributeEdge(const glm::ivec2& pos, u_int direction,
   // パネル情報
   const auto& status = field.getPanelStatus(pos);
   const auto& panel  = panels[status.number];
-  const auto edge    = panel.getRotatedEdge(status.rotation);
+  const auto& edge   = panel.getRotatedEdge(status.rotation);
 
   u_int dir = (direction + 2) % 4;
 
@@ -139,7 +141,7 @@ std::vector<std::vector<glm::ivec2>> isCompleteAttribute(u_int attribute,
   // パネル情報
   const auto& status = field.getPanelStatus(pos);
   const auto& panel  = panels[status.number];
-  const auto edge    = panel.getRotatedEdge(status.rotation);
+  const auto& edge   = panel.getRotatedEdge(status.rotation);
 
   // パネルは端か途中かの２択(両方含んだ道は無い)
   bool has_attr = false;
@@ -229,7 +231,6 @@ std::vector<std::vector<glm::ivec2>> isCompleteAttribute(u_int attribute,
   return completed;
 }
 
-
 // 周囲８箇所にパネルがあるか調査
 bool isPanelAroundPos(const glm::ivec2& pos, const Field& field) noexcept
 {
@@ -253,11 +254,11 @@ bool isPanelAroundPos(const glm::ivec2& pos, const Field& field) noexcept
 }
 
 // 教会が完成したか調査
-std::vector<glm::ivec2> isCompleteChurch(const glm::ivec2& pos,
-                                         const Field& field, const std::vector<Panel>& panels) noexcept
+// 完成した教会の位置を completed へ追加する
+void appendCompleteChurch(const glm::ivec2& pos,
+                          const Field& field, const std::vector<Panel>& panels,
+                          std::vector<glm::ivec2>& completed) noexcept
 {
-  std::vector<glm::ivec2> completed;
-
   static const glm::ivec2 offsets[] = {
     {  0,  0 },
     {  0,  1 },
@@ -285,6 +286,13 @@ std::vector<glm::ivec2> isCompleteChurch(const glm::ivec2& pos,
       }
     }
   }
+}
+
+std::vector<glm::ivec2> isCompleteChurch(const glm::ivec2& pos,
+                                         const Field& field, const std::vector<Panel>& panels) noexcept
+{
+  std::vector<glm::ivec2> completed;
+  appendCompleteChurch(pos, field, panels, completed);
   return completed;
 }
 
@@ -37,7 +37,8 @@ class MainPart
 {
 
 public:
-  MainPart(const ci::JsonTree& params, Event<Arguments>& event, Archive& archive) noexcept
+  MainPart(const ci::JsonTree& params, Event<Arguments>& event, Archive& archive,
+           const View::Preload& preload = View::Preload()) noexcept
     : params_(params),
       event_(event),
       archive_(archive),
@@ -49,7 +50,7 @@ public:
       panel_height_(params.getValueForKey<float>("field.panel_height")),
       putdown_time_(Json::getVec<glm::vec2>(params["field.putdown_time"])),
       bg_height_(params_.getValueForKey<float>("field.bg.height")),
-      view_(params["field"]),
+      view_(params["field"], preload),
       ranking_records_(params.getValueForKey<u_int>("game.ranking_records")),
       transition_duration_(params.getValueForKey<float>("ui.transition.duration")),
       transition_color_(Json::getColor<float>(params["ui.transition.color"])),
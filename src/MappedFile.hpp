@@ -0,0 +1,137 @@
+﻿#pragma once
+
+//
+// ファイルをメモリに割り当てて読む(読み込み専用)
+//   読み込みはOSがページ単位で必要になった時に行うので、開くだけなら速い
+//   Windowsは CreateFileMapping、それ以外は mmap
+//
+
+#include <string>
+#include <cstddef>
+
+#if defined (_WIN32)
+#if !defined (NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+namespace ngs {
+
+class MappedFile
+{
+public:
+  MappedFile() = default;
+
+  MappedFile(const std::string& path) noexcept
+  {
+#if defined (_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return;
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && (size.QuadPart > 0))
+    {
+      HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (mapping)
+      {
+        data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (data_) size_ = size_t(size.QuadPart);
+        // TIPS 割り当て中は閉じても良い
+        CloseHandle(mapping);
+      }
+    }
+    CloseHandle(file);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat st;
+    if ((::fstat(fd, &st) == 0) && (st.st_size > 0))
+    {
+      void* p = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED)
+      {
+        data_ = static_cast<const char*>(p);
+        size_ = size_t(st.st_size);
+      }
+    }
+    // TIPS 割り当て中は閉じても良い
+    ::close(fd);
+#endif
+  }
+
+  ~MappedFile()
+  {
+    unmap();
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& rhs) noexcept
+    : data_(rhs.data_),
+      size_(rhs.size_)
+  {
+    rhs.data_ = nullptr;
+    rhs.size_ = 0;
+  }
+
+  MappedFile& operator=(MappedFile&& rhs) noexcept
+  {
+    if (this != &rhs)
+    {
+      unmap();
+      data_ = rhs.data_;
+      size_ = rhs.size_;
+      rhs.data_ = nullptr;
+      rhs.size_ = 0;
+    }
+    return *this;
+  }
+
+
+  // NOTICE 空のファイルは開けない扱い
+  bool isOpen() const noexcept
+  {
+    return data_ != nullptr;
+  }
+
+  const char* data() const noexcept
+  {
+    return data_;
+  }
+
+  size_t size() const noexcept
+  {
+    return size_;
+  }
+
+
+private:
+  void unmap() noexcept
+  {
+    if (!data_) return;
+
+#if defined (_WIN32)
+    UnmapViewOfFile(data_);
+#else
+    ::munmap(const_cast<char*>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+}
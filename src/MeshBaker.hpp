@@ -0,0 +1,202 @@
+﻿#pragma once
+
+//
+// メッシュの焼き込み(.ply → .bmesh)
+//   PLYの解析 → 同じ平面・同じ色の面をまとめる → 法線の計算 → 同じ頂点をまとめる
+//   → 法線を揺らす → 頂点キャッシュ・オーバードロー・頂点を読む順番に並べ替える → 書き出し
+//   ツール(tools/bake_mesh.cpp)とアプリ(Model::writeBaked と .bmeshが読めない時)で同じ処理を使う
+//   TIPS 法線を揺らす乱数は種を固定するので、何度焼き込んでも同じ結果になる
+//   NOTICE 乱数の分布は標準ライブラリの実装によって違うので、環境が違うと揺らし方も変わる
+//   Cinderに依存しないので、ツールからも使う
+//
+
+#include <string>
+#include <vector>
+#include <random>
+#include <utility>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include "PLYParser.hpp"
+#include "VertexWeld.hpp"
+#include "MeshOptimizer.hpp"
+#include "BakedMesh.hpp"
+
+
+namespace ngs { namespace MeshBaker {
+
+// ci::TriMesh の代わり
+struct Mesh
+{
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> colors;
+  std::vector<glm::vec3> normals;
+  std::vector<uint32_t> indices;
+};
+
+struct Options
+{
+  // 同じ平面・同じ色の面をまとめるか
+  bool merge = true;
+  // 法線を揺らすか(PLY::optimize と同じ)
+  bool displace = true;
+  // 法線を揺らす乱数の種
+  uint32_t seed = 1;
+};
+
+
+// ci::TriMesh::recalculateNormals と同じ
+void recalculateNormals(Mesh& mesh) noexcept
+{
+  mesh.normals.assign(mesh.positions.size(), glm::vec3(0.0f));
+  for (size_t i = 0; i < mesh.indices.size(); i += 3)
+  {
+    const auto& v0 = mesh.positions[mesh.indices[i]];
+    const auto& v1 = mesh.positions[mesh.indices[i + 1]];
+    const auto& v2 = mesh.positions[mesh.indices[i + 2]];
+    auto normal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
+    for (int j = 0; j < 3; ++j)
+    {
+      mesh.normals[mesh.indices[i + j]] += normal;
+    }
+  }
+  for (auto& n : mesh.normals)
+  {
+    n = glm::normalize(n);
+  }
+}
+
+// PLYを解析して法線を計算する
+//   rects: まとめた長方形の数
+// TIPS 面をまとめるのは法線を計算する前(頂点を共有すると法線が変わる)
+bool parsePly(const char* data, size_t size, bool merge, Mesh& mesh, uint32_t& rects) noexcept
+{
+  std::vector<float> positions;
+  std::vector<float> colors;
+  if (!PLYParser::parse(data, size, positions, colors, mesh.indices)) return false;
+
+  rects = merge ? MeshOptimizer::mergeCoplanarFaces(positions, colors, mesh.indices) : 0;
+
+  mesh.positions.resize(positions.size() / 3);
+  mesh.colors.resize(colors.size() / 3);
+  std::memcpy(mesh.positions.data(), positions.data(), positions.size() * sizeof(float));
+  std::memcpy(mesh.colors.data(), colors.data(), colors.size() * sizeof(float));
+
+  recalculateNormals(mesh);
+  return true;
+}
+
+// 同じ頂点をまとめた時に残る頂点(元の番号)と、まとめた後の頂点番号
+void weldMesh(const Mesh& mesh, std::vector<uint32_t>& unique, std::vector<uint32_t>& indices) noexcept
+{
+  std::vector<uint32_t> remap;
+  weldVertices(mesh.positions.data(), mesh.colors.data(), mesh.normals.data(),
+               uint32_t(mesh.positions.size()), remap, unique);
+
+  indices.resize(mesh.indices.size());
+  for (size_t i = 0; i < mesh.indices.size(); ++i)
+  {
+    indices[i] = remap[mesh.indices[i]];
+  }
+}
+
+// 同じ頂点をまとめる(PLY::optimize と同じ)
+void optimize(Mesh& mesh) noexcept
+{
+  std::vector<uint32_t> unique;
+  Mesh opt_mesh;
+  weldMesh(mesh, unique, opt_mesh.indices);
+
+  for (auto i : unique)
+  {
+    opt_mesh.positions.push_back(mesh.positions[i]);
+    opt_mesh.colors.push_back(mesh.colors[i]);
+    opt_mesh.normals.push_back(mesh.normals[i]);
+  }
+
+  mesh = std::move(opt_mesh);
+}
+
+// 法線を少し揺らす(PLY::displaceNormals と同じ)
+// 任意の軸で -0.08〜0.08 ラジアン回す
+void displaceNormals(Mesh& mesh, std::mt19937& engine) noexcept
+{
+  std::normal_distribution<float> axis_dist;
+  std::uniform_real_distribution<float> angle_dist(-0.08f, 0.08f);
+
+  for (auto& n : mesh.normals)
+  {
+    glm::vec3 axis;
+    do
+    {
+      axis = glm::vec3(axis_dist(engine), axis_dist(engine), axis_dist(engine));
+    }
+    while (glm::dot(axis, axis) < 1e-6f);
+    axis = glm::normalize(axis);
+    float r = angle_dist(engine);
+
+    // ロドリゲスの回転公式
+    float c = std::cos(r);
+    float s = std::sin(r);
+    n = n * c + glm::cross(axis, n) * s + axis * (glm::dot(axis, n) * (1.0f - c));
+  }
+}
+
+// 三角形と頂点を並べ替える
+void reorder(Mesh& mesh) noexcept
+{
+  auto vertex_num = uint32_t(mesh.positions.size());
+  std::vector<uint32_t> indices(mesh.indices.size());
+  MeshOptimizer::optimizeVertexCache(mesh.indices.data(), mesh.indices.size(), vertex_num, indices.data());
+  MeshOptimizer::optimizeOverdraw(indices.data(), indices.size(), &mesh.positions[0].x, vertex_num);
+
+  std::vector<uint32_t> remap;
+  auto count = MeshOptimizer::optimizeVertexFetch(indices.data(), indices.size(), vertex_num, remap);
+
+  Mesh opt_mesh;
+  opt_mesh.positions.resize(count);
+  opt_mesh.colors.resize(count);
+  opt_mesh.normals.resize(count);
+  for (uint32_t i = 0; i < vertex_num; ++i)
+  {
+    if (remap[i] == ~0u) continue;
+    opt_mesh.positions[remap[i]] = mesh.positions[i];
+    opt_mesh.colors[remap[i]]    = mesh.colors[i];
+    opt_mesh.normals[remap[i]]   = mesh.normals[i];
+  }
+  opt_mesh.indices = std::move(indices);
+
+  mesh = std::move(opt_mesh);
+}
+
+// 焼き込んでoutputへ書き出す
+void write(const Mesh& mesh, std::string& output)
+{
+  BakedMesh::write(&mesh.positions[0].x, &mesh.colors[0].x, &mesh.normals[0].x, uint32_t(mesh.positions.size()),
+                   mesh.indices.data(), uint32_t(mesh.indices.size()), output);
+}
+
+
+// PLYを焼き込む(全ての工程をまとめて行う)
+// 解析できないか三角形が無ければfalse
+bool bakePly(const char* data, size_t size, const Options& options, std::string& output)
+{
+  Mesh mesh;
+  uint32_t rects;
+  if (!parsePly(data, size, options.merge, mesh, rects) || mesh.indices.empty()) return false;
+
+  optimize(mesh);
+  if (options.displace)
+  {
+    // TIPS ファイルごとに乱数を初期化するので、焼き込む順番が変わっても結果は同じ
+    std::mt19937 engine(options.seed);
+    displaceNormals(mesh, engine);
+  }
+  reorder(mesh);
+  write(mesh, output);
+
+  return true;
+}
+
+} }
@@ -0,0 +1,703 @@
+﻿#pragma once
+
+//
+// メッシュの最適化(焼き込み時に使う)
+//   mergeCoplanarFaces:  同じ平面・同じ色のボクセルの面を大きな長方形にまとめる
+//   optimizeVertexCache: 頂点キャッシュが効く順番に三角形を並べ替える(Tom Forsyth の方法)
+//   optimizeOverdraw:    外側を向いた塊から先に描くよう並べ替える(Sander et al. 2007 を簡略化)
+//   optimizeVertexFetch: 頂点を最初に使われる順番に並べ替える
+//   calcACMR/calcOverdraw: 効果の測定(CPUのみ)
+//   Cinderに依存しないので、ツール(tools/bake_mesh.cpp)からも使う
+//
+
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "VertexWeld.hpp"
+
+
+namespace ngs { namespace MeshOptimizer {
+
+enum
+{
+  // 性能の測定に使う頂点キャッシュ(FIFO)の大きさ
+  FIFO_CACHE_SIZE = 16,
+  // 並べ替えで想定する頂点キャッシュ(LRU)の大きさ
+  LRU_CACHE_SIZE = 32,
+};
+
+
+// 三角形１つあたりの頂点シェーダーの実行回数(Average Cache Miss Ratio)
+// 0.5〜3.0 で小さいほど良い
+float calcACMR(const uint32_t* indices, size_t index_num, uint32_t vertex_num,
+               uint32_t cache_size = FIFO_CACHE_SIZE) noexcept
+{
+  if (index_num < 3) return 0.0f;
+
+  // TIPS 頂点ごとに最後に入った時刻を覚えておけば、キャッシュの中身を持たなくて良い
+  std::vector<uint32_t> timestamps(vertex_num, 0);
+  uint32_t time = cache_size + 1;
+  uint32_t misses = 0;
+  for (size_t i = 0; i < index_num; ++i)
+  {
+    auto index = indices[i];
+    if ((time - timestamps[index]) > cache_size)
+    {
+      timestamps[index] = time;
+      time += 1;
+      misses += 1;
+    }
+  }
+
+  return float(misses) / float(index_num / 3);
+}
+
+
+// 頂点の点数
+float vertexScore(int cache_position, uint32_t remaining) noexcept
+{
+  // 残りの三角形が無い頂点は選ばない
+  if (remaining == 0) return -1.0f;
+
+  float score = 0.0f;
+  if (cache_position >= 0)
+  {
+    // 直前の三角形で使った頂点は、次の三角形でも使いやすいので一律
+    if (cache_position < 3)
+    {
+      score = 0.75f;
+    }
+    else
+    {
+      float scale = 1.0f / float(LRU_CACHE_SIZE - 3);
+      score = std::pow(1.0f - float(cache_position - 3) * scale, 1.5f);
+    }
+  }
+
+  // 残りの三角形が少ない頂点を優先して、孤立した三角形を作らない
+  score += 2.0f / std::sqrt(float(remaining));
+  return score;
+}
+
+// 頂点キャッシュが効く順番に三角形を並べ替える
+//   destination: 並べ替えた頂点番号(index_num個)
+// TIPS 三角形の点数(頂点の点数の和)が最も高いものを、キャッシュにある頂点から探す
+//      見つからなければ元の順番で次の三角形を使う
+void optimizeVertexCache(const uint32_t* indices, size_t index_num, uint32_t vertex_num,
+                         uint32_t* destination) noexcept
+{
+  size_t face_num = index_num / 3;
+
+  // 頂点 → 三角形の一覧
+  std::vector<uint32_t> remaining(vertex_num, 0);
+  for (size_t i = 0; i < index_num; ++i) remaining[indices[i]] += 1;
+
+  std::vector<uint32_t> offsets(vertex_num + 1, 0);
+  for (uint32_t v = 0; v < vertex_num; ++v) offsets[v + 1] = offsets[v] + remaining[v];
+
+  std::vector<uint32_t> adjacency(index_num);
+  {
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < index_num; ++i) adjacency[fill[indices[i]]++] = uint32_t(i / 3);
+  }
+
+  std::vector<float> vertex_scores(vertex_num);
+  for (uint32_t v = 0; v < vertex_num; ++v) vertex_scores[v] = vertexScore(-1, remaining[v]);
+
+  std::vector<float> face_scores(face_num);
+  for (size_t f = 0; f < face_num; ++f)
+  {
+    face_scores[f] = vertex_scores[indices[f * 3]] + vertex_scores[indices[f * 3 + 1]] + vertex_scores[indices[f * 3 + 2]];
+  }
+  std::vector<bool> emitted(face_num, false);
+
+  // TIPS 三角形の頂点がキャッシュへ入ると一時的に3つはみ出す
+  uint32_t cache[LRU_CACHE_SIZE + 3];
+  uint32_t cache_count = 0;
+
+  size_t cursor = 0;
+  size_t best = face_num;
+  for (size_t output = 0; output < face_num; ++output)
+  {
+    if (best == face_num)
+    {
+      // キャッシュから候補が見つからなかった
+      while (emitted[cursor]) ++cursor;
+      best = cursor;
+    }
+
+    emitted[best] = true;
+    const auto* face = &indices[best * 3];
+    std::memcpy(&destination[output * 3], face, sizeof(uint32_t) * 3);
+
+    // 残りの三角形の一覧から取り除く
+    for (int k = 0; k < 3; ++k)
+    {
+      auto v = face[k];
+      auto* begin = &adjacency[offsets[v]];
+      auto* end   = begin + remaining[v];
+      auto* it    = std::find(begin, end, uint32_t(best));
+      *it = *(end - 1);
+      remaining[v] -= 1;
+    }
+
+    // キャッシュの先頭へ入れる
+    uint32_t new_cache[LRU_CACHE_SIZE + 3];
+    uint32_t new_count = 0;
+    for (int k = 0; k < 3; ++k) new_cache[new_count++] = face[k];
+    for (uint32_t i = 0; i < cache_count; ++i)
+    {
+      auto v = cache[i];
+      if ((v != face[0]) && (v != face[1]) && (v != face[2])) new_cache[new_count++] = v;
+    }
+
+    // 点数の更新と、次の三角形の候補探し
+    best = face_num;
+    float best_score = -1.0f;
+    for (uint32_t i = 0; i < new_count; ++i)
+    {
+      auto v = new_cache[i];
+      int position = (i < LRU_CACHE_SIZE) ? int(i) : -1;
+
+      float score = vertexScore(position, remaining[v]);
+      float diff  = score - vertex_scores[v];
+      vertex_scores[v] = score;
+
+      for (uint32_t j = 0; j < remaining[v]; ++j)
+      {
+        auto f = adjacency[offsets[v] + j];
+        face_scores[f] += diff;
+        if (face_scores[f] > best_score)
+        {
+          best_score = face_scores[f];
+          best = f;
+        }
+      }
+    }
+
+    cache_count = std::min(new_count, uint32_t(LRU_CACHE_SIZE));
+    std::memcpy(cache, new_cache, sizeof(uint32_t) * cache_count);
+  }
+}
+
+
+// 三角形を描いた時に塗られる画素数 / 見える画素数
+// 6方向から平行投影で描いて数える(裏面は描かない)
+// 1.0 に近いほど良い
+float calcOverdraw(const uint32_t* indices, size_t index_num, const float* positions, uint32_t vertex_num,
+                   int resolution = 128) noexcept
+{
+  float bounds_min[3];
+  float bounds_max[3];
+  for (int j = 0; j < 3; ++j)
+  {
+    bounds_min[j] =  std::numeric_limits<float>::max();
+    bounds_max[j] = -std::numeric_limits<float>::max();
+  }
+  for (uint32_t i = 0; i < vertex_num; ++i)
+  {
+    for (int j = 0; j < 3; ++j)
+    {
+      bounds_min[j] = std::min(bounds_min[j], positions[i * 3 + j]);
+      bounds_max[j] = std::max(bounds_max[j], positions[i * 3 + j]);
+    }
+  }
+  float extent = 0.0f;
+  for (int j = 0; j < 3; ++j) extent = std::max(extent, bounds_max[j] - bounds_min[j]);
+  if (extent <= 0.0f) return 0.0f;
+  float scale = float(resolution) / extent;
+
+  std::vector<float> depth_buffer(size_t(resolution) * resolution);
+  size_t shaded  = 0;
+  size_t covered = 0;
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    int u_axis = (axis + 1) % 3;
+    int v_axis = (axis + 2) % 3;
+    for (float sign : { 1.0f, -1.0f })
+    {
+      // sign側から見る(近い方が小さい)
+      std::fill(depth_buffer.begin(), depth_buffer.end(), std::numeric_limits<float>::max());
+      for (size_t i = 0; i < index_num; i += 3)
+      {
+        float u[3], v[3], z[3];
+        for (int k = 0; k < 3; ++k)
+        {
+          const auto* p = &positions[indices[i + k] * 3];
+          u[k] = (p[u_axis] - bounds_min[u_axis]) * scale;
+          v[k] = (p[v_axis] - bounds_min[v_axis]) * scale;
+          z[k] = -sign * p[axis];
+        }
+
+        // TIPS (u, v, axis) は右手系なので、反時計回り(表)なら面積は正
+        float area = ((u[1] - u[0]) * (v[2] - v[0]) - (u[2] - u[0]) * (v[1] - v[0])) * sign;
+        if (area <= 0.0f) continue;
+
+        int x0 = std::max(int(std::floor(std::min({ u[0], u[1], u[2] }))), 0);
+        int x1 = std::min(int(std::ceil(std::max({ u[0], u[1], u[2] }))), resolution - 1);
+        int y0 = std::max(int(std::floor(std::min({ v[0], v[1], v[2] }))), 0);
+        int y1 = std::min(int(std::ceil(std::max({ v[0], v[1], v[2] }))), resolution - 1);
+        for (int y = y0; y <= y1; ++y)
+        {
+          for (int x = x0; x <= x1; ++x)
+          {
+            float px = float(x) + 0.5f;
+            float py = float(y) + 0.5f;
+            float w0 = ((u[2] - u[1]) * (py - v[1]) - (v[2] - v[1]) * (px - u[1])) * sign;
+            float w1 = ((u[0] - u[2]) * (py - v[2]) - (v[0] - v[2]) * (px - u[2])) * sign;
+            float w2 = ((u[1] - u[0]) * (py - v[0]) - (v[1] - v[0]) * (px - u[0])) * sign;
+            if ((w0 < 0.0f) || (w1 < 0.0f) || (w2 < 0.0f)) continue;
+
+            float depth = (w0 * z[0] + w1 * z[1] + w2 * z[2]) / area;
+            auto& d = depth_buffer[size_t(y) * resolution + x];
+            if (depth < d)
+            {
+              d = depth;
+              shaded += 1;
+            }
+          }
+        }
+      }
+      for (auto d : depth_buffer)
+      {
+        if (d != std::numeric_limits<float>::max()) covered += 1;
+      }
+    }
+  }
+
+  return covered ? float(shaded) / float(covered) : 0.0f;
+}
+
+// 外側を向いた塊から先に描くよう並べ替える
+//   indices: optimizeVertexCache で並べ替えたもの(書き換える)
+//   threshold: ACMRの悪化をどこまで許すか
+// TIPS 頂点キャッシュが全て外れる所で塊に分け、塊の中心とメッシュの中心を結ぶ向きと
+//      塊の法線の内積が大きい順に並べる(塊の中の順番はそのまま)
+//      ACMRが threshold 倍より悪くなったら並べ替えない
+void optimizeOverdraw(uint32_t* indices, size_t index_num, const float* positions, uint32_t vertex_num,
+                      float threshold = 1.05f) noexcept
+{
+  size_t face_num = index_num / 3;
+  if (face_num == 0) return;
+
+  // 塊に分ける
+  std::vector<size_t> clusters;
+  {
+    std::vector<uint32_t> timestamps(vertex_num, 0);
+    uint32_t time = FIFO_CACHE_SIZE + 1;
+    for (size_t f = 0; f < face_num; ++f)
+    {
+      int misses = 0;
+      for (int k = 0; k < 3; ++k)
+      {
+        auto index = indices[f * 3 + k];
+        if ((time - timestamps[index]) > FIFO_CACHE_SIZE)
+        {
+          timestamps[index] = time;
+          time += 1;
+          misses += 1;
+        }
+      }
+      if ((f == 0) || (misses == 3)) clusters.push_back(f);
+    }
+  }
+  clusters.push_back(face_num);
+
+  // メッシュの中心(面積で重み付け)
+  auto triangle = [&](size_t f, float* center, float* normal)
+                  {
+                    const auto* p0 = &positions[indices[f * 3] * 3];
+                    const auto* p1 = &positions[indices[f * 3 + 1] * 3];
+                    const auto* p2 = &positions[indices[f * 3 + 2] * 3];
+                    float e1[3], e2[3];
+                    for (int j = 0; j < 3; ++j)
+                    {
+                      e1[j] = p1[j] - p0[j];
+                      e2[j] = p2[j] - p0[j];
+                      center[j] = (p0[j] + p1[j] + p2[j]) / 3.0f;
+                    }
+                    normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+                    normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+                    normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+                    return std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                  };
+
+  float mesh_center[3] = { 0.0f, 0.0f, 0.0f };
+  float mesh_area = 0.0f;
+  for (size_t f = 0; f < face_num; ++f)
+  {
+    float center[3], normal[3];
+    float area = triangle(f, center, normal);
+    for (int j = 0; j < 3; ++j) mesh_center[j] += center[j] * area;
+    mesh_area += area;
+  }
+  if (mesh_area <= 0.0f) return;
+  for (auto& c : mesh_center) c /= mesh_area;
+
+  // 塊ごとの点数
+  size_t cluster_num = clusters.size() - 1;
+  std::vector<std::pair<float, size_t>> order(cluster_num);
+  for (size_t c = 0; c < cluster_num; ++c)
+  {
+    float cluster_center[3] = { 0.0f, 0.0f, 0.0f };
+    float cluster_normal[3] = { 0.0f, 0.0f, 0.0f };
+    float cluster_area = 0.0f;
+    for (size_t f = clusters[c]; f < clusters[c + 1]; ++f)
+    {
+      float center[3], normal[3];
+      float area = triangle(f, center, normal);
+      for (int j = 0; j < 3; ++j)
+      {
+        cluster_center[j] += center[j] * area;
+        cluster_normal[j] += normal[j];
+      }
+      cluster_area += area;
+    }
+
+    float score = 0.0f;
+    float length = std::sqrt(cluster_normal[0] * cluster_normal[0]
+                             + cluster_normal[1] * cluster_normal[1]
+                             + cluster_normal[2] * cluster_normal[2]);
+    if ((cluster_area > 0.0f) && (length > 0.0f))
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+        score += (cluster_center[j] / cluster_area - mesh_center[j]) * cluster_normal[j] / length;
+      }
+    }
+    order[c] = { score, c };
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [](const std::pair<float, size_t>& a, const std::pair<float, size_t>& b)
+                   {
+                     return a.first > b.first;
+                   });
+
+  std::vector<uint32_t> sorted;
+  sorted.reserve(index_num);
+  for (const auto& o : order)
+  {
+    sorted.insert(sorted.end(), &indices[clusters[o.second] * 3], &indices[clusters[o.second + 1] * 3]);
+  }
+
+  if (calcACMR(sorted.data(), index_num, vertex_num) > (calcACMR(indices, index_num, vertex_num) * threshold)) return;
+  std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+
+// 頂点を最初に使われる順番に並べ替える
+//   indices: 頂点番号(書き換える)
+//   remap:   元の番号 → 新しい番号(使われない頂点は ~0u)
+//   戻り値:  使われている頂点数
+uint32_t optimizeVertexFetch(uint32_t* indices, size_t index_num, uint32_t vertex_num,
+                             std::vector<uint32_t>& remap) noexcept
+{
+  remap.assign(vertex_num, ~0u);
+  uint32_t count = 0;
+  for (size_t i = 0; i < index_num; ++i)
+  {
+    auto& r = remap[indices[i]];
+    if (r == ~0u) r = count++;
+    indices[i] = r;
+  }
+  return count;
+}
+
+
+// 同じ平面・同じ色のボクセルの面を大きな長方形にまとめる
+//   positions/colors: float 3つの並び(書き換える)
+//   indices: 三角形の頂点番号(書き換える)
+//   戻り値: まとめた長方形の数
+// TIPS 軸に垂直で、１辺が1.0の正方形に収まり、頂点の色が全て同じ三角形を対象にする
+//      (MagicaVoxelの書き出しは１ボクセルが1.0)
+//      正方形が全て埋まっているものを、同じ平面・同じ色の間で貪欲法で長方形にまとめる
+// NOTICE T字の継ぎ目で隙間ができないよう、まとめなかった三角形の頂点が長方形の辺の上にあれば
+//        その頂点も残して、長方形の中心から扇状に分割する
+//        長方形の内側に他の三角形の頂点があればまとめない
+// NOTICE 法線は含まないので、まとめた後に計算する事
+uint32_t mergeCoplanarFaces(std::vector<float>& positions, std::vector<float>& colors,
+                            std::vector<uint32_t>& indices)
+{
+  struct Plane
+  {
+    int axis;
+    float sign;
+    float coord;
+    float color[3];
+
+    bool operator<(const Plane& rhs) const noexcept
+    {
+      if (axis != rhs.axis)   return axis < rhs.axis;
+      if (sign != rhs.sign)   return sign < rhs.sign;
+      if (coord != rhs.coord) return coord < rhs.coord;
+      return std::lexicographical_compare(color, color + 3, rhs.color, rhs.color + 3);
+    }
+  };
+
+  struct Cell
+  {
+    // 三角形の面積の合計の2倍
+    float area;
+    std::vector<uint32_t> faces;
+    int rect;
+  };
+
+  const auto* p = positions.data();
+  const auto* c = colors.data();
+  size_t face_num = indices.size() / 3;
+
+  // 正方形ごとに三角形を集める
+  // TIPS 正方形は (u, v) の左下の整数座標で表す
+  using CellMap = std::map<std::pair<int, int>, Cell>;
+  std::map<Plane, CellMap> planes;
+  for (size_t f = 0; f < face_num; ++f)
+  {
+    const auto* i = &indices[f * 3];
+    const float* v[] = { &p[i[0] * 3], &p[i[1] * 3], &p[i[2] * 3] };
+
+    if ((std::memcmp(&c[i[0] * 3], &c[i[1] * 3], sizeof(float) * 3) != 0)
+        || (std::memcmp(&c[i[0] * 3], &c[i[2] * 3], sizeof(float) * 3) != 0)) continue;
+
+    float n[3];
+    n[0] = (v[1][1] - v[0][1]) * (v[2][2] - v[0][2]) - (v[1][2] - v[0][2]) * (v[2][1] - v[0][1]);
+    n[1] = (v[1][2] - v[0][2]) * (v[2][0] - v[0][0]) - (v[1][0] - v[0][0]) * (v[2][2] - v[0][2]);
+    n[2] = (v[1][0] - v[0][0]) * (v[2][1] - v[0][1]) - (v[1][1] - v[0][1]) * (v[2][0] - v[0][0]);
+
+    int axis = -1;
+    for (int j = 0; j < 3; ++j)
+    {
+      if (n[j] == 0.0f) continue;
+      if (axis >= 0)
+      {
+        axis = -1;
+        break;
+      }
+      axis = j;
+    }
+    if (axis < 0) continue;
+    int u_axis = (axis + 1) % 3;
+    int v_axis = (axis + 2) % 3;
+
+    float u_min = std::min({ v[0][u_axis], v[1][u_axis], v[2][u_axis] });
+    float v_min = std::min({ v[0][v_axis], v[1][v_axis], v[2][v_axis] });
+    float u_max = std::max({ v[0][u_axis], v[1][u_axis], v[2][u_axis] });
+    float v_max = std::max({ v[0][v_axis], v[1][v_axis], v[2][v_axis] });
+    float cell_u = std::floor(u_min);
+    float cell_v = std::floor(v_min);
+    if ((u_max > (cell_u + 1.0f)) || (v_max > (cell_v + 1.0f))) continue;
+
+    Plane plane = { axis, (n[axis] > 0.0f) ? 1.0f : -1.0f, v[0][axis], { c[i[0] * 3], c[i[0] * 3 + 1], c[i[0] * 3 + 2] } };
+    auto& cell = planes[plane][{ int(cell_u), int(cell_v) }];
+    if (cell.faces.empty())
+    {
+      cell.area = 0.0f;
+      cell.rect = -1;
+    }
+    cell.area += std::abs(n[axis]);
+    cell.faces.push_back(uint32_t(f));
+  }
+
+  // 頂点の位置 → 使っている三角形
+  // NOTICE ハッシュ値の衝突は「使われている」側に倒れるので安全
+  std::unordered_map<uint64_t, std::vector<uint32_t>> users;
+  for (size_t f = 0; f < face_num; ++f)
+  {
+    for (int k = 0; k < 3; ++k)
+    {
+      users[VertexWeld::hashFloats(&p[indices[f * 3 + k] * 3], 3)].push_back(uint32_t(f));
+    }
+  }
+
+  // 三角形がどの長方形に入ったか
+  std::vector<int> face_rects(face_num, -1);
+  std::vector<uint32_t> new_indices;
+  std::vector<float> new_positions;
+  std::vector<float> new_colors;
+  uint32_t vertex_num = uint32_t(positions.size() / 3);
+  int rect_num = 0;
+
+  auto usedOutside = [&](const float* point, int rect)
+                     {
+                       auto it = users.find(VertexWeld::hashFloats(point, 3));
+                       if (it == users.end()) return false;
+                       for (auto f : it->second)
+                       {
+                         if (face_rects[f] != rect) return true;
+                       }
+                       return false;
+                     };
+
+  for (auto& plane_cells : planes)
+  {
+    const auto& plane = plane_cells.first;
+    auto& cells = plane_cells.second;
+    int u_axis = (plane.axis + 1) % 3;
+    int v_axis = (plane.axis + 2) % 3;
+
+    // 埋まっていない正方形は使わない
+    for (auto it = cells.begin(); it != cells.end(); )
+    {
+      if (it->second.area == 2.0f) ++it;
+      else                         it = cells.erase(it);
+    }
+
+    auto isFree = [&](int u, int v)
+                  {
+                    auto it = cells.find({ u, v });
+                    return (it != cells.end()) && (it->second.rect < 0);
+                  };
+
+    // TIPS std::map は (u, v) の順に並んでいる
+    for (auto& cell : cells)
+    {
+      if (cell.second.rect >= 0) continue;
+      int u0 = cell.first.first;
+      int v0 = cell.first.second;
+
+      // v方向へ伸ばしてから、u方向へ伸ばす
+      int height = 1;
+      while (isFree(u0, v0 + height)) height += 1;
+      int width = 1;
+      while (true)
+      {
+        bool ok = true;
+        for (int dv = 0; dv < height; ++dv)
+        {
+          if (!isFree(u0 + width, v0 + dv))
+          {
+            ok = false;
+            break;
+          }
+        }
+        if (!ok) break;
+        width += 1;
+      }
+
+      int rect = rect_num++;
+      for (int du = 0; du < width; ++du)
+      {
+        for (int dv = 0; dv < height; ++dv)
+        {
+          auto& c = cells.at({ u0 + du, v0 + dv });
+          c.rect = rect;
+          for (auto f : c.faces) face_rects[f] = rect;
+        }
+      }
+
+      auto point = [&](int u, int v, float* out)
+                   {
+                     out[plane.axis] = plane.coord;
+                     out[u_axis] = float(u);
+                     out[v_axis] = float(v);
+                   };
+
+      // 内側に他の三角形の頂点があればまとめない
+      bool inside = false;
+      for (int du = 1; (du < width) && !inside; ++du)
+      {
+        for (int dv = 1; dv < height; ++dv)
+        {
+          float pos[3];
+          point(u0 + du, v0 + dv, pos);
+          if (usedOutside(pos, rect))
+          {
+            inside = true;
+            break;
+          }
+        }
+      }
+      if (inside)
+      {
+        for (int du = 0; du < width; ++du)
+        {
+          for (int dv = 0; dv < height; ++dv)
+          {
+            for (auto f : cells.at({ u0 + du, v0 + dv }).faces) face_rects[f] = -1;
+          }
+        }
+        rect_num -= 1;
+        continue;
+      }
+
+      // 辺の上の点(反時計回り)
+      std::vector<std::pair<int, int>> loop;
+      for (int du = 0; du < width; ++du)   loop.push_back({ u0 + du, v0 });
+      for (int dv = 0; dv < height; ++dv)  loop.push_back({ u0 + width, v0 + dv });
+      for (int du = width; du > 0; --du)   loop.push_back({ u0 + du, v0 + height });
+      for (int dv = height; dv > 0; --dv)  loop.push_back({ u0, v0 + dv });
+
+      std::vector<uint32_t> boundary;
+      for (const auto& uv : loop)
+      {
+        bool corner = ((uv.first == u0) || (uv.first == (u0 + width)))
+                      && ((uv.second == v0) || (uv.second == (v0 + height)));
+        float pos[3];
+        point(uv.first, uv.second, pos);
+        if (!corner && !usedOutside(pos, rect)) continue;
+
+        boundary.push_back(vertex_num++);
+        new_positions.insert(new_positions.end(), pos, pos + 3);
+        new_colors.insert(new_colors.end(), plane.color, plane.color + 3);
+      }
+      // 裏向きなら逆回り
+      if (plane.sign < 0.0f) std::reverse(boundary.begin(), boundary.end());
+
+      if (boundary.size() == 4)
+      {
+        new_indices.insert(new_indices.end(), { boundary[0], boundary[1], boundary[2] });
+        new_indices.insert(new_indices.end(), { boundary[0], boundary[2], boundary[3] });
+      }
+      else
+      {
+        float center[3];
+        center[plane.axis] = plane.coord;
+        center[u_axis] = float(u0) + float(width) * 0.5f;
+        center[v_axis] = float(v0) + float(height) * 0.5f;
+        uint32_t center_index = vertex_num++;
+        new_positions.insert(new_positions.end(), center, center + 3);
+        new_colors.insert(new_colors.end(), plane.color, plane.color + 3);
+
+        for (size_t k = 0; k < boundary.size(); ++k)
+        {
+          new_indices.insert(new_indices.end(), { center_index, boundary[k], boundary[(k + 1) % boundary.size()] });
+        }
+      }
+    }
+  }
+  if (rect_num == 0) return 0;
+
+  // まとめなかった三角形を先に残す
+  std::vector<uint32_t> merged;
+  merged.reserve(indices.size());
+  for (size_t f = 0; f < face_num; ++f)
+  {
+    if (face_rects[f] < 0) merged.insert(merged.end(), &indices[f * 3], &indices[f * 3 + 3]);
+  }
+  merged.insert(merged.end(), new_indices.begin(), new_indices.end());
+  positions.insert(positions.end(), new_positions.begin(), new_positions.end());
+  colors.insert(colors.end(), new_colors.begin(), new_colors.end());
+
+  // 使われなくなった頂点を取り除く
+  std::vector<uint32_t> remap;
+  uint32_t count = optimizeVertexFetch(merged.data(), merged.size(), vertex_num, remap);
+  std::vector<float> compact_positions(size_t(count) * 3);
+  std::vector<float> compact_colors(size_t(count) * 3);
+  for (uint32_t i = 0; i < vertex_num; ++i)
+  {
+    if (remap[i] == ~0u) continue;
+    std::memcpy(&compact_positions[remap[i] * 3], &positions[i * 3], sizeof(float) * 3);
+    std::memcpy(&compact_colors[remap[i] * 3], &colors[i * 3], sizeof(float) * 3);
+  }
+
+  positions.swap(compact_positions);
+  colors.swap(compact_colors);
+  indices.swap(merged);
+  return uint32_t(rect_num);
+}
+
+} }
@@ -5,8 +5,11 @@
 // FIXME Panel専用
 //
 
+#include <fstream>
 #include <cinder/DataTarget.h>
 #include "PLY.hpp"
+#include "BakedModel.hpp"
+#include "MeshBaker.hpp"
 
 
 namespace ngs { namespace Model {
@@ -53,4 +56,63 @@ ci::TriMesh load(const std::string& path)
 #endif
 }
 
+
+// PLYを焼き込む
+// TIPS tools/bake_mesh と同じ工程(MeshBaker)なので、同じ環境なら結果も同じ
+bool bakePly(const std::string& path, std::string& output)
+{
+  auto buffer = Asset::load(path)->getBuffer();
+  if (!MeshBaker::bakePly(static_cast<const char*>(buffer->getData()), buffer->getSize(), MeshBaker::Options(), output))
+  {
+    DOUT << "Bake error: " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// PLYを焼き込んで書き出す
+void writeBaked(const std::string& path)
+{
+  std::string output;
+  if (!bakePly(path, output)) return;
+
+  auto full_path = getAssetPath(BakedMesh::bakedPath(path));
+  std::ofstream fstr(full_path.string(), std::ios::binary);
+  fstr.write(output.data(), output.size());
+}
+
+// 焼き込み済みのメッシュ(.bmesh)を読む
+// .bmeshが無いか壊れていたら.plyを読んで焼き込む(Releaseビルドも同じ)
+// NOTICE どちらも読めなければ nullptr
+// TIPS まとめたファイル(assets.pack)から読む時は、割り当てたメモリからそのままVBOへ転送される
+BakedModelPtr loadBaked(const std::string& path) noexcept
+{
+  auto baked_path = BakedMesh::bakedPath(path);
+
+  try
+  {
+    auto buffer = Asset::load(baked_path)->getBuffer();
+    if (auto model = BakedModel::create(buffer->getData(), buffer->getSize()))
+    {
+      return model;
+    }
+    DOUT << "Broken baked mesh: " << baked_path << std::endl;
+  }
+  catch (const std::exception& e)
+  {
+    DOUT << "No baked mesh: " << baked_path << " " << e.what() << std::endl;
+  }
+
+  try
+  {
+    std::string output;
+    if (bakePly(path, output)) return BakedModel::create(output.data(), output.size());
+  }
+  catch (const std::exception& e)
+  {
+    DOUT << "Mesh load error: " << path << " " << e.what() << std::endl;
+  }
+  return nullptr;
+}
+
 } }
@@ -0,0 +1,558 @@
+﻿#pragma once
+
+//
+// PLYの解析(Cinderに依存しない部分)
+//   メモリ上のデータを先頭から１度だけ読み、頂点と三角形の配列へ直接書き込む
+//   行ごとの文字列や配列は作らない(書き込み先の配列以外はメモリを確保しない)
+//   format は ascii と binary_little_endian に対応
+//   頂点の x y z red green blue と、面の頂点番号のリストを読む(それ以外の要素や属性は読み飛ばす)
+//
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+
+
+namespace ngs { namespace PLYParser {
+
+enum class Type : uint8_t
+{
+  NONE,
+  INT8,
+  UINT8,
+  INT16,
+  UINT16,
+  INT32,
+  UINT32,
+  FLOAT32,
+  FLOAT64,
+};
+
+// 属性の使い道
+enum class Role : uint8_t
+{
+  NONE,
+  X,
+  Y,
+  Z,
+  RED,
+  GREEN,
+  BLUE,
+  INDICES,
+};
+
+struct Property
+{
+  Type type;
+  // リストの要素数の型(リストでなければNONE)
+  Type count_type;
+  Role role;
+};
+
+struct Element
+{
+  enum
+  {
+    MAX_PROPERTIES = 16,
+  };
+
+  enum Kind
+  {
+    VERTEX,
+    FACE,
+    OTHER,
+  };
+
+  Kind kind;
+  uint32_t count;
+  Property properties[MAX_PROPERTIES];
+  int num_properties;
+};
+
+struct Header
+{
+  enum
+  {
+    MAX_ELEMENTS = 8,
+  };
+
+  bool binary;
+  Element elements[MAX_ELEMENTS];
+  int num_elements;
+  uint32_t vertex_num;
+  uint32_t face_num;
+};
+
+
+// 文字列の範囲
+struct Token
+{
+  const char* begin;
+  const char* end;
+
+  bool operator==(const char* text) const noexcept
+  {
+    size_t size = std::strlen(text);
+    return (size_t(end - begin) == size) && (std::memcmp(begin, text, size) == 0);
+  }
+};
+
+
+bool isSpace(char c) noexcept
+{
+  return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+
+// 行の中の次の単語(行末なら空)
+Token nextWord(const char*& p, const char* end) noexcept
+{
+  while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\r'))) ++p;
+  const char* begin = p;
+  while ((p < end) && !isSpace(*p)) ++p;
+  return { begin, p };
+}
+
+void skipLine(const char*& p, const char* end) noexcept
+{
+  while ((p < end) && (*p != '\n')) ++p;
+  if (p < end) ++p;
+}
+
+
+Type toType(const Token& token) noexcept
+{
+  if ((token == "char")   || (token == "int8"))    return Type::INT8;
+  if ((token == "uchar")  || (token == "uint8"))   return Type::UINT8;
+  if ((token == "short")  || (token == "int16"))   return Type::INT16;
+  if ((token == "ushort") || (token == "uint16"))  return Type::UINT16;
+  if ((token == "int")    || (token == "int32"))   return Type::INT32;
+  if ((token == "uint")   || (token == "uint32"))  return Type::UINT32;
+  if ((token == "float")  || (token == "float32")) return Type::FLOAT32;
+  if ((token == "double") || (token == "float64")) return Type::FLOAT64;
+  return Type::NONE;
+}
+
+size_t sizeOf(Type type) noexcept
+{
+  switch (type)
+  {
+  case Type::INT8:
+  case Type::UINT8:
+    return 1;
+
+  case Type::INT16:
+  case Type::UINT16:
+    return 2;
+
+  case Type::INT32:
+  case Type::UINT32:
+  case Type::FLOAT32:
+    return 4;
+
+  case Type::FLOAT64:
+    return 8;
+
+  default:
+    return 0;
+  }
+}
+
+bool isInteger(Type type) noexcept
+{
+  return (type != Type::FLOAT32) && (type != Type::FLOAT64) && (type != Type::NONE);
+}
+
+
+bool parseInt(const char*& p, const char* end, int64_t& value) noexcept
+{
+  while ((p < end) && isSpace(*p)) ++p;
+
+  bool negative = false;
+  if ((p < end) && ((*p == '-') || (*p == '+')))
+  {
+    negative = (*p == '-');
+    ++p;
+  }
+
+  int64_t v = 0;
+  int digits = 0;
+  while ((p < end) && (*p >= '0') && (*p <= '9'))
+  {
+    if (++digits > 18) return false;
+    v = v * 10 + (*p - '0');
+    ++p;
+  }
+  if ((digits == 0) || ((p < end) && !isSpace(*p))) return false;
+
+  value = negative ? -v : v;
+  return true;
+}
+
+
+// ヘッダの解析
+// 成功したら p はデータの先頭を指す
+bool parseHeader(const char*& p, const char* end, Header& header) noexcept
+{
+  header.binary = false;
+  header.num_elements = 0;
+  header.vertex_num = 0;
+  header.face_num = 0;
+
+  if (!(nextWord(p, end) == "ply")) return false;
+  skipLine(p, end);
+
+  bool has_format = false;
+  while (p < end)
+  {
+    auto word = nextWord(p, end);
+    if (word == "format")
+    {
+      auto format = nextWord(p, end);
+      if (format == "ascii")                     header.binary = false;
+      else if (format == "binary_little_endian") header.binary = true;
+      else                                       return false;
+      has_format = true;
+    }
+    else if (word == "element")
+    {
+      if (header.num_elements == Header::MAX_ELEMENTS) return false;
+      auto& element = header.elements[header.num_elements++];
+
+      auto name = nextWord(p, end);
+      element.kind = (name == "vertex") ? Element::VERTEX
+                   : (name == "face")   ? Element::FACE
+                                        : Element::OTHER;
+      int64_t count;
+      if (!parseInt(p, end, count) || (count < 0) || (count > 0xffffffffll)) return false;
+      element.count = uint32_t(count);
+      element.num_properties = 0;
+
+      if (element.kind == Element::VERTEX) header.vertex_num = element.count;
+      if (element.kind == Element::FACE)   header.face_num   = element.count;
+    }
+    else if (word == "property")
+    {
+      if (header.num_elements == 0) return false;
+      auto& element = header.elements[header.num_elements - 1];
+      if (element.num_properties == Element::MAX_PROPERTIES) return false;
+      auto& property = element.properties[element.num_properties++];
+
+      auto type = nextWord(p, end);
+      if (type == "list")
+      {
+        property.count_type = toType(nextWord(p, end));
+        property.type       = toType(nextWord(p, end));
+        if (!isInteger(property.count_type)) return false;
+      }
+      else
+      {
+        property.count_type = Type::NONE;
+        property.type       = toType(type);
+      }
+      if (property.type == Type::NONE) return false;
+
+      auto name = nextWord(p, end);
+      property.role = Role::NONE;
+      if (element.kind == Element::VERTEX && (property.count_type == Type::NONE))
+      {
+        if (name == "x")          property.role = Role::X;
+        else if (name == "y")     property.role = Role::Y;
+        else if (name == "z")     property.role = Role::Z;
+        else if (name == "red")   property.role = Role::RED;
+        else if (name == "green") property.role = Role::GREEN;
+        else if (name == "blue")  property.role = Role::BLUE;
+      }
+      else if (element.kind == Element::FACE && (property.count_type != Type::NONE))
+      {
+        if ((name == "vertex_index") || (name == "vertex_indices"))
+        {
+          if (!isInteger(property.type)) return false;
+          property.role = Role::INDICES;
+        }
+      }
+    }
+    else if (word == "end_header")
+    {
+      skipLine(p, end);
+      return has_format;
+    }
+    // TIPS comment や obj_info は読み飛ばす
+    skipLine(p, end);
+  }
+
+  return false;
+}
+
+
+// 数値の読み込み(std::from_charsの代わり)
+// TIPS 仮数が24bitに収まり、指数が小さければfloatの演算１回で正しく丸められる
+//      それ以外はstrtofに任せる
+bool parseFloat(const char*& p, const char* end, float& value) noexcept
+{
+  static const float pow10[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+  };
+
+  while ((p < end) && isSpace(*p)) ++p;
+  const char* start = p;
+
+  bool negative = false;
+  if ((p < end) && ((*p == '-') || (*p == '+')))
+  {
+    negative = (*p == '-');
+    ++p;
+  }
+
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool any = false;
+  bool exact = true;
+  while ((p < end) && (*p >= '0') && (*p <= '9'))
+  {
+    any = true;
+    if (digits < 18)
+    {
+      mantissa = mantissa * 10 + (*p - '0');
+      if (mantissa != 0) ++digits;
+    }
+    else
+    {
+      exponent += 1;
+      exact = false;
+    }
+    ++p;
+  }
+  if ((p < end) && (*p == '.'))
+  {
+    ++p;
+    while ((p < end) && (*p >= '0') && (*p <= '9'))
+    {
+      any = true;
+      if (digits < 18)
+      {
+        mantissa = mantissa * 10 + (*p - '0');
+        if (mantissa != 0) ++digits;
+        exponent -= 1;
+      }
+      else
+      {
+        exact = false;
+      }
+      ++p;
+    }
+  }
+  if (!any) return false;
+
+  if ((p < end) && ((*p == 'e') || (*p == 'E')))
+  {
+    ++p;
+    bool negative_exp = false;
+    if ((p < end) && ((*p == '-') || (*p == '+')))
+    {
+      negative_exp = (*p == '-');
+      ++p;
+    }
+    int e = 0;
+    bool any_exp = false;
+    while ((p < end) && (*p >= '0') && (*p <= '9'))
+    {
+      any_exp = true;
+      if (e < 10000) e = e * 10 + (*p - '0');
+      ++p;
+    }
+    if (!any_exp) return false;
+    exponent += negative_exp ? -e : e;
+  }
+  if ((p < end) && !isSpace(*p)) return false;
+
+  if (exact && (mantissa <= (1u << 24)) && (exponent >= -10) && (exponent <= 10))
+  {
+    value = float(mantissa);
+    value = (exponent < 0) ? value / pow10[-exponent] : value * pow10[exponent];
+    if (negative) value = -value;
+    return true;
+  }
+
+  // NOTICE strtofは終端が必要
+  char buffer[64];
+  size_t size = size_t(p - start);
+  if (size >= sizeof(buffer)) return false;
+  std::memcpy(buffer, start, size);
+  buffer[size] = '\0';
+  value = std::strtof(buffer, nullptr);
+  return true;
+}
+
+// NOTICE リトルエンディアンの環境のみ
+template <typename T>
+T readRaw(const char* p) noexcept
+{
+  T value;
+  std::memcpy(&value, p, sizeof(T));
+  return value;
+}
+
+bool readBinary(const char*& p, const char* end, Type type, double& value) noexcept
+{
+  size_t size = sizeOf(type);
+  if (size_t(end - p) < size) return false;
+
+  switch (type)
+  {
+  case Type::INT8:    value = readRaw<int8_t>(p);   break;
+  case Type::UINT8:   value = readRaw<uint8_t>(p);  break;
+  case Type::INT16:   value = readRaw<int16_t>(p);  break;
+  case Type::UINT16:  value = readRaw<uint16_t>(p); break;
+  case Type::INT32:   value = readRaw<int32_t>(p);  break;
+  case Type::UINT32:  value = readRaw<uint32_t>(p); break;
+  case Type::FLOAT32: value = readRaw<float>(p);    break;
+  case Type::FLOAT64: value = readRaw<double>(p);   break;
+  default:            return false;
+  }
+  p += size;
+  return true;
+}
+
+// 値を１つ読む
+//   整数は int_value、小数は float_value へ
+bool readValue(const char*& p, const char* end, bool binary, Type type,
+               int64_t& int_value, float& float_value) noexcept
+{
+  if (binary)
+  {
+    double v;
+    if (!readBinary(p, end, type, v)) return false;
+    int_value   = int64_t(v);
+    float_value = float(v);
+    return true;
+  }
+
+  if (isInteger(type))
+  {
+    if (!parseInt(p, end, int_value)) return false;
+    float_value = float(int_value);
+    return true;
+  }
+  if (type == Type::FLOAT64)
+  {
+    // TIPS 倍精度はまれなのでstrtodに任せる
+    while ((p < end) && isSpace(*p)) ++p;
+    char buffer[64];
+    size_t size = 0;
+    while (((p + size) < end) && !isSpace(p[size]) && (size < (sizeof(buffer) - 1))) ++size;
+    std::memcpy(buffer, p, size);
+    buffer[size] = '\0';
+    char* last;
+    double v = std::strtod(buffer, &last);
+    if (last == buffer) return false;
+    p += size;
+    float_value = float(v);
+    int_value   = int64_t(v);
+    return true;
+  }
+  if (!parseFloat(p, end, float_value)) return false;
+  int_value = int64_t(float_value);
+  return true;
+}
+
+
+// 解析
+//   positions: x y z の並び
+//   colors:    r g b の並び(0〜1)。色の無いPLYは白
+//   indices:   三角形の頂点番号(多角形は扇状に分割)
+// 書き込み先の末尾へ追加する。壊れていたらfalse
+bool parse(const char* data, size_t size,
+           std::vector<float>& positions, std::vector<float>& colors,
+           std::vector<uint32_t>& indices) noexcept
+{
+  const char* p   = data;
+  const char* end = data + size;
+
+  Header header;
+  if (!parseHeader(p, end, header)) return false;
+
+  // TIPS 頂点数と面の数が分かっているので、先に確保しておく
+  uint32_t base = uint32_t(positions.size() / 3);
+  positions.reserve(positions.size() + size_t(header.vertex_num) * 3);
+  colors.reserve(colors.size() + size_t(header.vertex_num) * 3);
+  indices.reserve(indices.size() + size_t(header.face_num) * 3);
+
+  for (int e = 0; e < header.num_elements; ++e)
+  {
+    const auto& element = header.elements[e];
+    for (uint32_t i = 0; i < element.count; ++i)
+    {
+      float vertex[6] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+      for (int k = 0; k < element.num_properties; ++k)
+      {
+        const auto& property = element.properties[k];
+        int64_t int_value;
+        float float_value;
+
+        if (property.count_type != Type::NONE)
+        {
+          // リスト
+          if (!readValue(p, end, header.binary, property.count_type, int_value, float_value)) return false;
+          if (int_value < 0) return false;
+          auto count = uint32_t(int_value);
+
+          uint32_t first = 0;
+          uint32_t prev  = 0;
+          for (uint32_t j = 0; j < count; ++j)
+          {
+            if (!readValue(p, end, header.binary, property.type, int_value, float_value)) return false;
+            if (property.role != Role::INDICES) continue;
+
+            if ((int_value < 0) || (int_value >= int64_t(header.vertex_num))) return false;
+            uint32_t index = base + uint32_t(int_value);
+            if (j == 0)
+            {
+              first = index;
+            }
+            else if (j >= 2)
+            {
+              indices.push_back(first);
+              indices.push_back(prev);
+              indices.push_back(index);
+            }
+            prev = index;
+          }
+          continue;
+        }
+
+        if (!readValue(p, end, header.binary, property.type, int_value, float_value)) return false;
+        switch (property.role)
+        {
+        case Role::X: vertex[0] = float_value; break;
+        case Role::Y: vertex[1] = float_value; break;
+        case Role::Z: vertex[2] = float_value; break;
+
+        case Role::RED:
+        case Role::GREEN:
+        case Role::BLUE:
+          {
+            // TIPS 整数の色は0〜255
+            int index = 3 + int(property.role) - int(Role::RED);
+            vertex[index] = isInteger(property.type) ? (float_value / 255.0f) : float_value;
+          }
+          break;
+
+        default:
+          break;
+        }
+      }
+
+      if (element.kind == Element::VERTEX)
+      {
+        positions.insert(positions.end(), &vertex[0], &vertex[3]);
+        colors.insert(colors.end(), &vertex[3], &vertex[6]);
+      }
+    }
+  }
+
+  return true;
+}
+
+} }
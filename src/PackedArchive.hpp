@@ -0,0 +1,413 @@
+﻿#pragma once
+
+//
+// １つにまとめたファイル(tools/main.cpp で作る)を読む
+//   ファイルをメモリに割り当てて、中身はコピーせずに返す
+//   名前はハッシュ値の順に並べた索引から二分探索で探す
+//
+//   version 2 (リトルエンディアン)
+//     magic            4  "PMA2"
+//     version          4  2
+//     ファイル数       4
+//     境界             4  データの先頭はこの倍数(通常はページの大きさ)
+//     索引の位置       8  先頭から
+//     名前の位置       8  先頭から
+//     データ           ファイルごとに境界へ揃える
+//     索引             × ファイル数  名前のハッシュ値の順
+//       hash           8  名前のFNV-1a
+//       名前の位置     4  名前の先頭から
+//       名前の長さ     4
+//       offset         8  先頭から
+//       size           8  格納されている大きさ
+//       元の大きさ     8  伸長後
+//       crc            4  格納されているデータのCRC32
+//       圧縮           4  Compression
+//     名前             ディレクトリの区切りは '/'
+//
+//   version 1
+//     ファイル数       4
+//     ファイル情報     × ファイル数
+//       名前の長さ     4
+//       名前           可変
+//       offset         4  先頭から
+//       size           4
+//     データ
+//     索引             × ファイル数  名前のハッシュ値の順(無い場合もある)
+//       hash           8  名前のFNV-1a
+//       名前の位置     4  先頭から
+//       名前の長さ     4
+//       offset         4
+//       size           4
+//     索引の位置       4  先頭から
+//     索引の数         4
+//     magic            4  "PMIX"
+//
+//   NOTICE version 1 の索引の無いファイルは、開く時にファイル情報から索引を作る
+//
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include <zlib.h>
+#include "MappedFile.hpp"
+#include "CoreUtility.hpp"
+
+
+namespace ngs {
+
+class PackedArchive
+{
+public:
+  using Data = Span<const char>;
+
+  enum class Compression : uint32_t
+  {
+    NONE,
+    ZLIB,
+  };
+
+  struct Entry
+  {
+    // 格納されているデータ(圧縮されていればそのまま)
+    Data data{ nullptr, nullptr };
+    // 元の大きさ
+    uint64_t size = 0;
+    Compression compression = Compression::NONE;
+    // NOTICE version 1 はCRCを持っていない
+    bool has_crc = false;
+    uint32_t crc = 0;
+  };
+
+  enum
+  {
+    V1_INDEX_ENTRY_SIZE = 8 + 4 + 4 + 4 + 4,
+    V1_FOOTER_SIZE      = 4 + 4 + 4,
+
+    V2_HEADER_SIZE      = 4 + 4 + 4 + 4 + 8 + 8,
+    V2_INDEX_ENTRY_SIZE = 8 + 4 + 4 + 8 + 8 + 8 + 4 + 4,
+  };
+
+
+  PackedArchive() = default;
+
+  PackedArchive(const std::string& path) noexcept
+    : file_(path)
+  {
+    if (!file_.isOpen()) return;
+    valid_ = readV2() || readIndex() || buildIndex();
+  }
+
+  ~PackedArchive() = default;
+
+  // TIPS 索引は位置で持っているのでそのままムーブできる
+  PackedArchive(PackedArchive&&) = default;
+  PackedArchive& operator=(PackedArchive&&) = default;
+
+
+  bool isOpen() const noexcept
+  {
+    return valid_;
+  }
+
+  int version() const noexcept
+  {
+    return version_;
+  }
+
+  // まとめた時に作った索引を使っている
+  bool hasIndex() const noexcept
+  {
+    return valid_ && index_in_file_;
+  }
+
+  size_t size() const noexcept
+  {
+    return count_;
+  }
+
+
+  // ファイルを探す
+  // TIPS 中身はコピーしない(PackedArchiveが有効な間だけ使える)
+  bool find(const std::string& name, Entry& entry) const noexcept
+  {
+    if (!valid_) return false;
+
+    auto hash = hashName(name.data(), name.size());
+
+    // 同じハッシュ値の先頭
+    size_t first = 0;
+    size_t last  = count_;
+    while (first < last)
+    {
+      size_t mid = (first + last) / 2;
+      if (readValue<uint64_t>(index() + mid * entry_size_) < hash) first = mid + 1;
+      else                                                        last  = mid;
+    }
+
+    // NOTICE ハッシュ値が同じでも名前が違う事がある
+    for (size_t i = first; i < count_; ++i)
+    {
+      const char* p = index() + i * entry_size_;
+      if (readValue<uint64_t>(p) != hash) break;
+
+      uint64_t name_offset = names_ + readValue<uint32_t>(p + 8);
+      uint64_t name_size   = readValue<uint32_t>(p + 12);
+      if (!inFile(name_offset, name_size)) continue;
+      if ((name_size != name.size())
+          || (std::memcmp(file_.data() + name_offset, name.data(), name.size()) != 0)) continue;
+
+      return readEntry(p, entry);
+    }
+
+    return false;
+  }
+
+
+  // 格納されているデータが壊れていないか
+  static bool verify(const Entry& entry) noexcept
+  {
+    if (!entry.has_crc) return true;
+    return crc32(entry.data.begin(), entry.data.size()) == entry.crc;
+  }
+
+  // 伸長してoutputへ書き出す
+  // NOTICE outputは entry.size の大きさが必要
+  static bool extract(const Entry& entry, void* output) noexcept
+  {
+    if (!verify(entry)) return false;
+
+    switch (entry.compression)
+    {
+    case Compression::NONE:
+      if (entry.data.size() != entry.size) return false;
+      std::memcpy(output, entry.data.begin(), entry.data.size());
+      return true;
+
+    case Compression::ZLIB:
+      {
+        if ((entry.size > ULONG_MAX) || (entry.data.size() > ULONG_MAX)) return false;
+        uLongf size = uLongf(entry.size);
+        int status = uncompress(static_cast<Bytef*>(output), &size,
+                                reinterpret_cast<const Bytef*>(entry.data.begin()), uLong(entry.data.size()));
+        return (status == Z_OK) && (size == entry.size);
+      }
+    }
+
+    return false;
+  }
+
+  static bool extract(const Entry& entry, std::string& output) noexcept
+  {
+    output.resize(size_t(entry.size));
+    if (entry.size == 0) return verify(entry);
+    return extract(entry, &output[0]);
+  }
+
+
+  // 名前のハッシュ値(FNV-1a)
+  static uint64_t hashName(const char* name, size_t size) noexcept
+  {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i)
+    {
+      hash ^= uint8_t(name[i]);
+      hash *= 0x100000001b3ull;
+    }
+    return hash;
+  }
+
+  static uint32_t crc32(const char* data, size_t size) noexcept
+  {
+    uLong crc = ::crc32(0, Z_NULL, 0);
+    // TIPS zlibは一度に uInt までしか受け取れない
+    while (size > 0)
+    {
+      auto n = uInt(std::min(size, size_t(UINT_MAX)));
+      crc = ::crc32(crc, reinterpret_cast<const Bytef*>(data), n);
+      data += n;
+      size -= n;
+    }
+    return uint32_t(crc);
+  }
+
+
+private:
+  bool readV2() noexcept
+  {
+    auto file_size = file_.size();
+    if (file_size < V2_HEADER_SIZE) return false;
+
+    const char* header = file_.data();
+    if (std::memcmp(header, "PMA2", 4) != 0) return false;
+    if (readValue<uint32_t>(header + 4) != 2) return false;
+
+    auto count        = readValue<uint32_t>(header + 8);
+    auto index_offset = readValue<uint64_t>(header + 16);
+    auto names_offset = readValue<uint64_t>(header + 24);
+    if ((index_offset > file_size) || (names_offset > file_size)) return false;
+    if ((uint64_t(count) * V2_INDEX_ENTRY_SIZE) > (file_size - index_offset)) return false;
+
+    version_       = 2;
+    index_offset_  = index_offset;
+    index_in_file_ = true;
+    count_         = count;
+    entry_size_    = V2_INDEX_ENTRY_SIZE;
+    names_         = names_offset;
+    return true;
+  }
+
+  // 末尾の索引を使う
+  bool readIndex() noexcept
+  {
+    auto file_size = file_.size();
+    if (file_size < V1_FOOTER_SIZE) return false;
+
+    const char* footer = file_.data() + file_size - V1_FOOTER_SIZE;
+    if (std::memcmp(footer + 8, "PMIX", 4) != 0) return false;
+
+    auto index_offset = readValue<uint32_t>(footer);
+    auto count        = readValue<uint32_t>(footer + 4);
+    if ((uint64_t(index_offset) + uint64_t(count) * V1_INDEX_ENTRY_SIZE) != (file_size - V1_FOOTER_SIZE)) return false;
+
+    index_offset_  = index_offset;
+    index_in_file_ = true;
+    count_         = count;
+    return true;
+  }
+
+  // 索引が無いので、ファイル情報から作る
+  bool buildIndex() noexcept
+  {
+    auto file_size = file_.size();
+    if (file_size < 4) return false;
+
+    auto num = readValue<uint32_t>(file_.data());
+    // NOTICE 壊れた数で大量に確保しない
+    if (num > (file_size / 12)) return false;
+
+    struct Info
+    {
+      uint64_t hash;
+      uint32_t name_offset;
+      uint32_t name_size;
+      uint32_t offset;
+      uint32_t size;
+    };
+    std::vector<Info> infos;
+    infos.reserve(num);
+
+    size_t pos = 4;
+    for (uint32_t i = 0; i < num; ++i)
+    {
+      if ((pos + 4) > file_size) return false;
+      auto name_size = readValue<uint32_t>(file_.data() + pos);
+      pos += 4;
+      if ((uint64_t(pos) + name_size + 8) > file_size) return false;
+
+      Info info;
+      info.hash        = hashName(file_.data() + pos, name_size);
+      info.name_offset = uint32_t(pos);
+      info.name_size   = name_size;
+      pos += name_size;
+      info.offset = readValue<uint32_t>(file_.data() + pos);
+      info.size   = readValue<uint32_t>(file_.data() + pos + 4);
+      pos += 8;
+
+      infos.push_back(info);
+    }
+    std::stable_sort(std::begin(infos), std::end(infos),
+                     [](const Info& a, const Info& b)
+                     {
+                       return a.hash < b.hash;
+                     });
+
+    // TIPS 末尾の索引と同じ形式にしておけば、探す処理は１つで済む
+    built_index_.resize(infos.size() * V1_INDEX_ENTRY_SIZE);
+    char* p = &built_index_[0];
+    for (const auto& info : infos)
+    {
+      std::memcpy(p,      &info.hash,        8);
+      std::memcpy(p + 8,  &info.name_offset, 4);
+      std::memcpy(p + 12, &info.name_size,   4);
+      std::memcpy(p + 16, &info.offset,      4);
+      std::memcpy(p + 20, &info.size,        4);
+      p += V1_INDEX_ENTRY_SIZE;
+    }
+
+    count_ = infos.size();
+    return true;
+  }
+
+  bool readEntry(const char* p, Entry& entry) const noexcept
+  {
+    uint64_t offset;
+    uint64_t size;
+    if (version_ == 2)
+    {
+      offset            = readValue<uint64_t>(p + 16);
+      size              = readValue<uint64_t>(p + 24);
+      entry.size        = readValue<uint64_t>(p + 32);
+      entry.crc         = readValue<uint32_t>(p + 40);
+      entry.compression = Compression(readValue<uint32_t>(p + 44));
+      entry.has_crc     = true;
+
+      if (entry.compression > Compression::ZLIB) return false;
+    }
+    else
+    {
+      offset            = readValue<uint32_t>(p + 16);
+      size              = readValue<uint32_t>(p + 20);
+      entry.size        = size;
+      entry.crc         = 0;
+      entry.compression = Compression::NONE;
+      entry.has_crc     = false;
+    }
+    if (!inFile(offset, size)) return false;
+
+    entry.data = Data(file_.data() + offset, file_.data() + offset + size);
+    return true;
+  }
+
+  // 索引の先頭
+  // NOTICE ムーブでstd::stringの中身が移るので毎回求める
+  const char* index() const noexcept
+  {
+    return index_in_file_ ? file_.data() + index_offset_
+                          : built_index_.data();
+  }
+
+  bool inFile(uint64_t offset, uint64_t size) const noexcept
+  {
+    return (offset <= file_.size()) && (size <= (file_.size() - offset));
+  }
+
+  // NOTICE 境界に揃っていないのでmemcpyで読む
+  template <typename T>
+  static T readValue(const char* p) noexcept
+  {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+  }
+
+
+  MappedFile file_;
+  bool valid_  = false;
+  int version_ = 1;
+
+  // 索引(ハッシュ値の順)
+  uint64_t index_offset_ = 0;
+  // ファイルに索引があった
+  bool index_in_file_ = false;
+  size_t count_ = 0;
+  size_t entry_size_ = V1_INDEX_ENTRY_SIZE;
+  // 名前の位置(version 1 は先頭から)
+  uint64_t names_ = 0;
+  // 索引の無いファイル用に作ったもの
+  std::string built_index_;
+};
+
+}
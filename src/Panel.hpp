@@ -4,8 +4,12 @@
 // 地形パネル
 //
 
+#include "Defines.hpp"
 #include <vector>
-#include "Utility.hpp"
+#include <array>
+#include <iterator>
+#include <cstdint>
+#include "CoreUtility.hpp"
 
 
 namespace ngs {
@@ -33,168 +37,210 @@ struct Panel {
     BUILDING    = TOWN | CASTLE | FORT    // PATH完成とみなす建築物
   };
 
-  Panel(u_int attribute, u_int edge_up, u_int edge_right, u_int edge_bottom, u_int edge_left) noexcept
-    : attribute_(attribute),
-      edge_(4)
-  {
-    edge_[0] = edge_bottom;
-    edge_[1] = edge_right;
-    edge_[2] = edge_up;
-    edge_[3] = edge_left;
-
-    uint64_t edge = 0;
-    for (u_int i = 0; i < edge_.size(); ++i)
-    {
-      edge |= uint64_t(edge_[i] & Panel::EDGE_MASK) << (16 * i);
-    }
-    edge_bundled_ = edge;
-  }
+  // ４辺の構造
+  using Edge = std::array<u_int, 4>;
 
-  ~Panel() = default;
 
-
-  u_int getAttribute() const noexcept
+  // NOTICE 回転した辺の情報は全てここで求めておく
+  constexpr Panel(u_int attribute, u_int edge_up, u_int edge_right, u_int edge_bottom, u_int edge_left) noexcept
+    : attribute_(attribute),
+      rotated_edge_{ {
+        rotateEdge(edge_bottom, edge_right, edge_up, edge_left, 0),
+        rotateEdge(edge_bottom, edge_right, edge_up, edge_left, 1),
+        rotateEdge(edge_bottom, edge_right, edge_up, edge_left, 2),
+        rotateEdge(edge_bottom, edge_right, edge_up, edge_left, 3),
+      } },
+      rotated_value_{ {
+        bundleEdge(rotateEdge(edge_bottom, edge_right, edge_up, edge_left, 0)),
+        bundleEdge(rotateEdge(edge_bottom, edge_right, edge_up, edge_left, 1)),
+        bundleEdge(rotateEdge(edge_bottom, edge_right, edge_up, edge_left, 2)),
+        bundleEdge(rotateEdge(edge_bottom, edge_right, edge_up, edge_left, 3)),
+      } }
+  {}
+
+
+  constexpr u_int getAttribute() const noexcept
   {
     return attribute_;
   }
 
-  const std::vector<u_int>& getEdge() const noexcept
+  constexpr const Edge& getEdge() const noexcept
   {
-    return edge_;
+    return rotated_edge_[0];
   }
 
-  uint64_t getEdgeBundled() const noexcept
+  constexpr uint64_t getEdgeBundled() const noexcept
   {
-    return edge_bundled_;
+    return rotated_value_[0];
   }
 
   // 回転ずみの端情報
-  std::vector<u_int> getRotatedEdge(u_int rotation) const noexcept
+  constexpr const Edge& getRotatedEdge(u_int rotation) const noexcept
   {
-    std::vector<u_int> edge = edge_;
-
-    // 左方向へのシフト
-    std::rotate(std::begin(edge), std::begin(edge) + rotation, std::end(edge));
-    return edge;
+    return rotated_edge_[rotation];
   }
 
   // uint64_t で返す
-  uint64_t getRotatedEdgeValue(u_int rotation) const noexcept
+  constexpr uint64_t getRotatedEdgeValue(u_int rotation) const noexcept
   {
-    return rotateRight(edge_bundled_, rotation * 16);
+    return rotated_value_[rotation];
   }
 
 
 private:
+  // 左方向へのシフト
+  static constexpr Edge rotateEdge(u_int e0, u_int e1, u_int e2, u_int e3, u_int rotation) noexcept
+  {
+    return Edge{ {
+      selectEdge(e0, e1, e2, e3, rotation),
+      selectEdge(e0, e1, e2, e3, rotation + 1),
+      selectEdge(e0, e1, e2, e3, rotation + 2),
+      selectEdge(e0, e1, e2, e3, rotation + 3),
+    } };
+  }
+
+  static constexpr u_int selectEdge(u_int e0, u_int e1, u_int e2, u_int e3, u_int index) noexcept
+  {
+    return ((index % 4) == 0) ? e0
+         : ((index % 4) == 1) ? e1
+         : ((index % 4) == 2) ? e2
+         : e3;
+  }
+
+  // １つにまとめる
+  static constexpr uint64_t bundleEdge(const Edge& edge) noexcept
+  {
+    return (uint64_t(edge[0] & Panel::EDGE_MASK))
+         | (uint64_t(edge[1] & Panel::EDGE_MASK) << 16)
+         | (uint64_t(edge[2] & Panel::EDGE_MASK) << 32)
+         | (uint64_t(edge[3] & Panel::EDGE_MASK) << 48);
+  }
+
+
   u_int attribute_;
-  std::vector<u_int> edge_;     // ４辺の構造
-  uint64_t edge_bundled_;       // ４辺の構造(１つにまとめた値)
+  std::array<Edge, 4> rotated_edge_;        // ４辺の構造(回転ごと)
+  std::array<uint64_t, 4> rotated_value_;   // ４辺の構造(１つにまとめた値)
 
 };
 
 
+// 全パネル
+constexpr Panel panel_catalogue[] = {
+  // a
+  { Panel::DEEP_FOREST, Panel::GRASS,  Panel::FOREST, Panel::FOREST, Panel::FOREST },
+  { 0, Panel::PATH,   Panel::PATH,   Panel::FOREST, Panel::FOREST },
+  { Panel::TOWN, Panel::FOREST | Panel::EDGE, Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
+  { 0, Panel::GRASS,  Panel::GRASS,  Panel::PATH,   Panel::PATH },
+  
+  { 0, Panel::FOREST | Panel::EDGE, Panel::GRASS,  Panel::GRASS, Panel::GRASS },
+  { 0, Panel::FOREST, Panel::FOREST, Panel::GRASS, Panel::GRASS },
+  { 0, Panel::PATH,   Panel::PATH,   Panel::GRASS, Panel::FOREST | Panel::EDGE },
+  { 0, Panel::PATH,   Panel::GRASS,  Panel::GRASS, Panel::PATH },
+  
+  { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::GRASS, Panel::FOREST | Panel::EDGE },
+  { 0, Panel::GRASS, Panel::PATH,   Panel::PATH,  Panel::FOREST | Panel::EDGE },
+  { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS, Panel::PATH },
+  { 0, Panel::GRASS, Panel::GRASS,  Panel::PATH,  Panel::PATH },
+
+  // a
+  { Panel::DEEP_FOREST, Panel::GRASS,  Panel::FOREST, Panel::FOREST, Panel::FOREST },
+  { 0, Panel::PATH,   Panel::PATH,   Panel::FOREST, Panel::FOREST },
+  { Panel::TOWN, Panel::FOREST | Panel::EDGE, Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
+  { 0, Panel::GRASS,  Panel::GRASS,  Panel::PATH,   Panel::PATH },
+
+  { 0, Panel::FOREST | Panel::EDGE, Panel::GRASS,  Panel::GRASS, Panel::GRASS },
+  { 0, Panel::FOREST, Panel::FOREST, Panel::GRASS, Panel::GRASS },
+  { 0, Panel::PATH,   Panel::PATH,   Panel::GRASS, Panel::FOREST | Panel::EDGE },
+  { 0, Panel::PATH,   Panel::GRASS,  Panel::GRASS, Panel::PATH },
+  
+  { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::GRASS, Panel::FOREST | Panel::EDGE },
+  { 0, Panel::GRASS, Panel::PATH,   Panel::PATH,  Panel::FOREST | Panel::EDGE },
+  { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS, Panel::PATH },
+  { 0, Panel::GRASS, Panel::GRASS,  Panel::PATH,  Panel::PATH },
+
+  // a
+  { Panel::DEEP_FOREST, Panel::GRASS,  Panel::FOREST, Panel::FOREST, Panel::FOREST },
+  { 0, Panel::PATH,   Panel::PATH,   Panel::FOREST, Panel::FOREST },
+  { Panel::TOWN, Panel::FOREST | Panel::EDGE, Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
+  { 0, Panel::GRASS,  Panel::GRASS,  Panel::PATH,   Panel::PATH },
+
+  { 0, Panel::FOREST | Panel::EDGE, Panel::GRASS,  Panel::GRASS, Panel::GRASS },
+  { 0, Panel::FOREST, Panel::FOREST, Panel::GRASS, Panel::GRASS },
+  { 0, Panel::PATH,   Panel::PATH,   Panel::GRASS, Panel::FOREST | Panel::EDGE },
+  { 0, Panel::PATH,   Panel::GRASS,  Panel::GRASS, Panel::PATH },
+  
+  { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::GRASS, Panel::FOREST | Panel::EDGE },
+  { 0, Panel::GRASS, Panel::PATH,   Panel::PATH,  Panel::FOREST | Panel::EDGE },
+  { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS, Panel::PATH },
+  { 0, Panel::GRASS, Panel::GRASS,  Panel::PATH,  Panel::PATH },
+
+  // d
+  { 0, Panel::GRASS,  Panel::PATH,   Panel::GRASS,  Panel::PATH },
+  { Panel::TOWN, Panel::GRASS,  Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
+  { Panel::DEEP_FOREST, Panel::FOREST, Panel::FOREST, Panel::FOREST, Panel::PATH | Panel::EDGE },
+  { 0, Panel::GRASS,  Panel::FOREST, Panel::GRASS,  Panel::FOREST },
+  
+  { Panel::CHURCH, Panel::GRASS,  Panel::GRASS,  Panel::GRASS, Panel::GRASS },
+  { 0, Panel::PATH, Panel::FOREST | Panel::EDGE, Panel::PATH,  Panel::GRASS },
+  { 0, Panel::FOREST, Panel::GRASS,  Panel::GRASS, Panel::FOREST },
+  { Panel::CHURCH, Panel::GRASS,  Panel::GRASS,  Panel::GRASS, Panel::GRASS },
+   
+  { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS,  Panel::PATH },
+  { Panel::TOWN, Panel::PATH | Panel::EDGE,  Panel::PATH | Panel::EDGE,   Panel::GRASS,  Panel::PATH | Panel::EDGE },
+  { Panel::FOREST, Panel::GRASS, Panel::GRASS,  Panel::GRASS,  Panel::PATH | Panel::EDGE },
+  { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::FOREST | Panel::EDGE, Panel::GRASS },
+
+  // d
+  { 0, Panel::GRASS,  Panel::PATH,   Panel::GRASS,  Panel::PATH },
+  { Panel::TOWN, Panel::GRASS,  Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
+  { Panel::DEEP_FOREST, Panel::FOREST, Panel::FOREST, Panel::FOREST, Panel::PATH | Panel::EDGE },
+  { 0, Panel::GRASS,  Panel::FOREST, Panel::GRASS,  Panel::FOREST },
+  
+  { Panel::CHURCH, Panel::GRASS,  Panel::GRASS,  Panel::GRASS, Panel::GRASS },
+  { 0, Panel::PATH, Panel::FOREST | Panel::EDGE, Panel::PATH,  Panel::GRASS },
+  { 0, Panel::FOREST, Panel::GRASS,  Panel::GRASS, Panel::FOREST },
+  { Panel::CHURCH, Panel::GRASS,  Panel::GRASS,  Panel::GRASS, Panel::GRASS },
+
+  { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS,  Panel::PATH },
+  { Panel::TOWN, Panel::PATH | Panel::EDGE,  Panel::PATH | Panel::EDGE,   Panel::GRASS,  Panel::PATH | Panel::EDGE },
+  { Panel::FOREST, Panel::GRASS, Panel::GRASS,  Panel::GRASS,  Panel::PATH | Panel::EDGE },
+  { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::FOREST | Panel::EDGE, Panel::GRASS },
+
+  // f 
+  { 0, Panel::PATH,   Panel::FOREST, Panel::FOREST, Panel::PATH },
+  { Panel::DEEP_FOREST, Panel::FOREST, Panel::GRASS,  Panel::FOREST, Panel::FOREST },
+  { 0, Panel::GRASS,  Panel::GRASS,  Panel::FOREST | Panel::EDGE, Panel::GRASS },
+  { 0, Panel::PATH, Panel::FOREST | Panel::EDGE, Panel::PATH,   Panel::GRASS },
+  
+  { 0, Panel::FOREST, Panel::FOREST, Panel::PATH,   Panel::PATH },
+  { Panel::DEEP_FOREST, Panel::FOREST, Panel::FOREST, Panel::FOREST, Panel::FOREST },
+  { Panel::DEEP_FOREST, Panel::FOREST, Panel::PATH | Panel::EDGE,   Panel::FOREST, Panel::FOREST },
+  { Panel::CASTLE, Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
+
+  { 0, Panel::PATH, Panel::GRASS, Panel::PATH, Panel::GRASS },
+  { 0, Panel::FOREST, Panel::GRASS, Panel::FOREST, Panel::GRASS },
+  { 0, Panel::FOREST | Panel::EDGE, Panel::GRASS, Panel::GRASS, Panel::GRASS },
+  { Panel::START, Panel::PATH, Panel::FOREST | Panel::EDGE, Panel::PATH, Panel::GRASS },
+};
+
+// 開始用パネルの枚数
+constexpr int countStartPanels() noexcept
+{
+  int num = 0;
+  for (const auto& panel : panel_catalogue)
+  {
+    if (panel.getAttribute() & Panel::START) num += 1;
+  }
+  return num;
+}
+static_assert(countStartPanels() > 0, "No start panel.");
+
+
 // 初期パネル生成
+// TIPS 中身はコンパイル時に決まっている
 std::vector<Panel> createPanels() noexcept
 {
-  static const std::vector<Panel> panels = {
-    // a
-    { Panel::DEEP_FOREST, Panel::GRASS,  Panel::FOREST, Panel::FOREST, Panel::FOREST },
-    { 0, Panel::PATH,   Panel::PATH,   Panel::FOREST, Panel::FOREST },
-    { Panel::TOWN, Panel::FOREST | Panel::EDGE, Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
-    { 0, Panel::GRASS,  Panel::GRASS,  Panel::PATH,   Panel::PATH },
-    
-    { 0, Panel::FOREST | Panel::EDGE, Panel::GRASS,  Panel::GRASS, Panel::GRASS },
-    { 0, Panel::FOREST, Panel::FOREST, Panel::GRASS, Panel::GRASS },
-    { 0, Panel::PATH,   Panel::PATH,   Panel::GRASS, Panel::FOREST | Panel::EDGE },
-    { 0, Panel::PATH,   Panel::GRASS,  Panel::GRASS, Panel::PATH },
-    
-    { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::GRASS, Panel::FOREST | Panel::EDGE },
-    { 0, Panel::GRASS, Panel::PATH,   Panel::PATH,  Panel::FOREST | Panel::EDGE },
-    { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS, Panel::PATH },
-    { 0, Panel::GRASS, Panel::GRASS,  Panel::PATH,  Panel::PATH },
-
-    // a
-    { Panel::DEEP_FOREST, Panel::GRASS,  Panel::FOREST, Panel::FOREST, Panel::FOREST },
-    { 0, Panel::PATH,   Panel::PATH,   Panel::FOREST, Panel::FOREST },
-    { Panel::TOWN, Panel::FOREST | Panel::EDGE, Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
-    { 0, Panel::GRASS,  Panel::GRASS,  Panel::PATH,   Panel::PATH },
-
-    { 0, Panel::FOREST | Panel::EDGE, Panel::GRASS,  Panel::GRASS, Panel::GRASS },
-    { 0, Panel::FOREST, Panel::FOREST, Panel::GRASS, Panel::GRASS },
-    { 0, Panel::PATH,   Panel::PATH,   Panel::GRASS, Panel::FOREST | Panel::EDGE },
-    { 0, Panel::PATH,   Panel::GRASS,  Panel::GRASS, Panel::PATH },
-    
-    { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::GRASS, Panel::FOREST | Panel::EDGE },
-    { 0, Panel::GRASS, Panel::PATH,   Panel::PATH,  Panel::FOREST | Panel::EDGE },
-    { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS, Panel::PATH },
-    { 0, Panel::GRASS, Panel::GRASS,  Panel::PATH,  Panel::PATH },
-
-    // a
-    { Panel::DEEP_FOREST, Panel::GRASS,  Panel::FOREST, Panel::FOREST, Panel::FOREST },
-    { 0, Panel::PATH,   Panel::PATH,   Panel::FOREST, Panel::FOREST },
-    { Panel::TOWN, Panel::FOREST | Panel::EDGE, Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
-    { 0, Panel::GRASS,  Panel::GRASS,  Panel::PATH,   Panel::PATH },
-
-    { 0, Panel::FOREST | Panel::EDGE, Panel::GRASS,  Panel::GRASS, Panel::GRASS },
-    { 0, Panel::FOREST, Panel::FOREST, Panel::GRASS, Panel::GRASS },
-    { 0, Panel::PATH,   Panel::PATH,   Panel::GRASS, Panel::FOREST | Panel::EDGE },
-    { 0, Panel::PATH,   Panel::GRASS,  Panel::GRASS, Panel::PATH },
-    
-    { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::GRASS, Panel::FOREST | Panel::EDGE },
-    { 0, Panel::GRASS, Panel::PATH,   Panel::PATH,  Panel::FOREST | Panel::EDGE },
-    { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS, Panel::PATH },
-    { 0, Panel::GRASS, Panel::GRASS,  Panel::PATH,  Panel::PATH },
-
-    // d
-    { 0, Panel::GRASS,  Panel::PATH,   Panel::GRASS,  Panel::PATH },
-    { Panel::TOWN, Panel::GRASS,  Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
-    { Panel::DEEP_FOREST, Panel::FOREST, Panel::FOREST, Panel::FOREST, Panel::PATH | Panel::EDGE },
-    { 0, Panel::GRASS,  Panel::FOREST, Panel::GRASS,  Panel::FOREST },
-    
-    { Panel::CHURCH, Panel::GRASS,  Panel::GRASS,  Panel::GRASS, Panel::GRASS },
-    { 0, Panel::PATH, Panel::FOREST | Panel::EDGE, Panel::PATH,  Panel::GRASS },
-    { 0, Panel::FOREST, Panel::GRASS,  Panel::GRASS, Panel::FOREST },
-    { Panel::CHURCH, Panel::GRASS,  Panel::GRASS,  Panel::GRASS, Panel::GRASS },
-   
-    { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS,  Panel::PATH },
-    { Panel::TOWN, Panel::PATH | Panel::EDGE,  Panel::PATH | Panel::EDGE,   Panel::GRASS,  Panel::PATH | Panel::EDGE },
-    { Panel::FOREST, Panel::GRASS, Panel::GRASS,  Panel::GRASS,  Panel::PATH | Panel::EDGE },
-    { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::FOREST | Panel::EDGE, Panel::GRASS },
-
-    // d
-    { 0, Panel::GRASS,  Panel::PATH,   Panel::GRASS,  Panel::PATH },
-    { Panel::TOWN, Panel::GRASS,  Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
-    { Panel::DEEP_FOREST, Panel::FOREST, Panel::FOREST, Panel::FOREST, Panel::PATH | Panel::EDGE },
-    { 0, Panel::GRASS,  Panel::FOREST, Panel::GRASS,  Panel::FOREST },
-    
-    { Panel::CHURCH, Panel::GRASS,  Panel::GRASS,  Panel::GRASS, Panel::GRASS },
-    { 0, Panel::PATH, Panel::FOREST | Panel::EDGE, Panel::PATH,  Panel::GRASS },
-    { 0, Panel::FOREST, Panel::GRASS,  Panel::GRASS, Panel::FOREST },
-    { Panel::CHURCH, Panel::GRASS,  Panel::GRASS,  Panel::GRASS, Panel::GRASS },
-
-    { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS,  Panel::PATH },
-    { Panel::TOWN, Panel::PATH | Panel::EDGE,  Panel::PATH | Panel::EDGE,   Panel::GRASS,  Panel::PATH | Panel::EDGE },
-    { Panel::FOREST, Panel::GRASS, Panel::GRASS,  Panel::GRASS,  Panel::PATH | Panel::EDGE },
-    { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::FOREST | Panel::EDGE, Panel::GRASS },
-
-    // f 
-    { 0, Panel::PATH,   Panel::FOREST, Panel::FOREST, Panel::PATH },
-    { Panel::DEEP_FOREST, Panel::FOREST, Panel::GRASS,  Panel::FOREST, Panel::FOREST },
-    { 0, Panel::GRASS,  Panel::GRASS,  Panel::FOREST | Panel::EDGE, Panel::GRASS },
-    { 0, Panel::PATH, Panel::FOREST | Panel::EDGE, Panel::PATH,   Panel::GRASS },
-    
-    { 0, Panel::FOREST, Panel::FOREST, Panel::PATH,   Panel::PATH },
-    { Panel::DEEP_FOREST, Panel::FOREST, Panel::FOREST, Panel::FOREST, Panel::FOREST },
-    { Panel::DEEP_FOREST, Panel::FOREST, Panel::PATH | Panel::EDGE,   Panel::FOREST, Panel::FOREST },
-    { Panel::CASTLE, Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
-
-    { 0, Panel::PATH, Panel::GRASS, Panel::PATH, Panel::GRASS },
-    { 0, Panel::FOREST, Panel::GRASS, Panel::FOREST, Panel::GRASS },
-    { 0, Panel::FOREST | Panel::EDGE, Panel::GRASS, Panel::GRASS, Panel::GRASS },
-    { Panel::START, Panel::PATH, Panel::FOREST | Panel::EDGE, Panel::PATH, Panel::GRASS },
-  };
-
-  return panels;
+  return std::vector<Panel>(std::begin(panel_catalogue), std::end(panel_catalogue));
 }
 
 }
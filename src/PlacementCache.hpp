@@ -0,0 +1,440 @@
+﻿#pragma once
+
+//
+// 待機中のパネルが置けるかどうかを逐次管理する
+//   空き地ごとに周囲の辺(EdgeMatcher::Blank)と、置ける(パネル, 回転)のビット列を覚えておき
+//   パネルごとに「置ける空き地の数」を数えておく
+//   パネルを置いた時は、その位置と隣の空き地だけ更新する
+//
+//   ビット列は パネル番号 * 4 + 回転 の並び
+//   辺ごと・辺の種類ごとに「その辺を持つ(パネル, 回転)」のビット列を用意しておき
+//   空き地の周囲で決まっている辺の分だけANDを取る
+//
+//   置いた時に書き換える前の空き地を覚えておき、置く前の状態へ戻せる
+//
+
+#include "Defines.hpp"
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <cassert>
+#include <glm/glm.hpp>
+#include "Panel.hpp"
+#include "Field.hpp"
+#include "EdgeMatcher.hpp"
+#include "ChunkedGrid.hpp"
+
+
+namespace ngs {
+
+class PlacementCache
+{
+  // 空き地の情報
+  struct Entry
+  {
+    EdgeMatcher::Blank blank;
+    // ビット列の格納位置
+    u_int slot;
+  };
+
+  // パネルを置いた時に変わった内容
+  struct Step
+  {
+    // 置く前のchanges_とsaved_fits_の数
+    u_int changes;
+    u_int saved;
+  };
+
+  // 書き換える前の空き地
+  struct Change
+  {
+    glm::ivec2 pos;
+    // 空き地だった
+    bool existed;
+    Entry entry;
+  };
+
+
+public:
+  PlacementCache(const std::vector<Panel>& panels) noexcept
+    : matcher_(panels),
+      num_(u_int(panels.size())),
+      words_((num_ * 4 + 63) / 64),
+      placeable_(panels.size(), 0),
+      next_(words_)
+  {
+    // TIPS 空き地はパネルの枚数 * 2 + 2 を超えない
+    fits_.reserve((num_ * 2 + 2) * words_);
+    free_slots_.reserve(num_ * 2 + 2);
+    // NOTICE 置いた場所と隣の４箇所を覚える
+    history_.reserve(num_);
+    changes_.reserve(num_ * 5);
+    saved_fits_.reserve(num_ * 5 * words_);
+    // TIPS 空き地は原点から num_ マスの範囲に収まる(Field::reserve と同じ)
+    auto extent = glm::ivec2(int(num_));
+    blanks_.reserve(-extent, extent, num_ * 2 + 2);
+
+    // 辺の種類を集める
+    for (const auto& panel : panels)
+    {
+      for (auto e : panel.getEdge())
+      {
+        u_int value = e & Panel::EDGE_MASK;
+        if (std::find(std::begin(values_), std::end(values_), value) == std::end(values_))
+        {
+          values_.push_back(value);
+        }
+      }
+    }
+
+    // 辺ごと・種類ごとのビット列
+    side_fits_.resize(4 * values_.size() * words_, 0);
+    for (u_int i = 0; i < num_; ++i)
+    {
+      for (u_int r = 0; r < 4; ++r)
+      {
+        auto edge = panels[i].getRotatedEdgeValue(r);
+        u_int bit = i * 4 + r;
+        for (u_int side = 0; side < 4; ++side)
+        {
+          auto* bits = sideFits(side, findValue((edge >> (side * 16)) & Panel::EDGE_MASK));
+          bits[bit / 64] |= uint64_t(1) << (bit % 64);
+        }
+      }
+    }
+  }
+
+  ~PlacementCache() = default;
+
+
+  // パネルを置いた後に呼ぶ
+  // NOTICE fieldは置いた後の状態
+  void addPanel(const glm::ivec2& pos, const Field& field) noexcept
+  {
+    // 時計回りに調べる
+    static const glm::ivec2 offsets[] = {
+      {  0,  1 },
+      {  1,  0 },
+      {  0, -1 },
+      { -1,  0 },
+    };
+
+    history_.push_back({ u_int(changes_.size()), u_int(saved_fits_.size()) });
+
+    // 置いた場所は空き地ではなくなった
+    save(pos);
+    if (blanks_.count(pos))
+    {
+      auto slot = blanks_.at(pos).slot;
+      countFits(slot, -1);
+      free_slots_.push_back(slot);
+      blanks_.erase(pos);
+    }
+
+    // 隣の空き地は周囲の辺が変わる(新しくできた空き地も含む)
+    for (const auto& ofs : offsets)
+    {
+      auto p = pos + ofs;
+      if (!field.isBlank(p)) continue;
+
+      auto blank = EdgeMatcher::getBlank(p, field);
+      save(p);
+      if (blanks_.count(p))
+      {
+        // TIPS 辺が増えるだけなので、置けなくなったパネルだけ数を減らせばよい
+        auto& entry = blanks_.at(p);
+        entry.blank = blank;
+        updateFits(entry.slot, blank);
+      }
+      else
+      {
+        auto slot = allocateSlot();
+        setFits(slot, blank);
+        countFits(slot, 1);
+        blanks_.emplace(p, Entry{ blank, slot });
+      }
+    }
+  }
+
+  // 最後に置いたパネルの分を元に戻す
+  void undo() noexcept
+  {
+    assert(!history_.empty());
+    auto step = history_.back();
+    history_.pop_back();
+
+    // TIPS 覚えた順と逆に戻す
+    //      先に隣の空き地のビット列を手放すので、置いた場所の空き地は元の格納位置を使える
+    while (changes_.size() > step.changes)
+    {
+      restoreBlank(changes_.back());
+      changes_.pop_back();
+    }
+    assert(saved_fits_.size() == step.saved);
+  }
+
+  // 状態の目印(これまでに置いた枚数)
+  size_t snapshot() const noexcept
+  {
+    return history_.size();
+  }
+
+  // 目印の状態まで戻す
+  void restore(size_t snapshot) noexcept
+  {
+    while (history_.size() > snapshot)
+    {
+      undo();
+    }
+  }
+
+  // Fieldから作り直す
+  void rebuild(const Field& field) noexcept
+  {
+    clear();
+    for (const auto& pos : field.getBlankPositions())
+    {
+      auto blank = EdgeMatcher::getBlank(pos, field);
+      auto slot  = allocateSlot();
+      setFits(slot, blank);
+      countFits(slot, 1);
+      blanks_.emplace(pos, Entry{ blank, slot });
+    }
+  }
+
+  void clear() noexcept
+  {
+    blanks_.clear();
+    fits_.clear();
+    free_slots_.clear();
+    history_.clear();
+    changes_.clear();
+    saved_fits_.clear();
+    std::fill(std::begin(placeable_), std::end(placeable_), 0);
+  }
+
+
+  // どこかの空き地に置けるか
+  bool isPlaceable(u_int panel) const noexcept
+  {
+    return placeable_[panel] > 0;
+  }
+
+  // 置ける空き地の数
+  int getPlaceableCount(u_int panel) const noexcept
+  {
+    return placeable_[panel];
+  }
+
+  // 空き地に置ける回転(bit n が回転n)
+  u_int getRotations(const glm::ivec2& pos, u_int panel) const noexcept
+  {
+    if (!blanks_.count(pos)) return 0;
+
+    u_int bit = panel * 4;
+    const auto* bits = &fits_[blanks_.at(pos).slot * words_];
+    return u_int(bits[bit / 64] >> (bit % 64)) & 0xf;
+  }
+
+  const EdgeMatcher& getMatcher() const noexcept
+  {
+    return matcher_;
+  }
+
+
+private:
+  u_int findValue(u_int value) const noexcept
+  {
+    auto it = std::find(std::begin(values_), std::end(values_), value);
+    return u_int(std::distance(std::begin(values_), it));
+  }
+
+  uint64_t* sideFits(u_int side, u_int value_index) noexcept
+  {
+    return &side_fits_[(side * values_.size() + value_index) * words_];
+  }
+
+  u_int allocateSlot() noexcept
+  {
+    if (!free_slots_.empty())
+    {
+      auto slot = free_slots_.back();
+      free_slots_.pop_back();
+      return slot;
+    }
+
+    u_int slot = u_int(fits_.size() / words_);
+    fits_.resize(fits_.size() + words_);
+    return slot;
+  }
+
+  // 周囲の辺から置ける(パネル, 回転)を求める
+  void calcFits(const EdgeMatcher::Blank& blank, uint64_t* bits) const noexcept
+  {
+    std::fill(bits, bits + words_, ~uint64_t(0));
+    for (u_int side = 0; side < 4; ++side)
+    {
+      if (!((blank.mask >> (side * 16)) & Panel::EDGE_MASK)) continue;
+
+      u_int index = findValue((blank.edge >> (side * 16)) & Panel::EDGE_MASK);
+      if (index == values_.size())
+      {
+        // どのパネルにも無い辺
+        std::fill(bits, bits + words_, 0);
+        return;
+      }
+
+      const auto* side_bits = &side_fits_[(side * values_.size() + index) * words_];
+      for (u_int w = 0; w < words_; ++w)
+      {
+        bits[w] &= side_bits[w];
+      }
+    }
+  }
+
+  void setFits(u_int slot, const EdgeMatcher::Blank& blank) noexcept
+  {
+    auto* bits = &fits_[slot * words_];
+    calcFits(blank, bits);
+    // 端数は使わない
+    if ((num_ * 4) % 64) bits[words_ - 1] &= (uint64_t(1) << ((num_ * 4) % 64)) - 1;
+
+    assert(checkFits(slot, blank));
+  }
+
+  // 周囲の辺が増えた
+  void updateFits(u_int slot, const EdgeMatcher::Blank& blank) noexcept
+  {
+    auto* bits = &fits_[slot * words_];
+    auto* next = &next_[0];
+    calcFits(blank, next);
+
+    for (u_int w = 0; w < words_; ++w)
+    {
+      // 置けなくなったパネル
+      uint64_t lost = anyRotation(bits[w]) & ~anyRotation(next[w]);
+      for (u_int n = 0; lost; ++n, lost >>= 4)
+      {
+        if (lost & 1) placeable_[w * 16 + n] -= 1;
+      }
+
+      bits[w] &= next[w];
+    }
+
+    assert(checkFits(slot, blank));
+  }
+
+  // 空き地１つ分を数える(または取り除く)
+  void countFits(u_int slot, int value) noexcept
+  {
+    const auto* bits = &fits_[slot * words_];
+    for (u_int w = 0; w < words_; ++w)
+    {
+      uint64_t any = anyRotation(bits[w]);
+      for (u_int n = 0; any; ++n, any >>= 4)
+      {
+        if (any & 1) placeable_[w * 16 + n] += value;
+      }
+    }
+  }
+
+  // 書き換える前の空き地を覚える
+  void save(const glm::ivec2& pos) noexcept
+  {
+    if (!blanks_.count(pos))
+    {
+      changes_.push_back({ pos, false, Entry{} });
+      return;
+    }
+
+    const auto& entry = blanks_.at(pos);
+    changes_.push_back({ pos, true, entry });
+
+    const auto* bits = &fits_[entry.slot * words_];
+    saved_fits_.insert(std::end(saved_fits_), bits, bits + words_);
+  }
+
+  // 覚えておいた空き地に戻す
+  // NOTICE saved_fits_の末尾がこの空き地のビット列
+  void restoreBlank(const Change& change) noexcept
+  {
+    u_int slot;
+    if (blanks_.count(change.pos))
+    {
+      slot = blanks_.at(change.pos).slot;
+      countFits(slot, -1);
+      if (!change.existed)
+      {
+        // 新しくできた空き地
+        free_slots_.push_back(slot);
+        blanks_.erase(change.pos);
+        return;
+      }
+    }
+    else
+    {
+      if (!change.existed) return;
+      slot = allocateSlot();
+    }
+
+    // ビット列を戻して数え直す
+    auto saved = saved_fits_.size() - words_;
+    std::copy(std::begin(saved_fits_) + saved, std::end(saved_fits_), std::begin(fits_) + slot * words_);
+    saved_fits_.resize(saved);
+    countFits(slot, 1);
+
+    Entry entry{ change.entry.blank, slot };
+    if (blanks_.count(change.pos)) blanks_.at(change.pos) = entry;
+    else                           blanks_.emplace(change.pos, entry);
+  }
+
+  // パネルごと(４bit)に、どれかの回転で置けるなら最下位bitを立てる
+  static uint64_t anyRotation(uint64_t bits) noexcept
+  {
+    return (bits | (bits >> 1) | (bits >> 2) | (bits >> 3)) & 0x1111111111111111ull;
+  }
+
+  // EdgeMatcherと結果が一致するか
+  bool checkFits(u_int slot, const EdgeMatcher::Blank& blank) const noexcept
+  {
+    std::vector<uint8_t> rotations;
+    matcher_.match(blank, rotations);
+    for (u_int i = 0; i < num_; ++i)
+    {
+      u_int bit = i * 4;
+      if (((fits_[slot * words_ + bit / 64] >> (bit % 64)) & 0xf) != rotations[i]) return false;
+    }
+    return true;
+  }
+
+
+  EdgeMatcher matcher_;
+
+  u_int num_;
+  u_int words_;
+
+  // 辺の種類
+  std::vector<u_int> values_;
+  // 辺ごと・種類ごとの(パネル, 回転)のビット列
+  std::vector<uint64_t> side_fits_;
+
+  // 空き地ごとの周囲の辺とビット列の位置
+  ChunkedGrid<Entry> blanks_;
+  std::vector<uint64_t> fits_;
+  std::vector<u_int> free_slots_;
+
+  // パネルごとの置ける空き地の数
+  std::vector<int> placeable_;
+
+  // 置いたパネルごとの変更内容
+  std::vector<Step> history_;
+  std::vector<Change> changes_;
+  // 書き換える前のビット列
+  std::vector<uint64_t> saved_fits_;
+
+  // 作業用
+  std::vector<uint64_t> next_;
+};
+
+}
@@ -0,0 +1,181 @@
+﻿#pragma once
+
+//
+// ゲームの操作記録
+//   乱数の種と、置いたパネル(番号、位置、回転、時間)を順番に記録する
+//   同じ種で同じ操作をすれば同じ得点になるので、後から検証できる
+//
+//   バイナリ形式(リトルエンディアン)
+//     magic      4  "PMLG"
+//     version    1
+//     seed       4
+//     entry数    4
+//     entry     10  × entry数
+//       panel    1
+//       rotation 1
+//       x        2
+//       y        2
+//       time     4  開始からのミリ秒
+//
+
+#include "Defines.hpp"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+
+namespace ngs {
+
+struct PlayLog
+{
+  struct Entry
+  {
+    u_int panel;
+    glm::ivec2 pos;
+    u_int rotation;
+    // 開始からの経過時間(ミリ秒)
+    uint32_t time;
+  };
+
+
+  uint32_t seed = 0;
+  std::vector<Entry> entries;
+
+
+  void clear() noexcept
+  {
+    entries.clear();
+  }
+
+  void add(u_int panel, const glm::ivec2& pos, u_int rotation, double time) noexcept
+  {
+    entries.push_back({ panel, pos, rotation, uint32_t(std::max(time, 0.0) * 1000.0) });
+  }
+
+
+  // バイナリ化
+  std::string serialize() const noexcept
+  {
+    std::string data;
+    data.reserve(HEADER_SIZE + entries.size() * ENTRY_SIZE);
+
+    data.append("PMLG", 4);
+    data.push_back(char(VERSION));
+    writeValue(data, seed, 4);
+    writeValue(data, uint32_t(entries.size()), 4);
+    for (const auto& e : entries)
+    {
+      writeValue(data, e.panel, 1);
+      writeValue(data, e.rotation, 1);
+      writeValue(data, uint16_t(int16_t(e.pos.x)), 2);
+      writeValue(data, uint16_t(int16_t(e.pos.y)), 2);
+      writeValue(data, e.time, 4);
+    }
+
+    return data;
+  }
+
+  // バイナリから復元
+  // 壊れていたらfalse
+  bool deserialize(const std::string& data) noexcept
+  {
+    if (data.size() < HEADER_SIZE) return false;
+    if (data.compare(0, 4, "PMLG") != 0) return false;
+    if (uint8_t(data[4]) != VERSION) return false;
+
+    size_t offset = 5;
+    auto s   = readValue(data, offset, 4);
+    auto num = readValue(data, offset, 4);
+    if ((data.size() - HEADER_SIZE) != size_t(num) * ENTRY_SIZE) return false;
+
+    seed = s;
+    entries.resize(num);
+    for (auto& e : entries)
+    {
+      e.panel    = readValue(data, offset, 1);
+      e.rotation = readValue(data, offset, 1);
+      e.pos.x    = int16_t(readValue(data, offset, 2));
+      e.pos.y    = int16_t(readValue(data, offset, 2));
+      e.time     = readValue(data, offset, 4);
+    }
+
+    return true;
+  }
+
+
+  // テキストに埋め込むための16進文字列
+  std::string toHex() const noexcept
+  {
+    static const char digits[] = "0123456789abcdef";
+
+    auto data = serialize();
+    std::string text;
+    text.reserve(data.size() * 2);
+    for (auto c : data)
+    {
+      text.push_back(digits[(uint8_t(c) >> 4) & 0xf]);
+      text.push_back(digits[uint8_t(c) & 0xf]);
+    }
+
+    return text;
+  }
+
+  bool fromHex(const std::string& text) noexcept
+  {
+    if (text.size() % 2) return false;
+
+    auto digit = [](char c)
+                 {
+                   if (c >= '0' && c <= '9') return c - '0';
+                   if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+                   if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+                   return -1;
+                 };
+
+    std::string data;
+    data.reserve(text.size() / 2);
+    for (size_t i = 0; i < text.size(); i += 2)
+    {
+      int h = digit(text[i]);
+      int l = digit(text[i + 1]);
+      if ((h < 0) || (l < 0)) return false;
+
+      data.push_back(char((h << 4) | l));
+    }
+
+    return deserialize(data);
+  }
+
+
+private:
+  enum
+  {
+    VERSION     = 1,
+    HEADER_SIZE = 4 + 1 + 4 + 4,
+    ENTRY_SIZE  = 1 + 1 + 2 + 2 + 4,
+  };
+
+  static void writeValue(std::string& data, uint32_t value, int bytes) noexcept
+  {
+    for (int i = 0; i < bytes; ++i)
+    {
+      data.push_back(char((value >> (i * 8)) & 0xff));
+    }
+  }
+
+  static uint32_t readValue(const std::string& data, size_t& offset, int bytes) noexcept
+  {
+    uint32_t value = 0;
+    for (int i = 0; i < bytes; ++i)
+    {
+      value |= uint32_t(uint8_t(data[offset + i])) << (i * 8);
+    }
+    offset += bytes;
+
+    return value;
+  }
+};
+
+}
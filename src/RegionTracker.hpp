@@ -0,0 +1,253 @@
+﻿#pragma once
+
+//
+// 森や道のつながりを逐次管理する
+//   パネルの辺ごとに区画を作り、隣接した区画を素集合(Union-Find)で併合する
+//   区画ごとに「開いている辺」の数を持ち、0になったら完成
+//   置いた時に書き換えた区画を覚えておき、置く前の状態へ戻せる
+//   TIPS 元に戻せるよう、経路の圧縮はしない(大きさで併合するので木は低いまま)
+//
+
+#include <vector>
+#include <array>
+#include <cassert>
+#include <glm/glm.hpp>
+#include "Panel.hpp"
+#include "ChunkedGrid.hpp"
+
+
+namespace ngs {
+
+class RegionTracker
+{
+  // パネル４辺の区画番号(-1は対象外)
+  using Sides = std::array<int, 4>;
+
+  // パネルを置いた時に変わった内容
+  struct Step
+  {
+    glm::ivec2 pos;
+    // 置く前の区画の数
+    u_int regions;
+    // 置く前のchanges_の数
+    u_int changes;
+  };
+
+  // 書き換える前の区画
+  struct Change
+  {
+    int region;
+    int parent;
+    int size;
+    int open;
+  };
+
+
+public:
+  RegionTracker(u_int attribute) noexcept
+    : attribute_(attribute)
+  {}
+
+  ~RegionTracker() = default;
+
+
+  // 追加
+  void addPanel(const glm::ivec2& pos, const Panel& panel, u_int rotation) noexcept
+  {
+    // 時計回りに調べる
+    static const glm::ivec2 offsets[] = {
+      {  0,  1 },
+      {  1,  0 },
+      {  0, -1 },
+      { -1,  0 },
+    };
+
+    const auto& edge = panel.getRotatedEdge(rotation);
+
+    history_.push_back({ pos, u_int(parent_.size()), u_int(changes_.size()) });
+
+    // 端のある辺はそれぞれ独立、端の無い辺はパネル内で繋がっている
+    Sides sides{ { -1, -1, -1, -1 } };
+    int shared = -1;
+    for (u_int i = 0; i < 4; ++i)
+    {
+      if (!(edge[i] & attribute_)) continue;
+
+      if (edge[i] & Panel::EDGE)
+      {
+        sides[i] = createRegion();
+      }
+      else
+      {
+        if (shared < 0) shared = createRegion();
+        sides[i] = shared;
+      }
+    }
+
+    for (u_int i = 0; i < 4; ++i)
+    {
+      auto p = pos + offsets[i];
+      if (!cells_.count(p))
+      {
+        // 隣が空いている
+        if (sides[i] >= 0)
+        {
+          // NOTICE 既に前からある区画と併合している事がある
+          int root = find(sides[i]);
+          save(root);
+          open_[root] += 1;
+        }
+        continue;
+      }
+
+      // 隣の辺は塞がった
+      int neighbor = cells_.at(p)[(i + 2) % 4];
+      if (neighbor < 0) continue;
+
+      int root = find(neighbor);
+      save(root);
+      open_[root] -= 1;
+      if (sides[i] >= 0) unite(sides[i], neighbor);
+    }
+
+    cells_.emplace(pos, sides);
+  }
+
+  // 最後に置いたパネルを取り除く
+  void undo() noexcept
+  {
+    assert(!history_.empty());
+    auto step = history_.back();
+    history_.pop_back();
+
+    // 書き換えた区画を逆順に戻す
+    while (changes_.size() > step.changes)
+    {
+      const auto& c = changes_.back();
+      parent_[c.region] = c.parent;
+      size_[c.region]   = c.size;
+      open_[c.region]   = c.open;
+      changes_.pop_back();
+    }
+
+    parent_.resize(step.regions);
+    size_.resize(step.regions);
+    open_.resize(step.regions);
+
+    cells_.erase(step.pos);
+  }
+
+  // 状態の目印(これまでに置いた枚数)
+  size_t snapshot() const noexcept
+  {
+    return history_.size();
+  }
+
+  // 目印の状態まで戻す
+  void restore(size_t snapshot) noexcept
+  {
+    while (history_.size() > snapshot)
+    {
+      undo();
+    }
+  }
+
+  // 指定位置のパネルに完成した区画があるか
+  bool isCompleted(const glm::ivec2& pos) const noexcept
+  {
+    if (!cells_.count(pos)) return false;
+
+    const auto& sides = cells_.at(pos);
+    for (auto region : sides)
+    {
+      if (region < 0) continue;
+      if (open_[find(region)] == 0) return true;
+    }
+    return false;
+  }
+
+  // 置くパネルの枚数分の領域を確保
+  void reserve(size_t num_panels) noexcept
+  {
+    // NOTICE 区画はパネル１枚につき最大４つ
+    parent_.reserve(num_panels * 4);
+    size_.reserve(num_panels * 4);
+    open_.reserve(num_panels * 4);
+    history_.reserve(num_panels);
+    changes_.reserve(num_panels * 4);
+
+    // TIPS 盤面の広さは Field::reserve と同じ
+    auto extent = glm::ivec2(int(num_panels));
+    cells_.reserve(-extent, extent, num_panels);
+  }
+
+  void clear() noexcept
+  {
+    cells_.clear();
+    parent_.clear();
+    size_.clear();
+    open_.clear();
+    history_.clear();
+    changes_.clear();
+  }
+
+
+private:
+  int createRegion() noexcept
+  {
+    int region = int(parent_.size());
+    parent_.push_back(region);
+    size_.push_back(1);
+    open_.push_back(0);
+
+    return region;
+  }
+
+  int find(int region) const noexcept
+  {
+    while (parent_[region] != region)
+    {
+      region = parent_[region];
+    }
+    return region;
+  }
+
+  void unite(int a, int b) noexcept
+  {
+    a = find(a);
+    b = find(b);
+    if (a == b) return;
+
+    // 小さい方を大きい方へ繋ぐ
+    if (size_[a] < size_[b]) std::swap(a, b);
+    save(a);
+    save(b);
+    parent_[b] = a;
+    size_[a]  += size_[b];
+    open_[a]  += open_[b];
+  }
+
+  // 書き換える前の区画を覚える
+  // TIPS 置いた時に作った区画は、戻す時に捨てるので不要
+  void save(int region) noexcept
+  {
+    if (u_int(region) >= history_.back().regions) return;
+    changes_.push_back({ region, parent_[region], size_[region], open_[region] });
+  }
+
+
+  u_int attribute_;
+
+  ChunkedGrid<Sides> cells_;
+
+  std::vector<int> parent_;
+  std::vector<int> size_;
+  // 開いている辺の数
+  std::vector<int> open_;
+
+  // 置いたパネルごとの変更内容
+  std::vector<Step> history_;
+  std::vector<Change> changes_;
+};
+
+}
@@ -9,6 +9,7 @@
 #include "Asset.hpp"
 #include "CountExec.hpp"
 #include "AudioSession.h"
+#include "AssetLoader.hpp"
 
 
 namespace ngs {
@@ -160,7 +161,8 @@ class Sound
 
   // SE向けセットアップ
   Detail setupSe(const std::string& type, const std::string& slot,
-                 ci::audio::Context* ctx, const ci::audio::SourceFileRef& source, const ci::audio::Node::Format& format)
+                 ci::audio::Context* ctx, const ci::audio::SourceFileRef& source, const ci::audio::BufferRef& preloaded,
+                 const ci::audio::Node::Format& format)
   {
     if (!se_nodes_.count(slot))
     {
@@ -172,7 +174,8 @@ class Sound
     }
 
     auto node   = se_nodes_.at(slot);
-    auto buffer = source->loadBuffer();
+    // TIPS 展開済みならそれを使う
+    auto buffer = preloaded ? preloaded : source->loadBuffer();
 
     auto play = [node, buffer]()
                 {
@@ -201,6 +204,14 @@ class Sound
   }
 
 
+  template <typename T>
+  static T findPreload(const std::map<std::string, T>& preloaded, const std::string& path) noexcept
+  {
+    auto it = preloaded.find(path);
+    return (it != preloaded.end()) ? it->second : T();
+  }
+
+
   // Game内サウンドリスト読み込み
   void createEventSound(const ci::JsonTree& params)
   {
@@ -275,7 +286,52 @@ class Sound
 
 
 public:
-  Sound(const ci::JsonTree& params, Event<Arguments>& event) noexcept
+  // 起動時に読み込んでおいたもの(パスごと)
+  // TIPS 無いものはコンストラクタで読み込む
+  struct Preload
+  {
+    size_t sample_rate = 0;
+    std::map<std::string, ci::audio::SourceFileRef> sources;
+    // SEは展開まで済ませておく
+    std::map<std::string, ci::audio::BufferRef> buffers;
+  };
+
+  // 読み込みと展開をワーカーで行う仕事を登録
+  // NOTICE AudioSessionと出力の準備はメインスレッドで行う
+  static std::vector<AssetLoader::JobId> preload(const ci::JsonTree& params, AssetLoader& loader, Preload& preload) noexcept
+  {
+    using namespace std::literals;
+
+    auto setup = loader.addMain("Sound:setup",
+                                [&preload]()
+                                {
+                                  AudioSession::begin();
+                                  preload.sample_rate = ci::audio::Context::master()->getSampleRate();
+                                });
+
+    std::vector<AssetLoader::JobId> jobs{ setup };
+    for (const auto& p : params["sound"s])
+    {
+      const auto& path = p.getValueForKey<std::string>("path"s);
+      if (preload.sources.count(path)) continue;
+
+      bool is_se   = p.getValueForKey<std::string>("type"s) == "se"s;
+      auto& source = preload.sources[path];
+      auto* buffer = is_se ? &preload.buffers[path] : nullptr;
+      jobs.push_back(loader.add(path,
+                                [path, &preload, &source, buffer]()
+                                {
+                                  source = ci::audio::load(Asset::load(path), preload.sample_rate);
+                                  if (buffer) *buffer = source->loadBuffer();
+                                },
+                                { setup }));
+    }
+
+    return jobs;
+  }
+
+
+  Sound(const ci::JsonTree& params, Event<Arguments>& event, const Preload& preload = Preload()) noexcept
     : event_(event)
   {
     using namespace std::literals;
@@ -292,18 +348,18 @@ public:
     // カテゴリ別のNode生成
     const std::map<std::string,
                    std::function<Detail (const std::string&, const std::string&,
-                                         ci::audio::Context*, const ci::audio::SourceFileRef&)>> funcs{
+                                         ci::audio::Context*, const ci::audio::SourceFileRef&, const ci::audio::BufferRef&)>> funcs{
       { "bgm"s,
         [this, format](const std::string& type, const std::string& slot,
-                 ci::audio::Context* ctx, const ci::audio::SourceFileRef& source) noexcept
+                 ci::audio::Context* ctx, const ci::audio::SourceFileRef& source, const ci::audio::BufferRef&) noexcept
         {
           return setupBgm(type, slot, ctx, source, format);
         }},
       { "se"s,
         [this, format](const std::string& type, const std::string& slot,
-                 ci::audio::Context* ctx, const ci::audio::SourceFileRef& source) noexcept
+                 ci::audio::Context* ctx, const ci::audio::SourceFileRef& source, const ci::audio::BufferRef& buffer) noexcept
         {
-          return setupSe(type, slot, ctx, source, format);
+          return setupSe(type, slot, ctx, source, buffer, format);
         }},
     };
 
@@ -311,11 +367,19 @@ public:
     for (const auto& p : pp)
     {
       const auto& path = p.getValueForKey<std::string>("path"s);
-      auto source = ci::audio::load(Asset::load(path), ctx->getSampleRate());
+      // NOTICE 読み込んだ時と出力のサンプリングレートが違ったら使わない
+      ci::audio::SourceFileRef source;
+      ci::audio::BufferRef buffer;
+      if (preload.sample_rate == ctx->getSampleRate())
+      {
+        source = findPreload(preload.sources, path);
+        buffer = findPreload(preload.buffers, path);
+      }
+      if (!source) source = ci::audio::load(Asset::load(path), ctx->getSampleRate());
 
       const auto& type = p.getValueForKey<std::string>("type"s);
       auto slot        = Json::getValue(p, "slot"s, type);
-      auto detail = funcs.at(type)(type, slot, ctx, source);
+      auto detail = funcs.at(type)(type, slot, ctx, source, buffer);
 
       const auto& name = p.getValueForKey<std::string>("name"s);
       details_.insert({ name, detail });
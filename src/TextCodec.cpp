@@ -1,129 +1,379 @@
 ﻿//
 // text encode/decode
-// 
+//
 
 #include "Defines.hpp"
 #include <iostream>
-#include <fstream>
+#include <algorithm>
+#include <climits>
 #include <cassert>
 #include <zlib.h>
+#if !defined (NGS_HEADLESS)
 #include <cinder/app/App.h>
-#include <cinder/DataTarget.h>
+#endif
 #include "TextCodec.hpp"
 
 
 namespace ngs { namespace TextCodec {
 
 enum {
-  OUTBUFSIZ = 1024 * 8,
+  // 出力の空きがこれより少なければ広げる
+  MIN_SPARE = 1024 * 8,
 };
 
 
-// 圧縮
-std::string encode(const std::string& input) noexcept
+// zlibの出力をstringの末尾へ追加する
+// TIPS 確保済みの領域へ直接書き、足りなくなったら倍に広げる
+//      (固定の小さなバッファから何度もinsertしない)
+template <typename F>
+int process(z_stream& z, std::string& output, F func) noexcept
 {
-  z_stream z;
-  z.zalloc = Z_NULL;
-  z.zfree  = Z_NULL;
-  z.opaque = Z_NULL;
-  deflateInit(&z, Z_DEFAULT_COMPRESSION);
+  size_t used = output.size();
+  // NOTICE resizeは0で埋めるので、入力に見合った分だけ広げる
+  size_t spare = std::min(output.capacity() - used, size_t(z.avail_in) * 4 + MIN_SPARE);
+  output.resize(used + std::max(spare, size_t(MIN_SPARE)));
 
-  // SOURCE:http://yak-ex.blogspot.jp/2012/12/c-advent-calendar-2012-8-c-compiler-farm.html
-  z.next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.c_str()));
-  z.avail_in = static_cast<unsigned int>(input.size());
+  int status;
+  while (true)
+  {
+    size_t avail = std::min(output.size() - used, size_t(UINT_MAX));
+    z.next_out  = reinterpret_cast<Bytef*>(&output[used]);
+    z.avail_out = uInt(avail);
 
-  Bytef outbuf[OUTBUFSIZ];
-  z.next_out  = outbuf;
-  z.avail_out = OUTBUFSIZ;
+    status = func();
+    used += avail - z.avail_out;
 
-  std::string output;
-  while (1)
+    // 出力に空きが残った→入力を使い切ったか、完了か、エラー
+    if ((status != Z_OK) || (z.avail_out != 0)) break;
+
+    output.resize(output.size() * 2);
+  }
+  output.resize(used);
+
+  return status;
+}
+
+
+Encoder::Encoder(int level) noexcept
+  : z_(std::make_unique<z_stream>()),
+    level_(level)
+{
+  z_->zalloc = Z_NULL;
+  z_->zfree  = Z_NULL;
+  z_->opaque = Z_NULL;
+  deflateInit(z_.get(), level);
+}
+
+Encoder::~Encoder()
+{
+  deflateEnd(z_.get());
+}
+
+void Encoder::setLevel(int level) noexcept
+{
+  if (level == level_) return;
+
+  // NOTICE 入力の無い状態で変える
+  deflateReset(z_.get());
+  deflateParams(z_.get(), level, Z_DEFAULT_STRATEGY);
+  level_ = level;
+}
+
+void Encoder::encode(const char* data, size_t size, std::string& output) noexcept
+{
+  begin();
+  // TIPS 圧縮後の最大の大きさを先に確保しておけば、広げずに済む
+  output.reserve(output.size() + deflateBound(z_.get(), uLong(size)));
+
+  auto& z = *z_;
+  z.next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data));
+  z.avail_in = uInt(size);
+  assert(size <= UINT_MAX);
+
+  int status = process(z, output,
+                       [&z]()
+                       {
+                         return deflate(&z, Z_FINISH);
+                       });
+  if (status != Z_STREAM_END)
+  {
+    DOUT << "encode error!!" << std::endl;
+  }
+}
+
+void Encoder::begin() noexcept
+{
+  deflateReset(z_.get());
+}
+
+void Encoder::write(const char* data, size_t size, std::string& output) noexcept
+{
+  auto& z = *z_;
+  z.next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data));
+  z.avail_in = uInt(size);
+  assert(size <= UINT_MAX);
+
+  process(z, output,
+          [&z]()
+          {
+            int status = deflate(&z, Z_NO_FLUSH);
+            assert(status != Z_STREAM_ERROR);
+            // NOTICE 入力が空の時はZ_BUF_ERRORが返る
+            return (status == Z_BUF_ERROR) ? Z_OK : status;
+          });
+}
+
+void Encoder::finish(std::string& output) noexcept
+{
+  auto& z = *z_;
+  z.next_in  = Z_NULL;
+  z.avail_in = 0;
+
+  int status = process(z, output,
+                       [&z]()
+                       {
+                         return deflate(&z, Z_FINISH);
+                       });
+  if (status != Z_STREAM_END)
   {
-    int status = deflate(&z, Z_FINISH);
-    assert(status != Z_STREAM_ERROR);
-    
-    if ((z.avail_out == 0) || (status == Z_STREAM_END))
-    {
-      u_int count = OUTBUFSIZ - z.avail_out;
-      output.insert(output.end(), &outbuf[0], &outbuf[count]);
-
-      if (status == Z_STREAM_END) break;
-      
-      z.next_out  = outbuf;
-      z.avail_out = OUTBUFSIZ;
-    }
+    DOUT << "encode error!!" << std::endl;
   }
-  deflateEnd(&z);
+}
+
+
+Decoder::Decoder() noexcept
+  : z_(std::make_unique<z_stream>())
+{
+  z_->zalloc   = Z_NULL;
+  z_->zfree    = Z_NULL;
+  z_->opaque   = Z_NULL;
+  z_->next_in  = Z_NULL;
+  z_->avail_in = 0;
+  inflateInit(z_.get());
+}
+
+Decoder::~Decoder()
+{
+  inflateEnd(z_.get());
+}
+
+bool Decoder::decode(const char* data, size_t size, std::string& output) noexcept
+{
+  begin();
+  // TIPS 大きさは伸長するまで分からないので、テキストの圧縮率から見積もる
+  output.reserve(output.size() + size * 4);
+  if (write(data, size, output) != FINISHED)
+  {
+    DOUT << "decode error!!" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void Decoder::begin() noexcept
+{
+  inflateReset(z_.get());
+  state_ = CONTINUE;
+}
+
+Decoder::State Decoder::write(const char* data, size_t size, std::string& output) noexcept
+{
+  if (state_ != CONTINUE) return state_;
+
+  auto& z = *z_;
+  z.next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data));
+  z.avail_in = uInt(size);
+  assert(size <= UINT_MAX);
+
+  int status = process(z, output,
+                       [&z]()
+                       {
+                         return inflate(&z, Z_NO_FLUSH);
+                       });
+
+  switch (status)
+  {
+  case Z_STREAM_END:
+    state_ = FINISHED;
+    break;
+
+  case Z_OK:
+    break;
+
+  case Z_BUF_ERROR:
+    // NOTICE 入力を使い切った(続きを待つ)。空の入力で呼ばれたら途中で切れている
+    if (size == 0) state_ = FAILED;
+    break;
+
+  default:
+    state_ = FAILED;
+    break;
+  }
+
+  return state_;
+}
+
+
+Writer::Writer(const std::string& path, int level) noexcept
+  : fp_(std::fopen(path.c_str(), "wb")),
+    encoder_(level)
+{
+  buffer_.reserve(CHUNK_SIZE * 2);
+  encoder_.begin();
+}
+
+Writer::~Writer()
+{
+  close();
+}
+
+bool Writer::isOpen() const noexcept
+{
+  return fp_ != nullptr;
+}
+
+void Writer::write(const char* data, size_t size) noexcept
+{
+  if (!fp_) return;
+
+  // TIPS 大きな入力も塊ごとに圧縮して書き出す
+  while (size > 0)
+  {
+    size_t n = std::min(size, size_t(CHUNK_SIZE));
+    encoder_.write(data, n, buffer_);
+    flush(CHUNK_SIZE);
+
+    data += n;
+    size -= n;
+  }
+}
+
+void Writer::write(const std::string& text) noexcept
+{
+  write(text.data(), text.size());
+}
+
+bool Writer::close() noexcept
+{
+  if (!fp_) return false;
+
+  encoder_.finish(buffer_);
+  flush(0);
+  if (std::fclose(fp_) != 0) failed_ = true;
+  fp_ = nullptr;
+
+  return !failed_;
+}
+
+void Writer::flush(size_t threshold) noexcept
+{
+  if (buffer_.size() < std::max(threshold, size_t(1))) return;
+
+  if (std::fwrite(buffer_.data(), 1, buffer_.size(), fp_) != buffer_.size()) failed_ = true;
+  buffer_.clear();
+}
+
+
+Reader::Reader(const std::string& path) noexcept
+  : fp_(std::fopen(path.c_str(), "rb")),
+    buffer_(std::make_unique<char[]>(CHUNK_SIZE))
+{
+  if (!fp_) return;
+
+  if (std::fseek(fp_, 0, SEEK_END) == 0)
+  {
+    auto size = std::ftell(fp_);
+    if (size > 0) file_size_ = size_t(size);
+  }
+  std::fseek(fp_, 0, SEEK_SET);
+
+  decoder_.begin();
+}
+
+Reader::~Reader()
+{
+  if (fp_) std::fclose(fp_);
+}
+
+bool Reader::isOpen() const noexcept
+{
+  return fp_ != nullptr;
+}
+
+size_t Reader::getFileSize() const noexcept
+{
+  return file_size_;
+}
+
+bool Reader::read(std::string& output) noexcept
+{
+  if (!fp_ || (state_ != Decoder::CONTINUE)) return false;
+
+  // NOTICE ファイルの終わり(0バイト)も渡して、途中で切れていないか調べる
+  size_t size = std::fread(buffer_.get(), 1, CHUNK_SIZE, fp_);
+  state_ = decoder_.write(buffer_.get(), size, output);
+
+  return state_ == Decoder::CONTINUE;
+}
+
+bool Reader::isFinished() const noexcept
+{
+  return state_ == Decoder::FINISHED;
+}
+
+
+// 圧縮
+// TIPS z_streamはスレッドごとに使い回す
+std::string encode(const std::string& input, int level) noexcept
+{
+  static thread_local Encoder encoder;
+  encoder.setLevel(level);
+
+  std::string output;
+  encoder.encode(input.data(), input.size(), output);
 
   return output;
 }
 
 // 伸長
+// エラーが起こった場合は空の文字列を返す
 std::string decode(const std::string& input) noexcept
 {
-  z_stream z;
-  z.zalloc = Z_NULL;
-  z.zfree  = Z_NULL;
-  z.opaque = Z_NULL;
-  inflateInit(&z);
-  
-  z.next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.c_str()));
-  z.avail_in = static_cast<unsigned int>(input.size());
-
-  Bytef outbuf[OUTBUFSIZ];
-  z.next_out  = outbuf;
-  z.avail_out = OUTBUFSIZ;
+  static thread_local Decoder decoder;
 
   std::string output;
-  while (1) {
-    int status = inflate(&z, Z_NO_FLUSH);
-    if ((status == Z_STREAM_ERROR) || (status == Z_DATA_ERROR))
-    {
-      // エラーが起こった場合は空の文字列を返す
-      DOUT << "decode error!!" << std::endl;
-      
-      inflateEnd(&z);
-      return std::string();
-    }
-
-    if ((z.avail_out == 0) || (status == Z_STREAM_END))
-    {
-      u_int count = OUTBUFSIZ - z.avail_out;
-      output.insert(output.end(), &outbuf[0], &outbuf[count]);
-
-      if (status == Z_STREAM_END) break;
-
-      z.next_out  = outbuf;
-      z.avail_out = OUTBUFSIZ;
-    }
-  }
-  inflateEnd(&z);
+  if (!decoder.decode(input.data(), input.size(), output)) return std::string();
 
   return output;
 }
 
 
 // 書き出し
-void write(const std::string& path, const std::string& input) noexcept
+void write(const std::string& path, const std::string& input, int level) noexcept
 {
-  auto output = encode(input);
-
-  // Cinderにファイル書き出しが用意されていた
-  auto data_ref = ci::writeFile(path);
-  data_ref->getStream()->write(output);
+  Writer writer(path, level);
+  assert(writer.isOpen());
+  writer.write(input);
+  writer.close();
 }
 
 // 読み込み
+// TIPS ファイルを少しずつ読みながら伸長する
 std::string load(const std::string& path) noexcept
 {
-  std::ifstream fstr(path, std::ios::binary);
-  assert(fstr);
+  Reader reader(path);
+  assert(reader.isOpen());
+
+  std::string output;
+  output.reserve(reader.getFileSize() * 4);
+  while (reader.read(output)) {}
 
-  // SOURCE: http://fa11enprince.hatenablog.com/entry/2014/04/03/233500
-  std::string input((std::istreambuf_iterator<char>(fstr)),
-                    std::istreambuf_iterator<char>());
-    
-  return decode(input);
+  if (!reader.isFinished())
+  {
+    DOUT << "decode error!!" << std::endl;
+    return std::string();
+  }
+  return output;
 }
 
 } }
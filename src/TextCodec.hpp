@@ -2,17 +2,162 @@
 
 //
 // text encode/decode
+//   zlibの圧縮/伸長
+//   Encoder/Decoderは z_stream を使い回す(deflateReset/inflateReset)
+//   Writer/Readerはファイルを少しずつ読み書きしながら圧縮/伸長する
 //
 
 #include <string>
+#include <cstdio>
+#include <memory>
 
 
+struct z_stream_s;
+
 namespace ngs { namespace TextCodec {
 
-std::string encode(const std::string& input) noexcept;
+enum
+{
+  // 圧縮率(zlibと同じ 0:無圧縮 1:速い 〜 9:小さい)
+  DEFAULT_LEVEL = -1,
+  BEST_SPEED    = 1,
+  BEST_SIZE     = 9,
+
+  // ファイルを読み書きする単位
+  CHUNK_SIZE = 1024 * 64,
+};
+
+
+// 圧縮
+// NOTICE スレッドごとに作る
+class Encoder
+{
+public:
+  Encoder(int level = DEFAULT_LEVEL) noexcept;
+  ~Encoder();
+
+  Encoder(const Encoder&) = delete;
+  Encoder& operator=(const Encoder&) = delete;
+
+  void setLevel(int level) noexcept;
+
+  // まとめて圧縮してoutputの末尾へ追加
+  void encode(const char* data, size_t size, std::string& output) noexcept;
+
+  // 少しずつ圧縮
+  //   begin → write × n → finish
+  void begin() noexcept;
+  void write(const char* data, size_t size, std::string& output) noexcept;
+  void finish(std::string& output) noexcept;
+
+
+private:
+  std::unique_ptr<z_stream_s> z_;
+  int level_;
+};
+
+
+// 伸長
+// NOTICE スレッドごとに作る
+class Decoder
+{
+public:
+  enum State
+  {
+    CONTINUE,
+    FINISHED,
+    FAILED,
+  };
+
+
+  Decoder() noexcept;
+  ~Decoder();
+
+  Decoder(const Decoder&) = delete;
+  Decoder& operator=(const Decoder&) = delete;
+
+  // まとめて伸長してoutputの末尾へ追加
+  // 壊れていたり途中で切れていたらfalse
+  bool decode(const char* data, size_t size, std::string& output) noexcept;
+
+  // 少しずつ伸長
+  //   begin → write × n (FINISHEDかFAILEDが返るまで)
+  // TIPS 圧縮データの後ろの余計なデータは無視する
+  void begin() noexcept;
+  State write(const char* data, size_t size, std::string& output) noexcept;
+
+
+private:
+  std::unique_ptr<z_stream_s> z_;
+  State state_ = CONTINUE;
+};
+
+
+// 圧縮しながらファイルへ書き出す
+class Writer
+{
+public:
+  Writer(const std::string& path, int level = DEFAULT_LEVEL) noexcept;
+  ~Writer();
+
+  Writer(const Writer&) = delete;
+  Writer& operator=(const Writer&) = delete;
+
+  bool isOpen() const noexcept;
+
+  void write(const char* data, size_t size) noexcept;
+  void write(const std::string& text) noexcept;
+
+  // 残りを書き出して閉じる
+  // 書き出せなかったらfalse
+  bool close() noexcept;
+
+
+private:
+  void flush(size_t threshold) noexcept;
+
+  std::FILE* fp_;
+  Encoder encoder_;
+  std::string buffer_;
+  bool failed_ = false;
+};
+
+
+// ファイルを少しずつ読みながら伸長する
+class Reader
+{
+public:
+  Reader(const std::string& path) noexcept;
+  ~Reader();
+
+  Reader(const Reader&) = delete;
+  Reader& operator=(const Reader&) = delete;
+
+  bool isOpen() const noexcept;
+  // 圧縮されたデータの大きさ
+  size_t getFileSize() const noexcept;
+
+  // 次の塊を伸長してoutputの末尾へ追加
+  // 最後まで読んだか、壊れていたらfalse
+  bool read(std::string& output) noexcept;
+
+  // 最後まで正しく伸長できた
+  bool isFinished() const noexcept;
+
+
+private:
+  std::FILE* fp_;
+  size_t file_size_ = 0;
+  Decoder decoder_;
+  Decoder::State state_ = Decoder::CONTINUE;
+  std::unique_ptr<char[]> buffer_;
+};
+
+
+std::string encode(const std::string& input, int level = DEFAULT_LEVEL) noexcept;
 std::string decode(const std::string& input) noexcept;
 
-void write(const std::string& path, const std::string& input) noexcept;
+void write(const std::string& path, const std::string& input, int level = DEFAULT_LEVEL) noexcept;
 std::string load(const std::string& path) noexcept;
 
 } }
@@ -0,0 +1,179 @@
+﻿#pragma once
+
+//
+// ワークスティーリング方式のスレッドプール
+//   スレッドごとに仕事のキューを持ち、自分のキューが空なら他から盗む
+//   仕事にはスレッドの通し番号が渡される(スレッドごとの状態を持つ時に使う)
+//
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+
+namespace ngs {
+
+class ThreadPool
+{
+public:
+  using Job = std::function<void (unsigned int worker)>;
+
+
+  ThreadPool(unsigned int num = std::thread::hardware_concurrency()) noexcept
+  {
+    if (num == 0) num = 1;
+
+    for (unsigned int i = 0; i < num; ++i)
+    {
+      queues_.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned int i = 0; i < num; ++i)
+    {
+      threads_.emplace_back(&ThreadPool::run, this, i);
+    }
+  }
+
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+
+    for (auto& t : threads_)
+    {
+      t.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+
+  // NOTICE ワーカーからも呼ばれる。threads_ はコンストラクタで作っている途中の事がある
+  unsigned int size() const noexcept
+  {
+    return static_cast<unsigned int>(queues_.size());
+  }
+
+  // 仕事を追加
+  // TIPS ワーカーの中から呼ぶと自分のキューへ積む
+  void push(const Job& job) noexcept
+  {
+    const auto& current = currentWorker();
+    unsigned int index = (current.pool == this) ? current.index
+                                                : (next_queue_++ % size());
+    // NOTICE 先に数えておかないと、取り出された時に数が合わなくなる
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++pending_;
+      ++queued_;
+    }
+    {
+      auto& queue = *queues_[index];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.jobs.push_back(job);
+    }
+    wake_.notify_one();
+  }
+
+  // 全ての仕事が終わるまで待つ
+  // NOTICE ワーカーの中から呼んではいけない
+  void wait() noexcept
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return pending_ == 0; });
+  }
+
+
+private:
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+
+  // 実行中のスレッドがどのプールの何番目か
+  struct Worker
+  {
+    const ThreadPool* pool = nullptr;
+    unsigned int index = 0;
+  };
+
+  static Worker& currentWorker() noexcept
+  {
+    static thread_local Worker worker;
+    return worker;
+  }
+
+
+  // 自分のキューの末尾から取り出す。なければ他のキューの先頭から盗む
+  bool takeJob(unsigned int index, Job& job) noexcept
+  {
+    for (unsigned int i = 0; i < size(); ++i)
+    {
+      auto& queue = *queues_[(index + i) % size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.jobs.empty()) continue;
+
+      if (i == 0)
+      {
+        job = std::move(queue.jobs.back());
+        queue.jobs.pop_back();
+      }
+      else
+      {
+        job = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+      }
+      --queued_;
+      return true;
+    }
+
+    return false;
+  }
+
+  void run(unsigned int index) noexcept
+  {
+    currentWorker() = { this, index };
+
+    while (true)
+    {
+      Job job;
+      if (takeJob(index, job))
+      {
+        job(index);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0) done_.notify_all();
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [this]() { return stop_ || (queued_ > 0); });
+      if (stop_) break;
+    }
+  }
+
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  // 終わっていない仕事の数と、キューに積まれている仕事の数
+  size_t pending_ = 0;
+  std::atomic<size_t> queued_{ 0 };
+  bool stop_ = false;
+
+  std::atomic<unsigned int> next_queue_{ 0 };
+};
+
+}
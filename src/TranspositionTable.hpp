@@ -0,0 +1,94 @@
+﻿#pragma once
+
+//
+// 探索済みの盤面を覚えておく表(置換表)
+//   盤面のハッシュ値から引いて、64bitの値を１つ覚える
+//   大きさは固定で、同じ場所に入る盤面は上書きする
+//
+//   TIPS 複数のスレッドから同時に読み書きできる(ロックは使わない)
+//        キーは「キー XOR 値」で持ち、読んだ時に値とXORして元のキーに戻るか確かめる
+//        書き込み途中の中途半端な組み合わせは元に戻らないので、見つからなかった扱いになる
+//
+
+#include "Defines.hpp"
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+
+namespace ngs {
+
+class TranspositionTable
+{
+  struct Entry
+  {
+    std::atomic<uint64_t> check;
+    std::atomic<uint64_t> value;
+  };
+
+
+public:
+  // 2のbits乗個の場所を用意
+  TranspositionTable(u_int bits) noexcept
+    : mask_((size_t(1) << bits) - 1),
+      entries_(new Entry[size_t(1) << bits])
+  {
+    clear();
+  }
+
+  ~TranspositionTable() = default;
+
+  TranspositionTable(const TranspositionTable&) = delete;
+  TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+
+  // 見つかったらvalueに書き込んでtrue
+  bool probe(uint64_t key, uint64_t& value) const noexcept
+  {
+    const auto& entry = entries_[index(key)];
+    uint64_t check = entry.check.load(std::memory_order_relaxed);
+    uint64_t v     = entry.value.load(std::memory_order_relaxed);
+    if ((check ^ v) != key) return false;
+
+    value = v;
+    return true;
+  }
+
+  // NOTICE 同じ場所にあった盤面は上書きされる
+  void store(uint64_t key, uint64_t value) noexcept
+  {
+    auto& entry = entries_[index(key)];
+    entry.check.store(key ^ value, std::memory_order_relaxed);
+    entry.value.store(value, std::memory_order_relaxed);
+  }
+
+  void clear() noexcept
+  {
+    // TIPS 何も置いていない盤面(ハッシュ値0)と間違えないよう、キー1として埋める
+    //      ハッシュ値がちょうど1になる盤面はまず無い
+    for (size_t i = 0; i <= mask_; ++i)
+    {
+      entries_[i].check.store(1, std::memory_order_relaxed);
+      entries_[i].value.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  size_t size() const noexcept
+  {
+    return mask_ + 1;
+  }
+
+
+private:
+  size_t index(uint64_t key) const noexcept
+  {
+    // TIPS 上位bitも混ぜて使う
+    return size_t((key >> 32) ^ key) & mask_;
+  }
+
+
+  size_t mask_;
+  std::unique_ptr<Entry[]> entries_;
+};
+
+}
@@ -0,0 +1,101 @@
+﻿#pragma once
+
+//
+// 同じ頂点(位置・色・法線が全て一致)をまとめる
+//   頂点の値からハッシュ値を作り、オープンアドレス法の表で探すので頂点数に比例した時間で済む
+//   まとめた後の番号は最初に出てきた順で、総当たりで比べた場合と同じ結果になる
+//
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+
+namespace ngs {
+
+namespace VertexWeld {
+
+// floatの値のハッシュ値
+// NOTICE == で比べて等しい値は同じハッシュ値にする(-0.0と0.0)
+uint64_t hashFloats(const float* values, size_t num) noexcept
+{
+  uint64_t hash = 0x9e3779b97f4a7c15ull;
+  for (size_t i = 0; i < num; ++i)
+  {
+    float v = (values[i] == 0.0f) ? 0.0f : values[i];
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+
+    hash = (hash ^ bits) * 0xff51afd7ed558ccdull;
+    hash ^= hash >> 32;
+  }
+  return hash;
+}
+
+}
+
+
+// 同じ頂点をまとめる
+//   remap:  元の番号 → まとめた後の番号
+//   unique: まとめた後の頂点の元の番号(最初に出てきた頂点)
+//   戻り値: まとめた後の頂点数
+// TIPS P/C/N はfloat 3つの型(glm::vec3、ci::Color など)
+// NOTICE NaNを含む頂点はどれとも一致しない(総当たりで == を使った場合と同じ)
+template <typename P, typename C, typename N>
+uint32_t weldVertices(const P* positions, const C* colors, const N* normals, uint32_t num,
+                      std::vector<uint32_t>& remap, std::vector<uint32_t>& unique) noexcept
+{
+  static_assert((sizeof(P) == sizeof(float) * 3)
+                && (sizeof(C) == sizeof(float) * 3)
+                && (sizeof(N) == sizeof(float) * 3), "Each vertex element must be 3 floats.");
+
+  remap.resize(num);
+  unique.clear();
+
+  // 表の大きさは頂点数の2倍以上の2のべき乗
+  // 空きは0、それ以外は unique の番号 + 1
+  size_t table_size = 16;
+  while (table_size < size_t(num) * 2) table_size *= 2;
+  std::vector<uint32_t> table(table_size, 0);
+  const size_t mask = table_size - 1;
+
+  for (uint32_t i = 0; i < num; ++i)
+  {
+    const auto& p = positions[i];
+    const auto& c = colors[i];
+    const auto& n = normals[i];
+
+    float key[9];
+    std::memcpy(&key[0], &p, sizeof(float) * 3);
+    std::memcpy(&key[3], &c, sizeof(float) * 3);
+    std::memcpy(&key[6], &n, sizeof(float) * 3);
+    size_t slot = size_t(VertexWeld::hashFloats(key, 9)) & mask;
+
+    while (true)
+    {
+      uint32_t entry = table[slot];
+      if (entry == 0)
+      {
+        // 見つからなかった
+        table[slot] = uint32_t(unique.size()) + 1;
+        remap[i] = uint32_t(unique.size());
+        unique.push_back(i);
+        break;
+      }
+
+      uint32_t j = unique[entry - 1];
+      if ((positions[j] == p) && (colors[j] == c) && (normals[j] == n))
+      {
+        // 同じ頂点が見つかった
+        remap[i] = entry - 1;
+        break;
+      }
+
+      slot = (slot + 1) & mask;
+    }
+  }
+
+  return uint32_t(unique.size());
+}
+
+}
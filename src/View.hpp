@@ -6,6 +6,7 @@
 
 #include <boost/noncopyable.hpp>
 #include <deque>
+#include <map>
 #include <cinder/TriMesh.h>
 #include <cinder/gl/Vbo.h>
 #include <cinder/gl/Batch.h>
@@ -18,6 +19,7 @@
 #include "Shader.hpp"
 #include "Utility.hpp"
 #include "EaseFunc.hpp"
+#include "AssetLoader.hpp"
 
 
 namespace ngs {
@@ -87,15 +89,70 @@ public:
   };
 
 
+  // 起動時に読み込んでおいたもの(パスごと)
+  // TIPS 無いものはコンストラクタで読み込む
+  struct Preload
+  {
+    std::map<std::string, ci::TriMesh> meshes;
+    std::map<std::string, ci::Surface8u> images;
+  };
+
+
+  // ファイルの読み込みと解析をワーカーで行う仕事を登録
+  // GPUへの転送はコンストラクタ(メインスレッド)で行う
+  // NOTICE 格納先は先に用意しておき、仕事ごとに別の要素へ書き込む
+  static std::vector<AssetLoader::JobId> preload(const ci::JsonTree& params, AssetLoader& loader, Preload& preload) noexcept
+  {
+    std::vector<AssetLoader::JobId> jobs;
+
+    auto add_ply = [&](const std::string& path)
+                   {
+                     if (preload.meshes.count(path)) return;
+
+                     auto& mesh = preload.meshes[path];
+                     jobs.push_back(loader.add(path, [path, &mesh]() { mesh = PLY::load(path); }));
+                   };
+    auto add_obj = [&](const std::string& path, bool has_normal)
+                   {
+                     if (preload.meshes.count(path)) return;
+
+                     auto& mesh = preload.meshes[path];
+                     jobs.push_back(loader.add(path, [path, has_normal, &mesh]() { mesh = loadObj(path, has_normal); }));
+                   };
+    auto add_image = [&](const std::string& path)
+                     {
+                       if (preload.images.count(path)) return;
+
+                       auto& image = preload.images[path];
+                       jobs.push_back(loader.add(path, [path, &image]() { image = ci::Surface8u(ci::loadImage(Asset::load(path))); }));
+                     };
+
+    add_ply(params.getValueForKey<std::string>("selected_model"));
+    add_ply(params.getValueForKey<std::string>("cursor_model"));
+    add_ply(params.getValueForKey<std::string>("blank_model"));
+    add_obj(params.getValueForKey<std::string>("blank_shadow_model"), false);
+    add_obj(params.getValueForKey<std::string>("bg.model"), true);
+    add_obj(params.getValueForKey<std::string>("effect.model"), true);
+    for (const auto& cloud : params["cloud_models"])
+    {
+      add_obj(cloud.getValue<std::string>(), false);
+    }
+    add_image(params.getValueForKey<std::string>("bg.texture"));
+    add_image(params.getValueForKey<std::string>("cloud_texture"));
+
+    return jobs;
+  }
+
+
 public:
-  View(const ci::JsonTree& params) noexcept
+  View(const ci::JsonTree& params, const Preload& preload = Preload()) noexcept
     : polygon_offset_(Json::getVec<glm::vec2>(params["polygon_offset"])),
       panel_height_(params.getValueForKey<float>("panel_height")),
       blank_effect_speed_(params.getValueForKey<double>("blank_effect_speed")),
       blank_effect_(Json::getVec<glm::vec2>(params["blank_effect"])),
       blank_diffuse_(Json::getVec<glm::vec2>(params["blank_diffuse"])),
       bg_scale_(Json::getVec<glm::vec3>(params["bg.scale"])),
-      bg_texture_(ci::gl::Texture2d::create(ci::loadImage(Asset::load(params.getValueForKey<std::string>("bg.texture"))))),
+      bg_texture_(ci::gl::Texture2d::create(getImage(preload, params.getValueForKey<std::string>("bg.texture")))),
       effect_y_ofs_(Json::getVec<glm::vec2>(params["effect.y_ofs"])),
       effect_y_move_(Json::getVec<glm::vec2>(params["effect.y_move"])),
       effect_duration_(Json::getVec<glm::vec2>(params["effect.duration"])),
@@ -150,8 +207,8 @@ public:
     panel_aabb_ = ci::AxisAlignedBox(glm::vec3(-PANEL_SIZE / 2, 0, -PANEL_SIZE / 2),
                                      glm::vec3( PANEL_SIZE / 2, 2,  PANEL_SIZE / 2));
 
-    selected_model = ci::gl::VboMesh::create(PLY::load(params.getValueForKey<std::string>("selected_model")));
-    cursor_model   = ci::gl::VboMesh::create(PLY::load(params.getValueForKey<std::string>("cursor_model")));
+    selected_model = ci::gl::VboMesh::create(getPly(preload, params.getValueForKey<std::string>("selected_model")));
+    cursor_model   = ci::gl::VboMesh::create(getPly(preload, params.getValueForKey<std::string>("cursor_model")));
 
     {
       auto size = Json::getVec<glm::ivec2>(params["shadow_map"]);
@@ -175,7 +232,7 @@ public:
       blank_shader_->uniform("uShininess", params.getValueForKey<float>("field.shininess"));
       blank_shader_->uniform("uAmbient", params.getValueForKey<float>("field.ambient"));
 
-      auto model = ci::gl::VboMesh::create(PLY::load(params.getValueForKey<std::string>("blank_model")));
+      auto model = ci::gl::VboMesh::create(getPly(preload, params.getValueForKey<std::string>("blank_model")));
 
       {
         std::vector<glm::mat4> matrix(72 * 2 + 2);
@@ -202,7 +259,7 @@ public:
     }
     {
       // 処理負荷軽減のため専用モデルを用意
-      auto model = createVboMesh(params.getValueForKey<std::string>("blank_shadow_model"), false);
+      auto model = ci::gl::VboMesh::create(getObj(preload, params.getValueForKey<std::string>("blank_shadow_model"), false));
 
       ci::geom::BufferLayout layout;
       layout.append(ci::geom::Attrib::CUSTOM_0, 16, sizeof(glm::mat4), 0, 1 /* per instance */);
@@ -219,7 +276,7 @@ public:
       // BG
       auto name = params.getValueForKey<std::string>("bg.shader");
       bg_shader_ = createShader(name, name);
-      bg_model = ci::gl::Batch::create(createVboMesh(params.getValueForKey<std::string>("bg.model"), true), bg_shader_);
+      bg_model = ci::gl::Batch::create(ci::gl::VboMesh::create(getObj(preload, params.getValueForKey<std::string>("bg.model"), true)), bg_shader_);
       
       float checker_size = bg_scale_.x / (PANEL_SIZE / 2);
       bg_shader_->uniform("u_checker_size", checker_size);
@@ -261,7 +318,7 @@ public:
       {
         const auto& p = cloud.getValue<std::string>();
 
-        auto tri_mesh = loadObj(p, false);
+        const auto& tri_mesh = getObj(preload, p, false);
         cloud_models_.push_back(ci::gl::VboMesh::create(tri_mesh));
         auto bc = calcBoundingCircle(tri_mesh);
         bc.first  *= cloud_scale_.x;
@@ -279,7 +336,7 @@ public:
       cloud_shader_->uniform("uColor", cloud_color_);
       cloud_shader_->uniform("uThreshold", params.getValueForKey<float>("cloud_threshold"));
     }
-    cloud_texture_ = ci::gl::Texture2d::create(ci::loadImage(Asset::load(params.getValueForKey<std::string>("cloud_texture"))));
+    cloud_texture_ = ci::gl::Texture2d::create(getImage(preload, params.getValueForKey<std::string>("cloud_texture")));
 
     // エフェクト
     {
@@ -290,7 +347,7 @@ public:
       // effect_shader_->uniform("uShininess", params.getValueForKey<float>("field.shininess"));
       effect_shader_->uniform("uAmbient", params.getValueForKey<float>("effect.ambient"));
 
-      auto model = createVboMesh(params.getValueForKey<std::string>("effect.model"), true);
+      auto model = ci::gl::VboMesh::create(getObj(preload, params.getValueForKey<std::string>("effect.model"), true));
 
       {
         std::vector<glm::mat4> matrix(EFFECT_MAX_NUM);
@@ -959,24 +1016,25 @@ public:
 
 private:
   // 読まれてないパネルを読み込む
-  const ci::gl::BatchRef& getPanelModel(int number) noexcept
+  // NOTICE 読めなかったら nullptr (描画しない)
+  const BakedModelPtr& getPanelModel(int number) noexcept
   {
     if (!panel_models[number])
     {
       const auto& path = panel_path[number];
-      if (!panel_model_cache_.count(path))
+      auto it = panel_model_cache_.find(path);
+      if (it == std::end(panel_model_cache_))
       {
-        auto tri_mesh = Model::load(path);
-
-        // panel_aabb[number] = tri_mesh.calcBoundingBox();
-        auto mesh = ci::gl::Batch::create(tri_mesh, field_shader_);
-        panel_models[number] = mesh;
-        panel_model_cache_.insert({ path, mesh });
+        // TIPS 焼き込み済みのメッシュをそのままVBOへ転送する
+        //      読めなかった事も覚えておく(毎フレーム読み直さない)
+        auto model = Model::loadBaked(path);
+        panel_models[number] = model;
+        panel_model_cache_.insert({ path, model });
       }
-      else
+      else if (it->second)
       {
         DOUT << "Use cache: " << path << std::endl;
-        panel_models[number] = panel_model_cache_.at(path);
+        panel_models[number] = it->second;
       }
     }
 
@@ -1003,10 +1061,30 @@ private:
     return mesh;
   }
 
-  // OBJ形式からVboMeshを生成
-  static ci::gl::VboMeshRef createVboMesh(const std::string& path, bool has_normal)
+  // 起動時に読み込んでおいたものを取り出す
+  // TIPS 読み込めていなければここで読み込む
+  static ci::TriMesh getPly(const Preload& preload, const std::string& path)
   {
-    return ci::gl::VboMesh::create(loadObj(path, has_normal));
+    auto it = preload.meshes.find(path);
+    if ((it != preload.meshes.end()) && it->second.getNumIndices()) return it->second;
+
+    return PLY::load(path);
+  }
+
+  static ci::TriMesh getObj(const Preload& preload, const std::string& path, bool has_normal)
+  {
+    auto it = preload.meshes.find(path);
+    if ((it != preload.meshes.end()) && it->second.getNumIndices()) return it->second;
+
+    return loadObj(path, has_normal);
+  }
+
+  static ci::Surface8u getImage(const Preload& preload, const std::string& path)
+  {
+    auto it = preload.images.find(path);
+    if ((it != preload.images.end()) && it->second.getData()) return it->second;
+
+    return ci::Surface8u(ci::loadImage(Asset::load(path)));
   }
 
   // TriMeshの外接円をなんとなく求める
@@ -1206,7 +1284,7 @@ private:
     ci::gl::setModelMatrix(mtx);
 
     const auto& model = getPanelModel(number);
-    model->draw();
+    if (model) model->draw();
   }
 
   // Fieldのパネルを全て表示
@@ -1221,7 +1299,7 @@ private:
       shadow_shader_->uniform("uTopY", p.top_y);
 
       const auto& model = getPanelModel(p.index);
-      ci::gl::draw(model->getVboMesh());
+      if (model) model->draw();
     }
   }
 
@@ -1237,7 +1315,7 @@ private:
       field_shader_->uniform("uTopY", p.top_y);
 
       const auto& model = getPanelModel(p.index);
-      model->draw();
+      if (model) model->draw();
     }
   }
   
@@ -1446,9 +1524,9 @@ private:
 
   // パネル
   std::vector<std::string> panel_path;
-  std::vector<ci::gl::BatchRef> panel_models;
+  std::vector<BakedModelPtr> panel_models;
   // NOTE 同じパスのモデルデータのキャッシュ
-  std::map<std::string, ci::gl::BatchRef> panel_model_cache_;
+  std::map<std::string, BakedModelPtr> panel_model_cache_;
 
   // AABBは全パネル共通
   ci::AxisAlignedBox panel_aabb_;
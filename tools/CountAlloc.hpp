@@ -0,0 +1,96 @@
+﻿#pragma once
+
+//
+// ツール共通: operator new/delete を置き換えて割り当て回数を数える
+//   new/delete の全ての形(配列・サイズ付き・nothrow・アラインメント指定)を置き換え、
+//   確保と解放の組み合わせを揃える
+//   NOTICE 置き換えはプログラムに１つだけ。ツールのcppから１回だけincludeする
+//
+
+#include <new>
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+#include <cstddef>
+
+
+// 割り当て回数
+static std::atomic<size_t> allocations{ 0 };
+
+// TIPS 呼び出し側へ展開されると、GCCが確保と解放の組み合わせを誤って警告する
+//      (-Wmismatched-new-delete)
+#if defined (_MSC_VER)
+#define NGS_ALLOC_NOINLINE __declspec(noinline)
+#else
+#define NGS_ALLOC_NOINLINE __attribute__((noinline))
+#endif
+
+
+void* countedAlloc(std::size_t size) noexcept
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(size ? size : 1);
+}
+
+void* countedAllocOrThrow(std::size_t size)
+{
+  if (void* p = countedAlloc(size)) return p;
+  throw std::bad_alloc();
+}
+
+NGS_ALLOC_NOINLINE void* operator new(std::size_t size)                                 { return countedAllocOrThrow(size); }
+NGS_ALLOC_NOINLINE void* operator new[](std::size_t size)                               { return countedAllocOrThrow(size); }
+NGS_ALLOC_NOINLINE void* operator new(std::size_t size, const std::nothrow_t&) noexcept   { return countedAlloc(size); }
+NGS_ALLOC_NOINLINE void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+
+NGS_ALLOC_NOINLINE void operator delete(void* p) noexcept                          { std::free(p); }
+NGS_ALLOC_NOINLINE void operator delete[](void* p) noexcept                        { std::free(p); }
+NGS_ALLOC_NOINLINE void operator delete(void* p, std::size_t) noexcept             { std::free(p); }
+NGS_ALLOC_NOINLINE void operator delete[](void* p, std::size_t) noexcept           { std::free(p); }
+NGS_ALLOC_NOINLINE void operator delete(void* p, const std::nothrow_t&) noexcept   { std::free(p); }
+NGS_ALLOC_NOINLINE void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+
+// アラインメント指定(C++17)
+#if defined (__cpp_aligned_new)
+
+void* countedAlignedAlloc(std::size_t size, std::align_val_t alignment) noexcept
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  auto align = std::max(std::size_t(alignment), sizeof(void*));
+#if defined (_MSC_VER)
+  return _aligned_malloc(size ? size : 1, align);
+#else
+  void* p = nullptr;
+  return (posix_memalign(&p, align, size ? size : 1) == 0) ? p : nullptr;
+#endif
+}
+
+void* countedAlignedAllocOrThrow(std::size_t size, std::align_val_t alignment)
+{
+  if (void* p = countedAlignedAlloc(size, alignment)) return p;
+  throw std::bad_alloc();
+}
+
+void countedAlignedFree(void* p) noexcept
+{
+#if defined (_MSC_VER)
+  _aligned_free(p);
+#else
+  std::free(p);
+#endif
+}
+
+NGS_ALLOC_NOINLINE void* operator new(std::size_t size, std::align_val_t a)                                 { return countedAlignedAllocOrThrow(size, a); }
+NGS_ALLOC_NOINLINE void* operator new[](std::size_t size, std::align_val_t a)                               { return countedAlignedAllocOrThrow(size, a); }
+NGS_ALLOC_NOINLINE void* operator new(std::size_t size, std::align_val_t a, const std::nothrow_t&) noexcept   { return countedAlignedAlloc(size, a); }
+NGS_ALLOC_NOINLINE void* operator new[](std::size_t size, std::align_val_t a, const std::nothrow_t&) noexcept { return countedAlignedAlloc(size, a); }
+
+NGS_ALLOC_NOINLINE void operator delete(void* p, std::align_val_t) noexcept                          { countedAlignedFree(p); }
+NGS_ALLOC_NOINLINE void operator delete[](void* p, std::align_val_t) noexcept                        { countedAlignedFree(p); }
+NGS_ALLOC_NOINLINE void operator delete(void* p, std::size_t, std::align_val_t) noexcept             { countedAlignedFree(p); }
+NGS_ALLOC_NOINLINE void operator delete[](void* p, std::size_t, std::align_val_t) noexcept           { countedAlignedFree(p); }
+NGS_ALLOC_NOINLINE void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept   { countedAlignedFree(p); }
+NGS_ALLOC_NOINLINE void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { countedAlignedFree(p); }
+
+#endif
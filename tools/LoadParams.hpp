@@ -0,0 +1,70 @@
+﻿#pragma once
+
+//
+// ツール共通: params.json から得点計算のパラメーターを読む
+//   アプリ本体はCinderのJsonTreeで読むが、ツールはBoostで読む
+//
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include "GameCore.hpp"
+
+
+// params.json の "game" から得点計算のパラメーターを読む
+// TIPS 読めない時は理由を表示してfalseを返す(各ツールはNGで終える)
+// NOTICE 既定のパスはカレントからの相対なので、ビルドディレクトリから実行すると開けない
+bool loadScoreParams(const std::string& path, ngs::ScoreParams& params)
+{
+  std::ifstream fstr(path);
+  if (!fstr)
+  {
+    std::cout << "File open error:" << path << std::endl;
+    std::cout << "  -f で params.json を指定する" << std::endl;
+    return false;
+  }
+
+  try
+  {
+    boost::property_tree::ptree json;
+    boost::property_tree::read_json(fstr, json);
+    const auto& game = json.get_child("game");
+
+    auto getArray = [&game](const std::string& key, size_t size)
+                    {
+                      std::vector<float> values;
+                      for (const auto& v : game.get_child(key))
+                      {
+                        values.push_back(v.second.get_value<float>());
+                      }
+                      // NOTICE 足りないと得点計算で範囲外を読む
+                      if (values.size() < size)
+                      {
+                        throw boost::property_tree::ptree_error(key + ": needs " + std::to_string(size) + " values");
+                      }
+                      return values;
+                    };
+
+    auto panel_rate   = getArray("panel_rate", 2);
+    auto ranking_rate = getArray("ranking_rate", 3);
+    params.panel_rate         = glm::vec2(panel_rate[0], panel_rate[1]);
+    params.score_rates        = getArray("score_rates", 5);
+    params.perfect_score_rate = game.get<float>("perfect_score_rate");
+    params.ranking_rate       = glm::vec3(ranking_rate[0], ranking_rate[1], ranking_rate[2]);
+  }
+  catch (const boost::property_tree::file_parser_error& e)
+  {
+    std::cout << "Parse error: " << path << "(" << e.line() << ") " << e.message() << std::endl;
+    return false;
+  }
+  catch (const boost::property_tree::ptree_error& e)
+  {
+    std::cout << "Parse error: " << path << " " << e.what() << std::endl;
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,17 @@
+﻿#pragma once
+
+//
+// ツール共通: 処理にかかった時間を測る
+//
+
+#include <chrono>
+
+
+// funcの実行にかかった時間(秒)
+template <typename F>
+double measure(F func)
+{
+  auto start = std::chrono::steady_clock::now();
+  func();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
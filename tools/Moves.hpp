@@ -0,0 +1,39 @@
+﻿#pragma once
+
+//
+// ツール共通: 手持ちのパネルの置き方
+//   simulate と solve で使う
+//
+
+#include <vector>
+#include <cassert>
+#include "GameCore.hpp"
+
+
+// 置き方
+struct Move
+{
+  glm::ivec2 pos;
+  u_int rotation;
+};
+
+
+// 手持ちのパネルを置ける全ての場所と回転
+std::vector<Move> enumerateMoves(const std::vector<ngs::Panel>& panels, const ngs::GameCore& core)
+{
+  const auto& panel = panels[core.getHandPanel()];
+  const auto& field = core.getField();
+
+  std::vector<Move> moves;
+  for (const auto& pos : core.getBlankPositions())
+  {
+    for (u_int rotation = 0; rotation < 4; ++rotation)
+    {
+      if (ngs::canPutPanel(panel, pos, rotation, field)) moves.push_back({ pos, rotation });
+    }
+  }
+  // NOTICE 置けるパネルしか手持ちにならないので空にはならない
+  assert(!moves.empty());
+
+  return moves;
+}
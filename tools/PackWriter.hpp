@@ -0,0 +1,801 @@
+﻿#pragma once
+
+//
+// ツール共通: ファイルを１つにまとめて書き出す
+//   形式は src/PackedArchive.hpp を参照
+//   どのファイルをまとめるか、圧縮するかは規則(Rule)で決める
+//
+//   規則のファイル(tools/pack.rules)
+//     # コメント
+//     パターン  skip|store|zlib  [圧縮率]
+//   パターンは相対パス('/'区切り)に対して * と ? が使える
+//   上から順に調べて、最初に一致したものを使う。どれにも一致しなければstore
+//
+//   version 2 は前回まとめた時の記録から変わったファイルだけを読み直して圧縮する
+//   読み込みと圧縮はスレッドプールで行い、書き出しは１つのスレッドで順番に行う
+//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <zlib.h>
+#include <boost/filesystem.hpp>
+#include "PackedArchive.hpp"
+#include "ThreadPool.hpp"
+
+
+bool isHidden(const boost::filesystem::path& p)
+{
+  auto name = p.filename();
+  if(name != ".." &&
+     name != "."  &&
+     name.string()[0] == '.')
+  {
+    return true;
+  }
+
+  return false;
+}
+
+
+struct Rule
+{
+  enum Action
+  {
+    SKIP,
+    STORE,
+    ZLIB,
+  };
+
+  std::string pattern;
+  Action action;
+  int level;
+};
+
+// 規則の指定が無い時
+// TIPS 以前のisPackと同じ
+std::vector<Rule> defaultRules()
+{
+  return {
+    { "*.m4a",   Rule::SKIP,  0 },
+    { "*.png",   Rule::SKIP,  0 },
+    { "*.data",  Rule::SKIP,  0 },
+    // NOTICE まとめたファイル自身(と .manifest .tmp)は含めない
+    { "*.pack*", Rule::SKIP,  0 },
+    { "*",       Rule::STORE, 0 },
+  };
+}
+
+// 規則の読み込み
+// 書式が違っていたらfalse
+bool loadRules(const std::string& path, std::vector<Rule>& rules)
+{
+  std::ifstream fstr(path);
+  if (!fstr.is_open())
+  {
+    std::cout << "File open error:" << path << std::endl;
+    return false;
+  }
+
+  rules.clear();
+  std::string line;
+  int line_no = 0;
+  while (std::getline(fstr, line))
+  {
+    line_no += 1;
+    auto comment = line.find('#');
+    if (comment != std::string::npos) line.erase(comment);
+
+    std::istringstream sstr(line);
+    std::string pattern;
+    std::string action;
+    if (!(sstr >> pattern)) continue;
+
+    Rule rule{ pattern, Rule::STORE, Z_DEFAULT_COMPRESSION };
+    sstr >> action;
+    if (action == "skip")       rule.action = Rule::SKIP;
+    else if (action == "store") rule.action = Rule::STORE;
+    else if (action == "zlib")  rule.action = Rule::ZLIB;
+    else
+    {
+      std::cout << path << ":" << line_no << " Unknown action: " << action << std::endl;
+      return false;
+    }
+
+    int level;
+    if (sstr >> level)
+    {
+      if ((level < 1) || (level > 9))
+      {
+        std::cout << path << ":" << line_no << " Invalid level: " << level << std::endl;
+        return false;
+      }
+      rule.level = level;
+    }
+
+    rules.push_back(rule);
+  }
+
+  return true;
+}
+
+// * と ? だけのパターン照合
+bool matchPattern(const char* pattern, const char* name)
+{
+  // TIPS 最後の * の位置から照合し直す
+  const char* star = nullptr;
+  const char* retry = nullptr;
+  while (*name)
+  {
+    if ((*pattern == '?') || (*pattern == *name))
+    {
+      ++pattern;
+      ++name;
+    }
+    else if (*pattern == '*')
+    {
+      star  = pattern++;
+      retry = name;
+    }
+    else if (star)
+    {
+      pattern = star + 1;
+      name    = ++retry;
+    }
+    else
+    {
+      return false;
+    }
+  }
+  while (*pattern == '*') ++pattern;
+
+  return *pattern == '\0';
+}
+
+Rule findRule(const std::vector<Rule>& rules, const std::string& name)
+{
+  for (const auto& rule : rules)
+  {
+    if (matchPattern(rule.pattern.c_str(), name.c_str())) return rule;
+  }
+
+  return { "*", Rule::STORE, 0 };
+}
+
+
+// FIXME version 1 はファイル上限4GB
+struct File
+{
+  boost::filesystem::path path;
+  // まとめた時の名前(ディレクトリからの相対パス)
+  std::string name;
+  Rule rule;
+  // 先頭からのオフセット
+  uint64_t offset;
+  // データサイズ
+  uint64_t size;
+  // 更新時刻
+  std::time_t mtime;
+  // 中身のハッシュ値(まとめる時に計算する)
+  uint64_t hash;
+};
+
+// ディレクトリ内のまとめるファイルを集める
+// TIPS サブディレクトリも含む(隠しディレクトリは除く)
+//      順番はファイルシステムによらず名前の順
+// NOTICE 書き出し先(output)とその記録・一時ファイルは規則によらず除く
+//        ディレクトリの中へ書き出すと、次回に前回のファイルを含めてしまう
+std::vector<File> collectFiles(const boost::filesystem::path& p, const std::vector<Rule>& rules = defaultRules(),
+                               const boost::filesystem::path& output = {})
+{
+  std::vector<boost::filesystem::path> excludes;
+  if (!output.empty())
+  {
+    auto base = boost::filesystem::weakly_canonical(output).string();
+    excludes = { base, base + ".manifest", base + ".tmp" };
+  }
+
+  std::vector<File> files;
+  for (boost::filesystem::recursive_directory_iterator it(p), end; it != end; ++it)
+  {
+    const auto& path = it->path();
+    if (isHidden(path))
+    {
+      if (boost::filesystem::is_directory(path)) it.no_push();
+      continue;
+    }
+    if (!boost::filesystem::is_regular_file(path)) continue;
+    if (!excludes.empty()
+        && (std::find(std::begin(excludes), std::end(excludes), boost::filesystem::weakly_canonical(path)) != std::end(excludes)))
+    {
+      continue;
+    }
+
+    auto name = path.lexically_relative(p).generic_string();
+    auto rule = findRule(rules, name);
+    if (rule.action == Rule::SKIP) continue;
+
+    files.push_back({ path, name, rule, 0,
+                      boost::filesystem::file_size(path),
+                      boost::filesystem::last_write_time(path),
+                      0 });
+  }
+  std::sort(std::begin(files), std::end(files),
+            [](const File& a, const File& b)
+            {
+              return a.name < b.name;
+            });
+
+  return files;
+}
+
+
+template <typename T>
+void writeValue(std::ostream& file, T value)
+{
+  file.write((const char*)&value, sizeof(value));
+}
+
+bool readFile(const File& f, std::vector<char>& input)
+{
+  std::ifstream fstr(f.path.string(), std::ios::binary);
+  if (!fstr.is_open())
+  {
+    std::cout << "File open error:" << f.path << std::endl;
+    return false;
+  }
+
+  input.resize(f.size);
+  fstr.read(input.data(), input.size());
+  return bool(fstr);
+}
+
+
+// 中身のハッシュ値(MurmurHash64A)
+// TIPS 前回から変わったかどうかと、書き出した結果の検証に使う
+uint64_t hashContent(const char* data, size_t size)
+{
+  const uint64_t m = 0xc6a4a7935bd1e995ull;
+  const int r = 47;
+
+  uint64_t h = 0x5bd1e995ull ^ (size * m);
+  size_t n = size / 8;
+  for (size_t i = 0; i < n; ++i)
+  {
+    uint64_t k;
+    std::memcpy(&k, data + i * 8, 8);
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+
+    h ^= k;
+    h *= m;
+  }
+
+  const auto* tail = reinterpret_cast<const uint8_t*>(data + n * 8);
+  switch (size & 7)
+  {
+  case 7: h ^= uint64_t(tail[6]) << 48;  // fallthrough
+  case 6: h ^= uint64_t(tail[5]) << 40;  // fallthrough
+  case 5: h ^= uint64_t(tail[4]) << 32;  // fallthrough
+  case 4: h ^= uint64_t(tail[3]) << 24;  // fallthrough
+  case 3: h ^= uint64_t(tail[2]) << 16;  // fallthrough
+  case 2: h ^= uint64_t(tail[1]) << 8;   // fallthrough
+  case 1: h ^= uint64_t(tail[0]);
+          h *= m;
+  }
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+  return h;
+}
+
+
+// version 1 で書き出し
+//   with_index: 末尾に索引を追加する(falseなら索引の無い形式)
+// NOTICE 圧縮の指定は無視する
+bool writePack(std::vector<File>& files, const std::string& path, bool with_index = true)
+{
+  // ヘッダ情報確定
+  uint64_t offset = sizeof(uint32_t);
+  for (const auto& f : files)
+  {
+    offset += sizeof(uint32_t) * 3 + f.name.size();
+  }
+  for (auto& f : files)
+  {
+    f.offset = offset;
+    offset += f.size;
+  }
+  if (offset > UINT32_MAX)
+  {
+    std::cout << "Too large for version 1: " << offset << std::endl;
+    return false;
+  }
+
+  std::fstream file(path, std::ios::binary | std::ios::out);
+  if (!file.is_open())
+  {
+    std::cout << "File open error:" << path << std::endl;
+    return false;
+  }
+
+  // ヘッダ書き出し
+  // TIPS 名前の位置は索引で使う
+  std::vector<uint32_t> name_offsets;
+  uint32_t pos = sizeof(uint32_t);
+  writeValue(file, uint32_t(files.size()));
+  for (const auto& f : files)
+  {
+    writeValue(file, uint32_t(f.name.size()));
+    file.write(f.name.c_str(), f.name.size());
+    name_offsets.push_back(pos + sizeof(uint32_t));
+    pos += sizeof(uint32_t) * 3 + f.name.size();
+
+    writeValue(file, uint32_t(f.offset));
+    writeValue(file, uint32_t(f.size));
+  }
+
+  // ファイル結合
+  std::vector<char> input;
+  for (auto& f : files)
+  {
+    if (!readFile(f, input)) return false;
+    f.hash = hashContent(input.data(), input.size());
+    file.write(input.data(), input.size());
+  }
+
+  if (with_index)
+  {
+    // 名前のハッシュ値の順に並べる
+    std::vector<size_t> order(files.size());
+    std::vector<uint64_t> hashes(files.size());
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+      order[i]  = i;
+      hashes[i] = ngs::PackedArchive::hashName(files[i].name.data(), files[i].name.size());
+    }
+    std::stable_sort(std::begin(order), std::end(order),
+                     [&hashes](size_t a, size_t b)
+                     {
+                       return hashes[a] < hashes[b];
+                     });
+
+    for (auto i : order)
+    {
+      writeValue(file, hashes[i]);
+      writeValue(file, name_offsets[i]);
+      writeValue(file, uint32_t(files[i].name.size()));
+      writeValue(file, uint32_t(files[i].offset));
+      writeValue(file, uint32_t(files[i].size));
+    }
+    writeValue(file, uint32_t(offset));
+    writeValue(file, uint32_t(files.size()));
+    file.write("PMIX", 4);
+  }
+
+  return bool(file);
+}
+
+
+// 境界へ揃える
+void writePadding(std::ostream& file, uint64_t& offset, uint32_t alignment)
+{
+  static const char zero[4096] = {};
+
+  uint64_t padding = (alignment - offset % alignment) % alignment;
+  offset += padding;
+  while (padding > 0)
+  {
+    auto n = std::min(padding, uint64_t(sizeof(zero)));
+    file.write(zero, n);
+    padding -= n;
+  }
+}
+
+// 前回まとめた時の記録(まとめたファイル + ".manifest")
+//   PMMF 1 まとめた時刻
+//   中身のハッシュ値 大きさ 更新時刻 規則 圧縮率 名前
+struct Manifest
+{
+  struct Item
+  {
+    uint64_t hash;
+    uint64_t size;
+    std::time_t mtime;
+    Rule::Action action;
+    int level;
+  };
+
+  std::time_t time = 0;
+  std::map<std::string, Item> items;
+};
+
+bool loadManifest(const std::string& path, Manifest& manifest)
+{
+  std::ifstream fstr(path);
+  std::string magic;
+  int version;
+  if (!(fstr >> magic >> version >> manifest.time) || (magic != "PMMF") || (version != 1)) return false;
+
+  std::string line;
+  std::getline(fstr, line);
+  while (std::getline(fstr, line))
+  {
+    std::istringstream sstr(line);
+    Manifest::Item item;
+    int action;
+    std::string name;
+    sstr >> std::hex >> item.hash >> std::dec >> item.size >> item.mtime >> action >> item.level;
+    sstr.get();
+    std::getline(sstr, name);
+    if (!sstr || name.empty()) return false;
+
+    item.action = Rule::Action(action);
+    manifest.items.insert({ name, item });
+  }
+
+  return true;
+}
+
+bool writeManifest(const std::string& path, const std::vector<File>& files, std::time_t time)
+{
+  std::ofstream fstr(path);
+  fstr << "PMMF 1 " << time << "\n";
+  for (const auto& f : files)
+  {
+    fstr << std::hex << f.hash << std::dec
+         << ' ' << f.size << ' ' << f.mtime
+         << ' ' << int(f.rule.action) << ' ' << f.rule.level
+         << ' ' << f.name << "\n";
+  }
+
+  return bool(fstr);
+}
+
+
+struct PackOptions
+{
+  // ファイルごとのデータの先頭をこの倍数に揃える
+  uint32_t alignment = 4096;
+  unsigned int threads = std::thread::hardware_concurrency();
+  // 前回まとめたファイルから、変わっていないものを使い回す
+  bool incremental = true;
+};
+
+struct PackStats
+{
+  // 大きさと更新時刻が同じなので、読まずに使い回した
+  size_t unchanged = 0;
+  // 読んだが中身が同じだったので、圧縮せずに使い回した
+  size_t same_content = 0;
+  // 読んで圧縮した
+  size_t packed = 0;
+};
+
+
+// １ファイル分の書き出すデータ
+struct PackedData
+{
+  enum Source
+  {
+    PACKED,
+    UNCHANGED,
+    SAME_CONTENT,
+  };
+
+  // dataは buffer か前回のファイルを指す
+  std::vector<char> buffer;
+  const char* data = nullptr;
+  uint64_t size = 0;
+  uint32_t crc = 0;
+  ngs::PackedArchive::Compression compression = ngs::PackedArchive::Compression::NONE;
+  Source source = PACKED;
+  bool failed = false;
+};
+
+// 読み込み、ハッシュ値の計算、圧縮
+// NOTICE スレッドプールから呼ばれる(fとoutput以外は読むだけ)
+void packData(File& f, const Manifest& manifest, const ngs::PackedArchive& previous,
+              PackedData& output)
+{
+  using Archive = ngs::PackedArchive;
+
+  // 前回のデータ
+  Archive::Entry entry;
+  const Manifest::Item* item = nullptr;
+  {
+    auto it = manifest.items.find(f.name);
+    if ((it != std::end(manifest.items))
+        && (it->second.size == f.size)
+        && (it->second.action == f.rule.action) && (it->second.level == f.rule.level)
+        && previous.find(f.name, entry) && (entry.size == f.size))
+    {
+      item = &it->second;
+    }
+  }
+  auto reuse = [&entry, &output](PackedData::Source source)
+               {
+                 output.data        = entry.data.begin();
+                 output.size        = entry.data.size();
+                 output.crc         = entry.crc;
+                 output.compression = entry.compression;
+                 output.source      = source;
+               };
+
+  // NOTICE 前回まとめた時刻と同じ秒に更新されたファイルは、変わっていても更新時刻が同じになる
+  if (item && (item->mtime == f.mtime) && (f.mtime < manifest.time))
+  {
+    f.hash = item->hash;
+    reuse(PackedData::UNCHANGED);
+    return;
+  }
+
+  std::vector<char> input;
+  if (!readFile(f, input))
+  {
+    output.failed = true;
+    return;
+  }
+  f.hash = hashContent(input.data(), input.size());
+  if (item && (item->hash == f.hash))
+  {
+    reuse(PackedData::SAME_CONTENT);
+    return;
+  }
+
+  output.compression = Archive::Compression::NONE;
+  if ((f.rule.action == Rule::ZLIB) && !input.empty())
+  {
+    uLongf compressed_size = compressBound(uLong(input.size()));
+    output.buffer.resize(compressed_size);
+    int status = compress2(reinterpret_cast<Bytef*>(output.buffer.data()), &compressed_size,
+                           reinterpret_cast<const Bytef*>(input.data()), uLong(input.size()),
+                           f.rule.level);
+    // TIPS 小さくならなければ圧縮しない
+    if ((status == Z_OK) && (compressed_size < input.size()))
+    {
+      output.buffer.resize(compressed_size);
+      output.compression = Archive::Compression::ZLIB;
+    }
+  }
+  if (output.compression == Archive::Compression::NONE) output.buffer.swap(input);
+
+  output.data = output.buffer.data();
+  output.size = output.buffer.size();
+  output.crc  = Archive::crc32(output.data, output.size);
+}
+
+
+// version 2 で書き出し
+//   ファイルごとの読み込みと圧縮はスレッドプールで行い、書き出しは順番に１つのスレッドで行う
+//   options.incremental なら前回のファイルと記録(path + ".manifest")から変わっていないものを使い回す
+// TIPS 一時ファイルへ書き出してから置き換える(前回のファイルを読みながら書くため)
+bool writePackV2(std::vector<File>& files, const std::string& path,
+                 const PackOptions& options, PackStats& stats)
+{
+  using Archive = ngs::PackedArchive;
+
+  auto manifest_path = path + ".manifest";
+  auto tmp_path      = path + ".tmp";
+  auto pack_time     = std::time(nullptr);
+  auto alignment     = std::max(options.alignment, uint32_t(1));
+
+  // 途中で失敗したら一時ファイルを消す
+  auto discard = [&tmp_path](std::fstream& file)
+                 {
+                   file.close();
+                   boost::system::error_code error;
+                   boost::filesystem::remove(tmp_path, error);
+                   return false;
+                 };
+
+  // TIPS 記録か前回のファイルが無ければ全てまとめ直す
+  Manifest manifest;
+  Archive previous;
+  if (options.incremental && loadManifest(manifest_path, manifest))
+  {
+    previous = Archive(path);
+    if (!previous.isOpen() || (previous.version() != 2)) manifest.items.clear();
+  }
+
+  {
+    std::fstream file(tmp_path, std::ios::binary | std::ios::out);
+    if (!file.is_open())
+    {
+      std::cout << "File open error:" << tmp_path << std::endl;
+      return false;
+    }
+
+    // NOTICE ヘッダは最後に書き直す
+    std::vector<char> header(Archive::V2_HEADER_SIZE);
+    file.write(header.data(), header.size());
+    uint64_t offset = header.size();
+
+    std::vector<PackedData> packed(files.size());
+    std::vector<char> ready(files.size(), 0);
+    std::mutex mutex;
+    std::condition_variable done;
+
+    struct Info
+    {
+      uint64_t offset;
+      uint64_t size;
+      uint32_t crc;
+      Archive::Compression compression;
+    };
+    std::vector<Info> infos;
+    bool failed = false;
+    {
+      ngs::ThreadPool pool(options.threads);
+      auto push = [&](size_t i)
+                  {
+                    pool.push([&, i](unsigned int)
+                              {
+                                packData(files[i], manifest, previous, packed[i]);
+
+                                std::lock_guard<std::mutex> lock(mutex);
+                                ready[i] = 1;
+                                done.notify_all();
+                              });
+                  };
+
+      // NOTICE 先に全て積むと、書き出し待ちのデータでメモリが膨らむ
+      size_t window = size_t(pool.size()) * 4;
+      size_t pushed = std::min(window, files.size());
+      for (size_t i = 0; i < pushed; ++i) push(i);
+
+      // 順番に書き出す
+      for (size_t i = 0; i < files.size(); ++i)
+      {
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          done.wait(lock, [&ready, i]() { return ready[i] != 0; });
+        }
+        if (pushed < files.size()) push(pushed++);
+
+        auto& p = packed[i];
+        if (p.failed)
+        {
+          failed = true;
+          break;
+        }
+        switch (p.source)
+        {
+        case PackedData::PACKED:       stats.packed       += 1; break;
+        case PackedData::UNCHANGED:    stats.unchanged    += 1; break;
+        case PackedData::SAME_CONTENT: stats.same_content += 1; break;
+        }
+
+        writePadding(file, offset, alignment);
+        files[i].offset = offset;
+        file.write(p.data, p.size);
+        offset += p.size;
+
+        infos.push_back({ files[i].offset, p.size, p.crc, p.compression });
+        // TIPS 書き出したら解放
+        std::vector<char>().swap(p.buffer);
+      }
+      // NOTICE 積んだ仕事が終わるまで待ってから、ローカル変数を片付ける
+      pool.wait();
+    }
+    if (failed) return discard(file);
+
+    // 索引
+    writePadding(file, offset, 8);
+    uint64_t index_offset = offset;
+
+    std::vector<uint64_t> hashes(files.size());
+    std::vector<uint32_t> name_offsets(files.size());
+    std::vector<size_t> order(files.size());
+    uint32_t name_offset = 0;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+      hashes[i]       = Archive::hashName(files[i].name.data(), files[i].name.size());
+      name_offsets[i] = name_offset;
+      order[i]        = i;
+      name_offset += uint32_t(files[i].name.size());
+    }
+    std::stable_sort(std::begin(order), std::end(order),
+                     [&hashes](size_t a, size_t b)
+                     {
+                       return hashes[a] < hashes[b];
+                     });
+    for (auto i : order)
+    {
+      const auto& info = infos[i];
+      writeValue(file, hashes[i]);
+      writeValue(file, name_offsets[i]);
+      writeValue(file, uint32_t(files[i].name.size()));
+      writeValue(file, info.offset);
+      writeValue(file, info.size);
+      writeValue(file, uint64_t(files[i].size));
+      writeValue(file, info.crc);
+      writeValue(file, uint32_t(info.compression));
+    }
+    offset += uint64_t(files.size()) * Archive::V2_INDEX_ENTRY_SIZE;
+
+    // 名前
+    uint64_t names_offset = offset;
+    for (const auto& f : files)
+    {
+      file.write(f.name.c_str(), f.name.size());
+    }
+
+    // ヘッダ
+    file.seekp(0);
+    file.write("PMA2", 4);
+    writeValue(file, uint32_t(2));
+    writeValue(file, uint32_t(files.size()));
+    writeValue(file, alignment);
+    writeValue(file, index_offset);
+    writeValue(file, names_offset);
+
+    if (!file) return discard(file);
+  }
+
+  // NOTICE 置き換える前に前回のファイルを閉じる(Windowsは割り当て中のファイルを置き換えられない)
+  previous = Archive();
+  boost::system::error_code error;
+  boost::filesystem::rename(tmp_path, path, error);
+  if (error)
+  {
+    std::cout << "File rename error:" << path << std::endl;
+    return false;
+  }
+
+  return writeManifest(manifest_path, files, pack_time);
+}
+
+bool writePackV2(std::vector<File>& files, const std::string& path, uint32_t alignment = 4096)
+{
+  PackOptions options;
+  options.alignment   = alignment;
+  options.incremental = false;
+  PackStats stats;
+  return writePackV2(files, path, options, stats);
+}
+
+
+// まとめたファイルを検証する
+//   伸長した結果のハッシュ値を、まとめる時に計算したものと比べる
+// TIPS 元のファイルは読み直さない
+size_t verifyPack(const std::vector<File>& files, const std::string& path, unsigned int threads)
+{
+  ngs::PackedArchive archive(path);
+  if (!archive.isOpen() || (archive.size() != files.size())) return files.size();
+
+  std::atomic<size_t> errors{ 0 };
+  {
+    ngs::ThreadPool pool(threads);
+    for (const auto& f : files)
+    {
+      pool.push([&archive, &errors, &f](unsigned int)
+                {
+                  ngs::PackedArchive::Entry entry;
+                  std::string data;
+                  if (!archive.find(f.name, entry)
+                      || !ngs::PackedArchive::extract(entry, data)
+                      || (hashContent(data.data(), data.size()) != f.hash))
+                  {
+                    errors += 1;
+                  }
+                });
+    }
+    pool.wait();
+  }
+
+  return errors;
+}
@@ -0,0 +1,423 @@
+﻿#pragma once
+
+//
+// ツール共通: ゲーム記録の読み書き
+//   アプリ本体はCinderのJsonTreeで読み書きするが、ツールはBoostで読み、手書きで書き出す
+//   JSON形式(Game::save)、それをTextCodecで圧縮したもの、バイナリ形式(GameRecord)のどれでも読める
+//
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <random>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include "GameCore.hpp"
+#include "GameRecord.hpp"
+#include "TextCodec.hpp"
+
+
+// JSON形式の記録の中身
+struct Record
+{
+  int hand_panel = 0;
+  u_int hand_rotation = 0;
+  std::vector<int> waiting_panels;
+  // 置いた順番
+  std::vector<ngs::PanelStatus> field;
+
+  double play_time = 0.0;
+  std::vector<std::vector<glm::ivec2>> completed_forests;
+  std::vector<u_int> deep_forest;
+  std::vector<std::vector<glm::ivec2>> completed_path;
+  std::vector<glm::ivec2> completed_church;
+
+  u_int panel_turned_times = 0;
+  u_int panel_moved_times  = 0;
+  bool tutorial = false;
+  std::string play_log;
+};
+
+
+// ファイルをそのまま読む
+bool readFile(const std::string& path, std::string& data)
+{
+  std::ifstream fstr(path, std::ios::binary);
+  if (!fstr) return false;
+
+  data.assign(std::istreambuf_iterator<char>(fstr), std::istreambuf_iterator<char>());
+  return true;
+}
+
+// 圧縮されていたら伸長する
+// TIPS 平文のJSONは '{' で始まる。それ以外は圧縮されているとみなす
+std::string decodeText(const std::string& data)
+{
+  auto first = data.find_first_not_of(" \t\r\n\xEF\xBB\xBF");
+  if ((first != std::string::npos) && (data[first] == '{')) return data;
+
+  return ngs::TextCodec::decode(data);
+}
+
+bool parseJson(const std::string& text, boost::property_tree::ptree& json)
+{
+  if (text.empty()) return false;
+
+  std::istringstream str(text);
+  try
+  {
+    boost::property_tree::read_json(str, json);
+  }
+  catch (boost::property_tree::ptree_error&)
+  {
+    return false;
+  }
+  return true;
+}
+
+bool readJson(const std::string& path, boost::property_tree::ptree& json)
+{
+  std::string data;
+  return readFile(path, data) && parseJson(decodeText(data), json);
+}
+
+
+// [x, y]
+glm::ivec2 getVec(const boost::property_tree::ptree& json)
+{
+  if (json.size() != 2) throw boost::property_tree::ptree_bad_data("vec", 0);
+
+  auto it = json.begin();
+  glm::ivec2 v;
+  v.x = (it++)->second.get_value<int>();
+  v.y = it->second.get_value<int>();
+  return v;
+}
+
+template <typename T>
+std::vector<T> getArray(const boost::property_tree::ptree& json)
+{
+  std::vector<T> values;
+  for (const auto& v : json)
+  {
+    values.push_back(v.second.get_value<T>());
+  }
+  return values;
+}
+
+std::vector<glm::ivec2> getVecArray(const boost::property_tree::ptree& json)
+{
+  std::vector<glm::ivec2> values;
+  for (const auto& v : json)
+  {
+    values.push_back(getVec(v.second));
+  }
+  return values;
+}
+
+std::vector<std::vector<glm::ivec2>> getVecVecArray(const boost::property_tree::ptree& json)
+{
+  std::vector<std::vector<glm::ivec2>> values;
+  for (const auto& v : json)
+  {
+    values.push_back(getVecArray(v.second));
+  }
+  return values;
+}
+
+bool parseRecord(const boost::property_tree::ptree& json, Record& record)
+{
+  try
+  {
+    record.hand_panel     = json.get<int>("hand_panel");
+    record.hand_rotation  = json.get<u_int>("hand_rotation");
+    record.waiting_panels = getArray<int>(json.get_child("waiting_panels"));
+    for (const auto& obj : json.get_child("field"))
+    {
+      ngs::PanelStatus status;
+      status.number   = obj.second.get<int>("number");
+      status.position = getVec(obj.second.get_child("pos"));
+      status.rotation = obj.second.get<u_int>("rotation");
+      // NOTICE 古い記録には辺の情報が無い
+      status.edge     = obj.second.get<uint64_t>("edge", 0);
+      record.field.push_back(status);
+    }
+    record.play_time          = json.get<double>("play_time");
+    record.completed_forests  = getVecVecArray(json.get_child("completed_forests"));
+    record.deep_forest        = getArray<u_int>(json.get_child("deep_forest"));
+    record.completed_path     = getVecVecArray(json.get_child("completed_path"));
+    record.completed_church   = getVecArray(json.get_child("completed_church"));
+    record.panel_turned_times = json.get<u_int>("panel_turned_times");
+    record.panel_moved_times  = json.get<u_int>("panel_moved_times");
+    record.tutorial           = json.get<bool>("tutorial", false);
+    record.play_log           = json.get<std::string>("play_log", "");
+  }
+  catch (boost::property_tree::ptree_error&)
+  {
+    return false;
+  }
+
+  return !record.field.empty()
+         && (record.deep_forest.size() == record.completed_forests.size());
+}
+
+// バイナリ形式へ
+// 操作記録が壊れていたらfalse
+bool toGameRecord(const Record& record, ngs::GameRecord& game_record)
+{
+  game_record.hand_panel     = record.hand_panel;
+  game_record.hand_rotation  = record.hand_rotation;
+  game_record.waiting_panels = record.waiting_panels;
+
+  game_record.field.clear();
+  for (const auto& status : record.field)
+  {
+    game_record.field.push_back({ status.number, status.position, status.rotation });
+  }
+
+  game_record.play_time          = record.play_time;
+  game_record.panel_turned_times = record.panel_turned_times;
+  game_record.panel_moved_times  = record.panel_moved_times;
+  game_record.tutorial           = record.tutorial;
+
+  game_record.play_log.clear();
+  if (record.play_log.empty()) return true;
+  return game_record.play_log.fromHex(record.play_log);
+}
+
+
+// 記録から盤面を組み立て直す
+class RecordCore
+  : public ngs::GameCore
+{
+public:
+  using GameCore::GameCore;
+
+
+  // 記録の盤面を置いた順番に置き直す
+  // 置けない場所に置いていたらfalse
+  // edges: JSON形式に記録されていた辺の情報(無ければ調べない)
+  bool rebuild(const ngs::GameRecord& record, const std::vector<uint64_t>& edges = {}) noexcept
+  {
+    if (record.field.empty() || (record.hand_rotation > 3)) return false;
+    // 最初のパネルは中央
+    if (record.field[0].pos != glm::ivec2(0, 0)) return false;
+
+    // 同じパネルを２度使っていないか
+    std::vector<bool> used(panels_.size(), false);
+    auto use = [this, &used](int number)
+               {
+                 if ((number < 0) || (size_t(number) >= panels_.size())) return false;
+                 if (used[number]) return false;
+                 used[number] = true;
+                 return true;
+               };
+    for (size_t i = 0; i < record.field.size(); ++i)
+    {
+      const auto& p = record.field[i];
+      if (!use(p.panel) || (p.rotation > 3)) return false;
+
+      // NOTICE 記録されている辺の情報は置いた時に計算したもの
+      if ((i < edges.size()) && edges[i]
+          && (edges[i] != panels_[p.panel].getRotatedEdgeValue(p.rotation))) return false;
+    }
+    for (auto number : record.waiting_panels)
+    {
+      if (!use(number)) return false;
+    }
+
+    return restoreRecord(record);
+  }
+
+  // Game::loadと同じく、記録されていた完成した区画をそのまま使う
+  void load(const Record& record) noexcept
+  {
+    hand_panel     = record.hand_panel;
+    hand_rotation  = record.hand_rotation;
+    waiting_panels = record.waiting_panels;
+    field = ngs::Field();
+    for (const auto& status : record.field)
+    {
+      field.addPanel(status.number, status.position, status.rotation, status.edge);
+    }
+    rebuildRegions();
+
+    completed_forests = record.completed_forests;
+    deep_forest       = record.deep_forest;
+    completed_path    = record.completed_path;
+    completed_church  = record.completed_church;
+
+    panel_turned_times_ = record.panel_turned_times;
+    panel_moved_times_  = record.panel_moved_times;
+    is_tutorial_        = record.tutorial;
+
+    play_log_.clear();
+    if (!record.play_log.empty() && !play_log_.fromHex(record.play_log)) play_log_.clear();
+
+    total_panels = u_int(record.field.size()) - 1;
+    updateScores();
+    calcResults();
+  }
+
+
+  // 完成した区画が記録と一致するか
+  // TIPS 区画の並び順と区画内の並び順は問わない
+  bool matchCompleted(const Record& record) const noexcept
+  {
+    return (normalize(completed_forests, deep_forest) == normalize(record.completed_forests, record.deep_forest))
+           && (normalize(completed_path) == normalize(record.completed_path))
+           && (normalize({ completed_church }) == normalize({ record.completed_church }));
+  }
+
+  // 同じ盤面か
+  // TIPS パネルを置いた順番も比べる
+  bool matchField(const RecordCore& other) const noexcept
+  {
+    auto a = field.enumeratePanels();
+    auto b = other.field.enumeratePanels();
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+      if ((a[i].number != b[i].number)
+          || (a[i].position != b[i].position)
+          || (a[i].rotation != b[i].rotation)) return false;
+    }
+
+    return (waiting_panels == other.waiting_panels)
+           && (total_score == other.total_score);
+  }
+
+
+  // Game::saveと同じ形式で書き出す
+  std::string serialize(double play_time = 0.0) const noexcept
+  {
+    auto vec = [](std::ostream& str, const glm::ivec2& v)
+               {
+                 str << '[' << v.x << ',' << v.y << ']';
+               };
+    auto vecArray = [&vec](std::ostream& str, const std::vector<glm::ivec2>& values)
+                    {
+                      str << '[';
+                      for (size_t i = 0; i < values.size(); ++i)
+                      {
+                        if (i) str << ',';
+                        vec(str, values[i]);
+                      }
+                      str << ']';
+                    };
+    auto vecVecArray = [&vecArray](std::ostream& str, const std::vector<std::vector<glm::ivec2>>& values)
+                       {
+                         str << '[';
+                         for (size_t i = 0; i < values.size(); ++i)
+                         {
+                           if (i) str << ',';
+                           vecArray(str, values[i]);
+                         }
+                         str << ']';
+                       };
+    auto array = [](std::ostream& str, const auto& values)
+                 {
+                   str << '[';
+                   for (size_t i = 0; i < values.size(); ++i)
+                   {
+                     if (i) str << ',';
+                     str << values[i];
+                   }
+                   str << ']';
+                 };
+
+    std::ostringstream str;
+    str << "{\"hand_panel\":" << hand_panel
+        << ",\"hand_rotation\":" << hand_rotation
+        << ",\"waiting_panels\":";
+    array(str, waiting_panels);
+
+    str << ",\"field\":[";
+    const auto& positions = field.getPanelPositions();
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+      const auto& status = field.getPanelStatus(positions[i]);
+      if (i) str << ',';
+      str << "{\"pos\":";
+      vec(str, status.position);
+      str << ",\"number\":" << status.number
+          << ",\"rotation\":" << status.rotation
+          << ",\"edge\":" << status.edge << '}';
+    }
+    str << ']';
+
+    str << ",\"play_time\":" << play_time
+        << ",\"completed_forests\":";
+    vecVecArray(str, completed_forests);
+    str << ",\"deep_forest\":";
+    array(str, deep_forest);
+    str << ",\"completed_path\":";
+    vecVecArray(str, completed_path);
+    str << ",\"completed_church\":";
+    vecArray(str, completed_church);
+    str << ",\"panel_turned_times\":" << panel_turned_times_
+        << ",\"panel_moved_times\":" << panel_moved_times_
+        << ",\"tutorial\":" << (is_tutorial_ ? "true" : "false")
+        << ",\"play_log\":\"" << play_log_.toHex() << "\"}";
+
+    return str.str();
+  }
+
+
+private:
+  using Regions = std::vector<std::pair<std::vector<glm::ivec2>, u_int>>;
+
+  static Regions normalize(const std::vector<std::vector<glm::ivec2>>& regions,
+                           const std::vector<u_int>& values = {}) noexcept
+  {
+    Regions result;
+    for (size_t i = 0; i < regions.size(); ++i)
+    {
+      auto cells = regions[i];
+      std::sort(std::begin(cells), std::end(cells), ngs::LessVec<glm::ivec2>());
+      result.emplace_back(std::move(cells), (i < values.size()) ? values[i] : 0);
+    }
+    std::sort(std::begin(result), std::end(result),
+              [](const auto& a, const auto& b)
+              {
+                if (a.second != b.second) return a.second < b.second;
+                return std::lexicographical_compare(std::begin(a.first), std::end(a.first),
+                                                    std::begin(b.first), std::end(b.first),
+                                                    ngs::LessVec<glm::ivec2>());
+              });
+    return result;
+  }
+};
+
+
+// 置ける場所から適当に選んで最後まで遊ぶ
+// TIPS 検証や計測用の記録を作る
+void playRandomGame(ngs::GameCore& core, const std::vector<ngs::Panel>& panels, uint32_t seed)
+{
+  std::mt19937 engine(seed);
+
+  core.preparationPanel();
+  bool has_next = core.putFirstPanel();
+  std::vector<std::pair<glm::ivec2, u_int>> moves;
+  while (has_next)
+  {
+    moves.clear();
+    const auto& panel = panels[core.getHandPanel()];
+    for (const auto& pos : core.getBlankPositions())
+    {
+      for (u_int r = 0; r < 4; ++r)
+      {
+        if (ngs::canPutPanel(panel, pos, r, core.getField())) moves.emplace_back(pos, r);
+      }
+    }
+
+    std::uniform_int_distribution<size_t> dist(0, moves.size() - 1);
+    const auto& move = moves[dist(engine)];
+    while (core.getHandRotation() != move.second) core.rotationHandPanel();
+    // TIPS 操作記録の時間も入れておく
+    has_next = core.putHandPanel(move.first, core.getTotalPanels() * 1.5);
+  }
+  core.calcResults();
+}
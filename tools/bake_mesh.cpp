@@ -0,0 +1,412 @@
+﻿//
+// メッシュを焼き込むやつ(.ply/.obj → .bmesh)
+//   起動時に行っていた処理(PLYの解析・法線の計算・同じ頂点をまとめる・法線を揺らす)を前もって済ませ、
+//   インターリーブ済み・量子化済みの形式(src/BakedMesh.hpp)で書き出す
+//   書き出す前に、同じ平面・同じ色の面をまとめ、頂点キャッシュとオーバードローが効く順番に並べ替える
+//   (src/MeshOptimizer.hpp)
+//   各工程はアプリと共通(src/MeshBaker.hpp)。PLYはアプリで焼き込んだ結果と一致するかも調べる
+//   ディレクトリを渡すと、その中の名前が接頭辞で始まる .ply を焼き込む(.obj はファイル名で渡す)
+//   書き出す名前は BakedMesh::bakedPath (blank.ply → blank.bmesh、blank.obj → blank.obj.bmesh)
+//   書き出した後は読み戻して、元のメッシュとの誤差を調べる
+//
+//   ./bake_mesh [-o 出力先] [-p 接頭辞] [-d 1|0] [-c 1|0] [-s 乱数の種] path...
+//     -p ディレクトリから選ぶファイル名の先頭(既定はパネルの p。焼き込んだものを読むのはパネルだけ)
+//     -d 法線を揺らすか(PLY::optimize と同じ)
+//     -c 同じ平面・同じ色の面をまとめるか
+//
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <glm/glm.hpp>
+#include "BakedMesh.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshBaker.hpp"
+#include "Measure.hpp"
+
+
+using Mesh = ngs::MeshBaker::Mesh;
+
+
+bool readFile(const std::string& path, std::string& data)
+{
+  std::ifstream fstr(path, std::ios::binary);
+  if (!fstr.is_open()) return false;
+
+  data.assign((std::istreambuf_iterator<char>(fstr)), std::istreambuf_iterator<char>());
+  return true;
+}
+
+
+// PLY形式
+bool loadPly(const std::string& path, Mesh& mesh, bool merge, uint32_t& rects)
+{
+  std::string data;
+  if (!readFile(path, data)) return false;
+
+  return ngs::MeshBaker::parsePly(data.data(), data.size(), merge, mesh, rects);
+}
+
+// OBJ形式
+// TIPS 頂点の位置と法線のみ読む(テクスチャ座標とマテリアルは使わない)
+//      法線が無ければ計算する
+bool loadObj(const std::string& path, Mesh& mesh)
+{
+  std::ifstream fstr(path);
+  if (!fstr.is_open()) return false;
+
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> normals;
+  bool has_normal = true;
+
+  // "v" "v/vt" "v//vn" "v/vt/vn" (負の値は末尾から数える)
+  auto toIndex = [](long value, size_t size)
+                 {
+                   return (value < 0) ? long(size) + value : value - 1;
+                 };
+
+  std::string line;
+  while (std::getline(fstr, line))
+  {
+    std::istringstream sstr(line);
+    std::string word;
+    sstr >> word;
+    if (word == "v")
+    {
+      glm::vec3 p;
+      sstr >> p.x >> p.y >> p.z;
+      positions.push_back(p);
+    }
+    else if (word == "vn")
+    {
+      glm::vec3 n;
+      sstr >> n.x >> n.y >> n.z;
+      normals.push_back(n);
+    }
+    else if (word == "f")
+    {
+      uint32_t first = uint32_t(mesh.positions.size());
+      int num = 0;
+      std::string corner;
+      while (sstr >> corner)
+      {
+        long v  = std::stol(corner);
+        long vn = 0;
+        auto slash = corner.rfind('/');
+        if ((slash != std::string::npos) && (corner.find('/') != slash || corner[slash - 1] == '/'))
+        {
+          vn = std::stol(corner.substr(slash + 1));
+        }
+
+        v = toIndex(v, positions.size());
+        if ((v < 0) || (v >= long(positions.size()))) return false;
+        mesh.positions.push_back(positions[v]);
+        mesh.colors.push_back(glm::vec3(1.0f));
+        if (vn != 0)
+        {
+          vn = toIndex(vn, normals.size());
+          if ((vn < 0) || (vn >= long(normals.size()))) return false;
+          mesh.normals.push_back(normals[vn]);
+        }
+        else
+        {
+          mesh.normals.push_back(glm::vec3(0.0f));
+          has_normal = false;
+        }
+
+        // 多角形は扇状に分割
+        if (num >= 2)
+        {
+          uint32_t index = uint32_t(mesh.positions.size()) - 1;
+          mesh.indices.insert(mesh.indices.end(), { first, index - 1, index });
+        }
+        num += 1;
+      }
+    }
+  }
+
+  if (!has_normal) ngs::MeshBaker::recalculateNormals(mesh);
+  return true;
+}
+
+
+// 三角形の集合(位置の並び)
+// 並べ替えの前後で同じか調べる
+std::vector<std::vector<float>> triangleSet(const Mesh& mesh)
+{
+  std::vector<std::vector<float>> triangles;
+  for (size_t i = 0; i < mesh.indices.size(); i += 3)
+  {
+    std::vector<float> t;
+    for (int k = 0; k < 3; ++k)
+    {
+      const auto& p = mesh.positions[mesh.indices[i + k]];
+      const auto& c = mesh.colors[mesh.indices[i + k]];
+      t.insert(t.end(), { p.x, p.y, p.z, c.x, c.y, c.z });
+    }
+    triangles.push_back(std::move(t));
+  }
+  std::sort(std::begin(triangles), std::end(triangles));
+  return triangles;
+}
+
+// 面積の合計
+double calcArea(const Mesh& mesh)
+{
+  double area = 0.0;
+  for (size_t i = 0; i < mesh.indices.size(); i += 3)
+  {
+    const auto& v0 = mesh.positions[mesh.indices[i]];
+    const auto& v1 = mesh.positions[mesh.indices[i + 1]];
+    const auto& v2 = mesh.positions[mesh.indices[i + 2]];
+    area += glm::length(glm::cross(v1 - v0, v2 - v0)) * 0.5;
+  }
+  return area;
+}
+
+
+int main(int argc, char* argv[])
+{
+  std::string output_path;
+  std::string prefix = "p";
+  bool displace = true;
+  bool merge = true;
+  uint32_t seed = 1;
+  std::vector<std::string> inputs;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg[0] != '-')
+    {
+      inputs.push_back(arg);
+      continue;
+    }
+    if ((i + 1) >= argc)
+    {
+      std::cout << "Missing value: " << arg << std::endl;
+      return 1;
+    }
+
+    std::string value = argv[++i];
+    if (arg == "-o")      output_path = value;
+    else if (arg == "-p") prefix      = value;
+    else if (arg == "-d") displace    = (value != "0");
+    else if (arg == "-c") merge       = (value != "0");
+    else if (arg == "-s") seed        = uint32_t(std::stoul(value));
+    else
+    {
+      std::cout << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (inputs.empty())
+  {
+    std::cout << "Usage: bake_mesh [-o output] [-p prefix] [-d 1|0] [-c 1|0] [-s seed] path..." << std::endl;
+    return 1;
+  }
+
+  std::vector<boost::filesystem::path> paths;
+  for (const auto& input : inputs)
+  {
+    if (boost::filesystem::is_directory(input))
+    {
+      std::vector<boost::filesystem::path> found;
+      for (const auto& entry : boost::filesystem::directory_iterator(input))
+      {
+        auto name = entry.path().filename().string();
+        if ((name.compare(0, prefix.size(), prefix) == 0) && (entry.path().extension() == ".ply"))
+        {
+          found.push_back(entry.path());
+        }
+      }
+      std::sort(std::begin(found), std::end(found));
+      paths.insert(std::end(paths), std::begin(found), std::end(found));
+    }
+    else
+    {
+      paths.push_back(input);
+    }
+  }
+
+  size_t errors = 0;
+  size_t total_mesh_bytes = 0;
+  size_t total_baked_bytes = 0;
+  size_t total_faces[2] = { 0, 0 };
+  // 頂点シェーダーの実行回数(ACMR × 三角形の数)
+  double total_transformed[2] = { 0.0, 0.0 };
+  double total_build = 0.0;
+  double total_load = 0.0;
+  std::cout << std::fixed << std::setprecision(2)
+            << "file           triangles        vertices         ACMR       overdraw    baked(KB)" << std::endl;
+  for (const auto& path : paths)
+  {
+    // TIPS ファイルごとに乱数を初期化するので、焼き込む順番が変わっても結果は同じ
+    std::mt19937 engine(seed);
+    bool is_obj = (path.extension() == ".obj");
+
+    // 起動時に行っていた処理と、その時間
+    // NOTICE OBJ形式は色が無いので面をまとめない
+    Mesh source;
+    uint32_t rects = 0;
+    bool loaded = false;
+    auto t_build = measure([&]()
+                           {
+                             loaded = is_obj ? loadObj(path.string(), source)
+                                             : loadPly(path.string(), source, false, rects);
+                             if (loaded) ngs::MeshBaker::optimize(source);
+                           });
+
+    Mesh mesh;
+    if (loaded)
+    {
+      loaded = is_obj ? loadObj(path.string(), mesh)
+                      : loadPly(path.string(), mesh, merge, rects);
+    }
+    if (!loaded || mesh.indices.empty())
+    {
+      std::cout << "Load error: " << path.string() << std::endl;
+      errors += 1;
+      continue;
+    }
+    ngs::MeshBaker::optimize(mesh);
+    if (displace) ngs::MeshBaker::displaceNormals(mesh, engine);
+
+    // まとめても面積は変わらない
+    double source_area = calcArea(source);
+    if (std::abs(calcArea(mesh) - source_area) > (source_area * 1e-6)) errors += 1;
+
+    // 並べ替えても三角形は変わらない
+    auto triangles = triangleSet(mesh);
+    ngs::MeshBaker::reorder(mesh);
+    if (triangleSet(mesh) != triangles) errors += 1;
+
+    float acmr[] = {
+      ngs::MeshOptimizer::calcACMR(source.indices.data(), source.indices.size(), uint32_t(source.positions.size())),
+      ngs::MeshOptimizer::calcACMR(mesh.indices.data(), mesh.indices.size(), uint32_t(mesh.positions.size()))
+    };
+    float overdraw[] = {
+      ngs::MeshOptimizer::calcOverdraw(source.indices.data(), source.indices.size(),
+                                       &source.positions[0].x, uint32_t(source.positions.size())),
+      ngs::MeshOptimizer::calcOverdraw(mesh.indices.data(), mesh.indices.size(),
+                                       &mesh.positions[0].x, uint32_t(mesh.positions.size()))
+    };
+
+    std::string baked;
+    ngs::MeshBaker::write(mesh, baked);
+
+    // アプリで焼き込んだ時(MeshBaker::bakePly)と同じか
+    if (!is_obj)
+    {
+      ngs::MeshBaker::Options options;
+      options.merge    = merge;
+      options.displace = displace;
+      options.seed     = seed;
+
+      std::string data;
+      std::string app_baked;
+      if (!readFile(path.string(), data) || !ngs::MeshBaker::bakePly(data.data(), data.size(), options, app_baked)
+          || (app_baked != baked))
+      {
+        std::cout << "Pipeline mismatch: " << path.string() << std::endl;
+        errors += 1;
+      }
+    }
+
+    auto out = output_path.empty() ? path : (boost::filesystem::path(output_path) / path.filename());
+    out = ngs::BakedMesh::bakedPath(out.string());
+    {
+      std::ofstream fstr(out.string(), std::ios::binary);
+      fstr.write(baked.data(), baked.size());
+      if (!fstr)
+      {
+        std::cout << "Write error: " << out.string() << std::endl;
+        errors += 1;
+        continue;
+      }
+    }
+
+    // 読み戻して調べる
+    std::string data;
+    ngs::BakedMesh::Header header;
+    bool valid = false;
+    auto t_load = measure([&]()
+                          {
+                            valid = readFile(out.string(), data)
+                                    && ngs::BakedMesh::validate(data.data(), data.size(), header);
+                          });
+    if (!valid || (header.vertex_num != mesh.positions.size()) || (header.index_num != mesh.indices.size()))
+    {
+      std::cout << "Verify error: " << out.string() << std::endl;
+      errors += 1;
+      continue;
+    }
+
+    std::vector<uint32_t> indices(header.index_num);
+    ngs::BakedMesh::readIndices(data.data(), header, indices.data());
+    if (indices != mesh.indices) errors += 1;
+
+    float pos_error = 0.0f;
+    float nrm_error = 0.0f;
+    bool color_error = false;
+    for (uint32_t i = 0; i < header.vertex_num; ++i)
+    {
+      ngs::BakedMesh::Vertex vertex;
+      std::memcpy(&vertex, data.data() + header.vertex_offset + i * header.stride, sizeof(vertex));
+
+      float normal[3];
+      ngs::BakedMesh::unpackNormal(vertex.normal, normal);
+      for (int j = 0; j < 3; ++j)
+      {
+        pos_error = std::max(pos_error, std::abs(ngs::BakedMesh::fromHalf(vertex.position[j]) - mesh.positions[i][j]));
+        nrm_error = std::max(nrm_error, std::abs(normal[j] - mesh.normals[i][j]));
+        if (vertex.color[j] != ngs::BakedMesh::packColor(mesh.colors[i][j])) color_error = true;
+      }
+    }
+
+    // NOTICE 位置はhalf floatの精度(仮数10bit)、法線は10bitの精度に収まる事
+    float extent = 0.0f;
+    for (int j = 0; j < 3; ++j)
+    {
+      extent = std::max({ extent, std::abs(header.bounds_min[j]), std::abs(header.bounds_max[j]) });
+    }
+    if ((pos_error > (extent / 1024.0f)) || (nrm_error > (1.0f / 511.0f)) || color_error) errors += 1;
+
+    // TIPS ci::TriMesh は位置・色・法線を全てfloatで持つ
+    size_t mesh_bytes = source.positions.size() * sizeof(float) * 9 + source.indices.size() * sizeof(uint32_t);
+    total_mesh_bytes  += mesh_bytes;
+    total_baked_bytes += baked.size();
+    total_faces[0] += source.indices.size() / 3;
+    total_faces[1] += mesh.indices.size() / 3;
+    total_transformed[0] += acmr[0] * (source.indices.size() / 3);
+    total_transformed[1] += acmr[1] * (mesh.indices.size() / 3);
+    total_build += t_build;
+    total_load  += t_load;
+
+    std::cout << std::left << std::setw(12) << path.filename().string() << std::right
+              << std::setw(7) << (source.indices.size() / 3) << " ->" << std::setw(6) << (mesh.indices.size() / 3)
+              << std::setw(7) << source.positions.size() << " ->" << std::setw(6) << header.vertex_num
+              << std::setw(6) << acmr[0] << " ->" << std::setw(5) << acmr[1]
+              << std::setw(6) << overdraw[0] << " ->" << std::setw(5) << overdraw[1]
+              << std::setw(13) << (baked.size() / 1024.0) << std::endl;
+  }
+
+  std::cout << "total" << std::setw(14) << total_faces[0] << " ->" << std::setw(6) << total_faces[1] << std::endl
+            << "transformed vertices: " << std::setprecision(0) << total_transformed[0]
+            << " -> " << total_transformed[1] << std::setprecision(2) << std::endl
+            << "size: " << (total_mesh_bytes / 1024.0) << "KB -> " << (total_baked_bytes / 1024.0) << "KB" << std::endl
+            << "parse+weld: " << (total_build * 1e3) << "ms  load baked: " << (total_load * 1e3) << "ms" << std::endl;
+
+  std::cout << "errors: " << errors << std::endl;
+  if (errors > 0)
+  {
+    std::cout << "NG" << std::endl;
+    return 1;
+  }
+}
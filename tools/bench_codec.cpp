@@ -0,0 +1,300 @@
+﻿//
+// TextCodecの圧縮/伸長の速さを測るやつ
+//   以前の実装(呼ぶたびにz_streamを作り、8KBのバッファから少しずつinsert、
+//   ファイルは1文字ずつ読む)と比べる
+//   ゲーム記録くらいの小さなデータと、アーカイブくらいの大きなデータで測る
+//   圧縮率ごとの大きさと、途中で切れたデータを読めない事も調べる
+//
+//   ./bench_codec [-f params.json] [-n 記録数] [-d 作業ディレクトリ]
+//
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include "GameCore.hpp"
+#include "LoadParams.hpp"
+#include "RecordJson.hpp"
+#include "Measure.hpp"
+
+
+// 以前の実装
+namespace legacy {
+
+enum {
+  OUTBUFSIZ = 1024 * 8,
+};
+
+std::string encode(const std::string& input)
+{
+  z_stream z;
+  z.zalloc = Z_NULL;
+  z.zfree  = Z_NULL;
+  z.opaque = Z_NULL;
+  deflateInit(&z, Z_DEFAULT_COMPRESSION);
+
+  z.next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.c_str()));
+  z.avail_in = static_cast<unsigned int>(input.size());
+
+  Bytef outbuf[OUTBUFSIZ];
+  z.next_out  = outbuf;
+  z.avail_out = OUTBUFSIZ;
+
+  std::string output;
+  while (1)
+  {
+    int status = deflate(&z, Z_FINISH);
+    if ((z.avail_out == 0) || (status == Z_STREAM_END))
+    {
+      u_int count = OUTBUFSIZ - z.avail_out;
+      output.insert(output.end(), &outbuf[0], &outbuf[count]);
+      if (status == Z_STREAM_END) break;
+
+      z.next_out  = outbuf;
+      z.avail_out = OUTBUFSIZ;
+    }
+  }
+  deflateEnd(&z);
+
+  return output;
+}
+
+std::string decode(const std::string& input)
+{
+  z_stream z;
+  z.zalloc = Z_NULL;
+  z.zfree  = Z_NULL;
+  z.opaque = Z_NULL;
+  inflateInit(&z);
+
+  z.next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.c_str()));
+  z.avail_in = static_cast<unsigned int>(input.size());
+
+  Bytef outbuf[OUTBUFSIZ];
+  z.next_out  = outbuf;
+  z.avail_out = OUTBUFSIZ;
+
+  std::string output;
+  while (1)
+  {
+    int status = inflate(&z, Z_NO_FLUSH);
+    if (status != Z_OK && status != Z_STREAM_END)
+    {
+      inflateEnd(&z);
+      return std::string();
+    }
+
+    if ((z.avail_out == 0) || (status == Z_STREAM_END))
+    {
+      u_int count = OUTBUFSIZ - z.avail_out;
+      output.insert(output.end(), &outbuf[0], &outbuf[count]);
+      if (status == Z_STREAM_END) break;
+
+      z.next_out  = outbuf;
+      z.avail_out = OUTBUFSIZ;
+    }
+  }
+  inflateEnd(&z);
+
+  return output;
+}
+
+std::string load(const std::string& path)
+{
+  std::ifstream fstr(path, std::ios::binary);
+  std::string input((std::istreambuf_iterator<char>(fstr)),
+                    std::istreambuf_iterator<char>());
+  return decode(input);
+}
+
+}
+
+
+int main(int argc, char* argv[])
+{
+  std::string params_path = "assets/params.json";
+  size_t num_records = 2000;
+  std::string dir = "/tmp";
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if ((i + 1) >= argc)
+    {
+      std::cout << "Missing value: " << arg << std::endl;
+      return 1;
+    }
+
+    std::string value = argv[++i];
+    if (arg == "-f")      params_path = value;
+    else if (arg == "-n") num_records = std::stoul(value);
+    else if (arg == "-d") dir         = value;
+    else
+    {
+      std::cout << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  const auto panels = ngs::createPanels();
+  ngs::ScoreParams params;
+  if (!loadScoreParams(params_path, params))
+  {
+    std::cout << "NG" << std::endl;
+    return 1;
+  }
+  ngs::prepareScoreTable(params, panels.size());
+
+  // ゲーム記録
+  std::vector<std::string> records(num_records);
+  for (size_t i = 0; i < num_records; ++i)
+  {
+    RecordCore core(panels, params, uint32_t(i));
+    playRandomGame(core, panels, uint32_t(i));
+    records[i] = core.serialize();
+  }
+  // アーカイブ程度の大きなデータ
+  std::string archive;
+  for (size_t i = 0; (i < records.size()) && (archive.size() < 1024 * 1024 * 4); ++i)
+  {
+    archive += records[i];
+  }
+
+  size_t errors = 0;
+  std::cout << std::fixed << std::setprecision(1);
+
+  // 小さなデータ(記録ごと)
+  {
+    std::vector<std::string> encoded(num_records);
+    auto t_enc = measure([&]()
+                         {
+                           for (size_t i = 0; i < num_records; ++i) encoded[i] = ngs::TextCodec::encode(records[i]);
+                         });
+    auto t_dec = measure([&]()
+                         {
+                           for (size_t i = 0; i < num_records; ++i)
+                           {
+                             if (ngs::TextCodec::decode(encoded[i]) != records[i]) errors += 1;
+                           }
+                         });
+    auto t_legacy_enc = measure([&]()
+                                {
+                                  for (size_t i = 0; i < num_records; ++i) encoded[i] = legacy::encode(records[i]);
+                                });
+    auto t_legacy_dec = measure([&]()
+                                {
+                                  for (size_t i = 0; i < num_records; ++i)
+                                  {
+                                    if (legacy::decode(encoded[i]) != records[i]) errors += 1;
+                                  }
+                                });
+
+    std::cout << num_records << " records (" << (archive.size() / 1024) << " KB archive)" << std::endl
+              << "record         encode(us)  decode(us)" << std::endl
+              << "  legacy     " << std::setw(12) << (t_legacy_enc * 1e6 / num_records)
+              << std::setw(12) << (t_legacy_dec * 1e6 / num_records) << std::endl
+              << "  TextCodec  " << std::setw(12) << (t_enc * 1e6 / num_records)
+              << std::setw(12) << (t_dec * 1e6 / num_records) << std::endl;
+  }
+
+  // 大きなデータ(ファイル経由)
+  {
+    auto path = dir + "/bench_codec.data";
+    const int repeat = 10;
+    double mb = archive.size() * double(repeat) / (1024 * 1024);
+
+    std::string loaded;
+    auto t_legacy_write = measure([&]()
+                                  {
+                                    for (int i = 0; i < repeat; ++i)
+                                    {
+                                      auto data = legacy::encode(archive);
+                                      std::ofstream fstr(path, std::ios::binary);
+                                      fstr << data;
+                                    }
+                                  });
+    auto t_legacy_load = measure([&]()
+                                 {
+                                   for (int i = 0; i < repeat; ++i) loaded = legacy::load(path);
+                                 });
+    if (loaded != archive) errors += 1;
+
+    auto t_write = measure([&]()
+                           {
+                             for (int i = 0; i < repeat; ++i) ngs::TextCodec::write(path, archive);
+                           });
+    auto t_load = measure([&]()
+                          {
+                            for (int i = 0; i < repeat; ++i) loaded = ngs::TextCodec::load(path);
+                          });
+    if (loaded != archive) errors += 1;
+
+    std::cout << "archive        write(MB/s)  load(MB/s)" << std::endl
+              << "  legacy     " << std::setw(12) << (mb / t_legacy_write)
+              << std::setw(12) << (mb / t_legacy_load) << std::endl
+              << "  TextCodec  " << std::setw(12) << (mb / t_write)
+              << std::setw(12) << (mb / t_load) << std::endl;
+
+    // 途中で切れたファイル
+    auto data = ngs::TextCodec::encode(archive);
+    {
+      std::ofstream fstr(path, std::ios::binary);
+      fstr.write(data.data(), data.size() / 2);
+    }
+    if (!ngs::TextCodec::load(path).empty()) errors += 1;
+    if (!ngs::TextCodec::decode(data.substr(0, data.size() - 1)).empty()) errors += 1;
+    if (!ngs::TextCodec::decode("").empty()) errors += 1;
+    std::remove(path.c_str());
+  }
+
+  // 圧縮率
+  std::cout << "level          bytes  encode(MB/s)" << std::endl;
+  for (int level : { 1, 6, 9 })
+  {
+    std::string data;
+    ngs::TextCodec::Encoder encoder(level);
+    auto t = measure([&]()
+                     {
+                       for (int i = 0; i < 10; ++i)
+                       {
+                         data.clear();
+                         encoder.encode(archive.data(), archive.size(), data);
+                       }
+                     });
+    if (ngs::TextCodec::decode(data) != archive) errors += 1;
+
+    std::cout << "  " << level << std::setw(17) << data.size()
+              << std::setw(14) << (archive.size() * 10.0 / (1024 * 1024) / t) << std::endl;
+  }
+
+  // 少しずつ圧縮/伸長しても同じ結果になるか
+  {
+    ngs::TextCodec::Encoder encoder;
+    std::string data;
+    encoder.begin();
+    for (size_t i = 0; i < archive.size(); i += 1000)
+    {
+      encoder.write(archive.data() + i, std::min(size_t(1000), archive.size() - i), data);
+    }
+    encoder.finish(data);
+
+    ngs::TextCodec::Decoder decoder;
+    std::string text;
+    decoder.begin();
+    auto state = ngs::TextCodec::Decoder::CONTINUE;
+    for (size_t i = 0; (i < data.size()) && (state == ngs::TextCodec::Decoder::CONTINUE); i += 777)
+    {
+      state = decoder.write(data.data() + i, std::min(size_t(777), data.size() - i), text);
+    }
+    if ((state != ngs::TextCodec::Decoder::FINISHED) || (text != archive)) errors += 1;
+  }
+
+  std::cout << "errors: " << errors << std::endl;
+  if (errors > 0)
+  {
+    std::cout << "NG" << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,205 @@
+﻿//
+// パネルの置ける場所の判定速度を比べるやつ
+//   canPutPanel を全パネル×４回転で呼ぶ場合と、EdgeMatcher でまとめて調べる場合
+//   自動プレイで作った盤面の全ての空き地で調べる
+//
+//   ./bench_edge [盤面数] [繰り返し回数]
+//
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include "GameCore.hpp"
+
+
+// 適当に置いていって途中の盤面を集める
+std::vector<ngs::Field> createFields(const std::vector<ngs::Panel>& panels, int num)
+{
+  ngs::ScoreParams params{ { 1.0f, 1.0f }, { 1, 1, 1, 1, 1, 1 }, 1.0f, { 1.0f, 1.0f, 1.0f } };
+
+  std::vector<ngs::Field> fields;
+  for (uint32_t seed = 0; int(fields.size()) < num; ++seed)
+  {
+    std::mt19937 engine(seed);
+    ngs::GameCore core(panels, params, seed);
+    core.preparationPanel();
+    if (!core.putFirstPanel()) continue;
+
+    // どこまで置いた盤面を使うか
+    std::uniform_int_distribution<int> stop_dist(1, int(panels.size()));
+    int stop = stop_dist(engine);
+    for (int n = 0; n < stop; ++n)
+    {
+      const auto& panel = panels[core.getHandPanel()];
+      std::vector<std::pair<glm::ivec2, u_int>> moves;
+      for (const auto& pos : core.getBlankPositions())
+      {
+        for (u_int r = 0; r < 4; ++r)
+        {
+          if (ngs::canPutPanel(panel, pos, r, core.getField())) moves.emplace_back(pos, r);
+        }
+      }
+
+      std::uniform_int_distribution<size_t> dist(0, moves.size() - 1);
+      const auto& move = moves[dist(engine)];
+      while (core.getHandRotation() != move.second) core.rotationHandPanel();
+      if (!core.putHandPanel(move.first)) break;
+    }
+
+    fields.push_back(core.getField());
+  }
+
+  return fields;
+}
+
+
+template <typename F>
+double measure(int repeat, F func)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i)
+  {
+    func();
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+int main(int argc, char* argv[])
+{
+  int num_fields = (argc > 1) ? std::stoi(argv[1]) : 200;
+  int repeat     = (argc > 2) ? std::stoi(argv[2]) : 20;
+
+  const auto panels = ngs::createPanels();
+  const auto fields = createFields(panels, num_fields);
+  const u_int num_panels = u_int(panels.size());
+
+  ngs::EdgeMatcher matcher(panels);
+
+  size_t num_blanks = 0;
+  std::vector<ngs::EdgeMatcher::Blank> blanks;
+  for (const auto& field : fields)
+  {
+    num_blanks += field.getBlankPositions().size();
+    for (const auto& pos : field.getBlankPositions())
+    {
+      blanks.push_back(ngs::EdgeMatcher::getBlank(pos, field));
+    }
+  }
+
+  // 結果が一致するか確認
+  {
+    std::vector<uint8_t> rotations;
+    std::vector<uint8_t> rotations_scalar;
+    size_t index = 0;
+    size_t mismatch = 0;
+    for (const auto& field : fields)
+    {
+      for (const auto& pos : field.getBlankPositions())
+      {
+        matcher.match(blanks[index], rotations);
+        matcher.matchScalar(blanks[index], rotations_scalar);
+        for (u_int i = 0; i < num_panels; ++i)
+        {
+          for (u_int r = 0; r < 4; ++r)
+          {
+            bool expected = ngs::canPutPanel(panels[i], pos, r, field);
+            if (expected != bool(rotations[i] & (1 << r))) mismatch += 1;
+            if (expected != bool(rotations_scalar[i] & (1 << r))) mismatch += 1;
+          }
+          if (rotations[i] != matcher.matchRotations(i, blanks[index])) mismatch += 1;
+        }
+        ++index;
+      }
+    }
+    if (mismatch > 0)
+    {
+      std::cout << "Mismatch: " << mismatch << std::endl;
+      return 1;
+    }
+  }
+
+#if defined (NGS_EDGE_AVX2)
+  std::cout << "kernel: AVX2" << std::endl;
+#elif defined (NGS_EDGE_SSE2)
+  std::cout << "kernel: SSE2" << std::endl;
+#else
+  std::cout << "kernel: scalar" << std::endl;
+#endif
+  std::cout << fields.size() << " fields, " << num_blanks << " blanks, " << num_panels << " panels" << std::endl;
+
+  size_t found = 0;
+  std::vector<uint8_t> rotations;
+
+  // これまでの判定
+  auto t_put = measure(repeat,
+                       [&]()
+                       {
+                         for (const auto& field : fields)
+                         {
+                           for (const auto& pos : field.getBlankPositions())
+                           {
+                             for (u_int i = 0; i < num_panels; ++i)
+                             {
+                               for (u_int r = 0; r < 4; ++r)
+                               {
+                                 if (ngs::canPutPanel(panels[i], pos, r, field)) found += 1;
+                               }
+                             }
+                           }
+                         }
+                       });
+
+  // 空き地の周囲を調べてからまとめて判定
+  auto t_blank = measure(repeat,
+                         [&]()
+                         {
+                           for (const auto& field : fields)
+                           {
+                             for (const auto& pos : field.getBlankPositions())
+                             {
+                               matcher.match(ngs::EdgeMatcher::getBlank(pos, field), rotations);
+                               found += rotations[0];
+                             }
+                           }
+                         });
+
+  // 判定部分のみ
+  auto t_scalar = measure(repeat,
+                          [&]()
+                          {
+                            for (const auto& blank : blanks)
+                            {
+                              matcher.matchScalar(blank, rotations);
+                              found += rotations[0];
+                            }
+                          });
+
+  auto t_simd = measure(repeat,
+                        [&]()
+                        {
+                          for (const auto& blank : blanks)
+                          {
+                            matcher.match(blank, rotations);
+                            found += rotations[0];
+                          }
+                        });
+
+  double pairs = double(num_blanks) * num_panels * 4 * repeat / 1000000.0;
+  auto report = [pairs](const std::string& name, double t)
+                {
+                  std::cout << std::setw(20) << name << ": "
+                            << std::fixed << std::setprecision(3) << t << " sec  "
+                            << std::setprecision(1) << (pairs / t) << " M pairs/sec" << std::endl;
+                };
+  report("canPutPanel", t_put);
+  report("getBlank + match", t_blank);
+  report("matchScalar", t_scalar);
+  report("match", t_simd);
+
+  // 最適化で消されないように
+  std::cout << "(" << found << ")" << std::endl;
+}
@@ -0,0 +1,156 @@
+﻿//
+// Fieldのパネル検索速度を比べるやつ
+//   std::map と ChunkedGrid で同じ検索を行って時間を計る
+//
+//   c++ -std=c++14 -O2 -I<glmのパス> bench_field.cpp -o bench_field
+//   ./bench_field [パネル数] [繰り返し回数]
+//
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <random>
+#include <chrono>
+#include <glm/glm.hpp>
+#include "../src/ChunkedGrid.hpp"
+
+
+struct Status
+{
+  glm::ivec2 position;
+  int number;
+  unsigned int rotation;
+  uint64_t edge;
+};
+
+struct Less
+{
+  bool operator()(const glm::ivec2& lhs, const glm::ivec2& rhs) const noexcept
+  {
+    if (lhs.x < rhs.x) return true;
+    if (lhs.x > rhs.x) return false;
+    return lhs.y < rhs.y;
+  }
+};
+
+
+// 実際のゲームと同じように、既存のパネルの隣へ置いていく
+std::vector<glm::ivec2> createField(int num, std::mt19937& engine)
+{
+  static const glm::ivec2 offsets[] = {
+    {  0,  1 },
+    {  1,  0 },
+    {  0, -1 },
+    { -1,  0 },
+  };
+
+  std::set<glm::ivec2, Less> placed{ { 0, 0 } };
+  std::vector<glm::ivec2> positions{ { 0, 0 } };
+
+  while (int(positions.size()) < num)
+  {
+    std::uniform_int_distribution<size_t> dist_pos(0, positions.size() - 1);
+    std::uniform_int_distribution<int> dist_ofs(0, 3);
+
+    auto p = positions[dist_pos(engine)] + offsets[dist_ofs(engine)];
+    if (placed.insert(p).second)
+    {
+      positions.push_back(p);
+    }
+  }
+
+  return positions;
+}
+
+// canPutPanelとisPanelAroundPosと同じ調べ方
+template <typename T>
+uint64_t lookup(const T& container, const std::vector<glm::ivec2>& queries)
+{
+  static const glm::ivec2 offsets[] = {
+    {  0,  1 },
+    {  1,  1 },
+    {  1,  0 },
+    {  1, -1 },
+    {  0, -1 },
+    { -1, -1 },
+    { -1,  0 },
+    { -1,  1 },
+  };
+
+  uint64_t sum = 0;
+  for (const auto& pos : queries)
+  {
+    for (const auto& ofs : offsets)
+    {
+      auto p = pos + ofs;
+      if (!container.count(p)) continue;
+
+      sum += container.at(p).edge;
+    }
+  }
+  return sum;
+}
+
+template <typename T>
+double measure(const std::string& name, const T& container,
+               const std::vector<glm::ivec2>& queries, int repeat)
+{
+  uint64_t sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i)
+  {
+    sum += lookup(container, queries);
+  }
+  std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
+  double num = double(queries.size()) * 8 * repeat;
+  double rate = num / duration.count() / 1000000.0;
+  std::cout << name << ": " << duration.count() << " sec. "
+            << rate << " M lookups/sec."
+            << " (" << sum << ")" << std::endl;
+
+  return rate;
+}
+
+
+int main(int argc, char* argv[])
+{
+  int panel_num = (argc > 1) ? std::stoi(argv[1]) : 72;
+  int repeat    = (argc > 2) ? std::stoi(argv[2]) : 20000;
+
+  std::mt19937 engine(1);
+  auto positions = createField(panel_num, engine);
+
+  std::map<glm::ivec2, Status, Less> map_field;
+  ngs::ChunkedGrid<Status> grid_field;
+  for (const auto& p : positions)
+  {
+    Status status{ p, int(map_field.size()), 0, uint64_t(map_field.size()) };
+    map_field.emplace(p, status);
+    grid_field.emplace(p, status);
+  }
+
+  // パネルのある場所と、その周囲全部を調べる
+  std::set<glm::ivec2, Less> query_set;
+  for (const auto& p : positions)
+  {
+    for (int y = -1; y <= 1; ++y)
+    {
+      for (int x = -1; x <= 1; ++x)
+      {
+        query_set.insert(p + glm::ivec2(x, y));
+      }
+    }
+  }
+  std::vector<glm::ivec2> queries(std::begin(query_set), std::end(query_set));
+  std::shuffle(std::begin(queries), std::end(queries), engine);
+
+  std::cout << panel_num << " panels. " << queries.size() << " positions." << std::endl;
+
+  auto map_rate  = measure("std::map   ", map_field, queries, repeat);
+  auto grid_rate = measure("ChunkedGrid", grid_field, queries, repeat);
+
+  std::cout << "x" << grid_rate / map_rate << std::endl;
+}
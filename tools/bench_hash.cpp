@@ -0,0 +1,226 @@
+﻿//
+// 盤面のハッシュ値と置換表を調べるやつ
+//   自動プレイで作った途中の盤面全てについて
+//     ・置くたびに更新したハッシュ値が、盤面全体から計算し直した値と一致するか
+//     ・違う盤面で同じハッシュ値にならないか(衝突率)
+//     ・置換表に入れた盤面がどのくらい上書きされずに残るか
+//   置換表の読み書きの速さを、スレッド数を変えて測る
+//
+//   ./bench_hash [ゲーム数] [置換表の大きさ(bit数)] [スレッド数]
+//
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <random>
+#include <atomic>
+#include <thread>
+#include "GameCore.hpp"
+#include "TranspositionTable.hpp"
+#include "Measure.hpp"
+
+
+// 並び順によらない盤面の内容
+std::string describeField(const ngs::Field& field)
+{
+  auto panels = field.enumeratePanels();
+  std::sort(std::begin(panels), std::end(panels),
+            [](const ngs::PanelStatus& a, const ngs::PanelStatus& b)
+            {
+              return ngs::LessVec<glm::ivec2>()(a.position, b.position);
+            });
+
+  std::ostringstream str;
+  for (const auto& p : panels)
+  {
+    str << p.position.x << ',' << p.position.y << ':' << p.number << ':' << p.edge << ';';
+  }
+  return str.str();
+}
+
+// 盤面全体から計算し直す
+uint64_t calcHash(const ngs::Field& field)
+{
+  uint64_t hash = 0;
+  for (const auto& pos : field.getPanelPositions())
+  {
+    const auto& status = field.getPanelStatus(pos);
+    hash ^= ngs::Field::hashPanel(pos, status.number, status.edge);
+  }
+  return hash;
+}
+
+
+// 適当に置いていって、途中の盤面を全て集める
+std::vector<ngs::Field> createFields(const std::vector<ngs::Panel>& panels, int num_games)
+{
+  ngs::ScoreParams params{ { 1.0f, 1.0f }, { 1, 1, 1, 1, 1, 1 }, 1.0f, { 1.0f, 1.0f, 1.0f } };
+
+  std::vector<ngs::Field> fields;
+  for (int game = 0; game < num_games; ++game)
+  {
+    std::mt19937 engine(game);
+    ngs::GameCore core(panels, params, game);
+    core.preparationPanel();
+    bool has_next = core.putFirstPanel();
+    fields.push_back(core.getField());
+
+    while (has_next)
+    {
+      const auto& panel = panels[core.getHandPanel()];
+      std::vector<std::pair<glm::ivec2, u_int>> moves;
+      for (const auto& pos : core.getBlankPositions())
+      {
+        for (u_int r = 0; r < 4; ++r)
+        {
+          if (ngs::canPutPanel(panel, pos, r, core.getField())) moves.emplace_back(pos, r);
+        }
+      }
+
+      std::uniform_int_distribution<size_t> dist(0, moves.size() - 1);
+      const auto& move = moves[dist(engine)];
+      while (core.getHandRotation() != move.second) core.rotationHandPanel();
+      has_next = core.putHandPanel(move.first);
+
+      fields.push_back(core.getField());
+    }
+  }
+
+  return fields;
+}
+
+
+int main(int argc, char* argv[])
+{
+  int num_games      = (argc > 1) ? std::stoi(argv[1]) : 500;
+  u_int table_bits   = (argc > 2) ? std::stoul(argv[2]) : 20;
+  u_int num_threads  = (argc > 3) ? std::stoul(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+
+  const auto panels = ngs::createPanels();
+  const auto fields = createFields(panels, num_games);
+
+  // 置くたびに更新した値と、計算し直した値
+  size_t mismatch = 0;
+  std::vector<uint64_t> hashes;
+  hashes.reserve(fields.size());
+  for (const auto& field : fields)
+  {
+    if (field.getHash() != calcHash(field)) mismatch += 1;
+    hashes.push_back(field.getHash());
+  }
+
+  // 衝突
+  size_t collisions = 0;
+  std::unordered_map<uint64_t, std::string> boards;
+  for (const auto& field : fields)
+  {
+    auto desc = describeField(field);
+    auto result = boards.emplace(field.getHash(), desc);
+    if (!result.second && (result.first->second != desc)) collisions += 1;
+  }
+
+  // 違う盤面だけ残す
+  std::sort(std::begin(hashes), std::end(hashes));
+  hashes.erase(std::unique(std::begin(hashes), std::end(hashes)), std::end(hashes));
+
+  std::cout << fields.size() << " fields, " << hashes.size() << " unique boards" << std::endl
+            << "incremental mismatch: " << mismatch << std::endl
+            << "hash collisions: " << collisions
+            << " (" << std::scientific << std::setprecision(2)
+            << (double(collisions) / std::max(size_t(1), boards.size())) << ")" << std::endl;
+
+  // ハッシュ値の計算
+  uint64_t sum = 0;
+  auto t_full = measure([&]()
+                        {
+                          for (const auto& field : fields) sum ^= calcHash(field);
+                        });
+  auto t_incremental = measure([&]()
+                               {
+                                 for (const auto& field : fields) sum ^= field.getHash();
+                               });
+  std::cout << std::fixed << std::setprecision(1)
+            << "full hash:        " << (t_full * 1e9 / fields.size()) << " ns/board" << std::endl
+            << "incremental hash: " << (t_incremental * 1e9 / fields.size()) << " ns/board" << std::endl;
+
+  // 置換表に全部入れて、残った割合
+  ngs::TranspositionTable table(table_bits);
+  {
+    for (auto h : hashes) table.store(h, ngs::mixBits(h));
+
+    size_t kept = 0;
+    size_t wrong = 0;
+    for (auto h : hashes)
+    {
+      uint64_t value;
+      if (!table.probe(h, value)) continue;
+      if (value == ngs::mixBits(h)) kept += 1;
+      else                          wrong += 1;
+    }
+    std::cout << std::endl
+              << "table: " << table.size() << " entries, "
+              << std::setprecision(2) << (100.0 * hashes.size() / table.size()) << "% load" << std::endl
+              << "kept: " << (100.0 * kept / hashes.size()) << "%  wrong value: " << wrong << std::endl;
+  }
+
+  // 読み書きの速さ
+  // TIPS 値はキーから決まるので、読めた値が違っていたら書き込み途中を読んだ事になる
+  const size_t ops = 4000000;
+  for (u_int threads = 1; threads <= num_threads; threads *= 2)
+  {
+    table.clear();
+    std::atomic<size_t> torn{ 0 };
+    std::atomic<size_t> hits{ 0 };
+
+    auto t = measure([&]()
+                     {
+                       std::vector<std::thread> workers;
+                       for (u_int i = 0; i < threads; ++i)
+                       {
+                         workers.emplace_back([&, i]()
+                                              {
+                                                std::mt19937_64 engine(i);
+                                                std::uniform_int_distribution<size_t> dist(0, hashes.size() - 1);
+                                                size_t local_hits = 0;
+                                                size_t local_torn = 0;
+                                                for (size_t n = 0; n < ops / threads; ++n)
+                                                {
+                                                  auto h = hashes[dist(engine)];
+                                                  uint64_t value;
+                                                  if (table.probe(h, value))
+                                                  {
+                                                    local_hits += 1;
+                                                    if (value != ngs::mixBits(h)) local_torn += 1;
+                                                  }
+                                                  else
+                                                  {
+                                                    table.store(h, ngs::mixBits(h));
+                                                  }
+                                                }
+                                                hits += local_hits;
+                                                torn += local_torn;
+                                              });
+                       }
+                       for (auto& w : workers) w.join();
+                     });
+
+    std::cout << "threads: " << threads
+              << "  " << std::setprecision(1) << (ops / t / 1000000.0) << " M ops/sec"
+              << "  hit: " << std::setprecision(2) << (100.0 * hits / ops) << "%"
+              << "  torn: " << torn << std::endl;
+    if (torn > 0) mismatch += 1;
+  }
+
+  // 最適化で消されないように
+  std::cout << "(" << sum << ")" << std::endl;
+
+  if ((mismatch > 0) || (collisions > 0))
+  {
+    std::cout << "NG" << std::endl;
+    return 1;
+  }
+}
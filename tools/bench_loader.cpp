@@ -0,0 +1,220 @@
+﻿//
+// 起動時の並列読み込み(AssetLoader)の速さを測るやつ
+//   アセットのPLYを全て読み込んで解析(ワーカー)→転送(メインスレッド)→最初のフレーム
+//   という流れをスレッド数を変えて実行し、かかった時間を比べる
+//   結果が１つずつ順番に読んだ時と一致する事、依存する仕事の後に実行される事、
+//   例外を投げた仕事があっても最後まで実行される事も調べる
+//
+//   ./bench_loader [-a アセットのディレクトリ] [-t 最大スレッド数] [-r 繰り返し回数] [-v 1(経過を表示)]
+//
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <boost/filesystem.hpp>
+#include "PLYParser.hpp"
+#include "AssetLoader.hpp"
+
+
+struct Mesh
+{
+  std::vector<float> positions;
+  std::vector<float> colors;
+  std::vector<uint32_t> indices;
+
+  bool operator==(const Mesh& rhs) const noexcept
+  {
+    return (positions == rhs.positions) && (colors == rhs.colors) && (indices == rhs.indices);
+  }
+};
+
+// 読み込みと解析(PLY::load の ci::TriMesh を除いたもの)
+bool loadPly(const std::string& path, Mesh& mesh)
+{
+  std::ifstream fstr(path, std::ios::binary);
+  std::string text((std::istreambuf_iterator<char>(fstr)), std::istreambuf_iterator<char>());
+
+  return ngs::PLYParser::parse(text.data(), text.size(), mesh.positions, mesh.colors, mesh.indices);
+}
+
+// GPUへの転送の代わり
+void upload(const Mesh& mesh, std::vector<char>& buffer)
+{
+  buffer.resize(mesh.positions.size() * sizeof(float)
+                + mesh.colors.size() * sizeof(float)
+                + mesh.indices.size() * sizeof(uint32_t));
+
+  auto* p = buffer.data();
+  std::copy_n(reinterpret_cast<const char*>(mesh.positions.data()), mesh.positions.size() * sizeof(float), p);
+  p += mesh.positions.size() * sizeof(float);
+  std::copy_n(reinterpret_cast<const char*>(mesh.colors.data()), mesh.colors.size() * sizeof(float), p);
+  p += mesh.colors.size() * sizeof(float);
+  std::copy_n(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t), p);
+}
+
+
+int main(int argc, char* argv[])
+{
+  std::string assets_path = "assets";
+  unsigned int max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  int repeat = 5;
+  bool verbose = false;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if ((i + 1) >= argc)
+    {
+      std::cout << "Missing value: " << arg << std::endl;
+      return 1;
+    }
+
+    std::string value = argv[++i];
+    if (arg == "-a")      assets_path = value;
+    else if (arg == "-t") max_threads = unsigned(std::max(std::stoi(value), 1));
+    else if (arg == "-r") repeat      = std::stoi(value);
+    else if (arg == "-v") verbose     = std::stoi(value) != 0;
+    else
+    {
+      std::cout << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<std::string> paths;
+  for (const auto& entry : boost::filesystem::directory_iterator(assets_path))
+  {
+    if (entry.path().extension() == ".ply") paths.push_back(entry.path().string());
+  }
+  std::sort(std::begin(paths), std::end(paths));
+
+  size_t errors = 0;
+
+  // １つずつ順番に読んだ結果
+  std::vector<Mesh> expected(paths.size());
+  for (size_t i = 0; i < paths.size(); ++i)
+  {
+    if (!loadPly(paths[i], expected[i]))
+    {
+      std::cout << "Parse error: " << paths[i] << std::endl;
+      errors += 1;
+    }
+  }
+  std::cout << paths.size() << " files" << std::endl;
+
+  // 起動時の流れ
+  //   解析(ワーカー) → 転送(メインスレッド) → 最初のフレーム(メインスレッド)
+  auto startup = [&](unsigned int threads, bool report)
+                 {
+                   ngs::AssetLoader loader(threads);
+                   std::vector<Mesh> meshes(paths.size());
+                   std::vector<std::vector<char>> buffers(paths.size());
+                   size_t uploaded = 0;
+
+                   std::vector<ngs::AssetLoader::JobId> uploads;
+                   for (size_t i = 0; i < paths.size(); ++i)
+                   {
+                     auto name = boost::filesystem::path(paths[i]).filename().string();
+                     auto parse = loader.add(name,
+                                             [&, i]()
+                                             {
+                                               if (!loadPly(paths[i], meshes[i])) throw std::runtime_error("parse");
+                                             });
+                     uploads.push_back(loader.addMain("upload:" + name,
+                                                      [&, i]()
+                                                      {
+                                                        upload(meshes[i], buffers[i]);
+                                                        uploaded += 1;
+                                                      },
+                                                      { parse }));
+                   }
+                   loader.addMain("first frame", [&]() { if (uploaded != paths.size()) throw std::runtime_error("order"); },
+                                  uploads);
+
+                   auto begin = std::chrono::steady_clock::now();
+                   loader.run();
+                   auto end = std::chrono::steady_clock::now();
+
+                   if (loader.failed())
+                   {
+                     std::cout << "Failed jobs: " << loader.failed() << std::endl;
+                     errors += 1;
+                   }
+                   for (size_t i = 0; i < paths.size(); ++i)
+                   {
+                     if (!(meshes[i] == expected[i]))
+                     {
+                       std::cout << "Mismatch: " << paths[i] << std::endl;
+                       errors += 1;
+                     }
+                   }
+                   if (report) loader.report(std::cout);
+
+                   return std::make_pair(std::chrono::duration<double>(end - begin).count(), loader.work());
+                 };
+
+  // 速さ
+  std::vector<unsigned int> thread_nums;
+  for (unsigned int threads = 1; threads < max_threads; threads *= 2) thread_nums.push_back(threads);
+  thread_nums.push_back(max_threads);
+
+  double single = 0.0;
+  for (auto threads : thread_nums)
+  {
+    double best = 1e9;
+    double work = 0.0;
+    for (int i = 0; i < repeat; ++i)
+    {
+      auto result = startup(threads, false);
+      if (result.first < best)
+      {
+        best = result.first;
+        work = result.second;
+      }
+    }
+    if (threads == 1) single = best;
+
+    std::cout << std::fixed << std::setprecision(2)
+              << std::setw(3) << threads << " threads: "
+              << std::setw(8) << (best * 1e3) << " ms (work " << (work * 1e3) << " ms) x"
+              << (single / best) << std::endl;
+  }
+  if (verbose) startup(max_threads, true);
+
+  // 依存関係と例外
+  {
+    ngs::AssetLoader loader(max_threads);
+    std::vector<int> done(6, 0);
+    auto a = loader.add("a", [&]() { done[0] = 1; });
+    auto b = loader.add("b", [&]() { throw std::runtime_error("b"); });
+    auto c = loader.addMain("c", [&]() { done[2] = done[0]; }, { a });
+    auto d = loader.add("d", [&]() { done[3] = done[2]; }, { b, c });
+    auto e = loader.addMain("e", [&]() { done[4] = done[3]; }, { d });
+    loader.add("f", [&]() { done[5] = done[4]; }, { a, e });
+    loader.run();
+
+    if ((loader.failed() != 1) || (std::count(done.begin() + 2, done.end(), 1) != 4))
+    {
+      std::cout << "Dependency error: failed " << loader.failed() << std::endl;
+      errors += 1;
+    }
+  }
+  {
+    // 仕事が無い
+    ngs::AssetLoader loader(max_threads);
+    loader.run();
+  }
+
+  std::cout << "errors: " << errors << std::endl;
+  if (errors)
+  {
+    std::cout << "NG" << std::endl;
+    return 1;
+  }
+  return 0;
+}
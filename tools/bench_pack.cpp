@@ -0,0 +1,420 @@
+﻿//
+// まとめたファイル(assets.pack)の読み込みの速さを測るやつ
+//   以前の実装(ifstream + std::map、読むたびにseekしてコピー)と
+//   PackedArchive(メモリに割り当て + 索引を二分探索、コピーしない)を比べる
+//   開いて索引を用意するまで、名前で探す、中身を読む をそれぞれ測る
+//   version 2 は無圧縮(CRCを調べる)と、規則のファイルに従って圧縮したもの(伸長する)を測る
+//   途中で切れたり壊れたファイルを開いても範囲外を読まない事、壊れたデータを返さない事も調べる
+//
+//   ./bench_pack [-a アセットのディレクトリ] [-m 規則のファイル] [-d 作業ディレクトリ] [-n 検索回数]
+//
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <cstdio>
+#include "PackWriter.hpp"
+#include "Measure.hpp"
+
+
+// 以前の実装(tools/main.cpp の PackedFile)
+namespace legacy {
+
+struct PackedFile
+{
+  struct Body
+  {
+    uint32_t offset;
+    uint32_t size;
+  };
+
+
+  PackedFile(const std::string& path)
+    : fstr_(path, std::ios::binary)
+  {
+    uint32_t file_num;
+    fstr_.read((char*)&file_num, sizeof(file_num));
+
+    for (uint32_t i = 0; i < file_num; ++i)
+    {
+      uint32_t path_size;
+      fstr_.read((char*)&path_size, sizeof(path_size));
+
+      std::vector<char> path(path_size);
+      fstr_.read(&path[0], path_size);
+
+      uint32_t offset;
+      fstr_.read((char*)&offset, sizeof(offset));
+
+      uint32_t size;
+      fstr_.read((char*)&size, sizeof(size));
+
+      Body body{ offset, size };
+      std::string filename{ std::begin(path), std::end(path) };
+      info_.insert({ filename, body });
+    }
+  }
+
+  bool contains(const std::string& path) const
+  {
+    return info_.count(path) != 0;
+  }
+
+  std::vector<char> read(const std::string& path)
+  {
+    if (!info_.count(path)) return std::vector<char>();
+
+    const auto& body = info_.at(path);
+    fstr_.seekg(body.offset);
+
+    std::vector<char> input(body.size);
+    fstr_.read(input.data(), input.size());
+
+    return input;
+  }
+
+
+private:
+  std::ifstream fstr_;
+  std::map<std::string, Body> info_;
+};
+
+}
+
+
+template <typename T>
+uint32_t checksum(const T& data)
+{
+  uint32_t sum = 0;
+  for (auto c : data) sum = sum * 31 + uint8_t(c);
+  return sum;
+}
+
+
+int main(int argc, char* argv[])
+{
+  std::string assets_path = "assets";
+  std::string rules_path  = "tools/pack.rules";
+  std::string dir = "/tmp";
+  size_t num_lookups = 200000;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if ((i + 1) >= argc)
+    {
+      std::cout << "Missing value: " << arg << std::endl;
+      return 1;
+    }
+
+    std::string value = argv[++i];
+    if (arg == "-a")      assets_path = value;
+    else if (arg == "-m") rules_path  = value;
+    else if (arg == "-d") dir         = value;
+    else if (arg == "-n") num_lookups = std::stoul(value);
+    else
+    {
+      std::cout << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<Rule> rules;
+  if (!loadRules(rules_path, rules)) return 1;
+
+  // TIPS 名前の順に集めるので、規則によらず同じ順番になる
+  auto files        = collectFiles(assets_path);
+  auto files_zlib   = collectFiles(assets_path, rules);
+  auto path         = dir + "/bench_pack.pack";
+  auto path_plain   = dir + "/bench_pack_plain.pack";
+  auto path_v2      = dir + "/bench_pack_v2.pack";
+  auto path_v2_zlib = dir + "/bench_pack_v2_zlib.pack";
+  if (files.empty()
+      || !writePack(files, path) || !writePack(files, path_plain, false)
+      || !writePackV2(files, path_v2) || !writePackV2(files_zlib, path_v2_zlib))
+  {
+    std::cout << "NG" << std::endl;
+    return 1;
+  }
+
+  std::vector<std::string> names;
+  size_t total_size = 0;
+  for (const auto& f : files)
+  {
+    names.push_back(f.name);
+    total_size += f.size;
+  }
+  std::cout << files.size() << " files, " << (total_size / 1024) << " KB" << std::endl;
+
+  size_t errors = 0;
+  std::cout << std::fixed << std::setprecision(2);
+
+  // まとめる速さ
+  {
+    auto pack_path = dir + "/bench_pack_build.pack";
+    std::remove((pack_path + ".manifest").c_str());
+
+    auto t_v1 = measure([&]() { if (!writePack(files_zlib, pack_path)) errors += 1; });
+    auto pack = [&](unsigned int threads, bool incremental, size_t expected_packed)
+                {
+                  PackOptions options;
+                  options.threads     = threads;
+                  options.incremental = incremental;
+                  PackStats stats;
+                  auto t = measure([&]() { if (!writePackV2(files_zlib, pack_path, options, stats)) errors += 1; });
+                  if ((stats.packed != expected_packed) || (verifyPack(files_zlib, pack_path, threads) != 0)) errors += 1;
+                  return t;
+                };
+    auto t_v2_1     = pack(1, false, files_zlib.size());
+    auto t_v2       = pack(std::thread::hardware_concurrency(), false, files_zlib.size());
+    auto t_v2_again = pack(std::thread::hardware_concurrency(), true, 0);
+
+    std::cout << "pack (zlib rules)     (ms)" << std::endl
+              << "  v1 (no zlib)     " << std::setw(10) << (t_v1 * 1e3) << std::endl
+              << "  v2 1 thread      " << std::setw(10) << (t_v2_1 * 1e3) << std::endl
+              << "  v2 " << std::left << std::setw(14) << (std::to_string(std::thread::hardware_concurrency()) + " threads")
+              << std::right << std::setw(10) << (t_v2 * 1e3) << std::endl
+              << "  v2 incremental   " << std::setw(10) << (t_v2_again * 1e3) << std::endl;
+
+    std::remove(pack_path.c_str());
+    std::remove((pack_path + ".manifest").c_str());
+  }
+
+  // 大きさ
+  {
+    std::cout << "size                           (KB)" << std::endl;
+    for (const auto& p : { path, path_v2, path_v2_zlib })
+    {
+      std::cout << "  " << std::left << std::setw(26) << boost::filesystem::path(p).filename().string() << std::right
+                << std::setw(10) << (boost::filesystem::file_size(p) / 1024.0) << std::endl;
+    }
+  }
+
+  // 開いて索引を用意するまで
+  {
+    const int repeat = 200;
+    auto t_legacy = measure([&]()
+                            {
+                              for (int i = 0; i < repeat; ++i)
+                              {
+                                legacy::PackedFile packed(path);
+                                if (!packed.contains(names[0])) errors += 1;
+                              }
+                            });
+    auto t_index = measure([&]()
+                           {
+                             for (int i = 0; i < repeat; ++i)
+                             {
+                               ngs::PackedArchive archive(path);
+                               if (!archive.hasIndex()) errors += 1;
+                             }
+                           });
+    auto t_plain = measure([&]()
+                           {
+                             for (int i = 0; i < repeat; ++i)
+                             {
+                               ngs::PackedArchive archive(path_plain);
+                               if (!archive.isOpen() || archive.hasIndex()) errors += 1;
+                             }
+                           });
+    auto t_v2 = measure([&]()
+                        {
+                          for (int i = 0; i < repeat; ++i)
+                          {
+                            ngs::PackedArchive archive(path_v2);
+                            if ((archive.version() != 2) || !archive.hasIndex()) errors += 1;
+                          }
+                        });
+
+    std::cout << "open                  (us)" << std::endl
+              << "  legacy           " << std::setw(10) << (t_legacy * 1e6 / repeat) << std::endl
+              << "  v1 + index       " << std::setw(10) << (t_index * 1e6 / repeat) << std::endl
+              << "  v1 (no index)    " << std::setw(10) << (t_plain * 1e6 / repeat) << std::endl
+              << "  v2               " << std::setw(10) << (t_v2 * 1e6 / repeat) << std::endl;
+  }
+
+  legacy::PackedFile packed(path);
+  ngs::PackedArchive archive(path);
+  ngs::PackedArchive archive_v2(path_v2);
+  ngs::PackedArchive archive_zlib(path_v2_zlib);
+
+  // 名前で探す
+  {
+    std::mt19937 engine(1);
+    std::uniform_int_distribution<size_t> dist(0, names.size() - 1);
+    std::vector<std::string> queries(num_lookups);
+    for (auto& q : queries)
+    {
+      q = names[dist(engine)];
+    }
+
+    size_t found_legacy = 0;
+    size_t found = 0;
+    size_t found_v2 = 0;
+    auto t_legacy = measure([&]()
+                            {
+                              for (const auto& q : queries) found_legacy += packed.contains(q);
+                            });
+    auto t_find = measure([&]()
+                          {
+                            ngs::PackedArchive::Entry entry;
+                            for (const auto& q : queries) found += archive.find(q, entry);
+                          });
+    auto t_find_v2 = measure([&]()
+                             {
+                               ngs::PackedArchive::Entry entry;
+                               for (const auto& q : queries) found_v2 += archive_v2.find(q, entry);
+                             });
+    if ((found_legacy != num_lookups) || (found != num_lookups) || (found_v2 != num_lookups)) errors += 1;
+
+    std::cout << "lookup                (ns)" << std::endl
+              << "  std::map         " << std::setw(10) << (t_legacy * 1e9 / num_lookups) << std::endl
+              << "  sorted hash v1   " << std::setw(10) << (t_find * 1e9 / num_lookups) << std::endl
+              << "  sorted hash v2   " << std::setw(10) << (t_find_v2 * 1e9 / num_lookups) << std::endl;
+  }
+
+  // 中身を読む
+  {
+    const int repeat = 20;
+    uint32_t sum_legacy = 0;
+    uint32_t sum = 0;
+    uint32_t sum_v2 = 0;
+    uint32_t sum_zlib = 0;
+    auto t_legacy = measure([&]()
+                            {
+                              for (int i = 0; i < repeat; ++i)
+                              {
+                                for (const auto& name : names) sum_legacy += checksum(packed.read(name));
+                              }
+                            });
+    auto t_read = measure([&]()
+                          {
+                            for (int i = 0; i < repeat; ++i)
+                            {
+                              for (const auto& name : names)
+                              {
+                                ngs::PackedArchive::Entry entry;
+                                archive.find(name, entry);
+                                sum += checksum(entry.data);
+                              }
+                            }
+                          });
+    auto t_read_v2 = measure([&]()
+                             {
+                               for (int i = 0; i < repeat; ++i)
+                               {
+                                 for (const auto& name : names)
+                                 {
+                                   ngs::PackedArchive::Entry entry;
+                                   if (!archive_v2.find(name, entry) || !ngs::PackedArchive::verify(entry)) errors += 1;
+                                   sum_v2 += checksum(entry.data);
+                                 }
+                               }
+                             });
+    auto t_read_zlib = measure([&]()
+                               {
+                                 std::string data;
+                                 for (int i = 0; i < repeat; ++i)
+                                 {
+                                   for (const auto& name : names)
+                                   {
+                                     ngs::PackedArchive::Entry entry;
+                                     if (!archive_zlib.find(name, entry) || !ngs::PackedArchive::extract(entry, data)) errors += 1;
+                                     sum_zlib += checksum(data);
+                                   }
+                                 }
+                               });
+    if ((sum_legacy != sum) || (sum_legacy != sum_v2) || (sum_legacy != sum_zlib)) errors += 1;
+
+    double reads = double(repeat) * names.size();
+    double mb    = total_size * double(repeat) / (1024 * 1024);
+    std::cout << "read                  (us/file)   (MB/s)" << std::endl
+              << "  seek + copy      " << std::setw(10) << (t_legacy * 1e6 / reads)
+              << std::setw(12) << (mb / t_legacy) << std::endl
+              << "  span             " << std::setw(10) << (t_read * 1e6 / reads)
+              << std::setw(12) << (mb / t_read) << std::endl
+              << "  v2 span + crc    " << std::setw(10) << (t_read_v2 * 1e6 / reads)
+              << std::setw(12) << (mb / t_read_v2) << std::endl
+              << "  v2 zlib extract  " << std::setw(10) << (t_read_zlib * 1e6 / reads)
+              << std::setw(12) << (mb / t_read_zlib) << std::endl;
+  }
+
+  // 中身が一致するか
+  for (const auto& name : names)
+  {
+    auto src = packed.read(name);
+    for (const auto* a : { &archive, &archive_v2, &archive_zlib })
+    {
+      ngs::PackedArchive::Entry entry;
+      std::string data;
+      if (!a->find(name, entry) || !ngs::PackedArchive::extract(entry, data)
+          || !std::equal(std::begin(src), std::end(src), std::begin(data), std::end(data))) errors += 1;
+    }
+  }
+  // データの先頭がページ境界に揃っているか
+  for (const auto& f : files)
+  {
+    if ((f.offset % 4096) != 0) errors += 1;
+  }
+  {
+    ngs::PackedArchive::Entry entry;
+    if (archive.find("not_found.json", entry) || archive_v2.find("not_found.json", entry)) errors += 1;
+  }
+
+  // 途中で切れたファイル、壊れたファイル
+  // NOTICE 範囲外を指すファイルは見つからない扱い、CRCが違うファイルは読めない
+  for (const auto& p : { path, path_v2, path_v2_zlib })
+  {
+    std::ifstream fstr(p, std::ios::binary);
+    std::string whole((std::istreambuf_iterator<char>(fstr)), std::istreambuf_iterator<char>());
+    auto cut_path = dir + "/bench_pack_cut.pack";
+
+    std::mt19937 engine(2);
+    std::vector<std::string> broken;
+    for (size_t size : { size_t(0), size_t(3), size_t(100), whole.size() / 2, whole.size() - 1 })
+    {
+      broken.push_back(whole.substr(0, size));
+    }
+    for (int i = 0; i < 20; ++i)
+    {
+      broken.push_back(whole);
+      broken.back()[engine() % whole.size()] ^= 0x40;
+    }
+
+    for (const auto& data : broken)
+    {
+      {
+        std::ofstream out(cut_path, std::ios::binary);
+        out.write(data.data(), data.size());
+      }
+      ngs::PackedArchive cut(cut_path);
+      for (const auto& name : names)
+      {
+        ngs::PackedArchive::Entry entry;
+        std::string extracted;
+        if (!cut.find(name, entry) || !ngs::PackedArchive::extract(entry, extracted)) continue;
+
+        // NOTICE version 1 はCRCが無いので、壊れたデータを返してしまう
+        if (cut.version() == 1) continue;
+        auto src = packed.read(name);
+        if (!std::equal(std::begin(src), std::end(src), std::begin(extracted), std::end(extracted))) errors += 1;
+      }
+    }
+    std::remove(cut_path.c_str());
+  }
+  std::remove(path.c_str());
+  std::remove(path_plain.c_str());
+  std::remove(path_v2.c_str());
+  std::remove(path_v2_zlib.c_str());
+
+  std::cout << "errors: " << errors << std::endl;
+  if (errors > 0)
+  {
+    std::cout << "NG" << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,378 @@
+﻿//
+// PLYの解析の速さを測るやつ
+//   以前の実装(istringstreamで１行ずつ読み、splitで分けてstof/stoul)と
+//   PLYParser(ascii と binary_little_endian)を比べ、結果が完全に一致する事も調べる
+//   operator new を置き換えて、解析中の割り当て回数も数える
+//
+//   ./bench_ply [-a アセットのディレクトリ] [-r 繰り返し回数]
+//
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <boost/filesystem.hpp>
+#include "PLYParser.hpp"
+#include "MappedFile.hpp"
+#include "CountAlloc.hpp"
+#include "Measure.hpp"
+
+
+struct Mesh
+{
+  std::vector<float> positions;
+  std::vector<float> colors;
+  std::vector<uint32_t> indices;
+
+  void clear() noexcept
+  {
+    positions.clear();
+    colors.clear();
+    indices.clear();
+  }
+
+  bool operator==(const Mesh& rhs) const noexcept
+  {
+    // NOTICE floatの == ではなくビット単位で比べる
+    auto same = [](const std::vector<float>& a, const std::vector<float>& b)
+                {
+                  return (a.size() == b.size())
+                         && (std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0);
+                };
+    return same(positions, rhs.positions) && same(colors, rhs.colors) && (indices == rhs.indices);
+  }
+};
+
+
+// 以前の実装(PLY::load から ci::TriMesh を除いたもの)
+namespace legacy {
+
+std::vector<std::string> split(const std::string& text) noexcept
+{
+  std::istringstream line_separater(text);
+  const char delimiter = ' ';
+
+  std::vector<std::string> split_text;
+  while (!line_separater.eof())
+  {
+    std::string separated_string;
+    std::getline(line_separater, separated_string, delimiter);
+    split_text.push_back(separated_string);
+  }
+
+  return split_text;
+}
+
+void load(const std::string& str, Mesh& mesh)
+{
+  std::istringstream iss(str);
+
+  int vertex_num = 0;
+  int face_num = 0;
+
+  // ヘッダ解析
+  while (!iss.eof())
+  {
+    std::string line_buffer;
+    std::getline(iss, line_buffer);
+
+    auto split_text = split(line_buffer);
+    if (split_text[0] == "element" && split_text[1] == "vertex")
+    {
+      vertex_num = std::stoi(split_text[2]);
+    }
+    else if (split_text[0] == "element" && split_text[1] == "face")
+    {
+      face_num = std::stoi(split_text[2]);
+    }
+    else if (split_text[0] == "end_header")
+    {
+      break;
+    }
+  }
+
+  for (int i = 0; i < vertex_num; ++i)
+  {
+    std::string line_buffer;
+    std::getline(iss, line_buffer);
+    auto split_text = split(line_buffer);
+
+    mesh.positions.push_back(std::stof(split_text[0]));
+    mesh.positions.push_back(std::stof(split_text[1]));
+    mesh.positions.push_back(std::stof(split_text[2]));
+
+    mesh.colors.push_back(std::stof(split_text[3]) / 255.0f);
+    mesh.colors.push_back(std::stof(split_text[4]) / 255.0f);
+    mesh.colors.push_back(std::stof(split_text[5]) / 255.0f);
+  }
+
+  for (int i = 0; i < face_num; ++i)
+  {
+    std::string line_buffer;
+    std::getline(iss, line_buffer);
+    auto split_text = split(line_buffer);
+
+    switch (std::stoi(split_text[0]))
+    {
+    case 3:
+      {
+        uint32_t v0 = uint32_t(std::stoul(split_text[1]));
+        uint32_t v1 = uint32_t(std::stoul(split_text[2]));
+        uint32_t v2 = uint32_t(std::stoul(split_text[3]));
+        mesh.indices.insert(mesh.indices.end(), { v0, v1, v2 });
+      }
+      break;
+
+    case 4:
+      {
+        uint32_t v0 = uint32_t(std::stoul(split_text[1]));
+        uint32_t v1 = uint32_t(std::stoul(split_text[2]));
+        uint32_t v2 = uint32_t(std::stoul(split_text[3]));
+        uint32_t v3 = uint32_t(std::stoul(split_text[4]));
+        mesh.indices.insert(mesh.indices.end(), { v0, v1, v2 });
+        mesh.indices.insert(mesh.indices.end(), { v0, v2, v3 });
+      }
+      break;
+    }
+  }
+}
+
+}
+
+
+// binary_little_endian で書き出す(比較用)
+// TIPS 面は全て三角形にする
+std::string toBinary(const Mesh& mesh)
+{
+  uint32_t vertex_num = uint32_t(mesh.positions.size() / 3);
+  uint32_t face_num   = uint32_t(mesh.indices.size() / 3);
+
+  std::ostringstream header;
+  header << "ply\n"
+         << "format binary_little_endian 1.0\n"
+         << "comment bench_ply\n"
+         << "element vertex " << vertex_num << "\n"
+         << "property float x\n"
+         << "property float y\n"
+         << "property float z\n"
+         << "property uchar red\n"
+         << "property uchar green\n"
+         << "property uchar blue\n"
+         << "element face " << face_num << "\n"
+         << "property list uchar int vertex_index\n"
+         << "end_header\n";
+
+  std::string data = header.str();
+  for (uint32_t i = 0; i < vertex_num; ++i)
+  {
+    data.append(reinterpret_cast<const char*>(&mesh.positions[i * 3]), sizeof(float) * 3);
+    for (int j = 0; j < 3; ++j)
+    {
+      data.push_back(char(uint8_t(std::lround(mesh.colors[i * 3 + j] * 255.0f))));
+    }
+  }
+  for (uint32_t i = 0; i < face_num; ++i)
+  {
+    data.push_back(3);
+    data.append(reinterpret_cast<const char*>(&mesh.indices[i * 3]), sizeof(uint32_t) * 3);
+  }
+
+  return data;
+}
+
+
+int main(int argc, char* argv[])
+{
+  std::string assets_path = "assets";
+  int repeat = 5;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if ((i + 1) >= argc)
+    {
+      std::cout << "Missing value: " << arg << std::endl;
+      return 1;
+    }
+
+    std::string value = argv[++i];
+    if (arg == "-a")      assets_path = value;
+    else if (arg == "-r") repeat      = std::stoi(value);
+    else
+    {
+      std::cout << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<std::string> paths;
+  for (const auto& entry : boost::filesystem::directory_iterator(assets_path))
+  {
+    if (entry.path().extension() == ".ply") paths.push_back(entry.path().string());
+  }
+  std::sort(std::begin(paths), std::end(paths));
+
+  // 全てメモリに読んでおく
+  std::vector<std::string> texts;
+  std::vector<std::string> binaries;
+  size_t errors = 0;
+  size_t total_vertices = 0;
+  size_t text_bytes = 0;
+  size_t binary_bytes = 0;
+  for (const auto& path : paths)
+  {
+    std::ifstream fstr(path, std::ios::binary);
+    texts.emplace_back((std::istreambuf_iterator<char>(fstr)), std::istreambuf_iterator<char>());
+
+    Mesh legacy_mesh;
+    Mesh mesh;
+    Mesh binary_mesh;
+    legacy::load(texts.back(), legacy_mesh);
+    binaries.push_back(toBinary(legacy_mesh));
+    if (!ngs::PLYParser::parse(texts.back().data(), texts.back().size(), mesh.positions, mesh.colors, mesh.indices)
+        || !ngs::PLYParser::parse(binaries.back().data(), binaries.back().size(),
+                                  binary_mesh.positions, binary_mesh.colors, binary_mesh.indices)
+        || !(mesh == legacy_mesh) || !(binary_mesh == legacy_mesh))
+    {
+      std::cout << "Mismatch: " << path << std::endl;
+      errors += 1;
+    }
+
+    total_vertices += legacy_mesh.positions.size() / 3;
+    text_bytes     += texts.back().size();
+    binary_bytes   += binaries.back().size();
+  }
+  std::cout << paths.size() << " files, " << total_vertices << " vertices, "
+            << (text_bytes / 1024) << " KB (ascii) " << (binary_bytes / 1024) << " KB (binary)" << std::endl;
+
+  // 解析
+  {
+    Mesh mesh;
+    auto run = [&](const std::vector<std::string>& sources, bool use_legacy, size_t& allocs)
+               {
+                 allocs = 0;
+                 return measure([&]()
+                                {
+                                  for (int i = 0; i < repeat; ++i)
+                                  {
+                                    for (const auto& source : sources)
+                                    {
+                                      // TIPS 書き込み先は使い回す(割り当ては解析で起きた分だけになる)
+                                      mesh.clear();
+                                      size_t before = allocations;
+                                      if (use_legacy)
+                                      {
+                                        legacy::load(source, mesh);
+                                      }
+                                      else if (!ngs::PLYParser::parse(source.data(), source.size(),
+                                                                      mesh.positions, mesh.colors, mesh.indices))
+                                      {
+                                        errors += 1;
+                                      }
+                                      allocs += allocations - before;
+                                    }
+                                  }
+                                });
+               };
+
+    size_t legacy_allocs;
+    size_t ascii_allocs;
+    size_t binary_allocs;
+    auto t_legacy = run(texts, true, legacy_allocs);
+    // NOTICE 一番大きなファイルの分を確保済みにしてから測る
+    run(texts, false, ascii_allocs);
+    auto t_ascii  = run(texts, false, ascii_allocs);
+    auto t_binary = run(binaries, false, binary_allocs);
+    if ((ascii_allocs != 0) || (binary_allocs != 0)) errors += 1;
+
+    double vertices = double(total_vertices) * repeat;
+    double loads    = double(paths.size()) * repeat;
+    std::cout << std::fixed << std::setprecision(2)
+              << "parse              Mvertices/s     MB/s   allocs/file" << std::endl
+              << "  legacy         " << std::setw(12) << (vertices / t_legacy / 1e6)
+              << std::setw(10) << (text_bytes * double(repeat) / (1024 * 1024) / t_legacy)
+              << std::setw(14) << (legacy_allocs / loads) << std::endl
+              << "  ascii          " << std::setw(12) << (vertices / t_ascii / 1e6)
+              << std::setw(10) << (text_bytes * double(repeat) / (1024 * 1024) / t_ascii)
+              << std::setw(14) << (ascii_allocs / loads) << std::endl
+              << "  binary         " << std::setw(12) << (vertices / t_binary / 1e6)
+              << std::setw(10) << (binary_bytes * double(repeat) / (1024 * 1024) / t_binary)
+              << std::setw(14) << (binary_allocs / loads) << std::endl;
+  }
+
+  // ファイルを割り当てて、そのまま解析
+  {
+    Mesh mesh;
+    auto t = measure([&]()
+                     {
+                       for (const auto& path : paths)
+                       {
+                         ngs::MappedFile file(path);
+                         mesh.clear();
+                         if (!ngs::PLYParser::parse(file.data(), file.size(), mesh.positions, mesh.colors, mesh.indices)) errors += 1;
+                       }
+                     });
+    std::cout << "  mmap + ascii   " << std::setw(12) << (total_vertices / t / 1e6) << std::endl;
+  }
+
+  // 壊れたデータ
+  // NOTICE 途中で切れていたらfalse、範囲外は読まない
+  {
+    const auto& text = texts.front();
+    // TIPS 最後の行を丸ごと削ったもの(数値の途中で切れたものは区別できない)
+    size_t last_line = text.rfind('\n', text.size() - 2) + 1;
+    for (size_t size : { size_t(0), size_t(4), size_t(100), text.size() / 2, last_line })
+    {
+      Mesh mesh;
+      // TIPS 終端の無い領域に置く(範囲外を読んだらsanitizerで分かる)
+      std::vector<char> data(text.begin(), text.begin() + size);
+      if (ngs::PLYParser::parse(data.data(), data.size(), mesh.positions, mesh.colors, mesh.indices)) errors += 1;
+    }
+    const auto& binary = binaries.front();
+    {
+      Mesh mesh;
+      std::vector<char> data(binary.begin(), binary.end() - 1);
+      if (ngs::PLYParser::parse(data.data(), data.size(), mesh.positions, mesh.colors, mesh.indices)) errors += 1;
+    }
+
+    // 範囲外の頂点番号、数値でない値、余分な属性
+    const char* broken[] = {
+      "ply\nformat ascii 1.0\nelement vertex 1\nproperty float x\nproperty float y\nproperty float z\n"
+      "element face 1\nproperty list uchar int vertex_index\nend_header\n0 0 0\n3 0 0 1\n",
+      "ply\nformat ascii 1.0\nelement vertex 1\nproperty float x\nproperty float y\nproperty float z\n"
+      "end_header\n0 zero 0\n",
+      "ply\nformat binary_big_endian 1.0\nelement vertex 0\nend_header\n",
+    };
+    for (const auto* text : broken)
+    {
+      Mesh mesh;
+      if (ngs::PLYParser::parse(text, std::strlen(text), mesh.positions, mesh.colors, mesh.indices)) errors += 1;
+    }
+
+    const char* extra = "ply\r\nformat ascii 1.0\r\nelement vertex 3\r\nproperty double x\r\nproperty float y\r\n"
+                        "property float z\r\nproperty float nx\r\nproperty float red\r\n"
+                        "element face 1\r\nproperty uchar flags\r\nproperty list uchar uint vertex_indices\r\nend_header\r\n"
+                        "1.5 -2e1 0.125 9 0.5\r\n0 1 2 9 1\r\n3 4 5 9 0\r\n"
+                        "7 4 0 1 2 0\r\n";
+    Mesh mesh;
+    if (!ngs::PLYParser::parse(extra, std::strlen(extra), mesh.positions, mesh.colors, mesh.indices)
+        || (mesh.positions != std::vector<float>{ 1.5f, -20.0f, 0.125f, 0, 1, 2, 3, 4, 5 })
+        || (mesh.colors != std::vector<float>{ 0.5f, 1, 1, 1, 1, 1, 0, 1, 1 })
+        || (mesh.indices != std::vector<uint32_t>{ 0, 1, 2, 0, 2, 0 }))
+    {
+      errors += 1;
+    }
+  }
+
+  std::cout << "errors: " << errors << std::endl;
+  if (errors > 0)
+  {
+    std::cout << "NG" << std::endl;
+    return 1;
+  }
+}
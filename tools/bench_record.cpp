@@ -0,0 +1,170 @@
+﻿//
+// ゲーム記録の保存と読み込みの速さ、大きさを形式ごとに測るやつ
+//   json:   Game::saveと同じJSON。読み込みはGame::loadと同じく完成した区画を記録から読む
+//   zlib:   JSONをTextCodecで圧縮したもの(リリースビルドの形式)
+//   binary: GameRecord。完成した区画は読み込む時に置き直して計算する
+//   読み込んだ結果が元のゲームと一致するかも調べる
+//
+//   ./bench_record [-f params.json] [-n 記録数]
+//
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include "GameCore.hpp"
+#include "LoadParams.hpp"
+#include "RecordJson.hpp"
+#include "Measure.hpp"
+
+
+int main(int argc, char* argv[])
+{
+  std::string params_path = "assets/params.json";
+  size_t num_records = 2000;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if ((i + 1) >= argc)
+    {
+      std::cout << "Missing value: " << arg << std::endl;
+      return 1;
+    }
+
+    std::string value = argv[++i];
+    if (arg == "-f")      params_path = value;
+    else if (arg == "-n") num_records = std::stoul(value);
+    else
+    {
+      std::cout << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  const auto panels = ngs::createPanels();
+  ngs::ScoreParams params;
+  if (!loadScoreParams(params_path, params))
+  {
+    std::cout << "NG" << std::endl;
+    return 1;
+  }
+  ngs::prepareScoreTable(params, panels.size());
+
+  // 元のゲーム
+  std::vector<RecordCore> games;
+  games.reserve(num_records);
+  for (size_t i = 0; i < num_records; ++i)
+  {
+    games.emplace_back(panels, params, uint32_t(i));
+    playRandomGame(games.back(), panels, uint32_t(i));
+  }
+  const double play_time = 123.456;
+
+  // 保存
+  std::vector<std::string> json(num_records);
+  std::vector<std::string> zlib(num_records);
+  std::vector<std::string> binary(num_records);
+  auto t_save_json = measure([&]()
+                             {
+                               for (size_t i = 0; i < num_records; ++i) json[i] = games[i].serialize(play_time);
+                             });
+  auto t_save_zlib = measure([&]()
+                             {
+                               for (size_t i = 0; i < num_records; ++i)
+                               {
+                                 zlib[i] = ngs::TextCodec::encode(games[i].serialize(play_time));
+                               }
+                             });
+  auto t_save_binary = measure([&]()
+                               {
+                                 for (size_t i = 0; i < num_records; ++i)
+                                 {
+                                   auto record = games[i].createRecord();
+                                   record.play_time = play_time;
+                                   binary[i] = record.serialize();
+                                 }
+                               });
+
+  // 読み込み
+  // TIPS 読み込み先は使い回す
+  size_t mismatch = 0;
+  RecordCore core(panels, params, 0);
+  auto loadJson = [&](const std::string& text, size_t i)
+                  {
+                    boost::property_tree::ptree tree;
+                    Record record;
+                    if (!parseJson(text, tree) || !parseRecord(tree, record))
+                    {
+                      mismatch += 1;
+                      return;
+                    }
+                    core.load(record);
+                    if (!core.matchField(games[i])) mismatch += 1;
+                  };
+
+  auto t_load_json = measure([&]()
+                             {
+                               for (size_t i = 0; i < num_records; ++i) loadJson(json[i], i);
+                             });
+  auto t_load_zlib = measure([&]()
+                             {
+                               for (size_t i = 0; i < num_records; ++i) loadJson(ngs::TextCodec::decode(zlib[i]), i);
+                             });
+  auto t_load_binary = measure([&]()
+                               {
+                                 ngs::GameRecord record;
+                                 for (size_t i = 0; i < num_records; ++i)
+                                 {
+                                   if (!record.deserialize(binary[i])
+                                       || (record.play_time != play_time)
+                                       || !core.restoreRecord(record)
+                                       || !core.matchField(games[i])
+                                       || (core.getPlayLog().entries.size() != games[i].getPlayLog().entries.size()))
+                                   {
+                                     mismatch += 1;
+                                   }
+                                 }
+                               });
+
+  // バイナリから復元した完成した区画が元と一致するか
+  for (size_t i = 0; i < num_records; ++i)
+  {
+    boost::property_tree::ptree tree;
+    Record record;
+    ngs::GameRecord game_record;
+    parseJson(json[i], tree);
+    parseRecord(tree, record);
+    game_record.deserialize(binary[i]);
+    core.restoreRecord(game_record);
+    if (!core.matchCompleted(record)) mismatch += 1;
+  }
+
+  auto bytes = [](const std::vector<std::string>& data)
+               {
+                 size_t total = 0;
+                 for (const auto& d : data) total += d.size();
+                 return double(total) / data.size();
+               };
+  auto usec = [num_records](double t)
+              {
+                return t * 1e6 / num_records;
+              };
+
+  std::cout << num_records << " records" << std::endl
+            << "          bytes/record   save(us)   load(us)" << std::endl
+            << std::fixed << std::setprecision(1);
+  std::cout << "json    " << std::setw(14) << bytes(json)
+            << std::setw(11) << usec(t_save_json) << std::setw(11) << usec(t_load_json) << std::endl;
+  std::cout << "zlib    " << std::setw(14) << bytes(zlib)
+            << std::setw(11) << usec(t_save_zlib) << std::setw(11) << usec(t_load_zlib) << std::endl;
+  std::cout << "binary  " << std::setw(14) << bytes(binary)
+            << std::setw(11) << usec(t_save_binary) << std::setw(11) << usec(t_load_binary) << std::endl;
+  std::cout << "mismatch: " << mismatch << std::endl;
+
+  if (mismatch > 0)
+  {
+    std::cout << "NG" << std::endl;
+    return 1;
+  }
+}
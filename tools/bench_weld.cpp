@@ -0,0 +1,234 @@
+﻿//
+// PLY::optimize(同じ頂点をまとめる)の速さを測るやつ
+//   以前の実装(全ての頂点を総当たりで比べ、番号の変換をstd::mapで持つ)と
+//   weldVertices(ハッシュ値で探す)を比べ、結果の索引が完全に一致する事も調べる
+//   PLYの読み込みと法線の計算は PLY::load と同じ事をCinder無しで行う
+//
+//   ./bench_weld [-a アセットのディレクトリ] [-p ファイル名の先頭] [-r 繰り返し回数]
+//
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <limits>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <glm/glm.hpp>
+#include "MeshBaker.hpp"
+#include "Measure.hpp"
+
+
+using Mesh = ngs::MeshBaker::Mesh;
+
+
+// MagicaVoxelから書き出したPLY(ASCII)
+bool loadPly(const std::string& path, Mesh& mesh)
+{
+  std::ifstream fstr(path);
+  if (!fstr.is_open()) return false;
+
+  int vertex_num = 0;
+  int face_num = 0;
+  std::string line;
+  while (std::getline(fstr, line))
+  {
+    std::istringstream sstr(line);
+    std::string word;
+    std::string element;
+    sstr >> word;
+    if (word == "element")
+    {
+      int num;
+      sstr >> element >> num;
+      if (element == "vertex") vertex_num = num;
+      else if (element == "face") face_num = num;
+    }
+    else if (word == "end_header")
+    {
+      break;
+    }
+  }
+
+  for (int i = 0; i < vertex_num; ++i)
+  {
+    glm::vec3 p;
+    float r, g, b;
+    fstr >> p.x >> p.y >> p.z >> r >> g >> b;
+    mesh.positions.push_back(p);
+    mesh.colors.push_back(glm::vec3(r / 255.0f, g / 255.0f, b / 255.0f));
+  }
+  for (int i = 0; i < face_num; ++i)
+  {
+    int num;
+    fstr >> num;
+    std::vector<uint32_t> v(num);
+    for (auto& index : v) fstr >> index;
+
+    // 三角形か四角形のみ
+    for (int j = 1; (j + 1) < num; ++j)
+    {
+      mesh.indices.push_back(v[0]);
+      mesh.indices.push_back(v[j]);
+      mesh.indices.push_back(v[j + 1]);
+    }
+  }
+  if (!fstr) return false;
+
+  ngs::MeshBaker::recalculateNormals(mesh);
+  return true;
+}
+
+
+// 以前の実装
+namespace legacy {
+
+void optimize(const Mesh& mesh, std::vector<uint32_t>& unique, std::vector<uint32_t>& opt_indices)
+{
+  // 頂点索引変換情報
+  std::map<uint32_t, uint32_t> indices;
+
+  const auto& pos    = mesh.positions;
+  const auto& color  = mesh.colors;
+  const auto& normal = mesh.normals;
+
+  unique.clear();
+  uint32_t vertex_num = uint32_t(pos.size());
+  uint32_t index = 0;
+  for (uint32_t i = 0; i < vertex_num; ++i)
+  {
+    for (uint32_t j = 0; j < i; ++j)
+    {
+      if (pos[j] == pos[i]
+          && color[j] == color[i]
+          && normal[j] == normal[i])
+      {
+        // 同じ頂点が見つかった
+        indices.insert({ i, indices.at(j) });
+        goto NEXT;
+      }
+    }
+
+    // 見つからなかった
+    unique.push_back(i);
+    indices.insert({ i, index });
+    ++index;
+  NEXT:
+    ;
+  }
+
+  // 再マップ
+  opt_indices.resize(mesh.indices.size());
+  for (size_t i = 0; i < mesh.indices.size(); ++i)
+  {
+    opt_indices[i] = indices.at(mesh.indices[i]);
+  }
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  std::string assets_path = "assets";
+  std::string prefix = "pa";
+  int repeat = 3;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if ((i + 1) >= argc)
+    {
+      std::cout << "Missing value: " << arg << std::endl;
+      return 1;
+    }
+
+    std::string value = argv[++i];
+    if (arg == "-a")      assets_path = value;
+    else if (arg == "-p") prefix      = value;
+    else if (arg == "-r") repeat      = std::stoi(value);
+    else
+    {
+      std::cout << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<std::string> paths;
+  for (const auto& entry : boost::filesystem::directory_iterator(assets_path))
+  {
+    auto name = entry.path().filename().string();
+    if ((name.compare(0, prefix.size(), prefix) == 0) && (entry.path().extension() == ".ply"))
+    {
+      paths.push_back(entry.path().string());
+    }
+  }
+  std::sort(std::begin(paths), std::end(paths));
+
+  size_t errors = 0;
+  double total_legacy = 0.0;
+  double total_weld = 0.0;
+  std::cout << std::fixed << std::setprecision(2)
+            << "file            vertices     welded  legacy(ms)    weld(ms)" << std::endl;
+  for (const auto& path : paths)
+  {
+    Mesh mesh;
+    if (!loadPly(path, mesh))
+    {
+      std::cout << "File open error:" << path << std::endl;
+      errors += 1;
+      continue;
+    }
+
+    std::vector<uint32_t> legacy_unique;
+    std::vector<uint32_t> legacy_indices;
+    std::vector<uint32_t> unique;
+    std::vector<uint32_t> indices;
+    auto t_legacy = measure([&]()
+                            {
+                              for (int i = 0; i < repeat; ++i) legacy::optimize(mesh, legacy_unique, legacy_indices);
+                            }) / repeat;
+    auto t_weld = measure([&]()
+                          {
+                            for (int i = 0; i < repeat; ++i) ngs::MeshBaker::weldMesh(mesh, unique, indices);
+                          }) / repeat;
+    if ((unique != legacy_unique) || (indices != legacy_indices)) errors += 1;
+
+    total_legacy += t_legacy;
+    total_weld   += t_weld;
+    std::cout << std::left << std::setw(12) << boost::filesystem::path(path).filename().string() << std::right
+              << std::setw(12) << mesh.positions.size()
+              << std::setw(11) << unique.size()
+              << std::setw(12) << (t_legacy * 1e3)
+              << std::setw(12) << (t_weld * 1e3) << std::endl;
+  }
+  std::cout << "total" << std::setw(42) << (total_legacy * 1e3)
+            << std::setw(12) << (total_weld * 1e3) << std::endl;
+
+  // -0.0と0.0、NaNの扱いが総当たりと同じか
+  {
+    float nan = std::numeric_limits<float>::quiet_NaN();
+    Mesh mesh;
+    mesh.positions = { glm::vec3(0.0f), glm::vec3(-0.0f), glm::vec3(nan), glm::vec3(nan), glm::vec3(1.0f), glm::vec3(0.0f) };
+    mesh.colors.assign(mesh.positions.size(), glm::vec3(1.0f));
+    mesh.normals.assign(mesh.positions.size(), glm::vec3(0.0f, 1.0f, 0.0f));
+    mesh.indices = { 0, 1, 2, 3, 4, 5 };
+
+    std::vector<uint32_t> legacy_unique;
+    std::vector<uint32_t> legacy_indices;
+    std::vector<uint32_t> unique;
+    std::vector<uint32_t> indices;
+    legacy::optimize(mesh, legacy_unique, legacy_indices);
+    ngs::MeshBaker::weldMesh(mesh, unique, indices);
+    if ((unique != legacy_unique) || (indices != legacy_indices)) errors += 1;
+  }
+
+  std::cout << "errors: " << errors << std::endl;
+  if (errors > 0)
+  {
+    std::cout << "NG" << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,197 @@
+﻿//
+// パネルを置いた時のメモリ割り当て回数を数えるやつ
+//   operator new を置き換えて回数を数える
+//   ゲームごとに１回遊んで最初の状態へ戻した後(準備運動)は、
+//   パネルを置いても(区画が完成しても)割り当てが無い事を確認する
+//   完成した森や道を調べる処理(CompletionSearch)も割り当てが無い事を確認する
+//   NOTICE パネルを置いた時の確認はリリースビルド(NDEBUG)のみ
+//
+//   ./check_alloc [-f params.json] [-n 試行回数] [-r 準備運動の後に遊ぶ回数] [-s 乱数の種]
+//
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include "GameCore.hpp"
+#include "LoadParams.hpp"
+#include "CountAlloc.hpp"
+
+
+// 完成した区画の数を覗くため
+struct Probe
+  : public ngs::GameCore
+{
+  using GameCore::GameCore;
+
+  size_t completedNum() const noexcept
+  {
+    return completed_forests.size() + completed_path.size() + completed_church.size();
+  }
+
+  const std::vector<std::vector<glm::ivec2>>& getCompleted(u_int attribute) const noexcept
+  {
+    return (attribute == ngs::Panel::FOREST) ? completed_forests : completed_path;
+  }
+};
+
+
+int main(int argc, char* argv[])
+{
+  std::string params_path = "assets/params.json";
+  int num_games = 200;
+  int num_rounds = 2;
+  uint32_t seed = 0;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if ((i + 1) >= argc)
+    {
+      std::cout << "Missing value: " << arg << std::endl;
+      return 1;
+    }
+
+    std::string value = argv[++i];
+    if (arg == "-f")      params_path = value;
+    else if (arg == "-n") num_games   = std::stoi(value);
+    else if (arg == "-r") num_rounds  = std::stoi(value);
+    else if (arg == "-s") seed        = uint32_t(std::stoul(value));
+    else
+    {
+      std::cout << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  const auto panels = ngs::createPanels();
+  ngs::ScoreParams params;
+  if (!loadScoreParams(params_path, params))
+  {
+    std::cout << "NG" << std::endl;
+    return 1;
+  }
+  ngs::prepareScoreTable(params, panels.size());
+
+  // パネルを置いた時の割り当て
+  struct Count
+  {
+    size_t placements = 0;
+    size_t allocations = 0;
+    size_t with_alloc = 0;
+    size_t complete_placements = 0;
+    size_t complete_allocations = 0;
+  };
+  // 準備運動(作ったばかりのゲーム)と、その後
+  Count fresh;
+  Count warm;
+  // 完成判定と得点計算だけの割り当て
+  size_t search_allocations = 0;
+  size_t searches = 0;
+
+  std::vector<std::pair<glm::ivec2, u_int>> moves;
+  moves.reserve(1024);
+
+  for (int game = 0; game < num_games; ++game)
+  {
+    std::mt19937 engine(seed + game);
+    Probe core(panels, params, seed + game);
+    core.preparationPanel();
+    if (!core.putFirstPanel()) continue;
+    const auto start = core.snapshot();
+
+    // NOTICE 作業領域はGameCoreと一緒に確保済み
+    ngs::CompletionSearch search(panels.size());
+
+    for (int round = 0; round <= num_rounds; ++round)
+    {
+      auto& count = (round == 0) ? fresh : warm;
+
+      while (true)
+      {
+        // 置ける場所から適当に選ぶ
+        moves.clear();
+        const auto& panel = panels[core.getHandPanel()];
+        for (const auto& pos : core.getBlankPositions())
+        {
+          for (u_int r = 0; r < 4; ++r)
+          {
+            if (ngs::canPutPanel(panel, pos, r, core.getField())) moves.emplace_back(pos, r);
+          }
+        }
+        std::uniform_int_distribution<size_t> dist(0, moves.size() - 1);
+        auto move = moves[dist(engine)];
+        while (core.getHandRotation() != move.second) core.rotationHandPanel();
+
+        auto completed_num = core.completedNum();
+        size_t before = allocations;
+        bool next = core.putHandPanel(move.first);
+        auto allocated = allocations - before;
+
+        count.placements  += 1;
+        count.allocations += allocated;
+        if (allocated > 0) count.with_alloc += 1;
+        if (core.completedNum() != completed_num)
+        {
+          count.complete_placements  += 1;
+          count.complete_allocations += allocated;
+        }
+
+        // 同じ盤面で完成判定と得点計算だけを行う
+        before = allocations;
+        for (u_int attribute : { ngs::Panel::FOREST, ngs::Panel::PATH })
+        {
+          const auto& completed = core.getCompleted(attribute);
+          search.search(attribute, move.first, core.getField(), panels);
+          search.countTotalAttribute(completed, core.getField());
+          search.countTown(completed, core.getField(), panels);
+          searches += 1;
+        }
+        search_allocations += allocations - before;
+
+        if (!next) break;
+      }
+
+      // 最初の状態へ戻す
+      core.restore(start);
+    }
+  }
+
+  auto print = [](const char* title, const Count& count)
+               {
+                 std::cout << title << count.placements
+                           << "  allocations: " << count.allocations
+                           << "  (placements with allocation: " << count.with_alloc << ")" << std::endl
+                           << "  completion: " << count.complete_placements
+                           << "  allocations: " << count.complete_allocations << std::endl;
+               };
+  print("placements (fresh): ", fresh);
+  print("placements (warm):  ", warm);
+  std::cout << "search: " << searches
+            << "  allocations: " << search_allocations << std::endl;
+
+  size_t errors = 0;
+#if defined (NDEBUG)
+  if (warm.allocations > 0)
+  {
+    std::cout << "putHandPanel allocated after warm-up." << std::endl;
+    errors += 1;
+  }
+#else
+  // NOTICE デバッグビルドはログ出力と総当たりの検算(assert)で割り当てるので調べない
+  std::cout << "putHandPanel is not checked in debug build." << std::endl;
+#endif
+  if (search_allocations > 0)
+  {
+    std::cout << "Search allocated." << std::endl;
+    errors += 1;
+  }
+
+  std::cout << "errors: " << errors << std::endl;
+  if (errors)
+  {
+    std::cout << "NG" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,185 @@
+﻿//
+// ゲーム記録の形式を変換するやつ
+//   JSON形式(平文、TextCodecの圧縮)とバイナリ形式(GameRecord)を相互に変換する
+//   入力はどの形式でも良い。変換前に盤面を置き直して、壊れた記録は書き出さない
+//
+//   ./convert_records [-f params.json] [-o binary|json|zlib] 入力 出力
+//     入力がディレクトリなら、中の game-*.json を全て出力ディレクトリへ同じ名前で書き出す
+//
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include "GameCore.hpp"
+#include "LoadParams.hpp"
+#include "RecordJson.hpp"
+
+
+namespace fs = boost::filesystem;
+
+
+enum Format
+{
+  BINARY,
+  JSON,
+  ZLIB,
+};
+
+
+// 1つ変換する
+// 読めない記録はfalse
+bool convert(const std::string& input, const std::string& output, Format format,
+             RecordCore& core, size_t& input_bytes, size_t& output_bytes)
+{
+  std::string data;
+  if (!readFile(input, data)) return false;
+
+  ngs::GameRecord game_record;
+  if (ngs::GameRecord::isRecord(data))
+  {
+    if (!game_record.deserialize(data)) return false;
+  }
+  else
+  {
+    boost::property_tree::ptree json;
+    Record record;
+    if (!parseJson(decodeText(data), json) || !parseRecord(json, record)) return false;
+    if (!toGameRecord(record, game_record)) return false;
+  }
+  if (!core.rebuild(game_record)) return false;
+
+  std::string converted;
+  switch (format)
+  {
+  case BINARY:
+    converted = core.createRecord().serialize();
+    break;
+
+  case JSON:
+    converted = core.serialize(game_record.play_time);
+    break;
+
+  case ZLIB:
+    converted = ngs::TextCodec::encode(core.serialize(game_record.play_time));
+    break;
+  }
+
+  std::ofstream fstr(output, std::ios::binary);
+  fstr.write(converted.data(), converted.size());
+  if (!fstr) return false;
+
+  input_bytes  += data.size();
+  output_bytes += converted.size();
+  return true;
+}
+
+
+int main(int argc, char* argv[])
+{
+  std::string params_path = "assets/params.json";
+  Format format = BINARY;
+  std::vector<std::string> paths;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg[0] != '-')
+    {
+      paths.push_back(arg);
+      continue;
+    }
+    if ((i + 1) >= argc)
+    {
+      std::cout << "Missing value: " << arg << std::endl;
+      return 1;
+    }
+
+    std::string value = argv[++i];
+    if (arg == "-f")
+    {
+      params_path = value;
+    }
+    else if (arg == "-o")
+    {
+      if (value == "binary")    format = BINARY;
+      else if (value == "json") format = JSON;
+      else if (value == "zlib") format = ZLIB;
+      else
+      {
+        std::cout << "Unknown format: " << value << std::endl;
+        return 1;
+      }
+    }
+    else
+    {
+      std::cout << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (paths.size() != 2)
+  {
+    std::cout << "Usage: convert_records [-f params.json] [-o binary|json|zlib] input output" << std::endl;
+    return 1;
+  }
+
+  const auto panels = ngs::createPanels();
+  ngs::ScoreParams params;
+  if (!loadScoreParams(params_path, params))
+  {
+    std::cout << "NG" << std::endl;
+    return 1;
+  }
+  ngs::prepareScoreTable(params, panels.size());
+  // TIPS restoreRecordは盤面を消してから置き直すので使い回せる
+  RecordCore core(panels, params, 0);
+
+  // 入力と出力の組
+  std::vector<std::pair<std::string, std::string>> files;
+  if (fs::is_directory(paths[0]))
+  {
+    fs::create_directories(paths[1]);
+    for (const auto& entry : fs::directory_iterator(paths[0]))
+    {
+      if (!fs::is_regular_file(entry.status())) continue;
+      auto name = entry.path().filename().string();
+      if ((name.compare(0, 5, "game-") != 0) || (entry.path().extension() != ".json")) continue;
+      files.emplace_back(entry.path().string(), (fs::path(paths[1]) / name).string());
+    }
+    std::sort(std::begin(files), std::end(files));
+  }
+  else
+  {
+    files.emplace_back(paths[0], paths[1]);
+  }
+
+  size_t converted    = 0;
+  size_t input_bytes  = 0;
+  size_t output_bytes = 0;
+  for (const auto& f : files)
+  {
+    if (convert(f.first, f.second, format, core, input_bytes, output_bytes))
+    {
+      converted += 1;
+    }
+    else
+    {
+      std::cout << "broken: " << f.first << std::endl;
+    }
+  }
+
+  std::cout << converted << "/" << files.size() << " records converted"
+            << "  " << input_bytes << " -> " << output_bytes << " bytes";
+  if (converted > 0)
+  {
+    std::cout << std::fixed << std::setprecision(1)
+              << "  (" << (double(input_bytes) / converted)
+              << " -> " << (double(output_bytes) / converted) << " bytes/record)";
+  }
+  std::cout << std::endl;
+
+  return (converted == files.size()) ? 0 : 1;
+}
@@ -1,234 +1,138 @@
 ﻿//
 // ファイルを１つにまとめるやつ
-//   圧縮はしません
+//   サブディレクトリも含めてまとめる
+//   どのファイルをまとめるか、圧縮するかは規則のファイルで決める(tools/pack.rules)
+//   version 2 はデータの先頭をページ境界へ揃え、CRC32を付ける(src/PackedArchive.hpp で読む)
+//   前回から変わっていないファイルは使い回す(-i 0 で全てまとめ直す)
+//   書き出した後は、伸長した結果のハッシュ値を元のファイルのものと比べて検証する
+//
+//   ./pack [-v 1|2] [-m 規則のファイル] [-a 境界] [-t スレッド数] [-i 1|0] dir output
 //
 
 #include <iostream>
-#include <fstream>
 #include <string>
 #include <vector>
-#include <map>
-#include <cassert>
 #include <boost/filesystem.hpp>
+#include "PackWriter.hpp"
+#include "Measure.hpp"
 
 
-bool isHidden(const boost::filesystem::path& p)
-{
-  auto name = p.filename();
-  if(name != ".." &&
-     name != "."  &&
-     name.string()[0] == '.')
-  {
-    return true;
-  }
-
-  return false;
-}
-
-// Packするファイルか??
-//  FIXME ハードコーディング
-bool isPack(const boost::filesystem::path& p)
-{
-  auto name = p.extension();
-  if (name == ".m4a"
-      || name == ".png"
-      || name == ".data")
-  {
-    return false;
-  }
-  
-  return true;
-}
-
-
-// FIXME ファイル上限4GB
-struct File
-{
-  boost::filesystem::path path;
-  // 先頭からのオフセット
-  uint32_t offset;
-  // データサイズ
-  uint32_t size;
-};
-
-// ファイルに書き出す時は
-//
-//   header size 4
-//
-//   path size  4
-//   path       可変
-//   offset     4
-//   size       4
-//
-//   data
-//
-// とする
-
-uint32_t calcHeaderSize(const std::vector<File>& files)
-{
-  uint32_t size = sizeof(uint32_t);
-  for (const auto& f : files)
-  {
-    size += sizeof(uint32_t) * 3;
-    size += f.path.filename().size();
-  }
-
-  return size;
-}
-
-//
-// 実装
-//
-
-struct PackedFile
+int main(int argc, char* argv[])
 {
-  struct Body
-  {
-    uint32_t offset;
-    uint32_t size;
-  };
-
+  int version = 2;
+  PackOptions options;
+  auto rules = defaultRules();
+  std::vector<std::string> paths;
 
-  PackedFile(const std::string& path)
-    : fstr_(path, std::ios::binary)
+  for (int i = 1; i < argc; ++i)
   {
-    // ファイル数
-    uint32_t file_num;
-    fstr_.read((char*)&file_num, sizeof(file_num));
-
-    // ヘッダー解析
-    for (uint32_t i = 0; i < file_num; ++i)
+    std::string arg = argv[i];
+    if (arg[0] != '-')
     {
-      uint32_t path_size;
-      fstr_.read((char*)&path_size, sizeof(path_size));
-
-      std::vector<char> path(path_size);
-      fstr_.read(&path[0], path_size);
-
-      uint32_t offset;
-      fstr_.read((char*)&offset, sizeof(offset));
-
-      uint32_t size;
-      fstr_.read((char*)&size, sizeof(size));
-
-      Body body{ offset, size };
-      std::string filename{ std::begin(path), std::end(path) };
-      info_.insert({ filename, body });
-
-      std::cout << filename << std::endl;
+      paths.push_back(arg);
+      continue;
     }
-  }
-
-  std::vector<char> read(const std::string& path)
-  {
-    if (!info_.count(path))
+    if ((i + 1) >= argc)
     {
-      std::cout << "File not found: " << path << std::endl;
-      return std::vector<char>();
+      std::cout << "Missing value: " << arg << std::endl;
+      return 1;
     }
 
-    const auto& body = info_.at(path);
-    fstr_.seekg(body.offset);
-
-    std::vector<char> input(body.size);
-    fstr_.read(&input[0], input.size());
-
-    return input;
+    std::string value = argv[++i];
+    if (arg == "-v")
+    {
+      version = std::stoi(value);
+      if ((version != 1) && (version != 2))
+      {
+        std::cout << "Unknown version: " << value << std::endl;
+        return 1;
+      }
+    }
+    else if (arg == "-m")
+    {
+      if (!loadRules(value, rules)) return 1;
+    }
+    else if (arg == "-a")
+    {
+      // NOTICE 0 は割り算できない。境界は２のべき乗に限る
+      options.alignment = uint32_t(std::stoul(value));
+      if ((options.alignment == 0) || (options.alignment & (options.alignment - 1)))
+      {
+        std::cout << "Invalid alignment: " << value << std::endl;
+        return 1;
+      }
+    }
+    else if (arg == "-t")
+    {
+      options.threads = unsigned(std::stoul(value));
+    }
+    else if (arg == "-i")
+    {
+      options.incremental = (value != "0");
+    }
+    else
+    {
+      std::cout << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
   }
-
-
-private:
-  // TIPS ファイルは開きっぱなし
-  std::ifstream fstr_;
-  std::map<std::string, Body> info_;
-};
-
-
-int main(int argc, char* argv[])
-{
-  boost::filesystem::path p(argv[1]);
-
-  std::vector<File> files;
-
-  // ファイル情報収拾
-  for (boost::filesystem::directory_entry& x : boost::filesystem::directory_iterator(p))
+  if (paths.size() != 2)
   {
-    if (!isHidden(x.path()) && isPack(x.path()))
-    {
-      files.push_back({
-          x.path(),
-          0,
-          uint32_t(boost::filesystem::file_size(x.path())) });
+    std::cout << "Usage: pack [-v 1|2] [-m rules] [-a alignment] [-t threads] [-i 1|0] dir output" << std::endl;
+    return 1;
+  }
 
-      std::cout << x.path().filename() << std::endl;
-    }
+  boost::filesystem::path p(paths[0]);
+  auto files = collectFiles(p, rules, paths[1]);
+  for (const auto& f : files)
+  {
+    std::cout << f.name << std::endl;
   }
   std::cout << files.size() << " files." << std::endl;
 
-  // ヘッダ情報確定
-  auto header_size = calcHeaderSize(files);
-  auto offset = header_size;
-  for (auto& f : files)
+  bool written = false;
+  PackStats stats;
+  auto t_pack = measure([&]()
+                        {
+                          written = (version == 1) ? writePack(files, paths[1])
+                                                   : writePackV2(files, paths[1], options, stats);
+                        });
+  if (!written)
   {
-    f.offset = offset;
-    offset += f.size;
+    std::cout << "NG" << std::endl;
+    return 1;
   }
-
-
+  if (version == 2)
   {
-    std::fstream file(argv[2], std::ios::binary | std::ios::out);
-
-    // ヘッダ書き出し
-    uint32_t num = files.size();
-    file.write((char*)&num, sizeof(num));
-    for (const auto& f : files)
-    {
-      uint32_t size = f.path.filename().size();
-      file.write((char*)&size, sizeof(size));
-      file.write(f.path.filename().string().c_str(), size);
-
-      file.write((char*)&f.offset, sizeof(f.offset));
-      file.write((char*)&f.size, sizeof(f.size));
-    }
+    std::cout << "unchanged: " << stats.unchanged
+              << "  same content: " << stats.same_content
+              << "  packed: " << stats.packed << std::endl;
+  }
 
-    // ファイル結合
+  // テスト
+  size_t errors = 0;
+  auto t_verify = measure([&]()
+                          {
+                            errors = verifyPack(files, paths[1], options.threads);
+                          });
+  {
+    ngs::PackedArchive archive{ paths[1] };
+    if (!archive.hasIndex() || (archive.version() != version)) errors += 1;
+  }
+  // データの先頭が境界に揃っているか
+  if (version == 2)
+  {
     for (const auto& f : files)
     {
-      std::ifstream fstr(f.path.string(), std::ios::binary);
-      if (!fstr.is_open())
-      {
-        std::cout << "File open error:" << f.path << std::endl;
-        return 0;
-      }
-
-      std::vector<char> input(f.size);
-      fstr.read(&input[0], input.size());
-      file.write(&input[0], input.size());
+      if ((f.offset % options.alignment) != 0) errors += 1;
     }
   }
 
-  // テスト
+  std::cout << "pack: " << t_pack << " sec  verify: " << t_verify << " sec" << std::endl;
+  if (errors > 0)
   {
-    std::cout << "\nTest packed files.\n" << std::endl;
-
-    std::string path{ argv[2] };
-    PackedFile packed{ path };
-
-    // 実際のファイルと比較する
-    for (boost::filesystem::directory_entry& x : boost::filesystem::directory_iterator(p))
-    {
-      if (!isHidden(x.path()) && isPack(x.path()))
-      {
-        std::vector<char> src(boost::filesystem::file_size(x.path()));
-        {
-          std::ifstream fstr(x.path().string(), std::ios::binary);
-          fstr.read(&src[0], src.size());
-        }
-        auto dst = packed.read(x.path().filename().string());
-
-        // TIPS std::vectorの比較
-        assert(src == dst);
-      }
-    }
+    std::cout << "errors: " << errors << std::endl;
+    std::cout << "NG" << std::endl;
+    return 1;
   }
 }
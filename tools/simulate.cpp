@@ -0,0 +1,290 @@
+﻿//
+// ゲームを大量に自動プレイして、得点の分布を調べるやつ
+//   パネルの置き方(ポリシー)を選べる
+//     random : 置ける場所と回転から適当に選ぶ
+//     greedy : 置いた直後の得点が一番高くなる所を選ぶ
+//
+//   ./simulate [-f params.json] [-n 試行回数] [-t スレッド数] [-p random|greedy] [-s 乱数の種] [-v 1]
+//
+//   -v 1 で、全ゲームを操作記録から再現して得点が一致するか調べる
+//        逐次計算した得点と、完成した区画からまとめて計算した得点が一致するかも調べる
+//
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include "GameCore.hpp"
+#include "ThreadPool.hpp"
+#include "LoadParams.hpp"
+#include "Moves.hpp"
+
+
+using Policy = Move (*)(const std::vector<ngs::Panel>& panels, const ngs::GameCore& core, std::mt19937& engine);
+
+
+Move randomPolicy(const std::vector<ngs::Panel>& panels, const ngs::GameCore& core, std::mt19937& engine)
+{
+  auto moves = enumerateMoves(panels, core);
+
+  std::uniform_int_distribution<size_t> dist(0, moves.size() - 1);
+  return moves[dist(engine)];
+}
+
+Move greedyPolicy(const std::vector<ngs::Panel>& panels, const ngs::GameCore& core, std::mt19937& engine)
+{
+  auto moves = enumerateMoves(panels, core);
+  // TIPS 同点の時に先頭ばかり選ばないよう、先に混ぜておく
+  std::shuffle(std::begin(moves), std::end(moves), engine);
+
+  // 複製に置いてみて得点を調べる
+  // TIPS 複製は１回だけ作り、置くたびに元へ戻す
+  auto trial = core;
+  const auto snapshot = trial.snapshot();
+
+  Move best = moves[0];
+  u_int best_score = 0;
+  for (const auto& move : moves)
+  {
+    while (trial.getHandRotation() != move.rotation) trial.rotationHandPanel();
+    trial.putHandPanel(move.pos);
+    trial.calcResults();
+
+    if (trial.getTotalScore() > best_score)
+    {
+      best       = move;
+      best_score = trial.getTotalScore();
+    }
+    trial.restore(snapshot);
+  }
+
+  return best;
+}
+
+
+// １ゲームの結果
+struct Result
+{
+  u_int score   = 0;
+  u_int ranking = 0;
+  u_int panels  = 0;
+  bool perfect  = false;
+  // 操作記録から再現できた
+  bool replayed = true;
+  // 逐次計算とまとめて計算した得点が一致した
+  bool scored = true;
+};
+
+Result playGame(const std::vector<ngs::Panel>& panels, const ngs::ScoreParams& params,
+                Policy policy, uint32_t seed, bool verify)
+{
+  // ポリシー用の乱数はゲーム本体とは別にする
+  std::seed_seq seq{ seed, 1u };
+  std::mt19937 engine(seq);
+
+  ngs::GameCore core(panels, params, seed);
+  core.preparationPanel();
+
+  if (core.putFirstPanel())
+  {
+    while (true)
+    {
+      auto move = policy(panels, core, engine);
+      while (core.getHandRotation() != move.rotation) core.rotationHandPanel();
+      if (!core.putHandPanel(move.pos)) break;
+    }
+  }
+  core.calcResults();
+
+  Result result{ core.getTotalScore(), core.getTotalRanking(), core.getTotalPanels(), core.isPerfect() };
+  if (verify)
+  {
+    result.scored = (core.recalcTotalScore() == result.score);
+
+    // 記録を書き出して読み直したもので再現する
+    ngs::PlayLog log;
+    bool replayed = log.deserialize(core.getPlayLog().serialize());
+    if (replayed)
+    {
+      ngs::GameCore replay(panels, params, log.seed);
+      replayed = ngs::replayPlayLog(replay, log)
+                 && (replay.getTotalScore() == result.score)
+                 && (replay.getTotalPanels() == result.panels);
+    }
+    result.replayed = replayed;
+  }
+
+  return result;
+}
+
+
+// 度数分布を表示
+void printHistogram(const std::string& title, const std::map<u_int, size_t>& counts, size_t total, u_int width)
+{
+  std::cout << title << std::endl;
+
+  size_t max_count = 0;
+  for (const auto& c : counts)
+  {
+    max_count = std::max(max_count, c.second);
+  }
+
+  for (const auto& c : counts)
+  {
+    size_t bar = (max_count > 0) ? (c.second * 50 + max_count - 1) / max_count : 0;
+    std::cout << std::setw(8) << c.first;
+    if (width > 1) std::cout << " - " << std::setw(8) << (c.first + width - 1);
+    std::cout << " " << std::setw(8) << c.second
+              << " (" << std::fixed << std::setprecision(2) << std::setw(6) << (100.0 * c.second / total) << "%) "
+              << std::string(bar, '#') << std::endl;
+  }
+  std::cout << std::endl;
+}
+
+
+int main(int argc, char* argv[])
+{
+  std::string params_path = "assets/params.json";
+  size_t num_games = 10000;
+  unsigned int num_threads = std::thread::hardware_concurrency();
+  std::string policy_name = "random";
+  uint32_t seed = std::random_device()();
+  bool verify = false;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if ((i + 1) >= argc)
+    {
+      std::cout << "Missing value: " << arg << std::endl;
+      return 1;
+    }
+
+    std::string value = argv[++i];
+    if (arg == "-f")      params_path = value;
+    else if (arg == "-n") num_games   = std::stoul(value);
+    else if (arg == "-t") num_threads = std::stoul(value);
+    else if (arg == "-p") policy_name = value;
+    else if (arg == "-s") seed        = std::stoul(value);
+    else if (arg == "-v") verify      = (value != "0");
+    else
+    {
+      std::cout << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  std::map<std::string, Policy> policies = {
+    { "random", randomPolicy },
+    { "greedy", greedyPolicy },
+  };
+  if (!policies.count(policy_name))
+  {
+    std::cout << "Unknown policy: " << policy_name << std::endl;
+    return 1;
+  }
+  auto policy = policies.at(policy_name);
+
+  if (num_games == 0)
+  {
+    std::cout << "No games." << std::endl;
+    return 1;
+  }
+
+  const auto panels = ngs::createPanels();
+  ngs::ScoreParams params;
+  if (!loadScoreParams(params_path, params))
+  {
+    std::cout << "NG" << std::endl;
+    return 1;
+  }
+  // TIPS 得点の表は全ゲームで共有する
+  ngs::prepareScoreTable(params, panels.size());
+
+  std::vector<Result> results(num_games);
+
+  auto start = std::chrono::steady_clock::now();
+  {
+    ngs::ThreadPool pool(num_threads);
+    num_threads = pool.size();
+
+    // TIPS 何ゲームかまとめて１つの仕事にする
+    //      結果はゲームの通し番号の位置へ書くので排他は要らない
+    const size_t chunk = 64;
+    for (size_t begin = 0; begin < num_games; begin += chunk)
+    {
+      size_t end = std::min(begin + chunk, num_games);
+      pool.push([&, begin, end](unsigned int)
+                {
+                  for (size_t i = begin; i < end; ++i)
+                  {
+                    // ゲームごとに乱数の種を変える
+                    results[i] = playGame(panels, params, policy, uint32_t(seed + i), verify);
+                  }
+                });
+    }
+    pool.wait();
+  }
+  auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // 集計
+  u_int min_score = ~0u;
+  u_int max_score = 0;
+  double sum    = 0.0;
+  double sum_sq = 0.0;
+  size_t perfect = 0;
+  size_t mismatch = 0;
+  size_t score_mismatch = 0;
+  for (const auto& r : results)
+  {
+    if (!r.replayed) mismatch += 1;
+    if (!r.scored)   score_mismatch += 1;
+    min_score = std::min(min_score, r.score);
+    max_score = std::max(max_score, r.score);
+    sum    += r.score;
+    sum_sq += double(r.score) * r.score;
+    if (r.perfect) perfect += 1;
+  }
+  double mean   = sum / num_games;
+  double stddev = std::sqrt(std::max(0.0, sum_sq / num_games - mean * mean));
+
+  // 得点はおよそ20段階に分ける
+  u_int score_width = std::max(1u, (max_score - min_score) / 20 + 1);
+  std::map<u_int, size_t> score_counts;
+  std::map<u_int, size_t> ranking_counts;
+  std::map<u_int, size_t> panel_counts;
+  for (const auto& r : results)
+  {
+    score_counts[min_score + (r.score - min_score) / score_width * score_width] += 1;
+    ranking_counts[r.ranking] += 1;
+    panel_counts[r.panels] += 1;
+  }
+
+  std::cout << "policy: " << policy_name
+            << "  games: " << num_games
+            << "  threads: " << num_threads
+            << "  seed: " << seed << std::endl << std::endl;
+
+  printHistogram("Score", score_counts, num_games, score_width);
+  printHistogram("Ranking", ranking_counts, num_games, 1);
+  printHistogram("Panels", panel_counts, num_games, 1);
+
+  std::cout << std::fixed << std::setprecision(2)
+            << "score mean: " << mean << "  stddev: " << stddev
+            << "  min: " << min_score << "  max: " << max_score << std::endl
+            << "perfect: " << (100.0 * perfect / num_games) << "%" << std::endl
+            << "time: " << duration << " sec  "
+            << (num_games / duration) << " games/sec" << std::endl;
+
+  if (verify)
+  {
+    std::cout << "replay mismatch: " << mismatch << " / " << num_games << std::endl
+              << "score mismatch: " << score_mismatch << " / " << num_games << std::endl;
+    if ((mismatch > 0) || (score_mismatch > 0)) return 1;
+  }
+}
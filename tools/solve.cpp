@@ -0,0 +1,519 @@
+﻿//
+// パネルの順番が決まったゲームで、得点の高い置き方を探すやつ
+//   ランキングの基準を決める時の「理論上の最高点」の目安にする
+//     beam : 得点の高い途中の盤面を一定数残しながら、全ての置き方を試す
+//     mcts : モンテカルロ木探索(スレッドごとに木を作り、一番良かった結果を選ぶ)
+//
+//   ./solve [-f params.json] [-s 乱数の種] [-m beam|mcts] [-w ビーム幅] [-c 探索の係数]
+//           [-t スレッド数] [-T 制限時間(秒)] [-N 制限ノード数] [-H 置換表の大きさ(bit数)]
+//
+//   ノードはパネルを１枚置いた盤面１つ
+//   ビームサーチは盤面を複製せず、置いてみては snapshot/restore で元に戻す
+//   違う置き方で同じ盤面になったものは、置換表で見つけて１つだけ調べる
+//   見つけた置き方は、操作記録(16進)でも出力する
+//
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+#include "GameCore.hpp"
+#include "ThreadPool.hpp"
+#include "TranspositionTable.hpp"
+#include "LoadParams.hpp"
+#include "Moves.hpp"
+
+
+// 置いてみる
+// 次のパネルが無ければfalse
+bool applyMove(ngs::GameCore& core, const Move& move)
+{
+  while (core.getHandRotation() != move.rotation) core.rotationHandPanel();
+  return core.putHandPanel(move.pos);
+}
+
+
+// 探索の制限(時間とノード数)
+// TIPS スレッド間で共有する
+class Budget
+{
+public:
+  Budget(double seconds, size_t max_nodes) noexcept
+    : start_(std::chrono::steady_clock::now()),
+      seconds_(seconds),
+      max_nodes_(max_nodes)
+  {}
+
+  bool exhausted() const noexcept
+  {
+    if (max_nodes_ && (nodes_ >= max_nodes_)) return true;
+    return (seconds_ > 0.0) && (elapsed() >= seconds_);
+  }
+
+  void count(size_t nodes) noexcept
+  {
+    nodes_ += nodes;
+  }
+
+  size_t nodes() const noexcept
+  {
+    return nodes_;
+  }
+
+  double elapsed() const noexcept
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+  }
+
+
+private:
+  std::chrono::steady_clock::time_point start_;
+  double seconds_;
+  size_t max_nodes_;
+
+  std::atomic<size_t> nodes_{ 0 };
+};
+
+
+// 見つけた置き方
+struct Solution
+{
+  u_int score = 0;
+  ngs::PlayLog log;
+  bool found = false;
+
+  void update(const ngs::GameCore& core)
+  {
+    if (found && (core.getTotalScore() <= score)) return;
+
+    score = core.getTotalScore();
+    log   = core.getPlayLog();
+    found = true;
+  }
+};
+
+
+// 最初のパネルを置いた盤面
+std::unique_ptr<ngs::GameCore> createRoot(const std::vector<ngs::Panel>& panels, const ngs::ScoreParams& params,
+                                          uint32_t seed, bool& has_next)
+{
+  auto core = std::make_unique<ngs::GameCore>(panels, params, seed);
+  core->preparationPanel();
+  has_next = core->putFirstPanel();
+  core->calcResults();
+
+  return core;
+}
+
+
+// ビームサーチ
+//   手番ごとに全ての置き方を試して、得点の高い方から width 個の盤面を残す
+//   NOTICE 途中の得点はパネル設置数の分も含む(Perfectの倍率は最後の１枚で掛かる)
+//   TIPS 置いた後の盤面のハッシュ値は置く前に分かるので、置換表にあれば置かずに済ませる
+Solution beamSearch(const std::vector<ngs::Panel>& panels, const ngs::ScoreParams& params,
+                    uint32_t seed, size_t width,
+                    ngs::ThreadPool& pool, ngs::TranspositionTable& table,
+                    Budget& budget, size_t& transpositions)
+{
+  // 置き方の候補
+  struct Candidate
+  {
+    size_t parent;
+    Move move;
+    u_int score;
+    bool has_next;
+  };
+
+  Solution best;
+  std::atomic<size_t> found{ 0 };
+
+  bool has_next;
+  std::vector<std::unique_ptr<ngs::GameCore>> beam;
+  beam.push_back(createRoot(panels, params, seed, has_next));
+  if (!has_next)
+  {
+    best.update(*beam[0]);
+    return best;
+  }
+
+  while (!beam.empty())
+  {
+    // TIPS 制限を超えたら幅を１にして、最後まで置いた置き方を必ず作る
+    size_t beam_width = budget.exhausted() ? 1 : width;
+
+    // 盤面ごとに全部置いてみる
+    std::vector<std::vector<Candidate>> candidates(beam.size());
+    for (size_t i = 0; i < beam.size(); ++i)
+    {
+      pool.push([&, i](unsigned int)
+                {
+                  // TIPS 盤面を置いてみては元に戻す(盤面ごとに１つの仕事なので排他は要らない)
+                  auto& parent = *beam[i];
+                  auto moves = enumerateMoves(panels, parent);
+                  const auto snapshot = parent.snapshot();
+
+                  const auto& panel = panels[parent.getHandPanel()];
+                  auto hash = parent.getField().getHash();
+
+                  auto& result = candidates[i];
+                  result.reserve(moves.size());
+                  size_t skipped = 0;
+                  for (const auto& move : moves)
+                  {
+                    // 他の置き方で調べた盤面
+                    uint64_t key = hash ^ ngs::Field::hashPanel(move.pos, parent.getHandPanel(),
+                                                                 panel.getRotatedEdgeValue(move.rotation));
+                    uint64_t value;
+                    if (table.probe(key, value))
+                    {
+                      skipped += 1;
+                      continue;
+                    }
+
+                    bool next = applyMove(parent, move);
+                    assert(parent.getField().getHash() == key);
+                    parent.calcResults();
+                    table.store(key, parent.getTotalScore());
+                    result.push_back({ i, move, parent.getTotalScore(), next });
+                    parent.restore(snapshot);
+                  }
+                  budget.count(moves.size() - skipped);
+                  found += skipped;
+                });
+    }
+    pool.wait();
+
+    // 得点の高い順
+    // TIPS 同点なら先に作った方(スレッド数で結果が変わらないように)
+    std::vector<Candidate> sorted;
+    for (const auto& c : candidates)
+    {
+      sorted.insert(std::end(sorted), std::begin(c), std::end(c));
+    }
+    std::stable_sort(std::begin(sorted), std::end(sorted),
+                     [](const Candidate& a, const Candidate& b)
+                     {
+                       return a.score > b.score;
+                     });
+
+    // 最後まで置いたものは答えの候補
+    // 途中のものは上位だけ次の手番へ
+    std::vector<const Candidate*> selected;
+    for (const auto& c : sorted)
+    {
+      if (!c.has_next)
+      {
+        if (best.found && (c.score <= best.score)) continue;
+
+        auto core = *beam[c.parent];
+        applyMove(core, c.move);
+        core.calcResults();
+        best.update(core);
+      }
+      else if (selected.size() < beam_width)
+      {
+        selected.push_back(&c);
+      }
+    }
+
+    std::vector<std::unique_ptr<ngs::GameCore>> next(selected.size());
+    for (size_t i = 0; i < selected.size(); ++i)
+    {
+      pool.push([&, i](unsigned int)
+                {
+                  const auto& c = *selected[i];
+                  next[i] = std::make_unique<ngs::GameCore>(*beam[c.parent]);
+                  applyMove(*next[i], c.move);
+                });
+    }
+    pool.wait();
+    beam = std::move(next);
+  }
+  transpositions = found;
+
+  return best;
+}
+
+
+// モンテカルロ木探索
+//   選択(UCB1) → 展開(１手) → 最後まで適当に置く → 得点を逆伝播
+//   得点はそれまでの最高点で割って 0〜1 にする
+class TreeSearch
+{
+  struct Node
+  {
+    Move move;
+    Node* parent;
+
+    std::vector<std::unique_ptr<Node>> children;
+    // まだ試していない置き方
+    std::vector<Move> untried;
+    bool expanded = false;
+    // 最後の１枚
+    bool terminal = false;
+
+    u_int visits = 0;
+    double total = 0.0;
+  };
+
+
+public:
+  TreeSearch(const std::vector<ngs::Panel>& panels, const ngs::ScoreParams& params,
+             uint32_t seed, uint32_t worker, double exploration) noexcept
+    : panels_(panels),
+      exploration_(exploration)
+  {
+    // 探索用の乱数はゲーム本体とは別にする
+    std::seed_seq seq{ seed, 2u, worker };
+    engine_.seed(seq);
+
+    bool has_next;
+    root_ = createRoot(panels, params, seed, has_next);
+    root_node_.parent   = nullptr;
+    root_node_.terminal = !has_next;
+    if (!has_next) best_.update(*root_);
+  }
+
+
+  void run(Budget& budget) noexcept
+  {
+    if (root_node_.terminal) return;
+
+    while (!budget.exhausted())
+    {
+      // TIPS 最後まで置くので、戻すよりパネル１枚だけの最初の盤面を複製した方が速い
+      auto core = *root_;
+      Node* node = &root_node_;
+      bool has_next = true;
+      size_t nodes = 0;
+
+      // 選択と展開
+      while (!node->terminal)
+      {
+        if (!node->expanded)
+        {
+          node->untried = enumerateMoves(panels_, core);
+          std::shuffle(std::begin(node->untried), std::end(node->untried), engine_);
+          node->expanded = true;
+        }
+
+        if (!node->untried.empty())
+        {
+          auto move = node->untried.back();
+          node->untried.pop_back();
+          has_next = applyMove(core, move);
+          nodes += 1;
+
+          node->children.push_back(std::make_unique<Node>());
+          auto* child = node->children.back().get();
+          child->move     = move;
+          child->parent   = node;
+          child->terminal = !has_next;
+          node = child;
+          break;
+        }
+
+        node = selectChild(*node);
+        has_next = applyMove(core, node->move);
+        nodes += 1;
+      }
+
+      // 最後まで適当に置く
+      while (has_next)
+      {
+        auto moves = enumerateMoves(panels_, core);
+        std::uniform_int_distribution<size_t> dist(0, moves.size() - 1);
+        has_next = applyMove(core, moves[dist(engine_)]);
+        nodes += 1;
+      }
+      core.calcResults();
+      budget.count(nodes);
+
+      auto score = core.getTotalScore();
+      best_.update(core);
+      max_score_ = std::max(max_score_, score);
+
+      double reward = double(score) / max_score_;
+      for (auto* n = node; n; n = n->parent)
+      {
+        n->visits += 1;
+        n->total  += reward;
+      }
+    }
+  }
+
+  const Solution& getBest() const noexcept
+  {
+    return best_;
+  }
+
+
+private:
+  Node* selectChild(const Node& node) const noexcept
+  {
+    double log_visits = std::log(double(node.visits));
+
+    Node* best = nullptr;
+    double best_value = -1.0;
+    for (const auto& child : node.children)
+    {
+      double value = child->total / child->visits
+                     + exploration_ * std::sqrt(log_visits / child->visits);
+      if (value > best_value)
+      {
+        best       = child.get();
+        best_value = value;
+      }
+    }
+    return best;
+  }
+
+
+  const std::vector<ngs::Panel>& panels_;
+  double exploration_;
+
+  std::mt19937 engine_;
+
+  std::unique_ptr<ngs::GameCore> root_;
+  Node root_node_;
+
+  Solution best_;
+  u_int max_score_ = 1;
+};
+
+
+int main(int argc, char* argv[])
+{
+  std::string params_path = "assets/params.json";
+  uint32_t seed = 0;
+  std::string method = "beam";
+  size_t width = 16;
+  double exploration = 0.2;
+  unsigned int num_threads = std::thread::hardware_concurrency();
+  double seconds = 10.0;
+  size_t max_nodes = 0;
+  u_int table_bits = 20;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if ((i + 1) >= argc)
+    {
+      std::cout << "Missing value: " << arg << std::endl;
+      return 1;
+    }
+
+    std::string value = argv[++i];
+    if (arg == "-f")      params_path = value;
+    else if (arg == "-s") seed        = std::stoul(value);
+    else if (arg == "-m") method      = value;
+    else if (arg == "-w") width       = std::max(size_t(1), size_t(std::stoul(value)));
+    else if (arg == "-c") exploration = std::stod(value);
+    else if (arg == "-t") num_threads = std::stoul(value);
+    else if (arg == "-T") seconds     = std::stod(value);
+    else if (arg == "-N") max_nodes   = std::stoul(value);
+    else if (arg == "-H") table_bits  = std::stoul(value);
+    else
+    {
+      std::cout << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  if ((method != "beam") && (method != "mcts"))
+  {
+    std::cout << "Unknown method: " << method << std::endl;
+    return 1;
+  }
+
+  const auto panels = ngs::createPanels();
+  ngs::ScoreParams params;
+  if (!loadScoreParams(params_path, params))
+  {
+    std::cout << "NG" << std::endl;
+    return 1;
+  }
+  ngs::prepareScoreTable(params, panels.size());
+
+  Budget budget(seconds, max_nodes);
+  Solution best;
+  size_t transpositions = 0;
+  {
+    ngs::ThreadPool pool(num_threads);
+    num_threads = pool.size();
+
+    if (method == "beam")
+    {
+      ngs::TranspositionTable table(table_bits);
+      best = beamSearch(panels, params, seed, width, pool, table, budget, transpositions);
+    }
+    else
+    {
+      // TIPS スレッドごとに別の木を育てる
+      std::vector<std::unique_ptr<TreeSearch>> trees;
+      for (unsigned int i = 0; i < num_threads; ++i)
+      {
+        trees.push_back(std::make_unique<TreeSearch>(panels, params, seed, i, exploration));
+        auto* tree = trees.back().get();
+        pool.push([tree, &budget](unsigned int)
+                  {
+                    tree->run(budget);
+                  });
+      }
+      pool.wait();
+
+      for (const auto& tree : trees)
+      {
+        const auto& s = tree->getBest();
+        if (s.found && (!best.found || (s.score > best.score))) best = s;
+      }
+    }
+  }
+  auto duration = budget.elapsed();
+
+  // 記録から再現して確かめる
+  ngs::GameCore replay(panels, params, seed);
+  bool replayed = best.found
+                  && ngs::replayPlayLog(replay, best.log)
+                  && (replay.getTotalScore() == best.score);
+
+  std::cout << "method: " << method
+            << "  seed: " << seed
+            << "  threads: " << num_threads;
+  if (method == "beam") std::cout << "  width: " << width;
+  else                  std::cout << "  exploration: " << exploration;
+  std::cout << std::endl << std::endl;
+
+  std::cout << "moves:" << std::endl;
+  for (const auto& e : best.log.entries)
+  {
+    std::cout << std::setw(4) << e.panel
+              << "  (" << std::setw(3) << e.pos.x << ", " << std::setw(3) << e.pos.y << ")"
+              << "  rotation: " << e.rotation << std::endl;
+  }
+  std::cout << std::endl;
+
+  std::cout << std::fixed << std::setprecision(2)
+            << "nodes: " << budget.nodes()
+            << "  time: " << duration << " sec  "
+            << std::setprecision(0) << (budget.nodes() / duration) << " nodes/sec";
+  if (method == "beam") std::cout << "  transpositions: " << transpositions;
+  std::cout << std::endl
+            << "best score: " << best.score
+            << "  ranking: " << replay.getTotalRanking()
+            << "  panels: " << best.log.entries.size()
+            << "  perfect: " << (replay.isPerfect() ? "yes" : "no") << std::endl
+            << "play log: " << best.log.toHex() << std::endl;
+
+  if (!replayed)
+  {
+    std::cout << "NG: replay mismatch." << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,321 @@
+﻿//
+// 保存されたゲーム記録をまとめて検証するやつ
+//   ディレクトリ内の game-*.json を全て読み(平文JSON、TextCodecの圧縮、バイナリ形式のどれでも良い)
+//     ・記録の盤面を置いた順番に並べ直し、置けない場所に置いていないか
+//     ・完成した森/道/教会を計算し直し、記録と一致するか(JSON形式のみ)
+//     ・操作記録があれば、乱数の種から再現した盤面と一致するか
+//     ・records.json があれば、記録された得点とランクが計算し直した値と一致するか
+//   を調べて、食い違った記録を理由ごとに報告する
+//
+//   ./verify_records [-f params.json] [-a records.json] [-t スレッド数] ディレクトリ
+//   ./verify_records [-f params.json] -w 記録数 ディレクトリ    検証用の記録を書き出す
+//
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <boost/filesystem.hpp>
+#include "GameCore.hpp"
+#include "ThreadPool.hpp"
+#include "LoadParams.hpp"
+#include "RecordJson.hpp"
+
+
+namespace fs = boost::filesystem;
+
+
+// 検証結果
+enum Verdict
+{
+  OK,
+  // 読めない
+  BROKEN,
+  // 置けない場所に置いている
+  FIELD,
+  // 完成した区画が違う
+  COMPLETED,
+  // 操作記録から再現できない
+  REPLAY,
+  // 得点が違う
+  SCORE,
+
+  VERDICT_NUM
+};
+
+const char* verdictName(Verdict verdict) noexcept
+{
+  static const char* names[] = {
+    "ok",
+    "broken",
+    "field",
+    "completed",
+    "replay",
+    "score",
+  };
+  return names[verdict];
+}
+
+
+// 記録された得点(records.json の "games")
+struct Stored
+{
+  u_int score;
+  u_int rank;
+};
+
+std::map<std::string, Stored> loadArchive(const std::string& path)
+{
+  std::map<std::string, Stored> games;
+
+  boost::property_tree::ptree json;
+  if (!readJson(path, json))
+  {
+    std::cout << "Archive broken: " << path << std::endl;
+    return games;
+  }
+
+  auto child = json.get_child_optional("games");
+  if (!child) return games;
+  for (const auto& g : *child)
+  {
+    // NOTICE 記録を残していない得点もある
+    auto name = g.second.get_optional<std::string>("path");
+    if (!name) continue;
+    games[*name] = { g.second.get<u_int>("score"), g.second.get<u_int>("rank") };
+  }
+  return games;
+}
+
+
+Verdict verifyRecord(const std::string& path, const std::vector<ngs::Panel>& panels,
+                     const ngs::ScoreParams& params, const std::map<std::string, Stored>& archive)
+{
+  std::string data;
+  if (!readFile(path, data)) return BROKEN;
+
+  // JSON形式は記録されていた完成した区画や辺の情報とも比べる
+  bool is_json = !ngs::GameRecord::isRecord(data);
+  Record record;
+  ngs::GameRecord game_record;
+  std::vector<uint64_t> edges;
+  if (is_json)
+  {
+    boost::property_tree::ptree json;
+    if (!parseJson(decodeText(data), json) || !parseRecord(json, record)) return BROKEN;
+    if (!toGameRecord(record, game_record)) return REPLAY;
+
+    for (const auto& status : record.field)
+    {
+      edges.push_back(status.edge);
+    }
+  }
+  else
+  {
+    if (!game_record.deserialize(data)) return BROKEN;
+  }
+
+  RecordCore core(panels, params, 0);
+  if (!core.rebuild(game_record, edges)) return FIELD;
+  if (is_json && !core.matchCompleted(record)) return COMPLETED;
+
+  // NOTICE 古い記録とチュートリアルには操作記録が無い
+  const auto& log = game_record.play_log;
+  if (!log.entries.empty() && !game_record.tutorial)
+  {
+    RecordCore replay(panels, params, log.seed);
+    if (!ngs::replayPlayLog(replay, log) || !core.matchField(replay)) return REPLAY;
+  }
+
+  auto it = archive.find(fs::path(path).filename().string());
+  if (it != archive.end())
+  {
+    if ((it->second.score != core.getTotalScore())
+        || (it->second.rank != core.getTotalRanking())) return SCORE;
+  }
+
+  return OK;
+}
+
+
+// 検証用の記録を適当に遊んで作る
+// TIPS 平文、圧縮、バイナリ形式を順番に書き出す
+int writeRecords(const std::string& dir, size_t num, const std::vector<ngs::Panel>& panels,
+                 const ngs::ScoreParams& params)
+{
+  fs::create_directories(dir);
+
+  std::ostringstream archive;
+  archive << "{\"games\":[";
+  for (size_t i = 0; i < num; ++i)
+  {
+    uint32_t seed = uint32_t(i);
+    RecordCore core(panels, params, seed);
+    playRandomGame(core, panels, seed);
+
+    std::ostringstream name;
+    name << "game-" << std::setw(6) << std::setfill('0') << i << ".json";
+    auto path = (fs::path(dir) / name.str()).string();
+    switch (i % 3)
+    {
+    case 0:
+      {
+        std::ofstream fstr(path, std::ios::binary);
+        fstr << core.serialize();
+      }
+      break;
+
+    case 1:
+      ngs::TextCodec::write(path, core.serialize());
+      break;
+
+    case 2:
+      {
+        std::ofstream fstr(path, std::ios::binary);
+        fstr << core.createRecord().serialize();
+      }
+      break;
+    }
+
+    if (i) archive << ',';
+    archive << "{\"path\":\"" << name.str() << "\""
+            << ",\"score\":" << core.getTotalScore()
+            << ",\"rank\":" << core.getTotalRanking() << '}';
+  }
+  archive << "]}";
+
+  std::ofstream fstr((fs::path(dir) / "records.json").string(), std::ios::binary);
+  fstr << archive.str();
+
+  std::cout << num << " records written to " << dir << std::endl;
+  return 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+  std::string params_path = "assets/params.json";
+  std::string archive_path;
+  unsigned int num_threads = std::thread::hardware_concurrency();
+  size_t write_num = 0;
+  std::string dir;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg[0] != '-')
+    {
+      dir = arg;
+      continue;
+    }
+    if ((i + 1) >= argc)
+    {
+      std::cout << "Missing value: " << arg << std::endl;
+      return 1;
+    }
+
+    std::string value = argv[++i];
+    if (arg == "-f")      params_path  = value;
+    else if (arg == "-a") archive_path = value;
+    else if (arg == "-t") num_threads  = std::stoul(value);
+    else if (arg == "-w") write_num    = std::stoul(value);
+    else
+    {
+      std::cout << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (dir.empty())
+  {
+    std::cout << "No directory." << std::endl;
+    return 1;
+  }
+
+  const auto panels = ngs::createPanels();
+  ngs::ScoreParams params;
+  if (!loadScoreParams(params_path, params))
+  {
+    std::cout << "NG" << std::endl;
+    return 1;
+  }
+  // TIPS 得点の表は全記録で共有する
+  ngs::prepareScoreTable(params, panels.size());
+
+  if (write_num > 0) return writeRecords(dir, write_num, panels, params);
+
+  // 記録の一覧
+  std::vector<std::string> paths;
+  for (const auto& entry : fs::directory_iterator(dir))
+  {
+    if (!fs::is_regular_file(entry.status())) continue;
+    auto name = entry.path().filename().string();
+    if ((name.compare(0, 5, "game-") != 0) || (entry.path().extension() != ".json")) continue;
+    paths.push_back(entry.path().string());
+  }
+  std::sort(std::begin(paths), std::end(paths));
+  if (paths.empty())
+  {
+    std::cout << "No records." << std::endl;
+    return 1;
+  }
+
+  std::map<std::string, Stored> archive;
+  if (!archive_path.empty()) archive = loadArchive(archive_path);
+
+  std::vector<Verdict> verdicts(paths.size());
+
+  auto start = std::chrono::steady_clock::now();
+  {
+    ngs::ThreadPool pool(num_threads);
+    num_threads = pool.size();
+
+    // TIPS 何件かまとめて１つの仕事にする
+    //      結果は記録の通し番号の位置へ書くので排他は要らない
+    const size_t chunk = 32;
+    for (size_t begin = 0; begin < paths.size(); begin += chunk)
+    {
+      size_t end = std::min(begin + chunk, paths.size());
+      pool.push([&, begin, end](unsigned int)
+                {
+                  for (size_t i = begin; i < end; ++i)
+                  {
+                    verdicts[i] = verifyRecord(paths[i], panels, params, archive);
+                  }
+                });
+    }
+    pool.wait();
+  }
+  auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // 集計
+  size_t counts[VERDICT_NUM] = {};
+  for (size_t i = 0; i < paths.size(); ++i)
+  {
+    counts[verdicts[i]] += 1;
+    if (verdicts[i] != OK)
+    {
+      std::cout << verdictName(verdicts[i]) << ": " << paths[i] << std::endl;
+    }
+  }
+
+  std::cout << paths.size() << " records"
+            << "  threads: " << num_threads
+            << "  " << std::fixed << std::setprecision(1) << (paths.size() / duration) << " records/sec"
+            << std::endl;
+  for (int v = 0; v < VERDICT_NUM; ++v)
+  {
+    std::cout << "  " << std::setw(10) << std::left << verdictName(Verdict(v)) << counts[v] << std::endl;
+  }
+  if (!archive.empty())
+  {
+    std::cout << "  (" << archive.size() << " scores in archive)" << std::endl;
+  }
+
+  return (counts[OK] == paths.size()) ? 0 : 1;
+}